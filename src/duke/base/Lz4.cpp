@@ -0,0 +1,146 @@
+#include "Lz4.hpp"
+
+#include <algorithm>
+
+#include <cstdint>
+#include <cstring>
+
+namespace duke {
+
+namespace {
+
+const size_t kMinMatch = 4;
+// The format requires the last bytes of a block to be literals and matches to start earlier than this.
+const size_t kLastLiterals = 5;
+const size_t kMatchFindLimit = 12;
+const size_t kMaxOffset = 65535;
+const int kHashBits = 12;
+// Positions skipped grow by one every that many bytes without a match, incompressible data goes by quickly.
+const int kSkipTrigger = 6;
+
+inline uint32_t read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint64_t read64(const uint8_t* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - kHashBits); }
+
+// First byte differing from the one offset bytes before, pInput to pLimit.
+const uint8_t* findMatchEnd(const uint8_t* pInput, const uint8_t* pLimit, size_t offset) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (; pInput + sizeof(uint64_t) <= pLimit; pInput += sizeof(uint64_t)) {
+    const uint64_t difference = read64(pInput) ^ read64(pInput - offset);
+    if (difference) return pInput + __builtin_ctzll(difference) / 8;
+  }
+#endif
+  while (pInput < pLimit && *pInput == *(pInput - offset)) ++pInput;
+  return pInput;
+}
+
+// Lengths beyond the 15 of a token continue in bytes of 255.
+uint8_t* writeLength(size_t length, uint8_t* pOutput) {
+  for (; length >= 255; length -= 255) *pOutput++ = 255;
+  *pOutput++ = uint8_t(length);
+  return pOutput;
+}
+
+bool readLength(const uint8_t*& pInput, const uint8_t* pInputEnd, size_t& length) {
+  for (;;) {
+    if (pInput == pInputEnd) return false;
+    const uint8_t byte = *pInput++;
+    length += byte;
+    if (byte != 255) return true;
+  }
+}
+
+// Token and literals of a sequence, the match offset and length follow.
+uint8_t* writeLiterals(const uint8_t* pLiterals, size_t literals, size_t matchCode, uint8_t* pOutput) {
+  uint8_t* const pToken = pOutput++;
+  *pToken = uint8_t((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchCode, 15));
+  if (literals >= 15) pOutput = writeLength(literals - 15, pOutput);
+  memcpy(pOutput, pLiterals, literals);
+  return pOutput + literals;
+}
+
+}  // namespace
+
+size_t getLz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+size_t lz4Compress(const char* pSource, size_t size, char* pDestination) {
+  const auto* const pBegin = reinterpret_cast<const uint8_t*>(pSource);
+  const auto* const pEnd = pBegin + size;
+  auto* pOutput = reinterpret_cast<uint8_t*>(pDestination);
+  const uint8_t* pAnchor = pBegin;
+  if (size > kMatchFindLimit) {
+    const uint8_t* const pMatchLimit = pEnd - kLastLiterals;
+    const uint8_t* const pFindLimit = pEnd - kMatchFindLimit;
+    uint32_t table[1 << kHashBits] = {};
+    for (const uint8_t* pInput = pBegin; pInput < pFindLimit;) {
+      const uint32_t sequence = read32(pInput);
+      uint32_t& entry = table[hash(sequence)];
+      const uint8_t* pMatch = pBegin + entry;
+      entry = uint32_t(pInput - pBegin);
+      const size_t offset = pInput - pMatch;
+      if (offset == 0 || offset > kMaxOffset || read32(pMatch) != sequence) {
+        pInput += 1 + ((pInput - pAnchor) >> kSkipTrigger);
+        continue;
+      }
+      while (pInput > pAnchor && pMatch > pBegin && pInput[-1] == pMatch[-1]) --pInput, --pMatch;
+      const uint8_t* const pMatchEnd = findMatchEnd(pInput + kMinMatch, pMatchLimit, offset);
+      const size_t matchCode = pMatchEnd - pInput - kMinMatch;
+      pOutput = writeLiterals(pAnchor, pInput - pAnchor, matchCode, pOutput);
+      *pOutput++ = uint8_t(offset);
+      *pOutput++ = uint8_t(offset >> 8);
+      if (matchCode >= 15) pOutput = writeLength(matchCode - 15, pOutput);
+      pInput = pAnchor = pMatchEnd;
+      // matches often follow each other, the position just before is a likely reference
+      table[hash(read32(pInput - 2))] = uint32_t(pInput - 2 - pBegin);
+    }
+  }
+  pOutput = writeLiterals(pAnchor, pEnd - pAnchor, 0, pOutput);
+  return pOutput - reinterpret_cast<uint8_t*>(pDestination);
+}
+
+bool lz4Decompress(const char* pSource, size_t compressedSize, char* pDestination, size_t size) {
+  const auto* pInput = reinterpret_cast<const uint8_t*>(pSource);
+  const auto* const pInputEnd = pInput + compressedSize;
+  auto* const pBegin = reinterpret_cast<uint8_t*>(pDestination);
+  auto* const pOutputEnd = pBegin + size;
+  auto* pOutput = pBegin;
+  while (pInput < pInputEnd) {
+    const uint8_t token = *pInput++;
+    size_t literals = token >> 4;
+    if (literals == 15 && !readLength(pInput, pInputEnd, literals)) return false;
+    if (literals > size_t(pInputEnd - pInput) || literals > size_t(pOutputEnd - pOutput)) return false;
+    memcpy(pOutput, pInput, literals);
+    pInput += literals;
+    pOutput += literals;
+    if (pInput == pInputEnd) break;  // the last sequence has no match
+    if (pInputEnd - pInput < 2) return false;
+    const size_t offset = pInput[0] | (pInput[1] << 8);
+    pInput += 2;
+    if (offset == 0 || offset > size_t(pOutput - pBegin)) return false;
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(pInput, pInputEnd, matchLength)) return false;
+    matchLength += kMinMatch;
+    if (matchLength > size_t(pOutputEnd - pOutput)) return false;
+    // a match closer than its length repeats a pattern, copies double in size until done
+    const uint8_t* const pMatch = pOutput - offset;
+    while (matchLength > 0) {
+      const size_t chunk = std::min<size_t>(matchLength, pOutput - pMatch);
+      memcpy(pOutput, pMatch, chunk);
+      pOutput += chunk;
+      matchLength -= chunk;
+    }
+  }
+  return pOutput == pOutputEnd;
+}
+
+}  // namespace duke
@@ -0,0 +1,24 @@
+/**
+ * Compression to the LZ4 block format, fast enough to keep up with decoders.
+ * Blocks are interchangeable with the reference implementation's LZ4_compress_default and
+ * LZ4_decompress_safe.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace duke {
+
+// Largest compressed size of size bytes.
+size_t getLz4CompressBound(size_t size);
+
+// Compresses size bytes of pSource to pDestination which must hold getLz4CompressBound(size) bytes.
+// Returns the compressed size.
+size_t lz4Compress(const char* pSource, size_t size, char* pDestination);
+
+// Decompresses compressedSize bytes of pSource to the size bytes of pDestination.
+// Returns false if the block is malformed or doesn't decompress to exactly size bytes.
+bool lz4Decompress(const char* pSource, size_t compressedSize, char* pDestination, size_t size);
+
+}  // namespace duke
@@ -0,0 +1,121 @@
+#include "TaskPool.hpp"
+
+#include "duke/base/Check.hpp"
+
+#include <exception>
+
+namespace duke {
+
+namespace {
+
+struct Batch {
+  std::atomic<size_t> pending;
+  std::mutex mutex;
+  std::condition_variable done;
+  std::exception_ptr exception;
+};
+
+}  // namespace
+
+TaskPool::TaskPool(size_t workers) : m_Queued(0), m_NextQueue(0) {
+  if (workers == 0) workers = 1;
+  for (size_t i = 0; i < workers; ++i) m_Queues.emplace_back(new Queue());
+  for (size_t i = 0; i < workers; ++i) m_Threads.emplace_back(&TaskPool::workerLoop, this, i);
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_WakeMutex);
+    m_Stop = true;
+  }
+  m_Wake.notify_all();
+  for (auto& thread : m_Threads) thread.join();
+}
+
+bool TaskPool::tryPop(size_t index, Task& task) {
+  auto& queue = *m_Queues[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) return false;
+  task = std::move(queue.tasks.front());
+  queue.tasks.pop_front();
+  --m_Queued;
+  return true;
+}
+
+bool TaskPool::trySteal(size_t index, Task& task) {
+  const size_t count = m_Queues.size();
+  for (size_t i = 1; i <= count; ++i) {
+    const size_t victim = (index + i) % count;
+    if (victim == index) continue;
+    auto& queue = *m_Queues[victim];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) continue;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    --m_Queued;
+    return true;
+  }
+  return false;
+}
+
+void TaskPool::workerLoop(size_t index) {
+  Task task;
+  for (;;) {
+    if (tryPop(index, task) || trySteal(index, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_WakeMutex);
+    m_Wake.wait(lock, [this]() { return m_Stop || m_Queued > 0; });
+    if (m_Stop) return;
+  }
+}
+
+void TaskPool::run(std::vector<Task>& tasks) {
+  if (tasks.empty()) return;
+  auto pBatch = std::make_shared<Batch>();
+  pBatch->pending = tasks.size();
+  for (auto& task : tasks) {
+    Task wrapped = [pBatch, task]() {
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(pBatch->mutex);
+        if (!pBatch->exception) pBatch->exception = std::current_exception();
+      }
+      if (--pBatch->pending == 0) {
+        std::lock_guard<std::mutex> lock(pBatch->mutex);
+        pBatch->done.notify_all();
+      }
+    };
+    auto& queue = *m_Queues[m_NextQueue++ % m_Queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(wrapped));
+    ++m_Queued;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_WakeMutex);
+  }
+  m_Wake.notify_all();
+  // Helping the workers while waiting for the batch to complete.
+  // The calling thread owns no queue so it steals from all of them.
+  Task task;
+  while (pBatch->pending > 0) {
+    if (trySteal(m_Queues.size(), task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(pBatch->mutex);
+    pBatch->done.wait(lock, [&pBatch]() { return pBatch->pending == 0; });
+  }
+  if (pBatch->exception) std::rethrow_exception(pBatch->exception);
+}
+
+TaskPool& TaskPool::instance() {
+  static TaskPool pool(std::thread::hardware_concurrency());
+  return pool;
+}
+
+}  // namespace duke
@@ -0,0 +1,63 @@
+/**
+ * A small work stealing thread pool.
+ */
+
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+
+namespace duke {
+
+/**
+ * Every worker owns a deque of tasks, it pops from the front of its own deque
+ * and steals from the back of its siblings' when idle.
+ * The thread calling run() helps executing tasks until its batch is complete
+ * so run() can safely be called from within a task.
+ */
+class TaskPool : public noncopyable {
+ public:
+  typedef std::function<void()> Task;
+
+  explicit TaskPool(size_t workers);
+  ~TaskPool();
+
+  // Executes all tasks and returns once they are all complete.
+  // If a task throws, the first exception is rethrown here.
+  void run(std::vector<Task>& tasks);
+
+  inline size_t workers() const { return m_Threads.size(); }
+
+  // The pool shared by the whole application, one worker per hardware thread.
+  static TaskPool& instance();
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool tryPop(size_t index, Task& task);
+  bool trySteal(size_t index, Task& task);
+  void workerLoop(size_t index);
+
+  std::vector<std::unique_ptr<Queue>> m_Queues;
+  std::vector<std::thread> m_Threads;
+  std::atomic<size_t> m_Queued;
+  std::atomic<size_t> m_NextQueue;
+  std::mutex m_WakeMutex;
+  std::condition_variable m_Wake;
+  bool m_Stop = false;
+};
+
+}  // namespace duke
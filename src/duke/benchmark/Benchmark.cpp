@@ -1,4 +1,5 @@
 #include "Benchmark.hpp"
+#include "UploadAutotune.hpp"
 
 #include "duke/gl/GlFwApp.hpp"
 #include "duke/gl/GL.hpp"
@@ -63,20 +64,23 @@ class PBOUnpack : public SynchronousUnpack {
  public:
   virtual void updateTexture(const TextureConfiguration conf, const glm::uvec2 textureSize, const void* pData,
                              const GLsizeiptr dataSize) {
-    auto pboBound = pbo.scope_bind_buffer();
-    if (firstUpdate) glBufferData(pbo.target, dataSize, 0, pbo.usage);
-    GLubyte* ptr = (GLubyte*)glMapBufferRange(pbo.target, 0, dataSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!pPbo) {
+      pPbo.reset(new GlFencedUploadPbo());
+      pPbo->allocate(dataSize);
+    }
+    pPbo->waitForTransfers();
+    auto pboBound = pPbo->scope_bind_buffer();
+    GLubyte* ptr = (GLubyte*)glMapBufferRange(pPbo->target, 0, dataSize, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
     memcpy(ptr, pData, dataSize);
-    glUnmapBuffer(pbo.target);
+    glUnmapBuffer(pPbo->target);
     glTexSubImage2D(texture.target, 0, 0, 0, textureSize.x, textureSize.y, conf.pixel_format, conf.pixel_type, nullptr);
-    firstUpdate = false;
+    pPbo->fence();
   }
-  virtual void destroy() { firstUpdate = true; }
+  virtual void destroy() { pPbo.reset(); }
   virtual const char* name() const { return "Asynchronous"; }
 
  private:
-  GlStreamUploadPbo pbo;
-  bool firstUpdate = true;
+  unique_ptr<GlFencedUploadPbo> pPbo;
 };
 
 void benchmark() {
@@ -180,6 +184,12 @@ void main() {
       }
     }
   }
+
+  // what the startup autotuner would pick, see --upload-tuning
+  const UploadTuning tuning = measureUploadFormats(1920, 1080, 101);
+  for (const auto& pair : tuning.formats)
+    printf("%15s uploads fastest as %10s %30s\n", getInternalFormatString(pair.first),
+           getPixelFormatString(pair.second.pixelFormat), getPixelTypeString(pair.second.pixelType));
 }
 
 } /* namespace duke */
@@ -0,0 +1,135 @@
+#include "UploadAutotune.hpp"
+
+#include "duke/base/Check.hpp"
+#include "duke/filesystem/FsUtils.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/GlObjects.hpp"
+#include "duke/time/Clock.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace duke {
+
+namespace {
+
+const char kHeader[] = "duke upload formats 1";
+
+// Median time frames take to go from a pixel buffer to a texture stored as internalFormat, a single
+// upload slowed down by the rest of the system does not decide.
+double measureUploads(GLint internalFormat, const UploadFormat& format, unsigned width, unsigned height,
+                      gl::GlFencedUploadPbo& pbo, size_t repetitions) {
+  gl::GlTextureRectangle texture;
+  auto textureBound = texture.scope_bind_texture();
+  glTexImage2D(texture.target, 0, internalFormat, width, height, 0, format.pixelFormat, format.pixelType, nullptr);
+  auto pboBound = pbo.scope_bind_buffer();
+  // the first transfer lets the driver settle the texture storage
+  glTexSubImage2D(texture.target, 0, 0, 0, width, height, format.pixelFormat, format.pixelType, nullptr);
+  glFinish();
+  std::vector<double> seconds;
+  for (size_t i = 0; i < repetitions; ++i) {
+    const auto start = duke_clock::now();
+    glTexSubImage2D(texture.target, 0, 0, 0, width, height, format.pixelFormat, format.pixelType, nullptr);
+    glFinish();
+    seconds.push_back(std::chrono::duration<double>(duke_clock::now() - start).count());
+  }
+  glCheckError();
+  const auto median = seconds.begin() + seconds.size() / 2;
+  std::nth_element(seconds.begin(), median, seconds.end());
+  return *median;
+}
+
+}  // namespace
+
+const std::vector<int>& getTunedInternalFormats() {
+  static const std::vector<int> formats = {GL_RGB8,  GL_RGBA8,  GL_RGB16,  GL_RGBA16,
+                                           GL_RGB16F, GL_RGBA16F, GL_RGB32F, GL_RGBA32F};
+  return formats;
+}
+
+UploadTuning measureUploadFormats(unsigned width, unsigned height, size_t repetitions) {
+  CHECK(repetitions > 0) << "No upload to measure";
+  UploadTuning tuning;
+  tuning.driver = getDriverKey();
+  for (const int internalFormat : getTunedInternalFormats()) {
+    const auto candidates = getUploadFormatCandidates(internalFormat);
+    if (candidates.size() < 2) continue;
+    const auto& reference = candidates.front();
+    const size_t bytes = size_t(width) * height * getBytePerPixels(reference.pixelFormat, reference.pixelType);
+    gl::GlFencedUploadPbo pbo;
+    pbo.allocate(bytes);
+    {  // some drivers shortcut blank buffers
+      auto pboBound = pbo.scope_bind_buffer();
+      auto* pData = static_cast<unsigned char*>(glMapBufferRange(pbo.target, 0, bytes, GL_MAP_WRITE_BIT));
+      if (!pData) continue;  // keeps the default format
+      for (size_t i = 0; i < bytes; ++i) pData[i] = i * 7;
+      glUnmapBuffer(pbo.target);
+    }
+    double fastest = std::numeric_limits<double>::max();
+    for (const auto& candidate : candidates) {
+      const double seconds = measureUploads(internalFormat, candidate, width, height, pbo, repetitions);
+      if (seconds >= fastest) continue;
+      fastest = seconds;
+      tuning.formats[internalFormat] = candidate;
+    }
+  }
+  return tuning;
+}
+
+bool readUploadTuning(const std::string& filename, UploadTuning& tuning) {
+  std::ifstream file(filename);
+  std::string line;
+  if (!std::getline(file, line) || line != kHeader) return false;
+  if (!std::getline(file, tuning.driver)) return false;
+  tuning.formats.clear();
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    int internalFormat = 0;
+    UploadFormat format;
+    if (!(stream >> internalFormat >> format.pixelFormat >> format.pixelType >> format.redBlueSwapped)) return false;
+    const auto candidates = getUploadFormatCandidates(internalFormat);
+    if (std::find(candidates.begin(), candidates.end(), format) == candidates.end()) return false;
+    tuning.formats[internalFormat] = format;
+  }
+  return true;
+}
+
+// Written aside under a name unique to this process then renamed, concurrent instances never
+// read a partial tuning nor write the same temporary file.
+void writeUploadTuning(const std::string& filename, const UploadTuning& tuning) {
+  const std::string temporary = getTemporaryFilename(filename);
+  {
+    std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+    if (!file) return;
+    file << kHeader << '\n' << tuning.driver << '\n';
+    for (const auto& pair : tuning.formats)
+      file << pair.first << ' ' << pair.second.pixelFormat << ' ' << pair.second.pixelType << ' '
+           << pair.second.redBlueSwapped << '\n';
+    if (!file) {
+      file.close();
+      std::remove(temporary.c_str());
+      return;
+    }
+  }
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0) std::remove(temporary.c_str());
+}
+
+void applyUploadTuning(const UploadTuning& tuning) {
+  for (const auto& pair : tuning.formats) setUploadFormat(pair.first, pair.second);
+}
+
+void autotuneUploadFormats(const std::string& filename) {
+  UploadTuning tuning;
+  if (!readUploadTuning(filename, tuning) || tuning.driver != getDriverKey()) {
+    tuning = measureUploadFormats(1920, 1080, 15);
+    const std::string directory = getDirname(filename);
+    if (directory == filename || createDirectories(directory)) writeUploadTuning(filename, tuning);
+  }
+  applyUploadTuning(tuning);
+}
+
+} /* namespace duke */
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "duke/gl/GlUtils.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace duke {
+
+// Fastest upload format of each internal format for a driver.
+struct UploadTuning {
+  std::string driver;  // see getDriverKey
+  std::map<int, UploadFormat> formats;
+};
+
+// Internal formats decoders produce, the ones worth tuning.
+const std::vector<int>& getTunedInternalFormats();
+
+// Uploads frames of width x height from a pixel buffer repetitions times with each candidate format and keeps
+// the one with the fastest median upload. Must be called with a current context.
+UploadTuning measureUploadFormats(unsigned width, unsigned height, size_t repetitions);
+
+bool readUploadTuning(const std::string& filename, UploadTuning& tuning);
+void writeUploadTuning(const std::string& filename, const UploadTuning& tuning);
+
+// Sets the upload formats of tuning, see setUploadFormat.
+void applyUploadTuning(const UploadTuning& tuning);
+
+// Applies the tuning kept in filename, measuring it again first if it is missing or was done on another driver.
+// Must be called with a current context before frames are uploaded.
+void autotuneUploadFormats(const std::string& filename);
+
+} /* namespace duke */
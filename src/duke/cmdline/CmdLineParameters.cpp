@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include <sstream>
 #include <cstring>
+#include <cstdlib>
 #include <string>
 #include <algorithm>
 #include <thread>
@@ -45,6 +46,22 @@ size_t CmdLineParameters::getDefaultCacheSize() {
   return 500 * 1024 * 1024;  // 500MiB
 }
 
+string CmdLineParameters::getDefaultProgramCacheDirectory() {
+  const char* pCacheHome = getenv("XDG_CACHE_HOME");
+  if (pCacheHome && *pCacheHome) return string(pCacheHome) + "/duke/programs";
+  const char* pHome = getenv("HOME");
+  if (pHome && *pHome) return string(pHome) + "/.cache/duke/programs";
+  return {};
+}
+
+string CmdLineParameters::getDefaultUploadTuningFile() {
+  const char* pCacheHome = getenv("XDG_CACHE_HOME");
+  if (pCacheHome && *pCacheHome) return string(pCacheHome) + "/duke/upload-formats";
+  const char* pHome = getenv("HOME");
+  if (pHome && *pHome) return string(pHome) + "/.cache/duke/upload-formats";
+  return {};
+}
+
 CmdLineParameters::CmdLineParameters(int argc, const char* const* argv) {
   for (int i = 1; i < argc; ++i) {
     const char* pOption = argv[i];
@@ -52,6 +69,14 @@ CmdLineParameters::CmdLineParameters(int argc, const char* const* argv) {
       getArgs(argc, argv, ++i, swapBufferInterval);
     else if (matches(pOption, "--fullscreen", "-f"))
       fullscreen = true;
+    else if (matches(pOption, "--program-cache")) {
+      getArgs(argc, argv, ++i, programCacheDirectory);
+      if (programCacheDirectory == "none") programCacheDirectory.clear();
+    } else if (matches(pOption, "--upload-tuning")) {
+      getArgs(argc, argv, ++i, uploadTuningFile);
+      if (uploadTuningFile == "none") uploadTuningFile.clear();
+    } else if (matches(pOption, "--no-mipmaps"))
+      mipmapPyramid = false;
     else if (matches(pOption, "--unlimited"))
       unlimitedFPS = true;
     else if (matches(pOption, "--threads", "-t"))
@@ -74,6 +99,20 @@ CmdLineParameters::CmdLineParameters(int argc, const char* const* argv) {
       }
     } else if (matches(pOption, "--benchmark"))
       mode = ApplicationMode::BENCHMARK;
+    else if (matches(pOption, "--headless"))
+      mode = ApplicationMode::HEADLESS;
+    else if (matches(pOption, "--headless-size")) {
+      string size;
+      getArgs(argc, argv, ++i, size);
+      istringstream stream(size);
+      char separator = 0;
+      stream >> headlessWidth >> separator >> headlessHeight;
+      if (stream.fail() || separator != 'x' || headlessWidth == 0 || headlessHeight == 0)
+        throw logic_error("invalid headless size '" + size + "'");
+    } else if (matches(pOption, "--headless-output"))
+      getArgs(argc, argv, ++i, headlessOutput);
+    else if (matches(pOption, "--trace"))
+      getArgs(argc, argv, ++i, traceFile);
     else if (matches(pOption, "--help", "-h"))
       mode = ApplicationMode::HELP;
     else if (matches(pOption, "--version", "-v"))
@@ -88,6 +127,43 @@ CmdLineParameters::CmdLineParameters(int argc, const char* const* argv) {
       std::string colorSpaceString;
       getArgs(argc, argv, ++i, colorSpaceString);
       outputColorSpace = resolveFromName(colorSpaceString.c_str());
+    } else if (matches(pOption, "--lut")) {
+      getArgs(argc, argv, ++i, displayLut);
+    } else if (matches(pOption, "--allocator")) {
+      string allocator;
+      getArgs(argc, argv, ++i, allocator);
+      if (allocator == "aligned")
+        frameAllocator = FrameAllocatorType::ALIGNED;
+      else if (allocator == "slab")
+        frameAllocator = FrameAllocatorType::SLAB;
+      else if (allocator == "hugepages")
+        frameAllocator = FrameAllocatorType::HUGEPAGES;
+      else
+        throw logic_error("invalid allocator '" + allocator + "'");
+    } else if (matches(pOption, "--numa")) {
+      string placement;
+      getArgs(argc, argv, ++i, placement);
+      if (placement == "none")
+        numaPlacement = NumaPlacement::NONE;
+      else if (placement == "spread")
+        numaPlacement = NumaPlacement::SPREAD;
+      else if (placement == "gpu")
+        numaPlacement = NumaPlacement::GPU;
+      else
+        throw logic_error("invalid numa placement '" + placement + "'");
+    } else if (matches(pOption, "--proxy")) {
+      string format;
+      getArgs(argc, argv, ++i, format);
+      if (format == "none")
+        proxyFormat = ProxyFormat::NONE;
+      else if (format == "bc1")
+        proxyFormat = ProxyFormat::BC1;
+      else if (format == "bc7")
+        proxyFormat = ProxyFormat::BC7;
+      else
+        throw logic_error("invalid proxy format '" + format + "'");
+    } else if (matches(pOption, "--compress-cache")) {
+      compressCache = true;
     } else if (*pOption != '-')
       additionnalOptions.push_back(pOption);
     else
@@ -100,6 +176,13 @@ void CmdLineParameters::printHelpMessage() const {
   -h, --help                 display this help and exit
   -v, --version              output version information and exit
       --benchmark            tests current machine's performance.
+      --headless             renders every frame offscreen without window
+                             nor monitor and reports the achieved framerate.
+      --headless-size WxH    size of the offscreen framebuffer,
+                             default is 1920x1080.
+      --headless-output DIR  writes rendered frames to DIR as ppm files.
+      --trace FILE           writes cpu and gpu times of the render stages
+                             to FILE, open it with chrome://tracing.
       --swapinterval SIZE    specifies SIZE mandatory count of wait for
                              vblank before displaying a frame, default is 1.
 
@@ -115,7 +198,19 @@ void CmdLineParameters::printHelpMessage() const {
       --outputspace          force the display colorspace
                              [Linear, sRGB, Rec709]
 
+      --lut FILE             applies the cube, spi1d or spi3d lut FILE to
+                             display values.
+
   -f, --fullscreen           switch to fullscreen mode.
+      --program-cache DIR    where to keep compiled shader programs, 'none'
+                             disables it, default is ~/.cache/duke/programs.
+      --upload-tuning FILE   where to keep the fastest upload formats of this
+                             driver, measured on first launch and after driver
+                             updates. 'none' keeps the default formats, default
+                             is ~/.cache/duke/upload-formats.
+      --no-mipmaps           filters zoomed out frames in the shader instead
+                             of building a mipmap pyramid per frame,
+                             composited tracks are not filtered.
   -l, --list-formats         output supported formats and exit
   -s, --cache-size SIZE      size of the in-memory cache system in MiB,
                              default is %lu.
@@ -123,6 +218,20 @@ void CmdLineParameters::printHelpMessage() const {
                              of machine memory.
   -t, --threads SIZE         specify the number of decoding threads,
                              defaults to %u for this machine.
+      --allocator TYPE       memory allocator for decoded frames
+                             [aligned, slab, hugepages], default is slab.
+                             hugepages reserves the whole cache upfront.
+      --numa PLACEMENT       placement of decoding threads on numa machines
+                             [none, spread, gpu], default is none.
+                             spread distributes them on all nodes, gpu keeps
+                             them on the node the graphic card is attached to.
+      --proxy FORMAT         keeps decoded frames as compressed blocks
+                             [none, bc1, bc7], default is none. Holds 4 to
+                             8 times more frames at 8 bits per channel, bc1
+                             drops alpha.
+      --compress-cache       keeps frames away from the current one LZ4
+                             compressed, losslessly. Holds about twice more
+                             frames of integer formats.
 )",
          getDefaultCacheSize() / (1024 * 1024), getDefaultConcurrency());
 }
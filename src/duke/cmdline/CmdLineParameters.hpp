@@ -6,6 +6,8 @@
 
 #include "duke/time/FrameUtils.hpp"
 #include "duke/engine/ColorSpace.hpp"
+#include "duke/image/BlockCompression.hpp"
+#include "duke/memory/NumaTopology.hpp"
 
 namespace duke {
 
@@ -16,11 +18,18 @@ struct commandline_error : std::runtime_error {
 enum class ApplicationMode {
   DUKE,
   BENCHMARK,
+  HEADLESS,
   HELP,
   VERSION,
   LIST_SUPPORTED_FORMAT
 };
 
+enum class FrameAllocatorType {
+  ALIGNED,
+  SLAB,
+  HUGEPAGES
+};
+
 struct CmdLineParameters {
   CmdLineParameters(int argc, const char* const* argv);
   void printHelpMessage() const;
@@ -34,9 +43,30 @@ struct CmdLineParameters {
   std::vector<std::string> additionnalOptions;
   ColorSpace inputColorSpace = ColorSpace::Auto;
   ColorSpace outputColorSpace = ColorSpace::Auto;
+  std::string displayLut;
+  FrameAllocatorType frameAllocator = FrameAllocatorType::SLAB;
+  NumaPlacement numaPlacement = NumaPlacement::NONE;
+  ProxyFormat proxyFormat = ProxyFormat::NONE;
+  bool compressCache = false;
+  bool mipmapPyramid = true;
+  std::string programCacheDirectory = getDefaultProgramCacheDirectory();
+  std::string uploadTuningFile = getDefaultUploadTuningFile();
+  unsigned headlessWidth = 1920;
+  unsigned headlessHeight = 1080;
+  std::string headlessOutput;
+  std::string traceFile;
+
+  // Part of the cache budget keeping evicted frame buffers for reuse, the rest holds the cached frames.
+  // The slab reuses freed blocks through its own free lists, nothing is set aside.
+  inline size_t getRecycledBufferBytes() const {
+    return frameAllocator == FrameAllocatorType::SLAB ? 0 : imageCacheSizeDefault / 8;
+  }
+  inline size_t getCachedFrameBytes() const { return imageCacheSizeDefault - getRecycledBufferBytes(); }
 
   static unsigned getDefaultConcurrency();
   static size_t getDefaultCacheSize();
+  static std::string getDefaultProgramCacheDirectory();
+  static std::string getDefaultUploadTuningFile();
 };
 
 }  // namespace duke
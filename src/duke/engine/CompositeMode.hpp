@@ -0,0 +1,13 @@
+#pragma once
+
+namespace duke {
+
+// How the visible tracks are combined.
+enum class CompositeMode {
+  OVER,          // stacked in track order
+  WIPE,          // first track left of the wipe, second track right of it
+  SIDE_BY_SIDE,  // one column per track
+  DIFFERENCE     // absolute difference of the first two tracks
+};
+
+}  // namespace duke
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "duke/engine/CompositeMode.hpp"
 #include "duke/engine/FitMode.hpp"
 #include "duke/engine/ColorSpace.hpp"
 #include "duke/engine/Viewport.hpp"
@@ -12,6 +13,9 @@ struct ImageDescription;
 namespace duke {
 
 struct Texture;
+struct MipmapPyramid;
+class ColorLuts;
+struct ClipShaderCache;
 struct GeometryRenderer;
 struct GlyphRenderer;
 class IMediaStream;
@@ -31,17 +35,28 @@ struct Context {
   bool resetFitMode = true;
   float zoom = 1;
   glm::ivec2 pan;
+  // compositing
+  CompositeMode compositeMode = CompositeMode::OVER;
+  int wipe = 0;  // viewport column where wipe composites switch track
   // grading
   glm::bvec4 channels = glm::bvec4(false);
   float exposure = 1;
   float gamma = 1;
   ColorSpace fileColorSpace = ColorSpace::Auto;
   ColorSpace screenColorSpace = ColorSpace::Auto;
+  // colorspace conversions are evaluated in the shader if nullptr
+  const ColorLuts *pColorLuts = nullptr;
+  // shader states are resolved every frame if nullptr
+  ClipShaderCache *pClipShaderCache = nullptr;
   // file
   std::string filename;
   // current drawing
   const ImageDescription *pCurrentImage;
   const IMediaStream *pCurrentMediaStream;
+  // texture holding the current image, nullptr for tiled frames
+  const Texture *pCurrentTexture = nullptr;
+  // sampled instead of the bound texture when zoomed out, optional
+  const MipmapPyramid *pCurrentPyramid = nullptr;
 };
 
 } /* namespace duke */
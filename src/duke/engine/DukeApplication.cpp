@@ -6,6 +6,10 @@
 #include "duke/filesystem/FsUtils.hpp"
 #include "duke/gl/GL.hpp"
 #include "duke/io/IO.hpp"
+#include "duke/memory/HugePageAllocator.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+#include "duke/memory/NumaAllocator.hpp"
+#include "duke/memory/RecyclingAllocator.hpp"
 #include "duke/streams/DiskMediaStream.hpp"
 
 #include <sequence/Parser.hpp>
@@ -118,10 +122,65 @@ GLFWwindow* initializeMainWindow(DukeGLFWApplication* pApplication, const CmdLin
                                        fullscreen ? pPrimaryMonitor : nullptr, nullptr);
 }
 
+// Wraps pAllocator to keep evicted buffers, unless it is a slab reusing its free blocks itself.
+Allocator* recycle(const CmdLineParameters& parameters, Allocator* pAllocator, size_t recycledBytes) {
+  if (parameters.frameAllocator == FrameAllocatorType::SLAB) return pAllocator;
+  return new RecyclingAllocator(std::unique_ptr<Allocator>(pAllocator), recycledBytes);
+}
+
+// A pool of a numa node reserves huge pages prefaulted by the first worker of this node using it.
+Allocator* createBaseFrameAllocator(const CmdLineParameters& parameters, size_t reservation,
+                                    const NumaNode* pNode = nullptr) {
+  switch (parameters.frameAllocator) {
+    case FrameAllocatorType::ALIGNED:
+      return new AlignedMalloc();
+    case FrameAllocatorType::HUGEPAGES: {
+      auto pAllocator = new HugePageAllocator(reservation, pNode != nullptr);
+      if (pNode)
+        printf("Frame allocator reserved %lu MiB on numa node %d using %s\n",
+               pAllocator->reservedBytes() / (1024 * 1024), pNode->id, toString(pAllocator->mode()));
+      else
+        printf("Frame allocator reserved %lu MiB using %s, %lu MiB backed by huge pages\n",
+               pAllocator->reservedBytes() / (1024 * 1024), toString(pAllocator->mode()),
+               pAllocator->hugePageBytes() / (1024 * 1024));
+      return pAllocator;
+    }
+    case FrameAllocatorType::SLAB:
+    default:
+      return new BigAlignedBlock();
+  }
+}
+
 }  // namespace
 
+// Evicted frames are kept for reuse, their budget is taken from the cache's. The slab already keeps
+// its free blocks per size class, other allocators are wrapped in a RecyclingAllocator.
+// Frame buffers only account for the buffers in use, recycled ones have their own tag.
+// When threads are placed on numa nodes, each node has its own pool and recycled buffers.
+// Workers all run on the GPU node with the gpu placement, so does the upload thread in any
+// placement : its buffers come from the GPU node's pool.
+Allocator* createFrameAllocator(const CmdLineParameters& parameters) {
+  const auto& topology = getNumaTopology();
+  std::unique_ptr<Allocator> pAllocator;
+  if (parameters.numaPlacement != NumaPlacement::NONE && topology.isNuma()) {
+    const bool gpuOnly = parameters.numaPlacement == NumaPlacement::GPU && topology.findNode(topology.gpuNode);
+    const size_t nodes = topology.nodes.size();
+    pAllocator.reset(new NumaAllocator(topology, [&](const NumaNode& node) -> Allocator* {
+      const size_t share = gpuOnly ? (node.id == topology.gpuNode ? nodes : 0) : 1;
+      return recycle(parameters,
+                     createBaseFrameAllocator(parameters, parameters.imageCacheSizeDefault / nodes * share, &node),
+                     parameters.getRecycledBufferBytes() / nodes * share);
+    }));
+  } else {
+    pAllocator.reset(recycle(parameters, createBaseFrameAllocator(parameters, parameters.imageCacheSizeDefault),
+                             parameters.getRecycledBufferBytes()));
+  }
+  return new AccountingAllocator(std::move(pAllocator), "frame buffers");
+}
+
 DukeApplication::DukeApplication(const CmdLineParameters& parameters)
-    : m_MainWindow(initializeMainWindow(this, parameters), parameters) {
+    : m_FrameAllocator(createFrameAllocator(parameters)),
+      m_MainWindow(initializeMainWindow(this, parameters), parameters) {
 
   auto timeline = buildTimeline(parameters.additionnalOptions);
   auto frameDuration = parameters.defaultFrameRate;
@@ -2,17 +2,25 @@
 
 #include "duke/engine/DukeMainWindow.hpp"
 #include "duke/gl/GlFwApp.hpp"
+#include "duke/memory/Allocator.hpp"
 
 namespace duke {
 
 struct CmdLineParameters;
 
+Timeline buildTimeline(const std::vector<std::string> &paths);
+
+// The frame allocator configured on the command line.
+Allocator *createFrameAllocator(const CmdLineParameters &parameters);
+
 class DukeApplication : private DukeGLFWApplication {
  public:
   DukeApplication(const CmdLineParameters &parameters);
   void run();
 
  private:
+  // Must outlive the frames held by the main window.
+  ScopedFrameAllocator m_FrameAllocator;
   DukeMainWindow m_MainWindow;
 };
 
@@ -0,0 +1,166 @@
+#include "DukeHeadlessApplication.hpp"
+
+#include "duke/benchmark/UploadAutotune.hpp"
+#include "duke/cmdline/CmdLineParameters.hpp"
+#include "duke/engine/DukeApplication.hpp"
+#include "duke/engine/rendering/ImageRenderer.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/io/ImageLoadUtils.hpp"
+#include "duke/time/Clock.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace duke {
+
+namespace {
+
+// Longest time to wait for a frame to be read and uploaded.
+const auto kFrameTimeout = std::chrono::seconds(10);
+
+}  // namespace
+
+DukeHeadlessApplication::DukeHeadlessApplication(const CmdLineParameters &parameters)
+    : m_CmdLine(parameters),
+      m_FrameAllocator(createFrameAllocator(parameters)),
+      m_Player(parameters),
+      m_ProgramCache(parameters.programCacheDirectory),
+      m_Profiler(parameters.traceFile) {
+  m_GeometryRenderer.shaderPool.setBinaryCache(&m_ProgramCache);
+  m_Context.pGlyphRenderer = nullptr;
+  m_Context.pGeometryRenderer = &m_GeometryRenderer;
+  m_Context.fileColorSpace = parameters.inputColorSpace;
+  m_Context.screenColorSpace = parameters.outputColorSpace;
+  m_Context.pColorLuts = &m_ColorLuts;
+  m_Context.pClipShaderCache = &m_ClipShaderCache;
+  m_Context.viewport = Viewport(glm::ivec2(), glm::ivec2(parameters.headlessWidth, parameters.headlessHeight));
+  m_Context.fitMode = FitMode::INNER;
+
+  {
+    auto boundTexture = m_ColorBuffer.scope_bind_texture();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, parameters.headlessWidth, parameters.headlessHeight, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+  }
+  m_FrameBuffer.bind();
+  m_FrameBuffer.attachColor(m_ColorBuffer);
+  m_FrameBuffer.checkComplete();
+
+  glViewport(0, 0, parameters.headlessWidth, parameters.headlessHeight);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_DEPTH_TEST);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  setPaddedRgbFormats(getWidenedRgbFormats());
+  m_Player.getTextureCache().checkProxySupport();
+  if (!parameters.uploadTuningFile.empty()) autotuneUploadFormats(parameters.uploadTuningFile);
+  if (!parameters.displayLut.empty()) m_ColorLuts.setDisplayLut(loadLut(parameters.displayLut.c_str()));
+  try {
+    m_Player.getTextureCache().startUploadThread(std::unique_ptr<IGlContext>(new HeadlessContext(&m_GlContext)));
+  } catch (const std::exception &) {
+    // no shared context, prepare uploads the frames on the render thread
+  }
+
+  const auto timeline = buildTimeline(parameters.additionnalOptions);
+  if (timeline.empty()) throw commandline_error("nothing to render in headless mode");
+  m_Player.load(timeline, parameters.defaultFrameRate);
+  m_GeometryRenderer.shaderPool.warm(getTimelineShaderDescs(timeline, m_Context, parameters.mipmapPyramid));
+}
+
+void DukeHeadlessApplication::render(size_t frame) {
+  m_Context.currentFrame = FrameIndex(BaseRational(frame));
+  auto &textureCache = m_Player.getTextureCache();
+  {
+    ProfileScope upload(m_Profiler, ProfiledStage::UPLOAD);
+    textureCache.prepare(frame, IterationMode::FORWARD);
+  }
+
+  m_Profiler.begin(ProfiledStage::IMAGE);
+  glClear(GL_COLOR_BUFFER_BIT);
+  for (const Track &track : m_Player.getTimeline()) {
+    if (track.disabled) continue;
+    if (track.clipContaining(frame) == track.end()) continue;
+    const MediaFrameReference mfr = track.getMediaFrameReferenceAt(frame);
+    if (!mfr.pStream) continue;
+
+    const auto deadline = duke_clock::now() + kFrameTimeout;
+    auto pLoadedTexture = textureCache.getLoadedTexture(mfr);
+    while (!pLoadedTexture) {
+      if (duke_clock::now() > deadline)
+        throw std::runtime_error("timed out waiting for frame " + std::to_string(frame));
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      textureCache.prepare(frame, IterationMode::FORWARD);
+      pLoadedTexture = textureCache.getLoadedTexture(mfr);
+    }
+
+    m_Context.pCurrentImage = pLoadedTexture;
+    m_Context.pCurrentMediaStream = mfr.pStream;
+    m_Context.zoom = getZoomValue(m_Context);
+    const auto pSquare = m_GeometryRenderer.meshPool.getSquare();
+    m_Context.pCurrentPyramid = nullptr;
+    if (pLoadedTexture->pTiles) {
+      renderTiles(m_GeometryRenderer.shaderPool, pSquare.get(), m_Context, pLoadedTexture->pTiles,
+                  textureCache.getTileCache(), true);
+      continue;
+    }
+    auto &texture = *pLoadedTexture->pTexture;
+    auto boundTexture = texture.scope_bind_texture();
+    if (m_CmdLine.mipmapPyramid && m_Context.zoom < 1)
+      m_Context.pCurrentPyramid = getOrBuildPyramid(m_GeometryRenderer.shaderPool, pSquare.get(), m_Context,
+                                                    *pLoadedTexture, textureCache.getPyramidPool());
+    renderWithBoundTexture(m_GeometryRenderer.shaderPool, pSquare.get(), m_Context);
+  }
+  m_Profiler.end(ProfiledStage::IMAGE);
+  glFinish();
+}
+
+void DukeHeadlessApplication::write(size_t frame) const {
+  const size_t width = m_CmdLine.headlessWidth;
+  const size_t height = m_CmdLine.headlessHeight;
+  std::vector<char> pixels(width * height * 3);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+  char filename[32];
+  snprintf(filename, sizeof(filename), "/frame_%06lu.ppm", frame);
+  const std::string path = m_CmdLine.headlessOutput + filename;
+  FILE *pFile = fopen(path.c_str(), "wb");
+  if (!pFile) throw std::runtime_error("unable to open '" + path + "' for writing");
+  fprintf(pFile, "P6\n%lu %lu\n255\n", width, height);
+  // OpenGL rows are bottom up
+  for (size_t row = height; row > 0; --row) fwrite(pixels.data() + (row - 1) * width * 3, 1, width * 3, pFile);
+  fclose(pFile);
+}
+
+void DukeHeadlessApplication::run() {
+  const Range range = m_Player.getTimeline().getRange();
+  const auto start = duke_clock::now();
+  auto &glState = gl::getGlState();
+  glState.resetCounters();
+  for (size_t frame = range.first; frame <= range.last; ++frame) {
+    m_Profiler.nextFrame();
+    render(frame);
+    if (!m_CmdLine.headlessOutput.empty()) write(frame);
+  }
+  m_Profiler.nextFrame();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(duke_clock::now() - start).count();
+  const size_t frames = range.count();
+  printf("Rendered %lu frames at %ux%u in %.3fs, %.2f fps\n", frames, m_CmdLine.headlessWidth,
+         m_CmdLine.headlessHeight, elapsed / 1e6, elapsed ? frames * 1e6 / elapsed : 0.);
+  printf("%.1f gl calls per frame, %.1f redundant calls skipped\n", double(glState.calls) / frames,
+         double(glState.skipped) / frames);
+  const PboStats pboStats = m_Player.getTextureCache().takePboStats();
+  printf("%lu/%lu pixel buffer writes waited for the gpu, %.3fms in total\n", size_t(pboStats.waits),
+         size_t(pboStats.writes), pboStats.waitedUs / 1e3);
+  const FrameTimings &total = m_Profiler.getTotalTimings();
+  const size_t timedFrames = m_Profiler.getCollectedFrames();
+  for (size_t stage = 0; stage < size_t(ProfiledStage::_END) && timedFrames; ++stage)
+    printf("%s %.3fms cpu %.3fms gpu per frame\n", toString(ProfiledStage(stage)), total.cpuMs[stage] / timedFrames,
+           total.gpuMs[stage] / timedFrames);
+}
+
+} /* namespace duke */
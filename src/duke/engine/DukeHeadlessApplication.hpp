@@ -0,0 +1,51 @@
+#pragma once
+
+#include "duke/engine/Context.hpp"
+#include "duke/engine/FrameProfiler.hpp"
+#include "duke/engine/Player.hpp"
+#include "duke/engine/rendering/ColorLuts.hpp"
+#include "duke/engine/rendering/GeometryRenderer.hpp"
+#include "duke/engine/rendering/ImageRenderer.hpp"
+#include "duke/gl/GlObjects.hpp"
+#include "duke/gl/HeadlessContext.hpp"
+#include "duke/gl/ProgramBinaryCache.hpp"
+#include "duke/memory/Allocator.hpp"
+
+#include <string>
+
+namespace duke {
+
+struct CmdLineParameters;
+
+/**
+ * Renders the whole timeline into an offscreen framebuffer, no window nor
+ * monitor needed. Frames go through the same texture cache and image renderer
+ * as the interactive player, every frame is waited for.
+ * Used for batch jobs and benchmarking on display-less machines.
+ */
+class DukeHeadlessApplication : public noncopyable {
+ public:
+  DukeHeadlessApplication(const CmdLineParameters &parameters);
+  void run();
+
+ private:
+  void render(size_t frame);
+  void write(size_t frame) const;
+
+  const CmdLineParameters &m_CmdLine;
+  // Must outlive every GL object below.
+  HeadlessContext m_GlContext;
+  // Must outlive the frames held by the player.
+  ScopedFrameAllocator m_FrameAllocator;
+  Player m_Player;
+  ProgramBinaryCache m_ProgramCache;
+  GeometryRenderer m_GeometryRenderer;
+  ColorLuts m_ColorLuts;
+  ClipShaderCache m_ClipShaderCache;
+  gl::GlTexture2D m_ColorBuffer;
+  gl::GlFrameBufferObject m_FrameBuffer;
+  FrameProfiler m_Profiler;
+  Context m_Context;
+};
+
+} /* namespace duke */
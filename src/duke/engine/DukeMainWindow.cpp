@@ -1,35 +1,74 @@
 #include "DukeMainWindow.hpp"
 
+#include "duke/benchmark/UploadAutotune.hpp"
 #include "duke/engine/overlay/StatisticsOverlay.hpp"
 #include "duke/engine/overlay/OnScreenDisplayOverlay.hpp"
 #include "duke/engine/overlay/AttributesOverlay.hpp"
+#include "duke/engine/overlay/PixelProbeOverlay.hpp"
+#include "duke/engine/overlay/ScopesOverlay.hpp"
 #include "duke/engine/ConsoleIO.hpp"
+#include "duke/engine/FrameProfiler.hpp"
+#include "duke/engine/PresentationScheduler.hpp"
 #include "duke/engine/rendering/ImageRenderer.hpp"
 #include "duke/engine/commands/Commands.hpp"
 #include "duke/time/Clock.hpp"
 #include "duke/gl/GL.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/io/ImageLoadUtils.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+#include "duke/memory/NumaTopology.hpp"
 
+#include <memory>
 #include <string>
 #include <sstream>
 
 namespace duke {
 
 DukeMainWindow::DukeMainWindow(GLFWwindow *pWindow, const CmdLineParameters &parameters)
-    : DukeGLFWWindow(pWindow), m_CmdLine(parameters), m_Player(parameters), m_GlyphRenderer(m_GeometryRenderer) {
+    : DukeGLFWWindow(pWindow),
+      m_CmdLine(parameters),
+      m_Player(parameters),
+      m_ProgramCache(parameters.programCacheDirectory),
+      m_GlyphRenderer(m_GeometryRenderer) {
+  m_GeometryRenderer.shaderPool.setBinaryCache(&m_ProgramCache);
   m_Context.pGlyphRenderer = &m_GlyphRenderer;
   m_Context.pGeometryRenderer = &m_GeometryRenderer;
   m_Context.fileColorSpace = parameters.inputColorSpace;
   m_Context.screenColorSpace = parameters.outputColorSpace;
+  m_Context.pColorLuts = &m_ColorLuts;
+  m_Context.pClipShaderCache = &m_ClipShaderCache;
 
   ::glfwSetWindowTitle(m_pWindow, "Duke");
   ::glfwMakeContextCurrent(m_pWindow);
+  gl::getGlState().reset();
   ::glfwGetWindowSize(m_pWindow, &m_WindowDim.x, &m_WindowDim.y);
+  ::glfwGetFramebufferSize(m_pWindow, &m_FramebufferDim.x, &m_FramebufferDim.y);
   ::glfwGetWindowPos(m_pWindow, &m_WindowPos.x, &m_WindowPos.y);
   ::glfwSwapInterval(parameters.swapBufferInterval);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   glDisable(GL_DEPTH_TEST);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  setPaddedRgbFormats(getWidenedRgbFormats());
+  m_Player.getTextureCache().checkProxySupport();
+  if (!parameters.uploadTuningFile.empty()) autotuneUploadFormats(parameters.uploadTuningFile);
+  if (!parameters.displayLut.empty()) m_ColorLuts.setDisplayLut(loadLut(parameters.displayLut.c_str()));
+  try {
+    m_Player.getTextureCache().startUploadThread(std::unique_ptr<IGlContext>(new DukeGLFWSharedContext(m_pWindow)));
+  } catch (const std::exception &) {
+    // no shared context, prepare uploads the frames on the render thread
+  }
+
+  // The render thread reads frame buffers when uploading them itself, keeping it close to the GPU.
+  const auto& topology = getNumaTopology();
+  if (parameters.numaPlacement != NumaPlacement::NONE && topology.isNuma()) {
+    const NumaNode* pGpuNode = topology.findNode(topology.gpuNode);
+    if (pGpuNode && bindCurrentThreadToNode(*pGpuNode))
+      printf("Render thread bound to numa node %d\n", pGpuNode->id);
+    else
+      printf("Unable to find the GPU numa node, render thread is not bound\n");
+  }
 
   using std::bind;
   using std::placeholders::_1;
@@ -55,6 +94,8 @@ DukeMainWindow::DukeMainWindow(GLFWwindow *pWindow, const CmdLineParameters &par
                                      [&]() { m_Player.cue(m_Player.getTimeline().getRange().first); });
   m_Commands.addAndBind<FunctionCmd>({"end", "move to the last frame"},
                                      [&]() { m_Player.cue(m_Player.getTimeline().getRange().last); });
+  m_Commands.addAndBind<MemoryCmd>({"memory", "display memory usage per subsystem, 'memory json' for a json dump",
+                                   {value}});
   m_Commands.addAndBind<FunctionCmd>({"quit", "quit the application"},
                                      [&]() { glfwSetWindowShouldClose(getHandle(), true); });
   //	m_Commands.addAndBind<LsCmd>( { "ls", "list the current directory", { path } });
@@ -66,8 +107,11 @@ DukeMainWindow::DukeMainWindow(GLFWwindow *pWindow, const CmdLineParameters &par
 void DukeMainWindow::load(const Timeline &timeline, const FrameDuration &frameDuration, const FitMode fitMode,
                           int speed) {
   m_Player.load(timeline, frameDuration);
+  m_ClipShaderCache.clear();
   m_Player.setPlaybackSpeed(speed);
   m_Context.fitMode = fitMode;
+  // switching clips must not trigger a shader compilation
+  m_GeometryRenderer.shaderPool.warm(getTimelineShaderDescs(timeline, m_Context, m_CmdLine.mipmapPyramid));
 }
 
 void DukeMainWindow::onKey(int key, int action) {
@@ -77,22 +121,36 @@ void DukeMainWindow::onKey(int key, int action) {
 void DukeMainWindow::onChar(unsigned int unicodeCodePoint) { m_CharStrokes.push_back(unicodeCodePoint); }
 
 void DukeMainWindow::onWindowResize(int width, int height) {
-  ::glViewport(0, 0, width, height);
   m_WindowDim.x = width;
   m_WindowDim.y = height;
+  ::glfwGetFramebufferSize(m_pWindow, &m_FramebufferDim.x, &m_FramebufferDim.y);
+  ::glViewport(0, 0, m_FramebufferDim.x, m_FramebufferDim.y);
   m_Context.resetFitMode = true;
 }
 
 void DukeMainWindow::onMouseMove(int x, int y) {
-  int dx = x - m_MousePos.x;
-  int dy = y - m_MousePos.y;
-  m_MousePos.x = x;
-  m_MousePos.y = y;
+  // the cursor moves in window coordinates, images are drawn in framebuffer pixels
+  const glm::ivec2 position = glm::ivec2(x, y) * m_FramebufferDim / glm::max(m_WindowDim, glm::ivec2(1));
+  int dx = position.x - m_MousePos.x;
+  int dy = position.y - m_MousePos.y;
+  m_MousePos = position;
   if (m_MouseLeftDown) onMouseDrag(dx, dy);
+  if (m_MouseRightDown) {
+    m_HasProbeRegion = true;
+    m_ProbeRegionOppositeCorner = m_MousePos;
+  }
 }
 
 void DukeMainWindow::onMouseClick(int buttonId, int buttonState) {
   if (buttonId == GLFW_MOUSE_BUTTON_LEFT) m_MouseLeftDown = buttonState == GLFW_PRESS;
+  if (buttonId == GLFW_MOUSE_BUTTON_RIGHT) {
+    m_MouseRightDown = buttonState == GLFW_PRESS;
+    // pressing starts a new region, a click without dragging clears it
+    if (m_MouseRightDown) {
+      m_HasProbeRegion = false;
+      m_ProbeRegionCorner = m_MousePos;
+    }
+  }
 }
 
 void DukeMainWindow::onScroll(double x, double y) {
@@ -142,6 +200,28 @@ bool setNextMode(FitMode &mode) {
   throw std::runtime_error("unknown fitmode");
 }
 
+// Rate the swaps return at with vsync, 0 if unknown. The scheduler refines it.
+double getRefreshRate(GLFWwindow *pWindow, int swapInterval) {
+  GLFWmonitor *pMonitor = ::glfwGetWindowMonitor(pWindow);
+  if (!pMonitor) pMonitor = ::glfwGetPrimaryMonitor();
+  const GLFWvidmode *pMode = pMonitor ? ::glfwGetVideoMode(pMonitor) : nullptr;
+  if (!pMode || pMode->refreshRate <= 0 || swapInterval <= 0) return 0;
+  return double(pMode->refreshRate) / swapInterval;
+}
+
+// Reports the presentation errors since the previous report, at most once a second so a struggling
+// playback does not flood the console. The statistics overlay shows them as they happen.
+void logPresentation(duke_clock::time_point now, const PresentationStats &stats, PresentationStats &logged,
+                     duke_clock::time_point &lastLog) {
+  if (stats.late == logged.late || now - lastLog < std::chrono::seconds(1)) return;
+  printf("%lu frames presented late : %lu repeated refreshes, %lu dropped frames (total %lu late, %lu repeated, "
+         "%lu dropped over %lu presentations)\n",
+         stats.late - logged.late, stats.repeated - logged.repeated, stats.dropped - logged.dropped, stats.late,
+         stats.repeated, stats.dropped, stats.presented);
+  logged = stats;
+  lastLog = now;
+}
+
 const char *getFitModeString(FitMode &mode) {
   switch (mode) {
     case FitMode::ACTUAL:
@@ -156,6 +236,34 @@ const char *getFitModeString(FitMode &mode) {
   throw std::runtime_error("unknown fitmode");
 }
 
+CompositeMode getNextCompositeMode(CompositeMode mode) {
+  switch (mode) {
+    case CompositeMode::OVER:
+      return CompositeMode::WIPE;
+    case CompositeMode::WIPE:
+      return CompositeMode::SIDE_BY_SIDE;
+    case CompositeMode::SIDE_BY_SIDE:
+      return CompositeMode::DIFFERENCE;
+    case CompositeMode::DIFFERENCE:
+      return CompositeMode::OVER;
+  }
+  throw std::runtime_error("unknown composite mode");
+}
+
+const char *getCompositeModeString(CompositeMode mode) {
+  switch (mode) {
+    case CompositeMode::OVER:
+      return "Tracks over";
+    case CompositeMode::WIPE:
+      return "Wipe";
+    case CompositeMode::SIDE_BY_SIDE:
+      return "Side by side";
+    case CompositeMode::DIFFERENCE:
+      return "Difference";
+  }
+  throw std::runtime_error("unknown composite mode");
+}
+
 }  // namespace
 
 void DukeMainWindow::run() {
@@ -164,11 +272,20 @@ void DukeMainWindow::run() {
   AttributesOverlay metadataOverlay(m_GlyphRenderer);
   OnScreenDisplayOverlay statusOverlay(m_GlyphRenderer);
   StatisticsOverlay statisticOverlay(m_GlyphRenderer, m_Player.getTimeline());
+  ScopesOverlay scopesOverlay(m_GeometryRenderer);
+  PixelProbeOverlay probeOverlay(m_GlyphRenderer);
   bool showMetadataOverlay = false;
   bool showStatisticOverlay = true;
+  bool showScopesOverlay = false;
+  bool showProbeOverlay = false;
 
   SharedMesh pSquare = createSquare();
+  FrameProfiler profiler(m_CmdLine.traceFile);
+  PresentationScheduler scheduler(getRefreshRate(m_pWindow, m_CmdLine.swapBufferInterval));
+  PresentationStats loggedPresentation;
+  duke_clock::time_point lastPresentationLog;
 
+  std::vector<UploadTiming> uploadTimings;
   size_t lastFrame = 0;
   auto milestone = duke_clock::now();
   bool running = true;
@@ -202,15 +319,20 @@ void DukeMainWindow::run() {
     m_Context.pan = glm::ivec2();
     m_Context.resetFitMode = false;
   };
+  // Overlays queue their shapes and glyphs, drawing them at each overlay boundary keeps them
+  // stacked in rendering order.
+  const auto flushOverlay = [&]() { m_GlyphRenderer.flush(m_Context.viewport); };
 
   while (running) {
     // fetching user inputs
     ::glfwPollEvents();
+    profiler.nextFrame();
 
     // setting up context
-    m_Context.viewport = Viewport(glm::ivec2(), m_WindowDim);
+    m_Context.viewport = Viewport(glm::ivec2(), m_FramebufferDim);
     m_Context.currentFrame = m_Player.getCurrentFrame();
     m_Context.playbackTime = m_Player.getPlaybackTime();
+    m_Context.wipe = m_MousePos.x;
 
     // current frame
     const size_t frame = m_Context.currentFrame.round();
@@ -220,23 +342,54 @@ void DukeMainWindow::run() {
     const auto speed = m_Player.getPlaybackSpeed();
     const auto mode =
         speed < 0 ? IterationMode::BACKWARD : (speed > 0 ? IterationMode::FORWARD : IterationMode::PINGPONG);
-    textureCache.prepare(frame, mode);
+    if (textureCache.hasUploadThread()) {
+      // transfers happen on the upload thread, prepare only collects them
+      textureCache.prepare(frame, mode);
+      uploadTimings.clear();
+      textureCache.collectUploadTimings(uploadTimings);
+      for (const auto &timing : uploadTimings)
+        profiler.add(ProfiledStage::UPLOAD, timing.cpuBegin, timing.cpuEnd, timing.gpuBegin, timing.gpuEnd);
+    } else {
+      profiler.begin(ProfiledStage::UPLOAD);
+      textureCache.prepare(frame, mode);
+      profiler.end(ProfiledStage::UPLOAD);
+    }
+
+    // mouse positions are from the top left
+    const auto toViewport = [&](glm::ivec2 position) {
+      return glm::ivec2(position.x, m_Context.viewport.dimension.y - position.y - 1);
+    };
+    probeOverlay.cursor = toViewport(m_MousePos);
+    probeOverlay.hasRegion = m_HasProbeRegion;
+    probeOverlay.regionCorners[0] = toViewport(m_ProbeRegionCorner);
+    probeOverlay.regionCorners[1] = toViewport(m_ProbeRegionOppositeCorner);
 
     // rendering tracks
+    bool frameReady = true;
+    profiler.begin(ProfiledStage::IMAGE);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const auto &shaderPool = m_GlyphRenderer.getGeometryRenderer().shaderPool;
+    // gathering visible tracks, plain textures are composited in a single pass
+    struct VisibleTrack {
+      const Clip *pClip;
+      const IMediaStream *pMediaStream;
+      const TexturePackedFrame *pLoadedTexture;
+    };
+    std::vector<VisibleTrack> visibleTracks;
+    std::vector<CompositeLayer> compositeLayers;
+    std::vector<const VisibleTrack *> compositeTracks;  // track of each layer
+    bool compositable = true;
     for (const Track &track : m_Player.getTimeline()) {
       if (track.disabled) continue;
 
       const auto pTrackItr = track.clipContaining(frame);
       if (pTrackItr == track.end()) continue;
 
-      m_Context.pCurrentImage = nullptr;
-      m_Context.pCurrentMediaStream = nullptr;
       const MediaFrameReference mfr = track.getMediaFrameReferenceAt(frame);
       const auto pMediaStream = mfr.pStream;
-
+      const TexturePackedFrame *pLoadedTexture = nullptr;
       if (pMediaStream) {
-        auto pLoadedTexture = textureCache.getLoadedTexture(mfr);
+        pLoadedTexture = textureCache.getLoadedTexture(mfr);
         // Mode where we force the texture to be ready before displaying something
         if (m_CmdLine.unlimitedFPS) {
           int MaxTry = 1000;
@@ -247,32 +400,141 @@ void DukeMainWindow::run() {
             if (MaxTry-- <= 0) continue;
           }
         }
-        if (pLoadedTexture) {
-          m_Context.pCurrentImage = pLoadedTexture;
-          m_Context.pCurrentMediaStream = pMediaStream;
-          setupZoom();
-          auto &texture = *pLoadedTexture->pTexture;
-          auto boundTexture = texture.scope_bind_texture();
-          glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-          glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-          renderWithBoundTexture(m_GlyphRenderer.getGeometryRenderer().shaderPool, pSquare.get(), m_Context);
-        } else {
-          drawText(m_GlyphRenderer, m_Context.viewport, "caching", 100, 100, 1, 3);
+        if (pLoadedTexture && !pLoadedTexture->pTiles)
+          compositeLayers.push_back({pLoadedTexture, pLoadedTexture->pTexture.get(), nullptr});
+        else
+          compositable = false;
+      }
+      visibleTracks.push_back({&pTrackItr->second, pMediaStream, pLoadedTexture});
+    }
+    for (const VisibleTrack &visible : visibleTracks)
+      if (visible.pLoadedTexture && !visible.pLoadedTexture->pTiles) compositeTracks.push_back(&visible);
+    const size_t compositeLayerCount = getCompositeLayerCount(m_Context.compositeMode, compositeLayers.size());
+    if (compositable && compositeLayers.size() >= 2 && compositeLayerCount > 0) {
+      m_Context.pCurrentImage = compositeLayers.front().pImage;
+      m_Context.pCurrentMediaStream = compositeTracks.front()->pMediaStream;
+      m_Context.pCurrentTexture = compositeLayers.front().pTexture;
+      m_Context.pCurrentPyramid = nullptr;
+      setupZoom();
+      if (m_CmdLine.mipmapPyramid && m_Context.zoom < 1)
+        for (size_t i = 0; i < compositeLayerCount; ++i) {
+          const TexturePackedFrame &loaded = *compositeTracks[i]->pLoadedTexture;
+          auto boundTexture = loaded.pTexture->scope_bind_texture();
+          compositeLayers[i].pPyramid =
+              getOrBuildPyramid(shaderPool, pSquare.get(), m_Context, loaded, textureCache.getPyramidPool());
+        }
+      renderComposite(shaderPool, pSquare.get(), m_Context, compositeLayers);
+      // the probe, metadata and scopes follow the layer under the cursor
+      const size_t layer = getCompositeLayerAt(m_Context, compositeLayers, probeOverlay.cursor);
+      const Viewport viewport = m_Context.viewport;
+      m_Context.pCurrentImage = compositeLayers[layer].pImage;
+      m_Context.pCurrentMediaStream = compositeTracks[layer]->pMediaStream;
+      m_Context.pCurrentTexture = compositeLayers[layer].pTexture;
+      m_Context.pCurrentPyramid = compositeLayers[layer].pPyramid;
+      m_Context.viewport = getCompositeLayerViewport(m_Context, layer, compositeLayerCount);
+      if (showProbeOverlay) probeOverlay.probe(m_Context);
+      m_Context.viewport = viewport;
+      for (const VisibleTrack &visible : visibleTracks)
+        if (visible.pClip->pOverlay) {
+          visible.pClip->pOverlay->render(m_Context);
+          flushOverlay();
+        }
+      if (showMetadataOverlay) {
+        metadataOverlay.render(m_Context);
+        flushOverlay();
+      }
+      if (showScopesOverlay) {
+        scopesOverlay.render(m_Context);
+        flushOverlay();
+      }
+      m_Context.pCurrentTexture = nullptr;
+      m_Context.pCurrentPyramid = nullptr;
+    } else {
+      // the probe and scopes read the topmost loaded image, once per frame
+      const VisibleTrack *pTopmost = nullptr;
+      for (const VisibleTrack &visible : visibleTracks)
+        if (visible.pLoadedTexture) pTopmost = &visible;
+      for (const VisibleTrack &visible : visibleTracks) {
+        const bool topmost = &visible == pTopmost;
+        m_Context.pCurrentImage = nullptr;
+        m_Context.pCurrentMediaStream = nullptr;
+        m_Context.pCurrentTexture = nullptr;
+        const auto pLoadedTexture = visible.pLoadedTexture;
+        if (visible.pMediaStream) {
+          if (pLoadedTexture) {
+            m_Context.pCurrentImage = pLoadedTexture;
+            m_Context.pCurrentMediaStream = visible.pMediaStream;
+            setupZoom();
+            m_Context.pCurrentPyramid = nullptr;
+            if (pLoadedTexture->pTiles) {
+              renderTiles(shaderPool, pSquare.get(), m_Context, pLoadedTexture->pTiles, textureCache.getTileCache(),
+                          m_CmdLine.unlimitedFPS);
+            } else {
+              auto &texture = *pLoadedTexture->pTexture;
+              auto boundTexture = texture.scope_bind_texture();
+              m_Context.pCurrentTexture = &texture;
+              if (m_CmdLine.mipmapPyramid && (m_Context.zoom < 1 || (showScopesOverlay && topmost)))
+                m_Context.pCurrentPyramid = getOrBuildPyramid(shaderPool, pSquare.get(), m_Context, *pLoadedTexture,
+                                                              textureCache.getPyramidPool());
+              renderWithBoundTexture(shaderPool, pSquare.get(), m_Context);
+            }
+          } else {
+            frameReady = false;
+            drawText(m_GlyphRenderer, m_Context.viewport, "caching", 100, 100, 1, 3);
+            flushOverlay();
+          }
+        }
+        if (showProbeOverlay && topmost) probeOverlay.probe(m_Context);  // reads the image before it is covered
+        const auto &pOverlayTrack = visible.pClip->pOverlay;
+        if (pOverlayTrack) {
+          pOverlayTrack->render(m_Context);
+          flushOverlay();
+        }
+        if (showMetadataOverlay) {
+          metadataOverlay.render(m_Context);
+          flushOverlay();
+        }
+        if (showScopesOverlay && topmost) {
+          scopesOverlay.render(m_Context);
+          flushOverlay();
         }
+        m_Context.pCurrentTexture = nullptr;  // loaded textures may be released once the track is drawn
       }
-      const auto &pOverlayTrack = pTrackItr->second.pOverlay;
-      if (pOverlayTrack) pOverlayTrack->render(m_Context);
-      if (showMetadataOverlay) metadataOverlay.render(m_Context);
     }
-    if (showStatisticOverlay) statisticOverlay.render(m_Context);
-    statusOverlay.render(m_Context);
+    profiler.end(ProfiledStage::IMAGE);
+    {
+      ProfileScope overlays(profiler, ProfiledStage::OVERLAYS);
+      statisticOverlay.timings = profiler.getLastTimings();
+      if (showStatisticOverlay) {
+        statisticOverlay.render(m_Context);
+        flushOverlay();
+      }
+      if (showProbeOverlay) {
+        probeOverlay.render(m_Context);
+        flushOverlay();
+      }
+      statusOverlay.render(m_Context);
+      flushOverlay();
+      m_GlyphRenderer.endFrame();
+    }
 
     // displaying
     ::glfwSwapBuffers(m_pWindow);
+    const auto swapped = duke_clock::now();
+    scheduler.swapped(swapped, {frame, frameReady, m_Context.playbackTime, m_Player.getFrameDuration(), speed});
+    logPresentation(swapped, scheduler.getStats(), loggedPresentation, lastPresentationLog);
+    statisticOverlay.presentation = scheduler.getStats();
+    auto &glState = gl::getGlState();
+    statisticOverlay.glCalls = glState.calls;
+    statisticOverlay.glSkippedCalls = glState.skipped;
+    const PboStats pboStats = textureCache.takePboStats();
+    statisticOverlay.pboWrites = pboStats.writes;
+    statisticOverlay.pboWaits = pboStats.waits;
+    glState.resetCounters();
 
     // updating time
     const auto elapsedMicroSeconds = statisticOverlay.vBlankMetronom.tick();
-    const Time offset = m_CmdLine.unlimitedFPS ? m_Player.getFrameDuration() : Time(elapsedMicroSeconds);
+    const Time offset = m_CmdLine.unlimitedFPS ? Time(m_Player.getFrameDuration()) : scheduler.getAdvance();
     m_Player.offsetPlaybackTime(offset);
 
     m_Context.liveTime += Time(elapsedMicroSeconds.count(), 1000000);
@@ -320,6 +582,16 @@ void DukeMainWindow::run() {
         case 's':
           showStatisticOverlay = !showStatisticOverlay;
           break;
+        case 'h':
+          showScopesOverlay = !showScopesOverlay;
+          break;
+        case 'p':
+          showProbeOverlay = !showProbeOverlay;
+          break;
+        case 'c':
+          m_Context.compositeMode = getNextCompositeMode(m_Context.compositeMode);
+          display(getCompositeModeString(m_Context.compositeMode));
+          break;
         case 'f':
           setNextMode(m_Context.fitMode);
           m_Context.resetFitMode = true;
@@ -365,9 +637,13 @@ void DukeMainWindow::run() {
     // dumping cache state every 200 ms
     const auto now = duke_clock::now();
     if ((now - milestone) > std::chrono::milliseconds(100)) {
-      textureCache.getImageCache().dumpState(statisticOverlay.cacheState);
+      bool cacheStateChanged = false;
+      textureCache.getImageCache().dumpState(statisticOverlay.cacheState, &cacheStateChanged);
+      if (cacheStateChanged) statisticOverlay.cacheStateChanged = true;
       statisticOverlay.vBlankMetronom.compute();
       statisticOverlay.frameMetronom.compute();
+      MemoryAccounting::instance().update();
+      statisticOverlay.memory = MemoryAccounting::instance().snapshot();
       milestone = now;
     }
   }
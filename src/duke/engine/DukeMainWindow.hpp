@@ -7,9 +7,12 @@
 #include "duke/engine/Context.hpp"
 #include "duke/engine/rendering/ShaderPool.hpp"
 #include "duke/engine/rendering/MeshPool.hpp"
+#include "duke/engine/rendering/ColorLuts.hpp"
 #include "duke/engine/rendering/GeometryRenderer.hpp"
 #include "duke/engine/rendering/GlyphRenderer.hpp"
+#include "duke/engine/rendering/ImageRenderer.hpp"
 #include "duke/gl/GlFwApp.hpp"
+#include "duke/gl/ProgramBinaryCache.hpp"
 
 namespace duke {
 
@@ -31,17 +34,26 @@ class DukeMainWindow : public DukeGLFWWindow {
 
   bool togglePlayStop();
 
-  glm::ivec2 m_MousePos;
+  glm::ivec2 m_MousePos;  // framebuffer pixels from the top left
   glm::ivec2 m_WindowDim;
+  glm::ivec2 m_FramebufferDim;  // larger than the window on high density displays
   glm::ivec2 m_WindowPos;
   std::vector<unsigned int> m_CharStrokes;
   std::vector<int> m_KeyStrokes;
   bool m_MouseLeftDown = false;
+  bool m_MouseRightDown = false;
+  // pixel probe region, dragged with the right button, in framebuffer pixels from the top left
+  bool m_HasProbeRegion = false;
+  glm::ivec2 m_ProbeRegionCorner;
+  glm::ivec2 m_ProbeRegionOppositeCorner;
 
   const CmdLineParameters &m_CmdLine;
   Player m_Player;
+  ProgramBinaryCache m_ProgramCache;
   GeometryRenderer m_GeometryRenderer;
   GlyphRenderer m_GlyphRenderer;
+  ColorLuts m_ColorLuts;
+  ClipShaderCache m_ClipShaderCache;
   Context m_Context;
 
   cmd::Commands m_Commands;
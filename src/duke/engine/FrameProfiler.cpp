@@ -0,0 +1,165 @@
+#include "FrameProfiler.hpp"
+
+#include "duke/base/Check.hpp"
+#include "duke/gl/GlUtils.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace duke {
+
+namespace {
+
+double toMicroseconds(duke_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1e3;
+}
+
+}  // namespace
+
+const char* toString(ProfiledStage stage) {
+  switch (stage) {
+    case ProfiledStage::UPLOAD:
+      return "upload";
+    case ProfiledStage::IMAGE:
+      return "image";
+    case ProfiledStage::OVERLAYS:
+      return "overlays";
+    default:
+      return "unknown";
+  }
+}
+
+FrameProfiler::FrameProfiler(const std::string& traceFilename, size_t maxPendingFrames)
+    : m_MaxPendingFrames(maxPendingFrames), m_Supported(hasTimerQueries()), m_CpuOrigin(duke_clock::now()) {
+  if (m_Supported) glGetInteger64v(GL_TIMESTAMP, &m_GpuOrigin);
+  if (traceFilename.empty()) return;
+  m_pTraceFile = fopen(traceFilename.c_str(), "w");
+  if (!m_pTraceFile) throw std::runtime_error("unable to open trace file '" + traceFilename + "'");
+  fprintf(m_pTraceFile, "[");
+}
+
+FrameProfiler::~FrameProfiler() {
+  for (const auto& frame : m_Pending) release(frame);
+  release(m_Current);
+  if (!m_FreeQueries.empty()) glDeleteQueries(m_FreeQueries.size(), m_FreeQueries.data());
+  if (m_pTraceFile) {
+    fprintf(m_pTraceFile, "\n]\n");
+    fclose(m_pTraceFile);
+  }
+}
+
+GLuint FrameProfiler::acquireQuery() {
+  if (m_FreeQueries.empty()) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    return query;
+  }
+  const GLuint query = m_FreeQueries.back();
+  m_FreeQueries.pop_back();
+  return query;
+}
+
+void FrameProfiler::release(const Frame& frame) {
+  for (const auto& interval : frame.intervals) {
+    if (interval.beginQuery) m_FreeQueries.push_back(interval.beginQuery);
+    if (interval.endQuery) m_FreeQueries.push_back(interval.endQuery);
+  }
+}
+
+void FrameProfiler::begin(ProfiledStage stage) {
+  Interval interval{stage, 0, 0, duke_clock::now(), duke_clock::time_point(), 0, 0, false};
+  if (m_Supported) {
+    interval.beginQuery = acquireQuery();
+    glQueryCounter(interval.beginQuery, GL_TIMESTAMP);
+  }
+  m_Current.intervals.push_back(interval);
+}
+
+void FrameProfiler::end(ProfiledStage stage) {
+  auto itr = m_Current.intervals.rbegin();
+  for (; itr != m_Current.intervals.rend(); ++itr)
+    if (itr->stage == stage && itr->cpuEnd == duke_clock::time_point()) break;
+  CHECK(itr != m_Current.intervals.rend()) << "Ending stage " << toString(stage) << " that was not begun";
+  if (m_Supported) {
+    itr->endQuery = acquireQuery();
+    glQueryCounter(itr->endQuery, GL_TIMESTAMP);
+  }
+  itr->cpuEnd = duke_clock::now();
+}
+
+void FrameProfiler::add(ProfiledStage stage, duke_clock::time_point cpuBegin, duke_clock::time_point cpuEnd,
+                        GLuint64 gpuBegin, GLuint64 gpuEnd) {
+  m_Current.intervals.push_back({stage, 0, 0, cpuBegin, cpuEnd, gpuBegin, gpuEnd, true});
+}
+
+bool FrameProfiler::isAvailable(const Frame& frame) const {
+  if (!m_Supported) return true;
+  // timestamps complete in order, the last one tells for the whole frame
+  for (auto itr = frame.intervals.rbegin(); itr != frame.intervals.rend(); ++itr) {
+    if (!itr->endQuery) continue;
+    GLint available = 0;
+    glGetQueryObjectiv(itr->endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != 0;
+  }
+  return true;
+}
+
+void FrameProfiler::collect(const Frame& frame) {
+  FrameTimings timings;
+  timings.frame = frame.index;
+  for (const auto& interval : frame.intervals) {
+    const size_t stage = size_t(interval.stage);
+    const double cpuBeginUs = toMicroseconds(interval.cpuBegin - m_CpuOrigin);
+    const double cpuUs = toMicroseconds(interval.cpuEnd - interval.cpuBegin);
+    timings.cpuMs[stage] += cpuUs / 1e3;
+    trace(toString(interval.stage), interval.added ? "other thread" : "cpu", cpuBeginUs, cpuUs);
+    if (!m_Supported) continue;
+    GLuint64 gpuBegin = interval.gpuBegin, gpuEnd = interval.gpuEnd;
+    if (interval.endQuery) {
+      glGetQueryObjectui64v(interval.beginQuery, GL_QUERY_RESULT, &gpuBegin);
+      glGetQueryObjectui64v(interval.endQuery, GL_QUERY_RESULT, &gpuEnd);
+    }
+    if (!gpuEnd) continue;  // added without timer queries
+    const double gpuUs = (gpuEnd - gpuBegin) / 1e3;
+    timings.gpuMs[stage] += gpuUs / 1e3;
+    trace(toString(interval.stage), "gpu", (GLint64(gpuBegin) - m_GpuOrigin) / 1e3, gpuUs);
+  }
+  m_LastTimings = timings;
+  for (size_t stage = 0; stage < size_t(ProfiledStage::_END); ++stage) {
+    m_TotalTimings.cpuMs[stage] += timings.cpuMs[stage];
+    m_TotalTimings.gpuMs[stage] += timings.gpuMs[stage];
+  }
+  ++m_CollectedFrames;
+}
+
+void FrameProfiler::nextFrame() {
+  if (!m_Current.intervals.empty()) {
+    m_Pending.push_back(std::move(m_Current));
+    m_Current = Frame();
+  }
+  m_Current.index = m_FrameIndex++;
+  while (!m_Pending.empty() && isAvailable(m_Pending.front())) {
+    collect(m_Pending.front());
+    release(m_Pending.front());
+    m_Pending.pop_front();
+  }
+  // never waiting on the gpu, dropping frames it is too late for
+  while (m_Pending.size() > m_MaxPendingFrames) {
+    for (const auto& interval : m_Pending.front().intervals) {
+      glDeleteQueries(1, &interval.beginQuery);
+      glDeleteQueries(1, &interval.endQuery);
+    }
+    m_Pending.pop_front();
+    ++m_DroppedFrames;
+  }
+  glCheckError();
+}
+
+void FrameProfiler::trace(const char* pName, const char* pThread, double beginUs, double durationUs) {
+  if (!m_pTraceFile) return;
+  fprintf(m_pTraceFile, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":\"%s\",\"ts\":%.3f,\"dur\":%.3f}",
+          m_FirstEvent ? "" : ",", pName, pThread, beginUs, durationUs);
+  m_FirstEvent = false;
+}
+
+} /* namespace duke */
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/time/Clock.hpp"
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace duke {
+
+enum class ProfiledStage : unsigned char {
+  UPLOAD,    // pixel buffer transfers to textures
+  IMAGE,     // shading the frames
+  OVERLAYS,  // text and geometry
+  _END
+};
+
+const char* toString(ProfiledStage stage);
+
+// Cpu and gpu time spent in each stage during a frame.
+struct FrameTimings {
+  size_t frame = 0;
+  double cpuMs[size_t(ProfiledStage::_END)] = {};
+  double gpuMs[size_t(ProfiledStage::_END)] = {};
+};
+
+/**
+ * Times the stages of the render loop on the cpu and on the gpu.
+ * Gpu times come from GL_TIMESTAMP queries issued around each stage. They are
+ * read back frames later once available so the pipeline never stalls, frames
+ * still pending after maxPendingFrames are dropped.
+ * Completed frames are optionally written to a chrome trace file
+ * (chrome://tracing).
+ */
+class FrameProfiler : public noncopyable {
+ public:
+  FrameProfiler(const std::string& traceFilename = "", size_t maxPendingFrames = 8);
+  ~FrameProfiler();
+
+  // Closes the current frame and collects the frames the gpu completed.
+  void nextFrame();
+
+  void begin(ProfiledStage stage);
+  void end(ProfiledStage stage);
+  // Adds to the current frame a stage timed on another thread. Gpu times are
+  // GL_TIMESTAMP values from any context, 0 if unknown.
+  void add(ProfiledStage stage, duke_clock::time_point cpuBegin, duke_clock::time_point cpuEnd, GLuint64 gpuBegin,
+           GLuint64 gpuEnd);
+
+  // Timings of the last frame completed by the gpu.
+  const FrameTimings& getLastTimings() const { return m_LastTimings; }
+  // Sum of the timings of all completed frames.
+  const FrameTimings& getTotalTimings() const { return m_TotalTimings; }
+  size_t getCollectedFrames() const { return m_CollectedFrames; }
+  size_t getDroppedFrames() const { return m_DroppedFrames; }
+
+ private:
+  struct Interval {
+    ProfiledStage stage;
+    GLuint beginQuery;
+    GLuint endQuery;
+    duke_clock::time_point cpuBegin;
+    duke_clock::time_point cpuEnd;
+    GLuint64 gpuBegin;  // of added intervals, which have no queries
+    GLuint64 gpuEnd;
+    bool added;
+  };
+  struct Frame {
+    size_t index = 0;
+    std::vector<Interval> intervals;
+  };
+
+  GLuint acquireQuery();
+  void release(const Frame& frame);
+  bool isAvailable(const Frame& frame) const;
+  void collect(const Frame& frame);
+  void trace(const char* pName, const char* pThread, double beginUs, double durationUs);
+
+  const size_t m_MaxPendingFrames;
+  const bool m_Supported;
+  Frame m_Current;
+  std::deque<Frame> m_Pending;
+  std::vector<GLuint> m_FreeQueries;
+  FrameTimings m_LastTimings;
+  FrameTimings m_TotalTimings;
+  size_t m_FrameIndex = 0;
+  size_t m_CollectedFrames = 0;
+  size_t m_DroppedFrames = 0;
+  // trace
+  FILE* m_pTraceFile = nullptr;
+  bool m_FirstEvent = true;
+  duke_clock::time_point m_CpuOrigin;
+  GLint64 m_GpuOrigin = 0;
+};
+
+// Profiles a stage for the duration of the scope.
+struct ProfileScope : public noncopyable {
+  ProfileScope(FrameProfiler& profiler, ProfiledStage stage) : m_Profiler(profiler), m_Stage(stage) {
+    m_Profiler.begin(m_Stage);
+  }
+  ~ProfileScope() { m_Profiler.end(m_Stage); }
+
+ private:
+  FrameProfiler& m_Profiler;
+  const ProfiledStage m_Stage;
+};
+
+} /* namespace duke */
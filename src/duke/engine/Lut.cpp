@@ -0,0 +1,277 @@
+#include "duke/engine/Lut.hpp"
+
+#include "duke/base/StringUtils.hpp"
+#include "duke/filesystem/FsUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace duke {
+
+namespace {
+
+void checkSize(const Lut& lut) {
+  if (lut.type == LutType::NONE) throw std::runtime_error("lut: missing size");
+  if (lut.size < 2) throw std::runtime_error("lut: size must be at least 2");
+  if (lut.size > (lut.type == LutType::LUT_3D ? 256 : 1 << 20)) throw std::runtime_error("lut: size too big");
+}
+
+void checkComplete(const Lut& lut, size_t values) {
+  if (values != lut.entries() * 3)
+    throw std::runtime_error("lut: expected " + std::to_string(lut.entries()) + " entries, got " +
+                             std::to_string(values / 3));
+}
+
+bool isComment(const std::string& line) {
+  const auto first = line.find_first_not_of(" \t\r");
+  return first == std::string::npos || line[first] == '#';
+}
+
+float clamp01(float value) { return std::min(1.f, std::max(0.f, value)); }
+
+// Position of value in the lut's entries for channel.
+float getPosition(const Lut& lut, size_t channel, float value) {
+  const float range = lut.domainMax[channel] - lut.domainMin[channel];
+  return clamp01((value - lut.domainMin[channel]) / range) * (lut.size - 1);
+}
+
+float lerp(float a, float b, float weight) { return a + (b - a) * weight; }
+
+}  // namespace
+
+size_t Lut::entries() const { return type == LutType::LUT_3D ? size * size * size : size; }
+
+void Lut::apply(const float in[3], float out[3]) const {
+  switch (type) {
+    case LutType::LUT_1D:
+      for (size_t c = 0; c < 3; ++c) {
+        const float position = getPosition(*this, c, in[c]);
+        const size_t index = std::min<size_t>(position, size - 2);
+        out[c] = lerp(data[index * 3 + c], data[(index + 1) * 3 + c], position - index);
+      }
+      return;
+    case LutType::LUT_3D: {
+      size_t index[3];
+      float weight[3];
+      for (size_t c = 0; c < 3; ++c) {
+        const float position = getPosition(*this, c, in[c]);
+        index[c] = std::min<size_t>(position, size - 2);
+        weight[c] = position - index[c];
+      }
+      const auto at = [&](size_t r, size_t g, size_t b, size_t c) {
+        return data[((index[2] + b) * size * size + (index[1] + g) * size + index[0] + r) * 3 + c];
+      };
+      for (size_t c = 0; c < 3; ++c) {
+        const float c00 = lerp(at(0, 0, 0, c), at(1, 0, 0, c), weight[0]);
+        const float c10 = lerp(at(0, 1, 0, c), at(1, 1, 0, c), weight[0]);
+        const float c01 = lerp(at(0, 0, 1, c), at(1, 0, 1, c), weight[0]);
+        const float c11 = lerp(at(0, 1, 1, c), at(1, 1, 1, c), weight[0]);
+        out[c] = lerp(lerp(c00, c10, weight[1]), lerp(c01, c11, weight[1]), weight[2]);
+      }
+      return;
+    }
+    default:
+      std::copy(in, in + 3, out);
+  }
+}
+
+Lut parseCube(std::istream& stream) {
+  Lut lut;
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (isComment(line)) continue;
+    std::istringstream iss(line);
+    std::string keyword;
+    iss >> keyword;
+    if (keyword == "TITLE") continue;
+    if (keyword == "LUT_1D_SIZE" || keyword == "LUT_3D_SIZE") {
+      lut.type = keyword == "LUT_1D_SIZE" ? LutType::LUT_1D : LutType::LUT_3D;
+      iss >> lut.size;
+      checkSize(lut);
+      lut.data.reserve(lut.entries() * 3);
+    } else if (keyword == "DOMAIN_MIN") {
+      iss >> lut.domainMin[0] >> lut.domainMin[1] >> lut.domainMin[2];
+    } else if (keyword == "DOMAIN_MAX") {
+      iss >> lut.domainMax[0] >> lut.domainMax[1] >> lut.domainMax[2];
+    } else if (keyword == "LUT_1D_INPUT_RANGE" || keyword == "LUT_3D_INPUT_RANGE") {
+      // Resolve's single range for all channels
+      float from, to;
+      iss >> from >> to;
+      std::fill(lut.domainMin, lut.domainMin + 3, from);
+      std::fill(lut.domainMax, lut.domainMax + 3, to);
+    } else {
+      if (lut.type == LutType::NONE) throw std::runtime_error("cube: data before size");
+      float rgb[3];
+      std::istringstream values(line);
+      values >> rgb[0] >> rgb[1] >> rgb[2];
+      if (values.fail()) throw std::runtime_error("cube: invalid line '" + line + "'");
+      lut.data.insert(lut.data.end(), rgb, rgb + 3);
+      continue;
+    }
+    if (iss.fail()) throw std::runtime_error("cube: invalid line '" + line + "'");
+  }
+  checkSize(lut);
+  checkComplete(lut, lut.data.size());
+  return lut;
+}
+
+Lut parseSpi1d(std::istream& stream) {
+  Lut lut;
+  lut.type = LutType::LUT_1D;
+  size_t components = 1;
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (isComment(line)) continue;
+    std::istringstream iss(line);
+    std::string keyword;
+    iss >> keyword;
+    if (keyword == "Version") continue;
+    if (keyword == "From") {
+      float from, to;
+      iss >> from >> to;
+      std::fill(lut.domainMin, lut.domainMin + 3, from);
+      std::fill(lut.domainMax, lut.domainMax + 3, to);
+    } else if (keyword == "Length") {
+      iss >> lut.size;
+    } else if (keyword == "Components") {
+      iss >> components;
+      if (components != 1 && components != 3) throw std::runtime_error("spi1d: unsupported component count");
+    } else if (keyword == "{") {
+      break;
+    } else {
+      throw std::runtime_error("spi1d: unexpected line '" + line + "'");
+    }
+    if (iss.fail()) throw std::runtime_error("spi1d: invalid line '" + line + "'");
+  }
+  checkSize(lut);
+  lut.data.reserve(lut.size * 3);
+  while (std::getline(stream, line)) {
+    if (isComment(line)) continue;
+    if (line.find('}') != std::string::npos) break;
+    std::istringstream iss(line);
+    float values[3];
+    for (size_t c = 0; c < components; ++c) iss >> values[c];
+    if (iss.fail()) throw std::runtime_error("spi1d: invalid line '" + line + "'");
+    if (components == 1) values[1] = values[2] = values[0];
+    lut.data.insert(lut.data.end(), values, values + 3);
+  }
+  checkComplete(lut, lut.data.size());
+  return lut;
+}
+
+Lut parseSpi3d(std::istream& stream) {
+  Lut lut;
+  lut.type = LutType::LUT_3D;
+  std::string line;
+  // header is "SPILUT 1.0", "3 3" then the size of each dimension
+  size_t headerLines = 0;
+  while (headerLines < 3 && std::getline(stream, line)) {
+    if (isComment(line)) continue;
+    std::istringstream iss(line);
+    if (headerLines == 0 && line.compare(0, 6, "SPILUT") != 0) throw std::runtime_error("spi3d: missing SPILUT");
+    if (headerLines == 2) {
+      size_t sizes[3];
+      iss >> sizes[0] >> sizes[1] >> sizes[2];
+      if (iss.fail() || sizes[0] != sizes[1] || sizes[0] != sizes[2])
+        throw std::runtime_error("spi3d: only cubic luts are supported");
+      lut.size = sizes[0];
+    }
+    ++headerLines;
+  }
+  checkSize(lut);
+  lut.data.resize(lut.entries() * 3);
+  size_t values = 0;
+  while (std::getline(stream, line)) {
+    if (isComment(line)) continue;
+    std::istringstream iss(line);
+    size_t r, g, b;
+    float rgb[3];
+    iss >> r >> g >> b >> rgb[0] >> rgb[1] >> rgb[2];
+    if (iss.fail() || r >= lut.size || g >= lut.size || b >= lut.size)
+      throw std::runtime_error("spi3d: invalid line '" + line + "'");
+    std::copy(rgb, rgb + 3, lut.data.begin() + (b * lut.size * lut.size + g * lut.size + r) * 3);
+    values += 3;
+  }
+  checkComplete(lut, values);
+  return lut;
+}
+
+Lut loadLut(const char* pFilename) {
+  std::ifstream file(pFilename);
+  if (!file) throw std::runtime_error(std::string("unable to open lut '") + pFilename + "'");
+  const char* pExtension = fileExtension(pFilename);
+  if (pExtension && streq(pExtension, "cube")) return parseCube(file);
+  if (pExtension && streq(pExtension, "spi1d")) return parseSpi1d(file);
+  if (pExtension && streq(pExtension, "spi3d")) return parseSpi3d(file);
+  throw std::runtime_error(std::string("unsupported lut format '") + pFilename + "', expecting cube, spi1d or spi3d");
+}
+
+float toLinear(ColorSpace colorspace, float value) {
+  switch (colorspace) {
+    case ColorSpace::AlexaLogC:
+      return value < 0.1496582f ? (value - 0.092809f) / 5.367655f
+                                : (std::pow(10.f, (value - 0.385537f) / 0.2471896f) - 0.052272f) / 5.555556f;
+    case ColorSpace::KodakLog:
+      return 1.010915615730753f * (std::pow(10.f, (1023 * value - 685) / 300) - 0.010797751623277f);
+    case ColorSpace::Linear:
+      return value;
+    case ColorSpace::sRGB:
+    case ColorSpace::GammaCorrected:
+      return value < 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    case ColorSpace::Rec709:
+      return value < 0.018f ? value / 4.5f : std::pow((value + 0.099f) / 1.099f, 1 / 0.45f);
+    default:
+      throw std::runtime_error("ColorSpace must be resolved at this point");
+  }
+}
+
+float toScreen(ColorSpace colorspace, float value) {
+  switch (colorspace) {
+    case ColorSpace::Linear:
+      return value;
+    case ColorSpace::Rec709:
+      return clamp01(value < 0.018f ? 4.5f * value : 1.099f * std::pow(value, 0.45f) - 0.099f);
+    case ColorSpace::sRGB:
+    case ColorSpace::GammaCorrected:
+    case ColorSpace::Auto:
+      return clamp01(value < 0.0031308f ? 12.92f * value : 1.055f * std::pow(value, 1 / 2.4f) - 0.055f);
+    default:
+      throw std::runtime_error("Screen colorspace not handled");
+  }
+}
+
+namespace {
+
+template <typename F>
+Lut bake(size_t size, F function) {
+  Lut lut;
+  lut.type = LutType::LUT_1D;
+  lut.size = size;
+  lut.data.resize(size * 3);
+  for (size_t i = 0; i < size; ++i) std::fill_n(lut.data.begin() + i * 3, 3, function(float(i) / (size - 1)));
+  return lut;
+}
+
+}  // namespace
+
+Lut bakeToLinear(ColorSpace colorspace, size_t size) {
+  return bake(size, [colorspace](float value) { return toLinear(colorspace, value); });
+}
+
+Lut bakeToScreen(ColorSpace colorspace, size_t size) {
+  return bake(size, [colorspace](float value) { return toScreen(colorspace, value); });
+}
+
+Lut compose(const Lut& first, const Lut& second) {
+  if (first.type != LutType::LUT_1D || second.type != LutType::LUT_1D)
+    throw std::runtime_error("lut: only 1D luts can be composed");
+  Lut lut = first;
+  for (size_t i = 0; i < lut.size; ++i) second.apply(&first.data[i * 3], &lut.data[i * 3]);
+  return lut;
+}
+
+} /* namespace duke */
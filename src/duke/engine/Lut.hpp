@@ -0,0 +1,52 @@
+#pragma once
+
+#include "duke/engine/ColorSpace.hpp"
+
+#include <istream>
+#include <vector>
+
+namespace duke {
+
+enum class LutType : unsigned char {
+  NONE,
+  LUT_1D,
+  LUT_3D
+};
+
+/**
+ * A color lookup table.
+ * 1D luts hold size rgb entries, each channel being looked up independently.
+ * 3D luts hold size^3 rgb entries, red varying fastest then green then blue.
+ * Inputs are mapped from [domainMin, domainMax] to the lut's entries.
+ */
+struct Lut {
+  LutType type = LutType::NONE;
+  size_t size = 0;
+  std::vector<float> data;  // rgb interleaved
+  float domainMin[3] = {0, 0, 0};
+  float domainMax[3] = {1, 1, 1};
+
+  size_t entries() const;
+  // Interpolated lookup, for testing and baking.
+  void apply(const float in[3], float out[3]) const;
+};
+
+// Parsers throw std::runtime_error on malformed input.
+Lut parseCube(std::istream& stream);
+Lut parseSpi1d(std::istream& stream);
+Lut parseSpi3d(std::istream& stream);
+// Picks the parser from the file's extension.
+Lut loadLut(const char* pFilename);
+
+// Evaluates the colorspace conversions matching the GLSL functions.
+float toLinear(ColorSpace colorspace, float value);
+float toScreen(ColorSpace colorspace, float value);
+
+// 1D luts over [0, 1] replacing the GLSL conversion functions.
+Lut bakeToLinear(ColorSpace colorspace, size_t size = 4096);
+Lut bakeToScreen(ColorSpace colorspace, size_t size = 4096);
+
+// 1D lut over first's domain applying first then second, so both are sampled at once.
+Lut compose(const Lut& first, const Lut& second);
+
+} /* namespace duke */
@@ -0,0 +1,77 @@
+#include "PresentationScheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace duke {
+
+namespace {
+
+// Weight of a new measure in the refresh period estimate.
+const double kSmoothing = 0.05;
+// Measures further than this ratio from the estimate are jitter, they do not refine it.
+const double kTolerance = 0.25;
+
+size_t frameAt(const Time& time, const FrameDuration& frameDuration) {
+  return FrameIndex(BaseRational(time / frameDuration)).round();
+}
+
+}  // namespace
+
+PresentationScheduler::PresentationScheduler(double refreshRate) : m_PeriodUs(refreshRate > 0 ? 1e6 / refreshRate : 0) {}
+
+// Nanosecond resolution, the cadence would slowly drift from the frames with microseconds.
+Time PresentationScheduler::getRefreshPeriod() const { return Time(std::llround(m_PeriodUs * 1000), 1000000000); }
+
+size_t PresentationScheduler::swapped(duke_clock::time_point time, const Presentation& presentation) {
+  size_t refreshes = 1;
+  if (m_Started) {
+    const double elapsedUs = std::chrono::duration<double, std::micro>(time - m_LastSwap).count();
+    if (m_PeriodUs <= 0) m_PeriodUs = elapsedUs;
+    const Time period = getRefreshPeriod();
+    refreshes = std::max<size_t>(1, std::llround(elapsedUs / m_PeriodUs));
+    const double measuredUs = elapsedUs / refreshes;
+    if (std::abs(measuredUs - m_PeriodUs) < kTolerance * m_PeriodUs)
+      m_PeriodUs += kSmoothing * (measuredUs - m_PeriodUs);
+    else if (measuredUs < m_PeriodUs)  // a refresh is never shorter than the period, the estimate is off
+      m_PeriodUs = measuredUs;
+    account(presentation, refreshes, period);
+  } else {
+    m_FirstSwap = time;
+  }
+  // whole refreshes, plus the refreshes playback drifted away from the clock by. Jitter is well
+  // within half a refresh, only the errors of the period estimate adding up get corrected.
+  const Time period = getRefreshPeriod();
+  const double dueUs = std::chrono::duration<double, std::micro>(time - m_FirstSwap).count() + m_PeriodUs;
+  const double driftUs = dueUs - Time(m_Advanced + period * Time::int_type(refreshes)).asDouble() * 1e6;
+  const long long correction = m_PeriodUs > 0 ? std::llround(driftUs / m_PeriodUs) : 0;
+  m_Advance = period * Time::int_type(std::max<long long>(0, refreshes + correction));
+  m_Advanced += m_Advance;
+  ++m_Stats.presented;
+  m_Started = true;
+  m_LastSwap = time;
+  m_LastFrame = presentation.frame;
+  return refreshes;
+}
+
+// The previous frame stayed on screen until the refresh showing presentation, one refresh if on time.
+// presentation was due on the first of these refreshes.
+void PresentationScheduler::account(const Presentation& presentation, size_t refreshes, const Time& period) {
+  if (presentation.speed == 0) return;
+  if (refreshes > 1 || !presentation.ready) ++m_Stats.late;
+  const Time step = period * Time::int_type(presentation.speed);
+  const size_t next = frameAt(presentation.playbackTime + step * Time::int_type(refreshes), presentation.frameDuration);
+  bool dropping = false;
+  size_t lastDropped = 0;
+  for (size_t refresh = 0; refresh < refreshes; ++refresh) {
+    const size_t due = frameAt(presentation.playbackTime + step * Time::int_type(refresh), presentation.frameDuration);
+    if (refresh + 1 < refreshes && due != m_LastFrame) ++m_Stats.repeated;
+    if (due == m_LastFrame || due == presentation.frame || due == next || (dropping && due == lastDropped)) continue;
+    ++m_Stats.dropped;
+    dropping = true;
+    lastDropped = due;
+  }
+}
+
+} /* namespace duke */
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/time/Clock.hpp"
+#include "duke/time/FrameUtils.hpp"
+
+#include <cstddef>
+
+namespace duke {
+
+// What a buffer swap put on screen.
+struct Presentation {
+  size_t frame;
+  bool ready;  // false if the frame was not loaded in time
+  Time playbackTime;
+  FrameDuration frameDuration;
+  int speed;
+};
+
+// Presentation accuracy, only accounted during playback.
+struct PresentationStats {
+  size_t presented = 0;  // swaps
+  size_t late = 0;       // frames shown refreshes after they were due or not loaded in time
+  size_t repeated = 0;   // refreshes holding the previous frame while another one was due
+  size_t dropped = 0;    // frames due on screen that were never shown
+};
+
+/**
+ * Paces playback on the display refreshes.
+ * The refresh period is estimated from the swap timings, starting from the
+ * rate reported by the system if any. Playback advances by whole refresh
+ * periods so swap jitter does not change the cadence : each refresh shows
+ * the frame due at that time, e.g. 3:2 pulldown for 24 fps on 60 Hz.
+ * Playback is re-anchored to the clock whenever the errors of the period
+ * estimate add up to half a refresh.
+ * Swaps missing a refresh are detected and accounted for.
+ */
+class PresentationScheduler : public noncopyable {
+ public:
+  // refreshRate in Hz, 0 if unknown.
+  PresentationScheduler(double refreshRate = 0);
+
+  // Records the swap that returned at time, returns the number of refreshes since the previous one.
+  size_t swapped(duke_clock::time_point time, const Presentation& presentation);
+
+  // Time to advance playback by per refresh.
+  Time getRefreshPeriod() const;
+  // Time to advance playback by after the last swap, whole refresh periods.
+  Time getAdvance() const { return m_Advance; }
+  const PresentationStats& getStats() const { return m_Stats; }
+
+ private:
+  void account(const Presentation& presentation, size_t refreshes, const Time& period);
+
+  double m_PeriodUs;
+  bool m_Started = false;
+  duke_clock::time_point m_FirstSwap;
+  duke_clock::time_point m_LastSwap;
+  Time m_Advanced;  // since the first swap
+  Time m_Advance;
+  size_t m_LastFrame = 0;
+  PresentationStats m_Stats;
+};
+
+} /* namespace duke */
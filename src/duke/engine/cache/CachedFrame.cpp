@@ -0,0 +1,189 @@
+#include "CachedFrame.hpp"
+
+#include "duke/base/Check.hpp"
+#include "duke/base/Lz4.hpp"
+#include "duke/base/TaskPool.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/memory/Allocator.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace duke {
+
+namespace {
+
+// Chunks are compressed independently so frames spread over the task pool.
+const size_t kChunkBytes = 2 * 1024 * 1024;
+
+// Frames must at least lose a quarter of their size to be kept compressed.
+bool isSmallEnough(size_t compressedSize, size_t size) { return compressedSize * 4 <= size * 3; }
+
+struct Chunk {
+  size_t offset = 0;  // in the compressed buffer
+  size_t size = 0;
+};
+
+void forEachChunk(size_t chunks, const std::function<void(size_t)>& process) {
+  auto& pool = TaskPool::instance();
+  if (chunks < 2 || pool.workers() < 2) {
+    for (size_t i = 0; i < chunks; ++i) process(i);
+    return;
+  }
+  std::vector<TaskPool::Task> tasks;
+  for (size_t i = 0; i < chunks; ++i) tasks.push_back([&process, i]() { process(i); });
+  pool.run(tasks);
+}
+
+// Description of empty frames.
+const ImageDescription kNoDescription;
+
+// Bytes allocator holds for the buffer at pData of size bytes, size classes round requests up.
+size_t getHeldBytes(const Allocator& allocator, const void* pData, size_t size) {
+  const size_t allocated = allocator.allocatedSize(pData);
+  return allocated ? allocated : size;
+}
+
+MemoryTag& getDecodedTag() {
+  static MemoryTag& tag = MemoryAccounting::instance().tag("decoded frames");
+  return tag;
+}
+
+}  // namespace
+
+bool isWorthCompressing(const ImageDescription& description) {
+  const int32_t format = description.opengl_format;
+  if (format == -1 || isBlockCompressedFormat(format)) return false;
+  // low bits of floating point samples are mostly noise
+  return getChannels(format).type != Channels::FormatType::FLOATING_POINT;
+}
+
+struct CachedFrame::State {
+  std::mutex mutex;
+  FrameData decoded;
+  ImageDescription description;
+  size_t size = 0;
+  size_t weight = 0;  // held by the allocator for the pixels or the chunks, constant
+  std::shared_ptr<char> pCompressed;
+  std::vector<Chunk> chunks;
+
+  ~State() {
+    if (isCompressed() && isDecoded()) getDecodedTag().remove(size);
+  }
+
+  bool isCompressed() const { return !chunks.empty(); }
+  bool isDecoded() const { return decoded.getData().size() == size; }
+
+  // Chunks never change once constructed, no need to lock.
+  FrameData decompress(const Allocator& allocator) const {
+    FrameData frame;
+    auto data = frame.setDescriptionAndAllocate(description, allocator);
+    CHECK(data.size() == size);
+    std::vector<char> failed(chunks.size(), 0);
+    forEachChunk(chunks.size(), [&](size_t i) {
+      const size_t begin = i * kChunkBytes;
+      const size_t chunkSize = std::min(kChunkBytes, size - begin);
+      const Chunk& chunk = chunks[i];
+      failed[i] = !lz4Decompress(pCompressed.get() + chunk.offset, chunk.size, data.begin() + begin, chunkSize);
+    });
+    for (const char chunkFailed : failed)
+      if (chunkFailed) throw std::runtime_error("Corrupted compressed frame in the image cache");
+    return frame;
+  }
+
+  // Called with the mutex held.
+  void keepDecoded(FrameData&& frame) {
+    if (isCompressed() && !isDecoded()) getDecodedTag().add(size);
+    decoded = std::move(frame);
+  }
+};
+
+CachedFrame::CachedFrame(FrameData&& frame, bool compress, bool keepDecoded, const Allocator& allocator)
+    : m_pState(std::make_shared<State>()) {
+  State& state = *m_pState;
+  state.description = frame.getDescription();
+  const ConstMemorySlice data = frame.getData();
+  state.size = data.size();
+  if (compress && state.size > 0) {
+    const size_t chunks = (state.size + kChunkBytes - 1) / kChunkBytes;
+    std::vector<std::vector<char>> compressed(chunks);
+    forEachChunk(chunks, [&](size_t i) {
+      const size_t begin = i * kChunkBytes;
+      const size_t chunkSize = std::min(kChunkBytes, state.size - begin);
+      auto& buffer = compressed[i];
+      buffer.resize(getLz4CompressBound(chunkSize));
+      buffer.resize(lz4Compress(data.begin() + begin, chunkSize, buffer.data()));
+    });
+    size_t compressedSize = 0;
+    for (const auto& buffer : compressed) compressedSize += buffer.size();
+    if (isSmallEnough(compressedSize, state.size)) {
+      state.pCompressed = make_shared_memory<char>(compressedSize, allocator);
+      state.chunks.resize(chunks);
+      size_t offset = 0;
+      for (size_t i = 0; i < chunks; ++i) {
+        std::copy(compressed[i].begin(), compressed[i].end(), state.pCompressed.get() + offset);
+        state.chunks[i].offset = offset;
+        state.chunks[i].size = compressed[i].size();
+        offset += compressed[i].size();
+      }
+      state.weight = getHeldBytes(allocator, state.pCompressed.get(), compressedSize);
+    }
+  }
+  if (state.isCompressed() && !keepDecoded) return;
+  frame.persistDataIfNeeded(allocator);
+  if (!state.isCompressed() && state.size > 0)
+    state.weight = getHeldBytes(allocator, frame.getData().begin(), state.size);
+  state.keepDecoded(std::move(frame));
+}
+
+// The weight never changes once constructed, no need to lock.
+size_t CachedFrame::getWeight() const { return m_pState ? m_pState->weight : 0; }
+
+bool CachedFrame::isCompressed() const { return m_pState && m_pState->isCompressed(); }
+
+bool CachedFrame::isDecoded() const {
+  if (!m_pState) return false;
+  std::lock_guard<std::mutex> lock(m_pState->mutex);
+  return m_pState->isDecoded();
+}
+
+const ImageDescription& CachedFrame::getDescription() const {
+  return m_pState ? m_pState->description : kNoDescription;
+}
+
+size_t CachedFrame::getDecodedSize() const { return m_pState ? m_pState->size : 0; }
+
+FrameData CachedFrame::getFrame(const Allocator& allocator) const {
+  if (!m_pState) return FrameData();
+  {
+    std::lock_guard<std::mutex> lock(m_pState->mutex);
+    if (m_pState->isDecoded()) {
+      if (m_pState->isCompressed()) getDecodedTag().hit();
+      return m_pState->decoded;
+    }
+  }
+  // decompressed without the lock, the rehydration thread is not held up meanwhile
+  getDecodedTag().miss();
+  return m_pState->decompress(allocator);
+}
+
+void CachedFrame::decode(const Allocator& allocator) {
+  if (!m_pState || isDecoded()) return;
+  FrameData frame = m_pState->decompress(allocator);
+  std::lock_guard<std::mutex> lock(m_pState->mutex);
+  if (!m_pState->isDecoded()) m_pState->keepDecoded(std::move(frame));
+}
+
+void CachedFrame::dropDecoded() {
+  if (!m_pState) return;
+  std::lock_guard<std::mutex> lock(m_pState->mutex);
+  if (!m_pState->isCompressed() || !m_pState->isDecoded()) return;
+  getDecodedTag().remove(m_pState->size);
+  m_pState->decoded = FrameData();
+}
+
+} /* namespace duke */
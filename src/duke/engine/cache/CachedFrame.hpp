@@ -0,0 +1,48 @@
+#pragma once
+
+#include "duke/image/FrameData.hpp"
+
+#include <memory>
+
+struct Allocator;
+
+namespace duke {
+
+// True for frames losslessly compressing well and fast : integer channels, not already block compressed.
+bool isWorthCompressing(const ImageDescription& description);
+
+/**
+ * A frame of the image cache.
+ * Frames worth it are kept as LZ4 chunks, their decoded pixels only while they are about to be displayed,
+ * see LoadedImageCache. The kept pixels are accounted in the "decoded frames" memory tag. Chunks are
+ * compressed and decompressed in parallel on the task pool. Copies share the same frame, all functions
+ * are thread safe.
+ */
+class CachedFrame {
+ public:
+  CachedFrame() = default;
+  // Keeps the pixels decoded if they are not compressed.
+  CachedFrame(FrameData&& frame, bool compress, bool keepDecoded, const Allocator& allocator);
+
+  // Bytes accounted by the cache, the compressed size of compressed frames. Includes the rounding of the
+  // allocator size classes when it reports them, see Allocator::allocatedSize.
+  size_t getWeight() const;
+  bool isCompressed() const;
+  bool isDecoded() const;
+  // Description and size of the decoded frame, nothing is decompressed.
+  const ImageDescription& getDescription() const;
+  size_t getDecodedSize() const;
+
+  // The decoded frame. Frames not kept decoded are decompressed for this call only.
+  FrameData getFrame(const Allocator& allocator) const;
+  // Keeps the decoded pixels of a compressed frame until dropDecoded.
+  void decode(const Allocator& allocator);
+  // Releases the decoded pixels of a compressed frame.
+  void dropDecoded();
+
+ private:
+  struct State;
+  std::shared_ptr<State> m_pState;
+};
+
+} /* namespace duke */
@@ -2,17 +2,43 @@
 
 #include "duke/attributes/AttributeKeys.hpp"
 #include "duke/base/Check.hpp"
+#include "duke/base/TaskPool.hpp"
+#include "duke/engine/cache/TiledFrame.hpp"
 #include "duke/memory/Allocator.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
 
 namespace duke {
 
-LoadedImageCache::LoadedImageCache(unsigned workerThreadDefault, size_t maxSizeDefault)
-    : m_MaxWeight(maxSizeDefault),
+namespace {
+
+// Frames from the cued one on kept decoded, enough to play back while the next ones get decoded.
+const size_t kHotFrames = 16;
+// Share of the cache budget kept for the decoded pixels of hot frames, the weight only counts compressed chunks.
+const size_t kHotShare = 8;
+
+}  // namespace
+
+LoadedImageCache::LoadedImageCache(unsigned workerThreadDefault, size_t maxSizeDefault, NumaPlacement numaPlacement,
+                                   ProxyFormat proxyFormat, bool compressColdFrames)
+    : m_HotBytes(compressColdFrames ? maxSizeDefault / kHotShare : 0),
+      m_MaxWeight(maxSizeDefault - m_HotBytes),
       m_Cache(m_MaxWeight),
       m_TimelineHasMovie(false),
-      m_WorkerCount(workerThreadDefault) {}
+      m_WorkerCount(workerThreadDefault),
+      m_NumaPlacement(numaPlacement),
+      m_ProxyFormat(proxyFormat),
+      m_CompressColdFrames(compressColdFrames),
+      m_StopRehydration(false) {
+  // Created before workers and the render thread are placed on numa nodes, pool threads would otherwise
+  // inherit the cpus and memory policy of the node of the thread first using it.
+  TaskPool::instance();
+  if (m_CompressColdFrames) startRehydration();
+}
 
-LoadedImageCache::~LoadedImageCache() { stopWorkers(); }
+LoadedImageCache::~LoadedImageCache() {
+  stopWorkers();
+  stopRehydration();
+}
 
 void LoadedImageCache::setWorkerCount(size_t workerCount) {
   if (workerCount == m_WorkerCount) return;
@@ -21,6 +47,13 @@ void LoadedImageCache::setWorkerCount(size_t workerCount) {
   startWorkers();
 }
 
+void LoadedImageCache::setProxyFormat(ProxyFormat proxyFormat) {
+  CHECK(m_WorkerThreads.empty()) << "Proxy format set while workers are running";
+  m_ProxyFormat = proxyFormat;
+}
+
+ProxyFormat LoadedImageCache::getProxyFormat() const { return m_ProxyFormat; }
+
 namespace {
 
 bool clipIsForwardStream(const std::pair<size_t, Clip> &pair) {
@@ -41,23 +74,47 @@ void LoadedImageCache::load(const Timeline &timeline) {
   m_Timeline = timeline;
   m_MediaRanges = getMediaRanges(m_Timeline);
   m_TimelineHasMovie = timelineHasMovie(m_Timeline);
+  {
+    std::lock_guard<std::mutex> lock(m_HotMutex);
+    m_HotFrames.clear();
+  }
+  // Frames of the previous timeline are gone, giving their memory back.
+  getFrameAllocator().trim();
   if (m_MediaRanges.empty()) return;
   startWorkers();
   cue(m_MediaRanges.begin()->first, m_TimelineHasMovie ? IterationMode::FORWARD : IterationMode::PINGPONG);
 }
 
 void LoadedImageCache::cue(size_t frame, IterationMode mode) {
+  if (m_CompressColdFrames) updateHotFrames(frame);
   m_Cache.process(TimelineIterator(&m_Timeline, &m_MediaRanges, frame, mode));
 }
 
-void LoadedImageCache::terminate() { stopWorkers(); }
+void LoadedImageCache::terminate() {
+  stopWorkers();
+  stopRehydration();
+}
+
+bool LoadedImageCache::get(const MediaFrameReference &id, FrameData &data) const {
+  CachedFrame cached;
+  if (!m_Cache.get(id, cached)) return false;
+  data = cached.getFrame(getFrameAllocator());
+  return true;
+}
 
-bool LoadedImageCache::get(const MediaFrameReference &id, FrameData &data) const { return m_Cache.get(id, data); }
+bool LoadedImageCache::getDescription(const MediaFrameReference &id, ImageDescription &description) const {
+  CachedFrame cached;
+  if (!m_Cache.get(id, cached)) return false;
+  description = cached.getDescription();
+  return true;
+}
 
-uint64_t LoadedImageCache::dumpState(std::map<const IMediaStream *, std::vector<Range> > &state) const {
-  state.clear();
+uint64_t LoadedImageCache::dumpState(std::map<const IMediaStream *, std::vector<Range> > &previousState,
+                                     bool *pChanged) const {
+  std::map<const IMediaStream *, std::vector<Range> > state;
 
   const auto currentWeight = m_Cache.dumpKeys(m_DumpStateTmp);
+  MemoryAccounting::instance().tag("image cache").set(currentWeight, m_DumpStateTmp.size());
   std::sort(begin(m_DumpStateTmp), end(m_DumpStateTmp));
 
   const IMediaStream *pLastMedia = nullptr;
@@ -81,9 +138,22 @@ uint64_t LoadedImageCache::dumpState(std::map<const IMediaStream *, std::vector<
   }
   if (pLastMedia != nullptr) state.insert(std::make_pair(pLastMedia, std::move(mediaRanges)));
 
+  const bool changed = state != previousState;
+  if (changed) previousState.swap(state);
+  if (pChanged) *pChanged = changed;
   return currentWeight;
 }
 
+void LoadedImageCache::setFrameDecodedCallback(const std::function<void()> &callback) {
+  std::lock_guard<std::mutex> lock(m_CallbackMutex);
+  m_FrameDecodedCallback = callback;
+}
+
+void LoadedImageCache::notifyFrameDecoded() {
+  std::lock_guard<std::mutex> lock(m_CallbackMutex);
+  if (m_FrameDecodedCallback) m_FrameDecodedCallback();
+}
+
 uint64_t LoadedImageCache::getMaxWeight() const { return m_MaxWeight; }
 
 size_t LoadedImageCache::getWorkerCount() const { return m_WorkerCount; }
@@ -91,7 +161,7 @@ size_t LoadedImageCache::getWorkerCount() const { return m_WorkerCount; }
 void LoadedImageCache::startWorkers() {
   if (!m_WorkerThreads.empty()) throw std::logic_error("You must stop workers thread before calling startWorkers");
   m_Cache.terminate(false);
-  for (size_t i = 0; i < m_WorkerCount; ++i) m_WorkerThreads.emplace_back(&LoadedImageCache::workerFunction, this);
+  for (size_t i = 0; i < m_WorkerCount; ++i) m_WorkerThreads.emplace_back(&LoadedImageCache::workerFunction, this, i);
 }
 
 void LoadedImageCache::stopWorkers() {
@@ -100,13 +170,110 @@ void LoadedImageCache::stopWorkers() {
   m_WorkerThreads.clear();
 }
 
-namespace {
+// Frame buffers are first touched by the worker decoding them so binding the
+// worker to a node also makes its buffers local to this node.
+void LoadedImageCache::placeWorker(size_t workerIndex) const {
+  const auto& topology = getNumaTopology();
+  if (m_NumaPlacement == NumaPlacement::NONE || !topology.isNuma()) return;
+  const NumaNode* pNode = nullptr;
+  if (m_NumaPlacement == NumaPlacement::GPU) pNode = topology.findNode(topology.gpuNode);
+  if (!pNode) pNode = &topology.nodes[workerIndex % topology.nodes.size()];
+  if (!bindCurrentThreadToNode(*pNode)) printf("Unable to bind worker %lu to numa node %d\n", workerIndex, pNode->id);
+}
+
+// Frames that would be tiled stay as decoded, tiles are uploaded uncompressed.
+bool LoadedImageCache::isProxyEncoded(const ImageDescription &description) const {
+  return m_ProxyFormat != ProxyFormat::NONE && description.width <= kMaxUntiledSize &&
+         description.height <= kMaxUntiledSize && canEncodeProxy(description);
+}
 
-AlignedMalloc alignedMalloc;
+bool LoadedImageCache::isHotFrame(const MediaFrameReference &mfr) const {
+  std::lock_guard<std::mutex> lock(m_HotMutex);
+  return m_HotFrames.count(mfr) > 0;
+}
 
-}  // namespace
+// Called from the render thread, decoding and dropping are left to the rehydration thread so the cue never waits.
+// The window spans the frames LoadedTextureCache::prepare prefetches, forward whatever the cue mode, as long as
+// their decoded pixels fit in the hot share of the budget.
+void LoadedImageCache::updateHotFrames(size_t frame) {
+  TimelineIterator itr(&m_Timeline, &m_MediaRanges, frame, IterationMode::FORWARD);
+  itr.setMaxFrameIterations(kHotFrames);
+  std::set<MediaFrameReference> hotFrames;
+  std::vector<CachedFrame> toDecode;
+  CachedFrame cached;
+  size_t hotBytes = 0;
+  size_t frameBytes = 0;
+  while (!itr.empty()) {
+    const MediaFrameReference mfr = itr.next();
+    if (!mfr.pStream || hotFrames.count(mfr)) continue;
+    const bool inCache = m_Cache.get(mfr, cached);
+    // frames still to be read are assumed as large as the previous one and compressed
+    if (inCache) frameBytes = cached.getDecodedSize();
+    const size_t decodedBytes = !inCache || cached.isCompressed() ? frameBytes : 0;
+    if (hotBytes + decodedBytes > m_HotBytes) break;
+    hotBytes += decodedBytes;
+    hotFrames.insert(mfr);
+    if (inCache && cached.isCompressed()) toDecode.push_back(cached);
+  }
+  std::set<MediaFrameReference> previousHotFrames(hotFrames);
+  {
+    std::lock_guard<std::mutex> lock(m_HotMutex);
+    m_HotFrames.swap(previousHotFrames);
+  }
+  std::vector<CachedFrame> toDrop;
+  for (const auto &mfr : previousHotFrames)
+    if (!hotFrames.count(mfr) && m_Cache.get(mfr, cached) && cached.isCompressed()) toDrop.push_back(cached);
+  {
+    std::lock_guard<std::mutex> lock(m_RehydrationMutex);
+    // nearest frames first, a pending window is superseded by the new one
+    m_ToDecode.swap(toDecode);
+    m_ToDrop.insert(m_ToDrop.end(), toDrop.begin(), toDrop.end());
+  }
+  m_RehydrationCondition.notify_one();
+}
+
+void LoadedImageCache::startRehydration() {
+  m_StopRehydration = false;
+  m_RehydrationThread = std::thread(&LoadedImageCache::rehydrationFunction, this);
+}
+
+void LoadedImageCache::stopRehydration() {
+  if (!m_RehydrationThread.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(m_RehydrationMutex);
+    m_StopRehydration = true;
+  }
+  m_RehydrationCondition.notify_one();
+  m_RehydrationThread.join();
+}
+
+void LoadedImageCache::rehydrationFunction() {
+  for (;;) {
+    std::vector<CachedFrame> toDecode;
+    std::vector<CachedFrame> toDrop;
+    {
+      std::unique_lock<std::mutex> lock(m_RehydrationMutex);
+      m_RehydrationCondition.wait(lock, [this]() {
+        return m_StopRehydration || !m_ToDecode.empty() || !m_ToDrop.empty();
+      });
+      if (m_StopRehydration) return;
+      toDecode.swap(m_ToDecode);
+      toDrop.swap(m_ToDrop);
+    }
+    for (CachedFrame &frame : toDrop) frame.dropDecoded();
+    std::vector<TaskPool::Task> tasks;
+    for (CachedFrame &frame : toDecode) tasks.push_back([&frame]() { frame.decode(getFrameAllocator()); });
+    try {
+      TaskPool::instance().run(tasks);
+    }
+    catch (std::exception &e) {
+      printf("Something bad happened while decompressing image : %s\n", e.what());
+    }
+  }
+}
 
-void LoadedImageCache::workerFunction() {
+void LoadedImageCache::workerFunction(size_t workerIndex) {
+  placeWorker(workerIndex);
   MediaFrameReference mfr;
   try {
     for (;;) {
@@ -115,15 +282,24 @@ void LoadedImageCache::workerFunction() {
       ReadFrameResult result(mfr.pStream->process(mfr.frame));
 
       if (result) {
-        result.frame.persistDataIfNeeded(alignedMalloc);
-        const size_t weight = result.frame.getData().size();
-        m_Cache.push(mfr, weight, std::move(result.frame));
+        if (isProxyEncoded(result.frame.getDescription()))
+          encodeProxy(result.frame, m_ProxyFormat, getFrameAllocator());
+        const ImageDescription &description = result.frame.getDescription();
+        // tiled frames hand their pixels to the render thread, they are not decompressed there
+        const bool compress = m_CompressColdFrames && isWorthCompressing(description) &&
+                              description.width <= kMaxUntiledSize && description.height <= kMaxUntiledSize;
+        // hot frames are about to be displayed, they stay decoded along their compressed copy
+        CachedFrame cached(std::move(result.frame), compress, isHotFrame(mfr), getFrameAllocator());
+        const size_t weight = cached.getWeight();
+        m_Cache.push(mfr, weight, std::move(cached));
+        notifyFrameDecoded();
       } else {
         CHECK(result.reader);
         using namespace attribute;
         const auto &metadata = result.reader->getContainerDescription().metadata;
         printf("error while reading %s : %s\n", getWithDefault<File>(metadata), result.error.c_str());
-        m_Cache.push(mfr, 1UL, FrameData());
+        m_Cache.push(mfr, 1UL, CachedFrame());
+        notifyFrameDecoded();
       }
     }
   }
@@ -2,47 +2,95 @@
 
 #include <concurrent/cache/lookahead_cache.hpp>
 #include "duke/base/NonCopyable.hpp"
+#include "duke/engine/cache/CachedFrame.hpp"
 #include "duke/engine/cache/TimelineIterator.hpp"
 #include "duke/engine/Timeline.hpp"
+#include "duke/image/BlockCompression.hpp"
 #include "duke/image/FrameData.hpp"
+#include "duke/memory/NumaTopology.hpp"
 #include "duke/streams/IMediaStream.hpp"
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
 #include <thread>
 #include <vector>
 
 namespace duke {
 
 struct LoadedImageCache : public noncopyable {
-  LoadedImageCache(unsigned workerThreadDefault, size_t maxSizeDefault);
+  // Workers turn the frames they decode into proxyFormat blocks when possible.
+  // With compressColdFrames, frames out of the window following the cued frame are kept LZ4 compressed.
+  // An eighth of maxSizeDefault is then kept for the decoded pixels of the window.
+  LoadedImageCache(unsigned workerThreadDefault, size_t maxSizeDefault,
+                   NumaPlacement numaPlacement = NumaPlacement::NONE, ProxyFormat proxyFormat = ProxyFormat::NONE,
+                   bool compressColdFrames = false);
   ~LoadedImageCache();
 
   void setWorkerCount(size_t workerCount);
+  // Workers read it, must be called before load.
+  void setProxyFormat(ProxyFormat proxyFormat);
+  ProxyFormat getProxyFormat() const;
   void load(const Timeline &timeline);
   void cue(size_t frame, IterationMode mode);
   void terminate();
 
+  // Frames not kept decoded are decompressed by the call, only the uploads should ask for the pixels.
   bool get(const MediaFrameReference &id, FrameData &data) const;
-  uint64_t dumpState(std::map<const IMediaStream *, std::vector<Range> > &state) const;
+  bool getDescription(const MediaFrameReference &id, ImageDescription &description) const;
+  // Fills state with the cached frame ranges per stream and returns the cache weight.
+  // pChanged is set to whether state differs from the previous dump.
+  uint64_t dumpState(std::map<const IMediaStream *, std::vector<Range> > &state, bool *pChanged = nullptr) const;
+  // Called from the workers each time a frame enters the cache, nullptr to stop.
+  void setFrameDecodedCallback(const std::function<void()> &callback);
   uint64_t getMaxWeight() const;
   size_t getWorkerCount() const;
 
  private:
   void startWorkers();
   void stopWorkers();
-  void workerFunction();
+  void workerFunction(size_t workerIndex);
+  void placeWorker(size_t workerIndex) const;
+  bool isProxyEncoded(const ImageDescription &description) const;
+  bool isHotFrame(const MediaFrameReference &mfr) const;
+  void updateHotFrames(size_t frame);
+  void startRehydration();
+  void stopRehydration();
+  void rehydrationFunction();
+  void notifyFrameDecoded();
 
   typedef MediaFrameReference ID_TYPE;
   typedef uint64_t METRIC_TYPE;
-  typedef FrameData DATA_TYPE;
+  typedef CachedFrame DATA_TYPE;
   typedef TimelineIterator WORK_UNIT_RANGE;
 
-  size_t m_MaxWeight;
+  size_t m_HotBytes;   // decoded pixels of the hot compressed frames
+  size_t m_MaxWeight;  // the rest of the budget
   concurrent::cache::lookahead_cache<ID_TYPE, METRIC_TYPE, DATA_TYPE, WORK_UNIT_RANGE> m_Cache;
   std::vector<std::thread> m_WorkerThreads;
   Timeline m_Timeline;
   Ranges m_MediaRanges;
   bool m_TimelineHasMovie;
   size_t m_WorkerCount;
+  NumaPlacement m_NumaPlacement;
+  ProxyFormat m_ProxyFormat;
+  bool m_CompressColdFrames;
+
+  // Frames from the cued one on, kept decoded when cold frames are compressed.
+  mutable std::mutex m_HotMutex;
+  std::set<MediaFrameReference> m_HotFrames;
+
+  // Frames entering and leaving the hot window, decoded and dropped off the render thread.
+  std::mutex m_RehydrationMutex;
+  std::condition_variable m_RehydrationCondition;
+  std::vector<CachedFrame> m_ToDecode;
+  std::vector<CachedFrame> m_ToDrop;
+  bool m_StopRehydration;
+  std::thread m_RehydrationThread;
+
+  std::mutex m_CallbackMutex;
+  std::function<void()> m_FrameDecodedCallback;
 
   mutable std::vector<MediaFrameReference> m_DumpStateTmp;
 };
@@ -2,6 +2,7 @@
 
 #include "duke/engine/cache/LoadedImageCache.hpp"
 #include "duke/image/ImageUtils.hpp"
+#include "duke/time/Clock.hpp"
 
 namespace duke {
 
@@ -14,14 +15,23 @@ bool LoadedPboCache::get(const LoadedImageCache& imageCache, const MediaFrameRef
     if (!inCache || dataSize == 0) return false;
     evictOneIfNecessary();
     auto pSharedPbo = m_PboPool.get(dataSize);
-    {  // transfer buffer
+    {  // a recycled buffer may still be the source of a transfer
+      StopWatch watch;
+      if (pSharedPbo->waitForTransfers()) {
+        ++m_Waits;
+        m_WaitedUs += watch.elapsedMicroSeconds().count();
+      }
+      ++m_Writes;
+    }
+    {  // transfer buffer, synchronized above
       const auto target = pSharedPbo->target;
       const auto offset = 0;
       const auto length = dataSize;
-      const auto access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+      const auto access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
       const auto data = frame.getData();
       auto pboBound = pSharedPbo->scope_bind_buffer();
       void* destPtr = glMapBufferRange(target, offset, length, access);
+      if (!destPtr) return false;  // the pbo goes back to the pool
       memcpy(destPtr, data.begin(), data.size());
       glUnmapBuffer(target);
     }
@@ -50,4 +60,12 @@ void LoadedPboCache::evictOneIfNecessary() {
   }
 }
 
+PboStats LoadedPboCache::takeStats() {
+  PboStats stats;
+  stats.writes = m_Writes.exchange(0);
+  stats.waits = m_Waits.exchange(0);
+  stats.waitedUs = m_WaitedUs.exchange(0);
+  return stats;
+}
+
 } /* namespace duke */
@@ -6,13 +6,26 @@
 #include "duke/engine/cache/PboPool.hpp"
 #include "duke/base/NonCopyable.hpp"
 
+#include <atomic>
+#include <cstdint>
+
 namespace duke {
 
 struct LoadedImageCache;
 
+// How often a pooled buffer was still read by the gpu when about to be written.
+struct PboStats {
+  size_t writes = 0;
+  size_t waits = 0;
+  uint64_t waitedUs = 0;
+};
+
 struct LoadedPboCache : public noncopyable {
   bool get(const LoadedImageCache& imageCache, const MediaFrameReference& mfr, PboPackedFrame& pbo);
 
+  // Stats since the previous call, callable from any thread.
+  PboStats takeStats();
+
  private:
   void moveFront(const MediaFrameReference& mfr);
   void evictOneIfNecessary();
@@ -21,6 +34,9 @@ struct LoadedPboCache : public noncopyable {
   PboPool m_PboPool;
   std::map<MediaFrameReference, PboPackedFrame> m_Map;
   std::vector<MediaFrameReference> m_Fifo;
+  std::atomic<size_t> m_Writes{0};
+  std::atomic<size_t> m_Waits{0};
+  std::atomic<uint64_t> m_WaitedUs{0};
 };
 
 } /* namespace duke */
@@ -1,51 +1,214 @@
 #include "LoadedTextureCache.hpp"
 #include "duke/cmdline/CmdLineParameters.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/GlUtils.hpp"
 #include <algorithm>
+#include <cstdio>
 
 namespace duke {
 
+namespace {
+
+// Frames prefetched by prepare, more when uploads do not block the render thread.
+const size_t kPrefetchedFrames = 2;
+const size_t kUploadThreadPrefetchedFrames = 4;
+
+const char* getProxyExtension(ProxyFormat format) {
+  switch (format) {
+    case ProxyFormat::BC1:
+      return "GL_EXT_texture_compression_s3tc";
+    case ProxyFormat::BC7:
+      return "GL_ARB_texture_compression_bptc";
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace
+
 template <typename Map, typename F>
 void map_erase_if(Map& m, F pred) {
   for (auto i = std::begin(m); (i = std::find_if(i, std::end(m), pred)) != std::end(m);) m.erase(i++);
 }
 
 LoadedTextureCache::LoadedTextureCache(const CmdLineParameters& parameters)
-    : m_ImageCache(parameters.workerThreadDefault, parameters.imageCacheSizeDefault), m_LastFrame(0) {}
+    : m_ImageCache(parameters.workerThreadDefault, parameters.getCachedFrameBytes(), parameters.numaPlacement,
+                   parameters.proxyFormat, parameters.compressCache),
+      m_LastFrame(0),
+      m_NumaPlacement(parameters.numaPlacement) {}
+
+LoadedTextureCache::~LoadedTextureCache() {
+  m_pUploader.reset();
+  for (const auto& uploading : m_Uploading) glDeleteSync(uploading.fence);
+  for (const auto& uploading : m_UploadingTiles) glDeleteSync(uploading.fence);
+  for (const auto& retired : m_Retired) glDeleteSync(retired.fence);
+}
+
+void LoadedTextureCache::startUploadThread(std::unique_ptr<IGlContext> pContext) {
+  m_pUploader.reset(
+      new TextureUploader(std::move(pContext), m_ImageCache, m_PboCache, m_TexturePool, m_NumaPlacement));
+}
+
+bool LoadedTextureCache::hasUploadThread() const { return m_pUploader && !m_pUploader->hasFailed(); }
+
+void LoadedTextureCache::checkProxySupport() {
+  const char* pExtension = getProxyExtension(m_ImageCache.getProxyFormat());
+  if (!pExtension || hasGlExtension(pExtension)) return;
+  printf("%s is not supported by the driver, frames are not proxied\n", pExtension);
+  m_ImageCache.setProxyFormat(ProxyFormat::NONE);
+}
+
+void LoadedTextureCache::collectUploadTimings(std::vector<UploadTiming>& timings) {
+  if (m_pUploader) m_pUploader->collectTimings(timings);
+}
 
 void LoadedTextureCache::load(const Timeline& timeline) {
   m_Timeline = timeline;
   m_TimelineRanges = getMediaRanges(m_Timeline);
+  if (m_pUploader) m_pUploader->request({});
   m_ImageCache.load(timeline);
 }
 
+// The uploads the thread completed are still collected, the tiles it did not upload are uploaded here.
+// Only the render context uses the pooled textures from now on, retired ones are released right away.
+void LoadedTextureCache::stopFailedUploadThread() {
+  if (!m_pUploader || !m_pUploader->hasFailed()) return;
+  std::vector<TileUpload> tiles;
+  m_pUploader->collect(m_Uploading);
+  m_pUploader->collectTiles(m_UploadingTiles);
+  m_pUploader->takeRequestedTiles(tiles);
+  m_pUploader.reset();
+  for (auto& tile : tiles) {
+    glDeleteSync(tile.fence);
+    m_TileCache.get(*tile.pFrame, tile.tile);
+  }
+  for (const auto& retired : m_Retired) glDeleteSync(retired.fence);
+  m_Retired.clear();
+}
+
 void LoadedTextureCache::prepare(size_t frame, IterationMode mode) {
+  stopFailedUploadThread();
+  m_TileCache.nextFrame();
+  uploadTiles();
   if (frame != m_LastFrame) {
     m_ImageCache.cue(frame, mode);
     m_LastFrame = frame;
   }
   m_FrameMedia.clear();
   TimelineIterator itr(&m_Timeline, &m_TimelineRanges, frame, IterationMode::FORWARD);
-  itr.setMaxFrameIterations(2);  // loading this frame and prefetching next one
+  itr.setMaxFrameIterations(m_pUploader ? kUploadThreadPrefetchedFrames : kPrefetchedFrames);
+  m_Requests.clear();
   for (; !itr.empty();) {
     const auto mfr = itr.next();
     m_FrameMedia.insert(mfr);
     if (m_Map.find(mfr) != m_Map.end())  // already in cache
       continue;
+    // the pixels are only needed here for tiled frames, others are read by the upload
+    ImageDescription description;
+    FrameData frameData;
+    if (m_ImageCache.getDescription(mfr, description) && needsTiling(description) && m_ImageCache.get(mfr, frameData) &&
+        frameData.getData().size()) {
+      m_Map.insert({mfr, TexturePackedFrame(std::make_shared<TiledFrame>(frameData))});
+      continue;
+    }
+    if (m_pUploader) {
+      m_Requests.push_back(mfr);
+      continue;
+    }
     PboPackedFrame pboPackedFrame;
     const auto pboReady = m_PboCache.get(m_ImageCache, mfr, pboPackedFrame);
     if (pboReady) m_Map.insert({mfr, TexturePackedFrame(pboPackedFrame, m_TexturePool.get(pboPackedFrame))});
   }
+  if (m_pUploader || !m_Uploading.empty()) {
+    collectUploads();
+    const auto isUploaded = [&](const MediaFrameReference& mfr) {
+      return m_Map.find(mfr) != m_Map.end() ||
+             std::any_of(begin(m_Uploading), end(m_Uploading),
+                         [&](const UploadedTexture& uploading) { return uploading.mfr == mfr; });
+    };
+    m_Requests.erase(std::remove_if(begin(m_Requests), end(m_Requests), isUploaded), end(m_Requests));
+    if (m_pUploader) m_pUploader->request(m_Requests);
+  }
   // discarding all textures expect those fetched during this call
   const auto isOutsideCurrentFrame = [&](const Map::value_type& pair) {
     return m_FrameMedia.find(pair.first) == end(m_FrameMedia);
   };
+  if (m_pUploader) retireTextures();
   map_erase_if(m_Map, isOutsideCurrentFrame);
 }
 
+// Tiles requested while drawing the previous frame.
+void LoadedTextureCache::uploadTiles() {
+  std::vector<TileUpload> requests;
+  m_TileCache.takeRequests(requests);
+  if (!m_pUploader) {
+    for (const auto& request : requests) m_TileCache.get(*request.pFrame, request.tile);
+  } else {
+    // pooled textures may still be read by the frames in flight, the upload thread waits for them
+    for (auto& request : requests) {
+      request.pTexture = m_TileCache.acquire(*request.pFrame);
+      request.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    if (!requests.empty()) glFlush();
+    m_pUploader->requestTiles(requests);
+    m_pUploader->collectTiles(m_UploadingTiles);
+  }
+  // tiles uploaded by the thread, also after it failed
+  const auto collect = [&](const TileUpload& uploading) {
+    if (!gl::isSignaled(uploading.fence)) return false;
+    glDeleteSync(uploading.fence);
+    gl::getGlState().modifiedTexture(uploading.pTexture->id);
+    m_TileCache.insert(uploading);
+    return true;
+  };
+  m_UploadingTiles.erase(std::remove_if(begin(m_UploadingTiles), end(m_UploadingTiles), collect),
+                         end(m_UploadingTiles));
+}
+
+// Only textures the upload thread is done with are displayed, the render thread never waits on a transfer.
+void LoadedTextureCache::collectUploads() {
+  if (m_pUploader) m_pUploader->collect(m_Uploading);
+  auto& glState = gl::getGlState();
+  const auto collect = [&](UploadedTexture& uploading) {
+    const bool wanted = m_FrameMedia.find(uploading.mfr) != end(m_FrameMedia);
+    if (wanted && !gl::isSignaled(uploading.fence)) return false;
+    glDeleteSync(uploading.fence);
+    if (wanted) {
+      glState.modifiedTexture(uploading.frame.pTexture->id);
+      m_Map.insert({uploading.mfr, std::move(uploading.frame)});
+    }
+    return true;
+  };
+  m_Uploading.erase(std::remove_if(begin(m_Uploading), end(m_Uploading), collect), end(m_Uploading));
+}
+
+// The upload thread reuses pooled textures, those still read by the render context are held until it is done.
+void LoadedTextureCache::retireTextures() {
+  const auto isDone = [](const RetiredTextures& retired) {
+    if (!gl::isSignaled(retired.fence)) return false;
+    glDeleteSync(retired.fence);
+    return true;
+  };
+  m_Retired.erase(std::remove_if(begin(m_Retired), end(m_Retired), isDone), end(m_Retired));
+  RetiredTextures retired;
+  for (const auto& pair : m_Map)
+    if (pair.second.pTexture && m_FrameMedia.find(pair.first) == end(m_FrameMedia))
+      retired.textures.push_back(pair.second.pTexture);
+  if (retired.textures.empty()) return;
+  retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_Retired.push_back(std::move(retired));
+}
+
 const Timeline& LoadedTextureCache::getTimeline() const { return m_Timeline; }
 
 const LoadedImageCache& LoadedTextureCache::getImageCache() const { return m_ImageCache; }
 
+MipmapPyramidPool& LoadedTextureCache::getPyramidPool() { return m_PyramidPool; }
+
+TileCache& LoadedTextureCache::getTileCache() { return m_TileCache; }
+
+PboStats LoadedTextureCache::takePboStats() { return m_PboCache.takeStats(); }
+
 const TexturePackedFrame* LoadedTextureCache::getLoadedTexture(const MediaFrameReference& mfr) const {
   auto pFound = m_Map.find(mfr);
   if (pFound == m_Map.end()) return nullptr;
@@ -3,10 +3,15 @@
 #include "duke/base/NonCopyable.hpp"
 #include "duke/engine/cache/LoadedImageCache.hpp"
 #include "duke/engine/cache/LoadedPboCache.hpp"
+#include "duke/engine/cache/MipmapPyramidPool.hpp"
 #include "duke/engine/cache/TexturePackedFrame.hpp"
 #include "duke/engine/cache/TexturePool.hpp"
+#include "duke/engine/cache/TextureUploader.hpp"
+#include "duke/engine/cache/TiledFrame.hpp"
 #include "duke/engine/Timeline.hpp"
+#include "duke/gl/IGlContext.hpp"
 #include <map>
+#include <memory>
 #include <vector>
 
 namespace duke {
@@ -15,6 +20,17 @@ struct CmdLineParameters;
 
 struct LoadedTextureCache : public noncopyable {
   LoadedTextureCache(const CmdLineParameters& parameters);
+  ~LoadedTextureCache();
+
+  // Moves uploads to a thread owning pContext, a context sharing objects with the current one.
+  // Otherwise, or once the thread failed, frames are uploaded by prepare on the render thread.
+  void startUploadThread(std::unique_ptr<IGlContext> pContext);
+  bool hasUploadThread() const;
+  // Keeps frames as decoded if the current context can't sample the blocks of the proxy format.
+  // Must be called with a current context before load.
+  void checkProxySupport();
+  // Moves the timings of the transfers done by the upload thread since the last call to timings.
+  void collectUploadTimings(std::vector<UploadTiming>& timings);
 
   void load(const Timeline& timeline);
   void prepare(size_t frame, IterationMode mode);
@@ -22,17 +38,41 @@ struct LoadedTextureCache : public noncopyable {
   const TexturePackedFrame* getLoadedTexture(const MediaFrameReference& mfr) const;
   const Timeline& getTimeline() const;
   const LoadedImageCache& getImageCache() const;
+  MipmapPyramidPool& getPyramidPool();
+  TileCache& getTileCache();
+  // Pixel buffer stats since the previous call.
+  PboStats takePboStats();
 
  private:
+  void stopFailedUploadThread();
+  void uploadTiles();
+  void collectUploads();
+  void retireTextures();
+
+  // Textures released by the render context, given back to the pool once it is done reading them.
+  struct RetiredTextures {
+    std::vector<std::shared_ptr<Texture> > textures;
+    GLsync fence;
+  };
+
   Timeline m_Timeline;
   Ranges m_TimelineRanges;
   LoadedImageCache m_ImageCache;
   LoadedPboCache m_PboCache;
   TexturePool m_TexturePool;
+  MipmapPyramidPool m_PyramidPool;
+  TileCache m_TileCache;
   size_t m_LastFrame;
   std::set<MediaFrameReference> m_FrameMedia;
   typedef std::map<MediaFrameReference, TexturePackedFrame> Map;
   Map m_Map;
+  const NumaPlacement m_NumaPlacement;
+  std::vector<MediaFrameReference> m_Requests;
+  std::vector<UploadedTexture> m_Uploading;
+  std::vector<TileUpload> m_UploadingTiles;
+  std::vector<RetiredTextures> m_Retired;
+  // Stopped first, the thread uses the caches above.
+  std::unique_ptr<TextureUploader> m_pUploader;
 };
 
 } /* namespace duke */
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "duke/engine/cache/Pool.hpp"
+#include "duke/gl/Textures.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include <functional>
+#include <utility>
+
+namespace duke {
+
+struct MipmapPyramidPoolPolicy : public pool::PoolBase<std::pair<uint32_t, uint32_t>, MipmapPyramid> {
+ protected:
+  value_type* evictAndCreate(const key_type& key, PoolMap& map) {
+    auto* pValue = new MipmapPyramid();
+    {
+      auto bound = pValue->scope_bind_texture();
+      pValue->initialize(key.first, key.second);
+    }
+    ++count;
+    MemoryAccounting::instance().tag("mipmap pyramids").add(getMipmapPyramidSize(key.first, key.second));
+    return pValue;
+  }
+
+  key_type retrieveKey(const value_type* pData) { return {pData->width, pData->height}; }
+
+ public:
+  size_t count = 0;
+};
+
+typedef pool::Pool<MipmapPyramidPoolPolicy> MipmapPyramidPool;
+
+}  // namespace duke
@@ -10,7 +10,7 @@ namespace duke {
 struct PboPackedFrame : public ImageDescription {
   PboPackedFrame() = default;
   PboPackedFrame(const ImageDescription &other) : ImageDescription(other) {}
-  std::shared_ptr<gl::GlStreamUploadPbo> pPbo;
+  std::shared_ptr<gl::GlFencedUploadPbo> pPbo;
 };
 
 } /* namespace duke */
@@ -2,6 +2,7 @@
 
 #include "duke/engine/cache/Pool.hpp"
 #include "duke/gl/GlObjects.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
 
 #include <map>
 
@@ -9,16 +10,14 @@
 
 namespace duke {
 
-struct PboPoolPolicy : public pool::PoolBase<size_t, gl::GlStreamUploadPbo> {
+struct PboPoolPolicy : public pool::PoolBase<size_t, gl::GlFencedUploadPbo> {
  protected:
   value_type* evictAndCreate(const key_type& key, PoolMap& map) {
-    auto* pValue = new gl::GlStreamUploadPbo();
-    {
-      auto boundBuffer = pValue->scope_bind_buffer();
-      glBufferData(pValue->target, key, 0, pValue->usage);
-    }
+    auto* pValue = new gl::GlFencedUploadPbo();
+    pValue->allocate(key);
     m_KeyMap[pValue] = key;
     size += key;
+    MemoryAccounting::instance().tag("pbo pool").add(key);
     return pValue;
   }
 
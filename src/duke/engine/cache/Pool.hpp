@@ -3,6 +3,7 @@
 #include <functional>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <stack>
 
 namespace pool {
@@ -27,7 +28,9 @@ struct Pool : public BASE {
   using typename BASE::key_type;
   using typename BASE::value_type;
 
+  // Data may be released from another thread than the one getting it.
   DataPtr get(const key_type& key) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
     auto& stack = m_Pool[key];
     if (!stack.empty()) {
       DataPtr pData = std::move(stack.top());
@@ -38,10 +41,14 @@ struct Pool : public BASE {
   }
 
  private:
-  void recycle(value_type* pData) { m_Pool[BASE::retrieveKey(pData)].emplace(pData, recycleFunc()); }
+  void recycle(value_type* pData) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Pool[BASE::retrieveKey(pData)].emplace(pData, recycleFunc());
+  }
   inline std::function<void(value_type*)> recycleFunc() {
     return std::bind(&Pool::recycle, this, std::placeholders::_1);
   }
+  std::mutex m_Mutex;
   typename BASE::PoolMap m_Pool;
 };
 
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "duke/engine/ColorSpace.hpp"
+#include "duke/engine/cache/PboPackedFrame.hpp"
+#include "duke/engine/cache/TiledFrame.hpp"
 #include "duke/image/ImageDescription.hpp"
+#include "duke/image/ImageUtils.hpp"
 #include "duke/gl/Textures.hpp"
 #include "duke/gl/GlUtils.hpp"
 
@@ -14,11 +18,25 @@ struct TexturePackedFrame : public ImageDescription {
     auto pboBound = pbo.pPbo->scope_bind_buffer();
     auto textureBound = pTexture->scope_bind_texture();
     CHECK(opengl_format != -1) << "OpenGl format must be resolved at this point";
-    auto pixelFormat = getPixelFormat(opengl_format);
-    auto pixelType = getPixelType(opengl_format);
-    glTexSubImage2D(pTexture->target, 0, 0, 0, width, height, pixelFormat, pixelType, nullptr);
+    if (isBlockCompressedFormat(opengl_format)) {
+      glCompressedTexSubImage2D(pTexture->target, 0, 0, 0, width, height, opengl_format, getImageSize(*this),
+                                nullptr);
+    } else {
+      auto pixelFormat = getPixelFormat(opengl_format);
+      auto pixelType = getPixelType(opengl_format);
+      glTexSubImage2D(pTexture->target, 0, 0, 0, width, height, pixelFormat, pixelType, nullptr);
+    }
+    pbo.pPbo->fence();
   }
+  // A frame too large for a single texture, its tiles are uploaded when displayed.
+  TexturePackedFrame(const std::shared_ptr<TiledFrame> &pTiles)
+      : ImageDescription(pTiles->frame.getDescription()), pTiles(pTiles) {}
+  // One of pTexture or pTiles is set.
   std::shared_ptr<Texture> pTexture;
+  std::shared_ptr<TiledFrame> pTiles;
+  // Built on first zoomed out display, see getOrBuildPyramid.
+  mutable std::shared_ptr<MipmapPyramid> pPyramid;
+  mutable ColorSpace pyramidColorSpace = ColorSpace::Auto;
 };
 
 } /* namespace duke */
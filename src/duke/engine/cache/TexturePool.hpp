@@ -1,7 +1,11 @@
 #pragma once
 
+#include "duke/engine/cache/Pool.hpp"
 #include "duke/gl/GlUtils.hpp"
+#include "duke/gl/Textures.hpp"
 #include "duke/image/ImageDescription.hpp"
+#include "duke/image/ImageUtils.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
 
 #include <functional>
 #include <tuple>
@@ -19,12 +23,16 @@ struct ImageDescriptionLess : std::binary_function<ImageDescription, ImageDescri
 struct TexturePoolPolicy : public pool::PoolBase<ImageDescription, Texture, ImageDescriptionLess> {
  protected:
   value_type* evictAndCreate(const key_type& key, PoolMap& map) {
-    auto* pValue = new Texture();
+    auto* pValue = new Texture(getTextureTarget(key.opengl_format));
     {
       auto bound = pValue->scope_bind_texture();
       pValue->initialize(key, nullptr);
+      // frames are displayed unfiltered, set once as pooled textures are only sampled this way
+      glTexParameteri(pValue->target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(pValue->target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     }
     ++count;
+    MemoryAccounting::instance().tag("texture pool").add(getImageSize(key));
     return pValue;
   }
 
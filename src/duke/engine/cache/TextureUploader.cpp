@@ -0,0 +1,226 @@
+#include "TextureUploader.hpp"
+
+#include "duke/engine/cache/LoadedImageCache.hpp"
+#include "duke/engine/cache/LoadedPboCache.hpp"
+#include "duke/gl/GlUtils.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <iterator>
+
+namespace duke {
+
+namespace {
+
+// Timings the render thread did not collect yet, older ones are dropped.
+const size_t kMaxTimings = 256;
+
+}  // namespace
+
+TextureUploader::TextureUploader(std::unique_ptr<IGlContext> pContext, LoadedImageCache& imageCache,
+                                 LoadedPboCache& pboCache, TexturePool& texturePool, NumaPlacement numaPlacement)
+    : m_pContext(std::move(pContext)),
+      m_ImageCache(imageCache),
+      m_PboCache(pboCache),
+      m_TexturePool(texturePool),
+      m_NumaPlacement(numaPlacement),
+      m_Failed(false) {
+  m_ImageCache.setFrameDecodedCallback(std::bind(&TextureUploader::onFrameDecoded, this));
+  m_Thread = std::thread(&TextureUploader::run, this);
+}
+
+TextureUploader::~TextureUploader() {
+  m_ImageCache.setFrameDecodedCallback(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_Condition.notify_one();
+  m_Thread.join();
+  for (const auto& uploaded : m_Uploaded) glDeleteSync(uploaded.fence);
+  for (const auto& uploaded : m_UploadedTiles) glDeleteSync(uploaded.fence);
+  for (const auto& requested : m_RequestedTiles) glDeleteSync(requested.fence);
+}
+
+void TextureUploader::request(const std::vector<MediaFrameReference>& frames) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  const auto isUploaded = [this](const MediaFrameReference& mfr) {
+    return std::any_of(begin(m_Uploaded), end(m_Uploaded),
+                       [&](const UploadedTexture& uploaded) { return uploaded.mfr == mfr; });
+  };
+  std::vector<MediaFrameReference> requested;
+  for (const auto& mfr : frames)
+    if (!isUploaded(mfr)) requested.push_back(mfr);
+  if (requested == m_Requested) return;
+  m_Requested = std::move(requested);
+  m_Changed = true;
+  m_Condition.notify_one();
+}
+
+void TextureUploader::requestTiles(std::vector<TileUpload>& tiles) {
+  if (tiles.empty()) return;
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::move(begin(tiles), end(tiles), std::back_inserter(m_RequestedTiles));
+  tiles.clear();
+  m_Changed = true;
+  m_Condition.notify_one();
+}
+
+void TextureUploader::collectTiles(std::vector<TileUpload>& uploaded) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::move(begin(m_UploadedTiles), end(m_UploadedTiles), std::back_inserter(uploaded));
+  m_UploadedTiles.clear();
+}
+
+void TextureUploader::collect(std::vector<UploadedTexture>& uploaded) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::move(begin(m_Uploaded), end(m_Uploaded), std::back_inserter(uploaded));
+  m_Uploaded.clear();
+}
+
+void TextureUploader::takeRequestedTiles(std::vector<TileUpload>& tiles) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::move(begin(m_RequestedTiles), end(m_RequestedTiles), std::back_inserter(tiles));
+  m_RequestedTiles.clear();
+}
+
+void TextureUploader::collectTimings(std::vector<UploadTiming>& timings) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  timings.insert(end(timings), begin(m_Timings), end(m_Timings));
+  m_Timings.clear();
+}
+
+// Called from the decoding workers.
+void TextureUploader::onFrameDecoded() {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Requested.empty()) return;
+    m_Decoded = true;
+  }
+  m_Condition.notify_one();
+}
+
+void TextureUploader::beginTiming(PendingTiming& pending) {
+  if (!m_TimerQueries) return;
+  glGenQueries(2, pending.queries);
+  glQueryCounter(pending.queries[0], GL_TIMESTAMP);
+}
+
+GLsync TextureUploader::endTiming(PendingTiming& pending) {
+  if (m_TimerQueries) glQueryCounter(pending.queries[1], GL_TIMESTAMP);
+  GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  // the render context polls the fence, it has to reach the gpu
+  glFlush();
+  glCheckError();
+  pending.timing.cpuEnd = duke_clock::now();
+  m_PendingTimings.push_back(pending);
+  return fence;
+}
+
+void TextureUploader::upload(TileUpload& tile) {
+  PendingTiming pending{{duke_clock::now(), duke_clock::time_point(), 0, 0}, {0, 0}};
+  glWaitSync(tile.fence, 0, GL_TIMEOUT_IGNORED);
+  glDeleteSync(tile.fence);
+  tile.fence = nullptr;
+  beginTiming(pending);
+  {
+    auto bound = tile.pTexture->scope_bind_texture();
+    uploadTile(*tile.pFrame, tile.tile, *tile.pTexture);
+  }
+  tile.fence = endTiming(pending);
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_UploadedTiles.push_back(std::move(tile));
+}
+
+bool TextureUploader::upload(const MediaFrameReference& mfr) {
+  PendingTiming pending{{duke_clock::now(), duke_clock::time_point(), 0, 0}, {0, 0}};
+  PboPackedFrame pbo;
+  if (!m_PboCache.get(m_ImageCache, mfr, pbo)) return false;
+  beginTiming(pending);
+  TexturePackedFrame frame(pbo, m_TexturePool.get(pbo));
+  GLsync fence = endTiming(pending);
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  const auto pFound = std::find(begin(m_Requested), end(m_Requested), mfr);
+  if (pFound == end(m_Requested)) {  // not wanted anymore
+    glDeleteSync(fence);
+    return true;
+  }
+  m_Requested.erase(pFound);
+  m_Uploaded.push_back({mfr, std::move(frame), fence});
+  return true;
+}
+
+void TextureUploader::readTimings(bool wait) {
+  size_t read = 0;
+  for (; read < m_PendingTimings.size(); ++read) {
+    PendingTiming& pending = m_PendingTimings[read];
+    if (!m_TimerQueries) continue;
+    if (!wait) {  // timestamps complete in order
+      GLint available = 0;
+      glGetQueryObjectiv(pending.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) break;
+    }
+    glGetQueryObjectui64v(pending.queries[0], GL_QUERY_RESULT, &pending.timing.gpuBegin);
+    glGetQueryObjectui64v(pending.queries[1], GL_QUERY_RESULT, &pending.timing.gpuEnd);
+    glDeleteQueries(2, pending.queries);
+  }
+  if (read == 0) return;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (size_t i = 0; i < read; ++i) m_Timings.push_back(m_PendingTimings[i].timing);
+    if (m_Timings.size() > kMaxTimings) m_Timings.erase(begin(m_Timings), end(m_Timings) - kMaxTimings);
+  }
+  m_PendingTimings.erase(begin(m_PendingTimings), begin(m_PendingTimings) + read);
+}
+
+void TextureUploader::run() {
+  const auto& topology = getNumaTopology();
+  if (m_NumaPlacement != NumaPlacement::NONE && topology.isNuma()) {
+    const NumaNode* pGpuNode = topology.findNode(topology.gpuNode);
+    if (!pGpuNode || !bindCurrentThreadToNode(*pGpuNode)) printf("Unable to bind upload thread to the GPU numa node\n");
+  }
+  std::vector<TileUpload> tiles;
+  try {
+    m_pContext->makeCurrent();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    m_TimerQueries = hasTimerQueries();
+    bool uploaded = false;
+    std::vector<MediaFrameReference> requested;
+    for (;;) {
+      // about to wait, reading the timings can not delay a transfer
+      if (!uploaded) readTimings(true);
+      {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        // requests changed or, for frames not decoded yet, the image cache has new frames
+        const auto ready = [this] { return m_Stop || m_Changed || m_Decoded; };
+        if (!uploaded) m_Condition.wait(lock, ready);
+        if (m_Stop) break;
+        m_Changed = false;
+        m_Decoded = false;
+        requested = m_Requested;
+        tiles.swap(m_RequestedTiles);
+      }
+      // tiles are requested once drawn, they come first
+      for (auto& tile : tiles) upload(tile);
+      uploaded = !tiles.empty();
+      tiles.clear();
+      // one frame at a time, requests may change meanwhile
+      for (const auto& mfr : requested)
+        if ((uploaded = upload(mfr))) break;
+      readTimings(false);
+    }
+    readTimings(true);
+  } catch (const std::exception& e) {
+    printf("Upload thread stopped : %s\n", e.what());
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // the tiles of the batch not uploaded yet go back with the requested ones
+    for (auto& tile : tiles)
+      if (tile.pFrame) m_RequestedTiles.push_back(std::move(tile));
+    m_Failed = true;
+  }
+  m_pContext->doneCurrent();
+}
+
+} /* namespace duke */
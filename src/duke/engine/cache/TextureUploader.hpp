@@ -0,0 +1,110 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/engine/cache/TexturePackedFrame.hpp"
+#include "duke/engine/cache/TexturePool.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/IGlContext.hpp"
+#include "duke/memory/NumaTopology.hpp"
+#include "duke/streams/MediaFrameReference.hpp"
+#include "duke/time/Clock.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace duke {
+
+struct LoadedImageCache;
+struct LoadedPboCache;
+
+// A frame transferred by the upload thread, its texture is complete once fence is signaled.
+struct UploadedTexture {
+  MediaFrameReference mfr;
+  TexturePackedFrame frame;
+  GLsync fence;
+};
+
+// Time spent transferring a frame on the upload thread. Gpu times are GL_TIMESTAMP
+// values read on the upload context, 0 without timer queries.
+struct UploadTiming {
+  duke_clock::time_point cpuBegin;
+  duke_clock::time_point cpuEnd;
+  GLuint64 gpuBegin;
+  GLuint64 gpuEnd;
+};
+
+/**
+ * Streams frames from the image cache into textures on a dedicated thread.
+ * The thread makes current a context sharing objects with the render context
+ * and follows each upload with a fence. The render thread polls the fences and
+ * only binds completed textures, a slow transfer never holds a frame back.
+ * Requested frames not decoded yet are uploaded when the image cache signals
+ * new frames. Tiles of large frames go through the same thread, into textures
+ * acquired by the render thread. While the thread runs, the pbo cache and
+ * texture pool belong to it. If it stops on an error, hasFailed is set: uploads
+ * already done can still be collected and tiles not uploaded are handed back.
+ */
+class TextureUploader : public noncopyable {
+ public:
+  TextureUploader(std::unique_ptr<IGlContext> pContext, LoadedImageCache& imageCache, LoadedPboCache& pboCache,
+                  TexturePool& texturePool, NumaPlacement numaPlacement);
+  ~TextureUploader();
+
+  // Replaces the frames to upload, most urgent first. Frames not decoded yet are retried.
+  void request(const std::vector<MediaFrameReference>& frames);
+  // Moves the frames uploaded since the last call to uploaded.
+  void collect(std::vector<UploadedTexture>& uploaded);
+  // Queues the upload of tiles, emptying it. Unlike frames, tiles are uploaded even if requested again.
+  void requestTiles(std::vector<TileUpload>& tiles);
+  // Moves the tiles uploaded since the last call to uploaded.
+  void collectTiles(std::vector<TileUpload>& uploaded);
+  // Moves the timings of the transfers completed by the gpu since the last call to timings.
+  void collectTimings(std::vector<UploadTiming>& timings);
+  // True once the thread stopped on an error, nothing is uploaded anymore.
+  bool hasFailed() const { return m_Failed; }
+  // Moves the tiles requested but not uploaded to tiles, once the thread has failed.
+  void takeRequestedTiles(std::vector<TileUpload>& tiles);
+
+ private:
+  struct PendingTiming {
+    UploadTiming timing;
+    GLuint queries[2];
+  };
+
+  void run();
+  bool upload(const MediaFrameReference& mfr);
+  void upload(TileUpload& tile);
+  void beginTiming(PendingTiming& pending);
+  // Fences the transfer and keeps its timing to be read.
+  GLsync endTiming(PendingTiming& pending);
+  void onFrameDecoded();
+  // Reads the timer queries of the transfers, waiting for the gpu or only those available.
+  void readTimings(bool wait);
+
+  const std::unique_ptr<IGlContext> m_pContext;
+  LoadedImageCache& m_ImageCache;
+  LoadedPboCache& m_PboCache;
+  TexturePool& m_TexturePool;
+  const NumaPlacement m_NumaPlacement;
+  std::mutex m_Mutex;
+  std::condition_variable m_Condition;
+  bool m_Stop = false;
+  bool m_Changed = false;
+  bool m_Decoded = false;
+  std::atomic<bool> m_Failed;
+  std::vector<MediaFrameReference> m_Requested;
+  std::vector<UploadedTexture> m_Uploaded;
+  std::vector<TileUpload> m_RequestedTiles;
+  std::vector<TileUpload> m_UploadedTiles;
+  std::vector<UploadTiming> m_Timings;
+  // upload thread only
+  bool m_TimerQueries = false;
+  std::vector<PendingTiming> m_PendingTimings;
+  std::thread m_Thread;
+};
+
+} /* namespace duke */
@@ -0,0 +1,174 @@
+#include "TiledFrame.hpp"
+
+#include "duke/base/Check.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/image/ImageUtils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+
+namespace duke {
+
+namespace {
+
+GLint getMaxTextureSize() {
+  GLint size = 0;
+  glGetIntegerv(GL_MAX_RECTANGLE_TEXTURE_SIZE, &size);
+  return size;
+}
+
+uint64_t getNextTiledFrameId() {
+  static std::atomic<uint64_t> id(0);
+  return ++id;
+}
+
+int getOverviewFactor(glm::ivec2 dimensions) {
+  int factor = 1;
+  while (std::max(dimensions.x, dimensions.y) > int(kMaxOverviewSize) * factor) factor *= 2;
+  return factor;
+}
+
+ImageDescription getTileDescription(const TiledFrame& frame) {
+  const ImageDescription& description = frame.frame.getDescription();
+  ImageDescription tileDescription;
+  tileDescription.width = tileDescription.height = kTileSize + 2 * kTileBorder;
+  tileDescription.channels = description.channels;
+  tileDescription.opengl_format = description.opengl_format;
+  return tileDescription;
+}
+
+}  // namespace
+
+bool needsTiling(const ImageDescription& description) {
+  if (isBlockCompressedFormat(description.opengl_format)) return false;
+  static const uint32_t maxSize = std::min(kMaxUntiledSize, uint32_t(getMaxTextureSize()));
+  return description.width > maxSize || description.height > maxSize;
+}
+
+TiledFrame::TiledFrame(const FrameData& frame)
+    : frame(frame),
+      dimensions(frame.getDescription().width, frame.getDescription().height),
+      tiles((dimensions + glm::ivec2(kTileSize - 1)) / glm::ivec2(kTileSize)),
+      id(getNextTiledFrameId()),
+      overviewFactor(getOverviewFactor(dimensions)),
+      overviewDimensions((dimensions + glm::ivec2(overviewFactor - 1)) / overviewFactor) {}
+
+glm::ivec2 TiledFrame::getTileOffset(glm::ivec2 tile) const { return tile * int(kTileSize); }
+
+glm::ivec2 TiledFrame::getTileSize(glm::ivec2 tile) const {
+  return glm::min(glm::ivec2(kTileSize), dimensions - getTileOffset(tile));
+}
+
+glm::ivec2 TiledFrame::getTextureOffset(glm::ivec2 tile) const {
+  return glm::max(glm::ivec2(0), getTileOffset(tile) - int(kTileBorder));
+}
+
+glm::ivec2 TiledFrame::getTextureSize(glm::ivec2 tile) const {
+  const glm::ivec2 end = glm::min(dimensions, getTileOffset(tile) + getTileSize(tile) + int(kTileBorder));
+  return end - getTextureOffset(tile);
+}
+
+void uploadTile(const TiledFrame& frame, glm::ivec2 tile, Texture& texture) {
+  const ImageDescription& description = frame.frame.getDescription();
+  const glm::ivec2 offset = frame.getTextureOffset(tile);
+  const glm::ivec2 size = frame.getTextureSize(tile);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, description.width);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, offset.x);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, offset.y);
+  texture.update(0, 0, size.x, size.y, getPixelFormat(description.opengl_format),
+                 getPixelType(description.opengl_format), frame.frame.getData().begin());
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+}
+
+TileCache::TileCache(size_t maxBytes) : m_MaxBytes(maxBytes) {}
+
+void TileCache::nextFrame() {
+  for (auto itr = m_Overviews.begin(); itr != m_Overviews.end();)
+    if (itr->second.lastFrame < m_Frame)
+      m_Overviews.erase(itr++);
+    else
+      ++itr;
+  ++m_Frame;
+}
+
+TileCache::Key TileCache::getKey(const TiledFrame& frame, glm::ivec2 tile) {
+  CHECK(tile.x >= 0 && tile.y >= 0 && tile.x < frame.tiles.x && tile.y < frame.tiles.y) << "Invalid tile";
+  return Key(frame.id, tile.x, tile.y);
+}
+
+const Texture* TileCache::use(const Key& key) {
+  const auto pFound = m_Entries.find(key);
+  if (pFound == m_Entries.end()) return nullptr;
+  m_Lru.splice(m_Lru.begin(), m_Lru, pFound->second);
+  m_Lru.front().frame = m_Frame;
+  return m_Lru.front().pTexture.get();
+}
+
+void TileCache::add(const Key& key, std::shared_ptr<Texture> pTexture) {
+  const size_t bytes = getImageSize(pTexture->description);
+  // tiles used during this frame are still to be drawn
+  while (!m_Lru.empty() && m_Bytes + bytes > m_MaxBytes && m_Lru.back().frame != m_Frame) {
+    m_Bytes -= m_Lru.back().bytes;
+    m_Entries.erase(m_Lru.back().key);
+    m_Lru.pop_back();
+  }
+  ++m_Uploads;
+  m_Bytes += bytes;
+  m_Lru.push_front({key, std::move(pTexture), bytes, m_Frame});
+  m_Entries[key] = m_Lru.begin();
+  m_Requested.erase(key);
+}
+
+const Texture& TileCache::get(const TiledFrame& frame, glm::ivec2 tile) {
+  const Key key = getKey(frame, tile);
+  if (const Texture* pTexture = use(key)) return *pTexture;
+  auto pTexture = acquire(frame);
+  {
+    auto bound = pTexture->scope_bind_texture();
+    uploadTile(frame, tile, *pTexture);
+  }
+  add(key, std::move(pTexture));
+  return *m_Lru.front().pTexture;
+}
+
+const Texture* TileCache::find(const std::shared_ptr<const TiledFrame>& pFrame, glm::ivec2 tile) {
+  const Key key = getKey(*pFrame, tile);
+  if (const Texture* pTexture = use(key)) return pTexture;
+  if (m_Requested.insert(key).second) {
+    TileUpload request;
+    request.pFrame = pFrame;
+    request.tile = tile;
+    m_Requests.push_back(std::move(request));
+  }
+  return nullptr;
+}
+
+void TileCache::takeRequests(std::vector<TileUpload>& requests) {
+  std::move(begin(m_Requests), end(m_Requests), std::back_inserter(requests));
+  m_Requests.clear();
+}
+
+std::shared_ptr<Texture> TileCache::acquire(const TiledFrame& frame) { return m_Pool.get(getTileDescription(frame)); }
+
+void TileCache::insert(const TileUpload& upload) {
+  const Key key = getKey(*upload.pFrame, upload.tile);
+  if (m_Entries.find(key) == m_Entries.end()) add(key, upload.pTexture);
+  m_Requested.erase(key);
+}
+
+TileOverview& TileCache::getOverview(const TiledFrame& frame) {
+  TileOverview& overview = m_Overviews[frame.id];
+  if (!overview.pPyramid) {
+    const glm::uvec2 dimensions(frame.overviewDimensions);
+    overview.pPyramid = m_PyramidPool.get({dimensions.x, dimensions.y});
+    overview.drawn.assign(frame.tiles.x * frame.tiles.y, false);
+    overview.remaining = overview.drawn.size();
+  }
+  overview.lastFrame = m_Frame;
+  return overview;
+}
+
+} /* namespace duke */
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/engine/ColorSpace.hpp"
+#include "duke/engine/cache/MipmapPyramidPool.hpp"
+#include "duke/engine/cache/TexturePool.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/Textures.hpp"
+#include "duke/image/FrameData.hpp"
+
+#include <glm/glm.hpp>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace duke {
+
+// Side of the tiles large frames are split into.
+const uint32_t kTileSize = 2048;
+// Texels of the neighbouring tiles stored around each tile, filters reading a few texels away
+// from the drawn one do not show the seams.
+const uint32_t kTileBorder = 4;
+// Larger frames are rarely seen whole at full resolution.
+const uint32_t kMaxUntiledSize = 8192;
+// Largest side of the overview, the low resolution copy tiled frames are drawn from when zoomed out.
+const uint32_t kMaxOverviewSize = 4096;
+
+// True if the frame is too large to be displayed from a single texture : beyond the driver's
+// limit or kMaxUntiledSize. Block compressed frames are never tiled, they are made no larger.
+bool needsTiling(const ImageDescription& description);
+
+// A frame kept in memory and uploaded a tile at a time, see TileCache.
+struct TiledFrame : public noncopyable {
+  TiledFrame(const FrameData& frame);
+
+  // Texel origin and dimensions of tile, tiles on the right and top edges may be smaller.
+  glm::ivec2 getTileOffset(glm::ivec2 tile) const;
+  glm::ivec2 getTileSize(glm::ivec2 tile) const;
+  // Texels uploaded in the texture of tile : the tile and its border, clipped to the frame.
+  glm::ivec2 getTextureOffset(glm::ivec2 tile) const;
+  glm::ivec2 getTextureSize(glm::ivec2 tile) const;
+
+  const FrameData frame;
+  const glm::ivec2 dimensions;
+  const glm::ivec2 tiles;      // count per axis
+  const uint64_t id;           // tiles of different frames never alias
+  const int overviewFactor;    // power of two the overview is smaller than the frame by
+  const glm::ivec2 overviewDimensions;
+};
+
+// Uploads tile of frame into the bound texture.
+void uploadTile(const TiledFrame& frame, glm::ivec2 tile, Texture& texture);
+
+// A tile to upload into pTexture. On the upload thread, fence first tells when the render context is done
+// with the pooled texture, then when the tile is uploaded.
+struct TileUpload {
+  std::shared_ptr<const TiledFrame> pFrame;
+  glm::ivec2 tile;
+  std::shared_ptr<Texture> pTexture;
+  GLsync fence = nullptr;
+};
+
+// Low resolution copy of a tiled frame, tiles are drawn into it as they are uploaded.
+struct TileOverview {
+  std::shared_ptr<MipmapPyramid> pPyramid;
+  std::vector<bool> drawn;  // per tile, row major
+  size_t remaining = 0;     // tiles not drawn yet
+  bool mipmapped = false;   // levels are up to date
+  ColorSpace colorSpace = ColorSpace::Auto;
+  size_t lastFrame = 0;
+
+  bool isComplete() const { return pPyramid && remaining == 0; }
+};
+
+/**
+ * Tiles resident on the GPU. Missing tiles are requested when drawn and uploaded
+ * by the next LoadedTextureCache::prepare, on the upload thread if any. Least
+ * recently used tiles go back to the pool once maxBytes is exceeded, tiles used
+ * since nextFrame are kept even beyond. Render thread only.
+ */
+class TileCache : public noncopyable {
+ public:
+  TileCache(size_t maxBytes = size_t(1) << 30);
+
+  // Starts a frame, unpins the tiles of the previous one and drops the overviews it did not use.
+  void nextFrame();
+
+  // Texture holding tile of frame, uploading it now if needed.
+  const Texture& get(const TiledFrame& frame, glm::ivec2 tile);
+  // Texture holding tile of frame, nullptr and the tile is requested if not resident.
+  const Texture* find(const std::shared_ptr<const TiledFrame>& pFrame, glm::ivec2 tile);
+  // Moves the tiles requested since the last call to requests.
+  void takeRequests(std::vector<TileUpload>& requests);
+  // Texture for a tile of frame to be uploaded into then inserted.
+  std::shared_ptr<Texture> acquire(const TiledFrame& frame);
+  // Makes the uploaded texture of a requested tile resident.
+  void insert(const TileUpload& upload);
+
+  TileOverview& getOverview(const TiledFrame& frame);
+
+  size_t uploads() const { return m_Uploads; }
+
+ private:
+  typedef std::tuple<uint64_t, int, int> Key;
+  struct Entry {
+    Key key;
+    std::shared_ptr<Texture> pTexture;
+    size_t bytes;
+    size_t frame;  // last used
+  };
+  typedef std::list<Entry> Lru;
+
+  static Key getKey(const TiledFrame& frame, glm::ivec2 tile);
+  const Texture* use(const Key& key);
+  void add(const Key& key, std::shared_ptr<Texture> pTexture);
+
+  const size_t m_MaxBytes;
+  size_t m_Bytes = 0;
+  size_t m_Uploads = 0;
+  size_t m_Frame = 0;
+  TexturePool m_Pool;
+  MipmapPyramidPool m_PyramidPool;
+  Lru m_Lru;  // most recently used first
+  std::map<Key, Lru::iterator> m_Entries;
+  std::set<Key> m_Requested;
+  std::vector<TileUpload> m_Requests;
+  std::map<uint64_t, TileOverview> m_Overviews;
+};
+
+} /* namespace duke */
@@ -1,4 +1,5 @@
 #include "Commands.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
 #include <memory>
 
 using namespace std;
@@ -75,6 +76,19 @@ std::string FunctionCmd::execute() {
   return {};
 }
 
+std::string MemoryCmd::execute() {
+  const auto stats = MemoryAccounting::instance().snapshot();
+  return json ? toJson(stats) : toString(stats);
+}
+
+std::string MemoryCmd::doParseArguments(std::istream &stream) {
+  string format;
+  if (!(stream >> format)) return {};
+  if (format != "json") return "unknown format '" + format + "', only json is supported";
+  json = true;
+  return {};
+}
+
 SuggestParam::SuggestParam(const Parameters &params) : params(params) {}
 
 std::string SuggestParam::execute() {
@@ -58,6 +58,14 @@ class FunctionCmd : public Command {
   virtual std::string execute();
 };
 
+class MemoryCmd : public Command {
+  bool json = false;
+
+ public:
+  virtual std::string execute();
+  virtual std::string doParseArguments(std::istream &stream);
+};
+
 class SuggestParam : public Command {
   std::string value;
   const Parameters &params;
@@ -27,9 +27,7 @@ DukeSplashStream::~DukeSplashStream() {}
 namespace {
 
 void drawLetter(const GlyphRenderer& renderer, char c, float zoom, float alpha, ivec2 position) {
-  renderer.setAlpha(alpha);
-  renderer.setZoom(zoom);
-  renderer.draw(position.x, position.y, c);
+  renderer.draw(position.x, position.y, c, alpha, zoom);
 }
 
 }  // namespace
@@ -39,7 +37,6 @@ void DukeSplashStream::render(const Context& context) const {
   const size_t glyphWidth = zoom * 8;
   const auto time = context.liveTime.asMilliseconds();
   const auto& renderer = *context.pGlyphRenderer;
-  const auto bound = renderer.begin(context.viewport);
   {
     const char greetingsString[] = "Duke R0XX!!!";
     for (size_t i = 0; i < sizeof(greetingsString); ++i) {
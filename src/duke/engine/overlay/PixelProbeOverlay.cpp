@@ -0,0 +1,69 @@
+#include "PixelProbeOverlay.hpp"
+#include "duke/engine/Context.hpp"
+#include "duke/engine/rendering/GeometryRenderer.hpp"
+#include "duke/engine/rendering/GlyphRenderer.hpp"
+
+#include <sstream>
+#include <string>
+
+namespace duke {
+
+namespace {
+
+// Lines are displayed from bottom to top, each is prepended.
+void prepend(std::string &text, const std::string &line) { text = text.empty() ? line : line + '\n' + text; }
+
+std::string format(const char *pLabel, const glm::vec4 &value) {
+  std::ostringstream oss;
+  oss << std::fixed;
+  oss.precision(4);
+  oss << pLabel;
+  for (int i = 0; i < 4; ++i) oss << ' ' << value[i];
+  return oss.str();
+}
+
+}  // namespace
+
+PixelProbeOverlay::PixelProbeOverlay(const GlyphRenderer &glyphRenderer)
+    : m_GlyphRenderer(glyphRenderer), m_Probe(glyphRenderer.getGeometryRenderer()) {}
+
+void PixelProbeOverlay::probe(const Context &context) {
+  // composited layers may be centered in a part of the viewport
+  const glm::ivec2 offset = context.viewport.offset;
+  const glm::ivec2 corners[] = {regionCorners[0] - offset, regionCorners[1] - offset};
+  m_Probe.probe(context, cursor - offset, hasRegion ? corners : nullptr);
+}
+
+void PixelProbeOverlay::render(const Context &context) const {
+  const glm::ivec2 viewport = context.viewport.dimension;
+  if (hasRegion) {
+    const glm::ivec2 dimensions = glm::abs(regionCorners[1] - regionCorners[0]) + glm::ivec2(1);
+    const glm::ivec2 center = (regionCorners[0] + regionCorners[1] + glm::ivec2(1)) / 2;
+    m_GlyphRenderer.getGeometryRenderer().drawRect(viewport, dimensions, center - viewport / 2,
+                                                   glm::vec4(1, 1, 1, 0.15));
+  }
+  const ProbeReadings &readings = m_Probe.getReadings();
+  if (!readings.valid) return;
+
+  std::string text;
+  if (readings.onImage) {
+    prepend(text, "texel " + std::to_string(readings.texel.x) + ' ' + std::to_string(readings.texel.y));
+    prepend(text, format("file   ", readings.file));
+    prepend(text, format("linear ", readings.linear));
+  }
+  if (readings.onViewport) prepend(text, format("display", readings.display));
+  if (readings.regionTexels) {
+    const glm::ivec2 size = readings.regionLast - readings.regionFirst + glm::ivec2(1);
+    prepend(text, "region " + std::to_string(readings.regionFirst.x) + ' ' + std::to_string(readings.regionFirst.y) +
+                      ' ' + std::to_string(size.x) + 'x' + std::to_string(size.y));
+    prepend(text, format("file min   ", readings.regionFile.min));
+    prepend(text, format("file max   ", readings.regionFile.max));
+    prepend(text, format("file mean  ", readings.regionFile.mean));
+    prepend(text, format("linear min ", readings.regionLinear.min));
+    prepend(text, format("linear max ", readings.regionLinear.max));
+    prepend(text, format("linear mean", readings.regionLinear.mean));
+  }
+  drawText(m_GlyphRenderer, context.viewport, text.c_str(), cursor.x + 20, cursor.y + 20, 1, 1);
+}
+
+} /* namespace duke */
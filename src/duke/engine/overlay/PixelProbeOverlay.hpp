@@ -0,0 +1,34 @@
+#pragma once
+
+#include "IOverlay.hpp"
+#include "duke/engine/rendering/PixelProbe.hpp"
+
+#include <glm/glm.hpp>
+
+namespace duke {
+
+struct Context;
+struct GlyphRenderer;
+
+// Displays the values under the cursor and the statistics of the dragged region.
+class PixelProbeOverlay : public IOverlay {
+ public:
+  PixelProbeOverlay(const GlyphRenderer &);
+
+  // Reads the image context draws, positions are made relative to context's viewport, see PixelProbe::probe.
+  void probe(const Context &context);
+
+  virtual void render(const Context &) const;
+
+  // viewport positions from the bottom left
+  glm::ivec2 cursor;
+  // the region spans these opposite corners when set
+  bool hasRegion = false;
+  glm::ivec2 regionCorners[2];
+
+ private:
+  const GlyphRenderer &m_GlyphRenderer;
+  PixelProbe m_Probe;
+};
+
+} /* namespace duke */
@@ -0,0 +1,288 @@
+#include "ScopesOverlay.hpp"
+#include "duke/engine/Context.hpp"
+#include "duke/engine/rendering/GeometryRenderer.hpp"
+#include "duke/engine/rendering/ImageRenderer.hpp"
+#include "duke/engine/rendering/ShaderConstants.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/gl/Shader.hpp"
+#include "duke/gl/Textures.hpp"
+#include "duke/image/ImageDescription.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace duke {
+
+namespace {
+
+enum ScopeMode { HISTOGRAM = 0, WAVEFORM = 1, VECTORSCOPE = 2 };
+
+// Largest side of the image the scopes are computed from. Larger images are read from
+// context.pCurrentPyramid when set, otherwise from the 25 taps the image shader averages
+// per pixel when zoomed out : images more than 5 times larger are subsampled.
+const int kMaxSourceSize = 512;
+const int kPanelSize = 256;
+const int kPanelMargin = 10;
+
+const char pSplatVertexShader[] = R"(
+#version 330
+
+uniform sampler2D gScopeSampler;
+uniform int gScopeMode;
+
+flat out vec4 vColor;
+
+const vec3 kLuma = vec3(0.2126, 0.7152, 0.0722);  // Rec. 709
+
+// Center of the bin holding value in [0, 1].
+float bin(float value) {
+    return (floor(clamp(value, 0.0, 1.0) * 255.0 + 0.5) + 0.5) / 256.0;
+}
+
+void main() {
+    ivec2 size = textureSize(gScopeSampler, 0);
+    ivec2 texel = ivec2(gl_VertexID % size.x, gl_VertexID / size.x);
+    vec3 color = clamp(texelFetch(gScopeSampler, texel, 0).rgb, 0.0, 1.0);
+    float luma = dot(color, kLuma);
+    // one instance per channel : red, green, blue then luma
+    vec4 channel = vec4(equal(ivec4(gl_InstanceID), ivec4(0, 1, 2, 3)));
+    float value = dot(vec4(color, luma), channel);
+    vec2 position;
+    if (gScopeMode == 0) {
+        position = vec2(bin(value), 0.5);
+        vColor = channel;
+    } else if (gScopeMode == 1) {
+        position = vec2((texel.x + 0.5) / size.x, bin(value));
+        vColor = channel;
+    } else {
+        // Rec. 709 color difference, counts and colors are accumulated
+        vec2 chroma = vec2((color.b - luma) / 1.8556, (color.r - luma) / 1.5748);
+        position = vec2(bin(chroma.x + 0.5), bin(chroma.y + 0.5));
+        vColor = vec4(color, 1);
+    }
+    gl_Position = vec4(position * 2 - 1, 0, 1);
+})";
+
+const char pSplatFragmentShader[] = R"(
+#version 330
+
+flat in vec4 vColor;
+out vec4 vFragColor;
+
+void main(void)
+{
+    vFragColor = vColor;
+})";
+
+const char pDisplayVertexShader[] = R"(
+#version 330
+
+smooth out vec2 vUV;
+
+void main() {
+    // unit square as a triangle strip
+    vUV = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = vec4(vUV * 2 - 1, 0, 1);
+})";
+
+const char pDisplayFragmentShader[] = R"(
+#version 330
+
+uniform sampler2D gScopeSampler;
+uniform int gScopeMode;
+uniform float gScopeScale;  // inverse of the highest count for histograms, density gain otherwise
+
+smooth in vec2 vUV;
+out vec4 vFragColor;
+
+const vec4 kBackground = vec4(0, 0, 0, 0.6);
+
+void main(void)
+{
+    ivec2 size = textureSize(gScopeSampler, 0);
+    vec4 counts = texelFetch(gScopeSampler, min(ivec2(vUV * size), size - 1), 0);
+    vec3 color;
+    float intensity;
+    if (gScopeMode == 0) {
+        counts = texelFetch(gScopeSampler, ivec2(min(int(vUV.x * size.x), size.x - 1), 0), 0) * gScopeScale;
+        vec4 filled = vec4(lessThan(vec4(vUV.y), counts));
+        color = max(filled.rgb, vec3(filled.a * 0.5));
+        intensity = max(max(filled.r, filled.g), max(filled.b, filled.a)) * 0.8;
+    } else if (gScopeMode == 1) {
+        color = 1 - exp(-counts.rgb * gScopeScale);
+        intensity = max(color.r, max(color.g, color.b));
+    } else {
+        color = counts.rgb / max(counts.a, 1);
+        intensity = 1 - exp(-counts.a * gScopeScale);
+        // axes
+        if (any(lessThan(abs(vUV - 0.5), vec2(0.5 / size)))) intensity = max(intensity, 0.3);
+        if (counts.a == 0) color = vec3(1);
+    }
+    vFragColor = mix(kBackground, vec4(color, 1), intensity);
+})";
+
+void clearToZero() {
+  const GLfloat zero[] = {0, 0, 0, 0};
+  glClearBufferfv(GL_COLOR, 0, zero);
+}
+
+}  // namespace
+
+void ScopesOverlay::Target::initialize(GLint internalFormat, glm::ivec2 newDimensions) {
+  if (dimensions == newDimensions) return;
+  dimensions = newDimensions;
+  {
+    auto bound = texture.scope_bind_texture();
+    glTexImage2D(texture.target, 0, internalFormat, dimensions.x, dimensions.y, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+  frameBuffer.bind();
+  frameBuffer.attachColor(texture);
+  frameBuffer.checkComplete();
+}
+
+ScopesOverlay::ScopesOverlay(const GeometryRenderer &renderer)
+    : m_GeometryRenderer(renderer),
+      m_SplatProgram(makeVertexShader(pSplatVertexShader), makeFragmentShader(pSplatFragmentShader)),
+      m_DisplayProgram(makeVertexShader(pDisplayVertexShader), makeFragmentShader(pDisplayFragmentShader)) {
+  GLint previousFrameBuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  m_Histograms.initialize(GL_RGBA32F, glm::ivec2(kScopeBins, 1));
+  m_Waveform.initialize(GL_RGBA32F, glm::ivec2(kScopeBins, kScopeBins));
+  m_Vectorscope.initialize(GL_RGBA32F, glm::ivec2(kScopeBins, kScopeBins));
+  gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+  for (auto &readback : m_Readbacks) {
+    auto bound = readback.pbo.scope_bind_buffer();
+    glBufferData(readback.pbo.target, kScopeBins * 4 * sizeof(float), nullptr, readback.pbo.usage);
+  }
+  m_Histogram.counts.resize(kScopeBins * 4);
+  glCheckError();
+}
+
+ScopesOverlay::~ScopesOverlay() {
+  for (auto &readback : m_Readbacks)
+    if (readback.fence) glDeleteSync(readback.fence);
+}
+
+void ScopesOverlay::render(const Context &context) const {
+  collectReadbacks();
+  if (!context.pCurrentTexture || !context.pCurrentImage) return;
+  GLint previousFrameBuffer = 0;
+  GLint previousViewport[4];
+  GLint blendSource = 0, blendDestination = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  glGetIntegerv(GL_VIEWPORT, previousViewport);
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+  glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination);
+  const bool blending = glIsEnabled(GL_BLEND);
+
+  glDisable(GL_BLEND);
+  resolve(context);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  {
+    auto vaoBound = m_Vao.scope_bind();
+    auto sourceBound = m_Source.texture.scope_bind_texture();
+    m_SplatProgram.use();
+    m_SplatProgram.glUniform1i(shader::gScopeSampler, 0);
+    splat(m_Histograms, HISTOGRAM, 4);
+    splat(m_Waveform, WAVEFORM, 3);
+    splat(m_Vectorscope, VECTORSCOPE, 1);
+  }
+  readBack();
+
+  gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+  glBlendFunc(blendSource, blendDestination);
+  draw(context);
+  if (!blending) glDisable(GL_BLEND);
+  glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+  glCheckError();
+}
+
+// Draws the current image as displayed, fitted in the source target.
+void ScopesOverlay::resolve(const Context &context) const {
+  const ImageDescription &image = *context.pCurrentImage;
+  const float scale = float(kMaxSourceSize) / std::max(image.width, image.height);
+  const glm::ivec2 dimensions(std::max(1, int(image.width * scale)), std::max(1, int(image.height * scale)));
+  m_Source.initialize(GL_RGBA16F, dimensions);
+  m_Source.frameBuffer.bind();
+  glViewport(0, 0, dimensions.x, dimensions.y);
+  clearToZero();
+  Context resolving = context;
+  resolving.viewport = Viewport(glm::ivec2(), dimensions);
+  resolving.zoom = scale;
+  resolving.pan = glm::ivec2();
+  auto textureBound = context.pCurrentTexture->scope_bind_texture();
+  renderWithBoundTexture(m_GeometryRenderer.shaderPool, m_GeometryRenderer.meshPool.getSquare().get(), resolving);
+}
+
+void ScopesOverlay::splat(const Target &target, int mode, GLsizei instances) const {
+  target.frameBuffer.bind();
+  glViewport(0, 0, target.dimensions.x, target.dimensions.y);
+  clearToZero();
+  m_SplatProgram.glUniform1i(shader::gScopeMode, mode);
+  glDrawArraysInstanced(GL_POINTS, 0, m_Source.dimensions.x * m_Source.dimensions.y, instances);
+  gl::getGlState().called();
+}
+
+// Copies the histograms to a pixel buffer, skipped while both buffers are in flight.
+void ScopesOverlay::readBack() const {
+  Readback &readback = m_Readbacks[m_NextReadback];
+  if (readback.fence) return;
+  m_Histograms.frameBuffer.bind();
+  auto bound = readback.pbo.scope_bind_buffer();
+  glReadPixels(0, 0, kScopeBins, 1, GL_RGBA, GL_FLOAT, nullptr);
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_NextReadback = (m_NextReadback + 1) % 2;
+}
+
+// Maps the pixel buffers the gpu is done with, oldest first, never waits.
+void ScopesOverlay::collectReadbacks() const {
+  for (size_t i = 0; i < 2; ++i) {
+    Readback &readback = m_Readbacks[(m_NextReadback + i) % 2];
+    if (!readback.fence || !gl::isSignaled(readback.fence)) continue;
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    auto bound = readback.pbo.scope_bind_buffer();
+    const size_t bytes = m_Histogram.counts.size() * sizeof(float);
+    const void *pData = glMapBufferRange(readback.pbo.target, 0, bytes, GL_MAP_READ_BIT);
+    if (!pData) continue;
+    memcpy(m_Histogram.counts.data(), pData, bytes);
+    glUnmapBuffer(readback.pbo.target);
+    m_Histogram.maxCount = *std::max_element(m_Histogram.counts.begin(), m_Histogram.counts.end());
+  }
+}
+
+// Panels side by side in the top right corner of the viewport.
+void ScopesOverlay::draw(const Context &context) const {
+  const Viewport &viewport = context.viewport;
+  const float samples = m_Source.dimensions.x * m_Source.dimensions.y;
+  // gains bringing an evenly spread image to a mid intensity
+  const float waveformGain = 2 * kScopeBins * kScopeBins / samples;
+  const float vectorscopeGain = 64 * kScopeBins * kScopeBins / samples;
+  const struct {
+    const Target &target;
+    int mode;
+    float scale;
+  } panels[] = {{m_Histograms, HISTOGRAM, m_Histogram.maxCount > 0 ? 1 / m_Histogram.maxCount : 0},
+                {m_Waveform, WAVEFORM, waveformGain},
+                {m_Vectorscope, VECTORSCOPE, vectorscopeGain}};
+  auto vaoBound = m_Vao.scope_bind();
+  m_DisplayProgram.use();
+  m_DisplayProgram.glUniform1i(shader::gScopeSampler, 0);
+  int x = viewport.offset.x + viewport.dimension.x;
+  const int y = viewport.offset.y + viewport.dimension.y - kPanelMargin - kPanelSize;
+  for (int i = 2; i >= 0; --i) {
+    x -= kPanelMargin + kPanelSize;
+    glViewport(x, y, kPanelSize, kPanelSize);
+    auto bound = panels[i].target.texture.scope_bind_texture();
+    m_DisplayProgram.glUniform1i(shader::gScopeMode, panels[i].mode);
+    m_DisplayProgram.glUniform1f(shader::gScopeScale, panels[i].scale);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    gl::getGlState().called();
+  }
+}
+
+} /* namespace duke */
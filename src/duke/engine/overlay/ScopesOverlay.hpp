@@ -0,0 +1,76 @@
+#pragma once
+
+#include "IOverlay.hpp"
+#include "duke/gl/GlObjects.hpp"
+#include "duke/gl/Program.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace duke {
+
+struct Context;
+struct GeometryRenderer;
+
+// Bins of the histograms and waveform, values of the vectorscope axes.
+const int kScopeBins = 256;
+
+// Red, green, blue and luma counts of each histogram bin, interleaved.
+struct ScopeHistogram {
+  std::vector<float> counts;
+  float maxCount = 0;
+};
+
+/**
+ * Histograms, waveform and vectorscope of the current image, computed on the gpu.
+ * The image is first drawn as displayed into a small render target, from
+ * context.pCurrentPyramid when set so every texel is accounted for. Each of
+ * its pixels is then splatted as a point into float targets with additive
+ * blending, the scopes are drawn from these targets.
+ * The histogram is read back asynchronously through pixel buffers, frames
+ * later, to scale its display.
+ */
+class ScopesOverlay : public IOverlay {
+ public:
+  ScopesOverlay(const GeometryRenderer &renderer);
+  virtual ~ScopesOverlay();
+
+  virtual void render(const Context &) const;
+
+  // Histogram of a frame displayed recently, empty until the first readback completes.
+  const ScopeHistogram &getHistogram() const { return m_Histogram; }
+
+ private:
+  struct Target {
+    void initialize(GLint internalFormat, glm::ivec2 dimensions);
+
+    gl::GlTexture2D texture;
+    gl::GlFrameBufferObject frameBuffer;
+    glm::ivec2 dimensions;
+  };
+  struct Readback {
+    gl::GlStreamReadPbo pbo;
+    GLsync fence = nullptr;
+  };
+
+  void resolve(const Context &context) const;
+  void splat(const Target &target, int mode, GLsizei instances) const;
+  void readBack() const;
+  void collectReadbacks() const;
+  void draw(const Context &context) const;
+
+  const GeometryRenderer &m_GeometryRenderer;
+  mutable Program m_SplatProgram;
+  mutable Program m_DisplayProgram;
+  const gl::GlVertexArrayObject m_Vao;  // attributeless, vertices are generated from their id
+  mutable Target m_Source;
+  mutable Target m_Histograms;
+  mutable Target m_Waveform;
+  mutable Target m_Vectorscope;
+  mutable Readback m_Readbacks[2];
+  mutable size_t m_NextReadback = 0;
+  mutable ScopeHistogram m_Histogram;
+};
+
+} /* namespace duke */
@@ -24,21 +24,27 @@ void StatisticsOverlay::render(const Context& context) const {
                             glm::vec4(1, 1, 1, 0.2));                                                      // color
 
   // draw cache state
-  for (const Track& track : m_Timeline) {
-    for (const auto& clip : track) {
-      if (clip.second.pStream) {
-        const auto it = cacheState.find(clip.second.pStream.get());
-        if (it != cacheState.end())
-          for (const auto range : it->second) {
-            size_t rangeLength = frameLength * (range.last - range.first + 1);
-            geometryRenderer.drawRect(
-                context.viewport.dimension, glm::ivec2(rangeLength, height),                                  // size
-                glm::ivec2(frameLength * (clip.first + range.first) + rangeLength / 2.f + xOffset, yOffset),  // pan
-                glm::vec4(1, 1, 1, 0.4));                                                                     // color
-          }
+  if (cacheStateChanged || m_CacheBarViewport != context.viewport.dimension) {
+    m_CacheBar.clear();
+    for (const Track& track : m_Timeline) {
+      for (const auto& clip : track) {
+        if (clip.second.pStream) {
+          const auto it = cacheState.find(clip.second.pStream.get());
+          if (it != cacheState.end())
+            for (const auto range : it->second) {
+              size_t rangeLength = frameLength * (range.last - range.first + 1);
+              const glm::ivec2 size(rangeLength, height);
+              const glm::ivec2 pan(frameLength * (clip.first + range.first) + rangeLength / 2.f + xOffset, yOffset);
+              m_CacheBar.push_back({size, pan});
+            }
+        }
       }
     }
+    m_CacheBarViewport = context.viewport.dimension;
+    cacheStateChanged = false;
   }
+  for (const auto& rect : m_CacheBar)
+    geometryRenderer.drawRect(context.viewport.dimension, rect.dimensions, rect.pan, glm::vec4(1, 1, 1, 0.4));
 
   // draw cursor
   geometryRenderer.drawRect(
@@ -55,6 +61,18 @@ void StatisticsOverlay::render(const Context& context) const {
   oss.precision(2);
   oss << frameMetronom.getFPS() << "  FPS" << '\n';
   oss << "zoom " << context.zoom << "x";
+  oss << '\n' << presentation.late << " late " << presentation.repeated << " repeated " << presentation.dropped
+      << " dropped";
+  oss << '\n' << glCalls << " gl calls (" << glSkippedCalls << " skipped)";
+  oss << '\n' << pboWaits << '/' << pboWrites << " pbo writes waited";
+  for (size_t stage = 0; stage < size_t(ProfiledStage::_END); ++stage)
+    oss << '\n' << toString(ProfiledStage(stage)) << " cpu " << timings.cpuMs[stage] << " ms gpu "
+        << timings.gpuMs[stage] << " ms";
+  for (const auto& stat : memory) {
+    oss << '\n' << stat.tag << ' ' << stat.bytes / (1024 * 1024) << " MiB (peak " << stat.peakBytes / (1024 * 1024)
+        << ')';
+    if (stat.hits + stat.misses > 0) oss << ' ' << stat.hits << '/' << stat.hits + stat.misses << " hits";
+  }
 #ifndef NDEBUG  // adding vblank in case in debug mode
   oss << '\n' << vBlankMetronom.getFPS() << " VBPS";
 #endif
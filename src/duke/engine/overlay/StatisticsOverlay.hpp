@@ -1,8 +1,13 @@
 #pragma once
 
 #include "IOverlay.hpp"
+#include "duke/engine/FrameProfiler.hpp"
+#include "duke/engine/PresentationScheduler.hpp"
 #include "duke/engine/Timeline.hpp"
 #include "duke/time/Clock.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include <glm/glm.hpp>
 
 namespace duke {
 
@@ -16,12 +21,31 @@ class StatisticsOverlay : public duke::IOverlay {
   virtual void render(const Context&) const;
 
   std::map<const IMediaStream*, std::vector<Range> > cacheState;
+  // Set when cacheState is updated, the cache bar is rebuilt on next render.
+  mutable bool cacheStateChanged = true;
   Metronom vBlankMetronom;
   Metronom frameMetronom;
+  std::vector<MemoryTagStats> memory;
+  // gl calls of the last frame
+  size_t glCalls = 0;
+  size_t glSkippedCalls = 0;
+  // pixel buffer writes and how many waited for the gpu
+  size_t pboWrites = 0;
+  size_t pboWaits = 0;
+  PresentationStats presentation;
+  // stage times of the last frame completed by the gpu
+  FrameTimings timings;
 
  private:
+  struct Rect {
+    glm::ivec2 dimensions;
+    glm::ivec2 pan;
+  };
+
   const GlyphRenderer& m_GlyphRenderer;
   const Timeline& m_Timeline;
+  mutable std::vector<Rect> m_CacheBar;
+  mutable glm::ivec2 m_CacheBarViewport;
 };
 
 } /* namespace duke */
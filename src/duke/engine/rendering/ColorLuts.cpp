@@ -0,0 +1,97 @@
+#include "ColorLuts.hpp"
+
+#include "duke/engine/rendering/ShaderConstants.hpp"
+#include "duke/engine/rendering/ShaderFactory.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/Program.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace duke {
+
+namespace {
+
+enum : GLint {
+  INPUT_LUT_UNIT = 1,
+  SCREEN_LUT_UNIT = 2,
+  DISPLAY_LUT_UNIT = 3
+};
+
+GLint getMaxSize(bool is3d) {
+  GLint maxSize = 0;
+  glGetIntegerv(is3d ? GL_MAX_3D_TEXTURE_SIZE : GL_MAX_TEXTURE_SIZE, &maxSize);
+  return maxSize;
+}
+
+}  // namespace
+
+LutTexture::LutTexture(const Lut& lut)
+    : texture(lut.type == LutType::LUT_3D ? GL_TEXTURE_3D : GL_TEXTURE_1D), bytes(lut.data.size() * sizeof(float)) {
+  const bool is3d = lut.type == LutType::LUT_3D;
+  const GLint maxSize = getMaxSize(is3d);
+  if (lut.size > size_t(maxSize))
+    throw std::runtime_error("lut: " + std::to_string(lut.size) + " entries exceed the " + std::to_string(maxSize) +
+                             " texels supported by this GPU");
+  auto bound = texture.scope_bind_texture();
+  const auto target = texture.target;
+  if (is3d)
+    glTexImage3D(target, 0, GL_RGB32F, lut.size, lut.size, lut.size, 0, GL_RGB, GL_FLOAT, lut.data.data());
+  else
+    glTexImage1D(target, 0, GL_RGB32F, lut.size, 0, GL_RGB, GL_FLOAT, lut.data.data());
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glCheckError();
+  MemoryAccounting::instance().tag("color luts").add(bytes);
+}
+
+LutTexture::~LutTexture() { MemoryAccounting::instance().tag("color luts").remove(bytes); }
+
+void ColorLuts::setDisplayLut(const Lut& lut) {
+  m_pDisplayLut.reset(new LutTexture(lut));
+  m_DisplayLut = lut;
+  if (lut.type != LutType::LUT_1D) m_DisplayLut.data.clear();
+  // screen luts may have the previous display lut folded in
+  m_ColorSpaceLuts.clear();
+}
+
+LutType ColorLuts::getDisplayLutType() const { return m_pDisplayLut ? m_DisplayLut.type : LutType::NONE; }
+
+const gl::GlTextureObject& ColorLuts::getColorSpaceLut(ColorSpace colorspace, bool toLinear) const {
+  auto& pTexture = m_ColorSpaceLuts[std::make_pair(colorspace, toLinear)];
+  if (!pTexture) {
+    if (toLinear)
+      pTexture.reset(new LutTexture(bakeToLinear(colorspace)));
+    else if (getDisplayLutType() == LutType::LUT_1D)
+      pTexture.reset(new LutTexture(compose(bakeToScreen(colorspace), m_DisplayLut)));
+    else
+      pTexture.reset(new LutTexture(bakeToScreen(colorspace)));
+  }
+  return pTexture->texture;
+}
+
+void ColorLuts::bind(Program& program, const ShaderDescription& description) const {
+  if (description.usesInputLut()) {
+    gl::bindToUnit(INPUT_LUT_UNIT, getColorSpaceLut(description.fileColorspace, true));
+    program.glUniform1i(shader::gInputLut, INPUT_LUT_UNIT);
+  }
+  if (description.usesScreenLut()) {
+    gl::bindToUnit(SCREEN_LUT_UNIT, getColorSpaceLut(description.screenColorspace, false));
+    program.glUniform1i(shader::gScreenLut, SCREEN_LUT_UNIT);
+  }
+  if (description.usesDisplayLut() && !description.foldsDisplayLut() && m_pDisplayLut) {
+    gl::bindToUnit(DISPLAY_LUT_UNIT, m_pDisplayLut->texture);
+    program.glUniform1i(shader::gDisplayLut, DISPLAY_LUT_UNIT);
+    program.glUniform3f(shader::gDisplayLutMin, m_DisplayLut.domainMin[0], m_DisplayLut.domainMin[1],
+                        m_DisplayLut.domainMin[2]);
+    program.glUniform3f(shader::gDisplayLutMax, m_DisplayLut.domainMax[0], m_DisplayLut.domainMax[1],
+                        m_DisplayLut.domainMax[2]);
+  }
+}
+
+} /* namespace duke */
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/engine/ColorSpace.hpp"
+#include "duke/engine/Lut.hpp"
+#include "duke/gl/GlObjects.hpp"
+
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace duke {
+
+struct Program;
+struct ShaderDescription;
+
+/**
+ * A lut uploaded to a texture, its bytes are accounted for as long as it lives.
+ * Throws std::runtime_error if the lut exceeds the texture size limits.
+ */
+struct LutTexture : public noncopyable {
+  explicit LutTexture(const Lut& lut);
+  ~LutTexture();
+
+  gl::GlTextureObject texture;
+  const size_t bytes;
+};
+
+/**
+ * Lut textures sampled by the image shaders: colorspace conversions baked on
+ * first use and an optional display lut loaded from file.
+ * A 1D display lut is folded into the screen luts so the output is looked up once.
+ * The frame stays on texture unit 0, luts go to units 1 to 3.
+ */
+class ColorLuts : public noncopyable {
+ public:
+  void setDisplayLut(const Lut& lut);
+  LutType getDisplayLutType() const;
+
+  // Binds the luts used by description and points program's samplers to them.
+  void bind(Program& program, const ShaderDescription& description) const;
+
+ private:
+  const gl::GlTextureObject& getColorSpaceLut(ColorSpace colorspace, bool toLinear) const;
+
+  mutable std::map<std::pair<ColorSpace, bool>, std::unique_ptr<LutTexture>> m_ColorSpaceLuts;
+  std::unique_ptr<LutTexture> m_pDisplayLut;
+  Lut m_DisplayLut;  // data is only kept for 1D luts, to fold them
+};
+
+} /* namespace duke */
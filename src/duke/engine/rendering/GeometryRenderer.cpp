@@ -1,37 +1,97 @@
 #include "GeometryRenderer.hpp"
-#include "duke/gl/Mesh.hpp"
-#include "duke/engine/Context.hpp"
-#include "duke/engine/rendering/ShaderConstants.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/Shader.hpp"
+
+#include <cstddef>
 
 namespace duke {
 
 namespace {
 
-void render(const SharedProgram &pProgram, const SharedMesh &pMesh, const glm::ivec2 &viewport,
-            const glm::ivec2 &dimensions, const glm::ivec2 &pan, const glm::vec4 &color) {
-  pProgram->use();
-  pProgram->glUniform2i(shader::gImage, dimensions.x, dimensions.y);
-  pProgram->glUniform2i(shader::gViewport, viewport.x, viewport.y);
-  pProgram->glUniform4f(shader::gSolidColor, color.r, color.g, color.b, color.a);
+const char pGeometryVertexShader[] = R"(
+#version 330
 
-  pProgram->glUniform2i(shader::gPan, pan.x, pan.y);
-  pProgram->glUniform1f(shader::gZoom, 1);
+layout (location = 0) in vec2 Position;
+layout (location = 1) in vec4 Color;
 
-  pMesh->draw();
+flat out vec4 vColor;
 
-  glCheckError();
+void main() {
+    gl_Position = vec4(Position, 0, 1);
+    vColor = Color;
+})";
+
+const char pGeometryFragmentShader[] = R"(
+#version 330
+
+out vec4 vFragColor;
+flat in vec4 vColor;
+
+void main(void)
+{
+    vFragColor = vColor;
+})";
+
+// Maps a point of the [-1,1] square to normalized device coordinates, the same way the
+// image vertex shader does : centered on the viewport, panned and scaled to dimensions.
+glm::vec2 toDevice(const glm::ivec2 &viewport, const glm::ivec2 &dimensions, const glm::ivec2 &pan, float x,
+                   float y) {
+  const glm::ivec2 translating = viewport / 2 + pan;  // integer to prevent aliasing
+  const glm::vec2 pixel(translating.x + x * dimensions.x / 2.f, translating.y + y * dimensions.y / 2.f);
+  return glm::vec2(pixel.x * 2 / viewport.x - 1, pixel.y * 2 / viewport.y - 1);
 }
 
 }  // namespace
 
+GeometryRenderer::GeometryRenderer()
+    : m_Program(makeVertexShader(pGeometryVertexShader), makeFragmentShader(pGeometryFragmentShader)) {
+  auto vaoBound = m_Vao.scope_bind();
+  auto vboBound = m_Vbo.scope_bind_buffer();
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid *)offsetof(Vertex, color));
+  glEnableVertexAttribArray(1);
+  glCheckError();
+}
+
 void GeometryRenderer::drawRect(const glm::ivec2 &viewport, const glm::ivec2 &dimensions, const glm::ivec2 &pan,
                                 const glm::vec4 &color) const {
-  render(shaderPool.get(ShaderDescription::createSolidDesc()), meshPool.getSquare(), viewport, dimensions, pan, color);
+  const glm::vec2 bottomLeft = toDevice(viewport, dimensions, pan, -1, -1);
+  const glm::vec2 topRight = toDevice(viewport, dimensions, pan, 1, 1);
+  const glm::vec2 topLeft(bottomLeft.x, topRight.y);
+  const glm::vec2 bottomRight(topRight.x, bottomLeft.y);
+  push(GL_TRIANGLES, {{bottomLeft, color}, {topLeft, color}, {topRight, color},
+                      {bottomLeft, color}, {topRight, color}, {bottomRight, color}});
 }
 
 void GeometryRenderer::drawLine(const glm::ivec2 &viewport, const glm::ivec2 &dimensions, const glm::ivec2 &pan,
                                 const glm::vec4 &color) const {
-  render(shaderPool.get(ShaderDescription::createSolidDesc()), meshPool.getLine(), viewport, dimensions, pan, color);
+  push(GL_LINES,
+       {{toDevice(viewport, dimensions, pan, -1, -1), color}, {toDevice(viewport, dimensions, pan, 1, 1), color}});
 }
+
+void GeometryRenderer::push(GLenum mode, std::initializer_list<Vertex> vertices) const {
+  if (m_Batches.empty() || m_Batches.back().mode != mode) m_Batches.push_back({mode, GLint(m_Vertices.size()), 0});
+  m_Vertices.insert(m_Vertices.end(), vertices);
+  m_Batches.back().count += vertices.size();
 }
-/* namespace duke */
+
+void GeometryRenderer::flush() const {
+  if (m_Batches.empty()) return;
+  auto vaoBound = m_Vao.scope_bind();
+  {
+    auto vboBound = m_Vbo.scope_bind_buffer();
+    glBufferData(m_Vbo.target, m_Vertices.size() * sizeof(Vertex), m_Vertices.data(), m_Vbo.usage);
+  }
+  m_Program.use();
+  auto &state = gl::getGlState();
+  for (const Batch &batch : m_Batches) {
+    glDrawArrays(batch.mode, batch.first, batch.count);
+    state.called();
+  }
+  glCheckError();
+  m_Vertices.clear();
+  m_Batches.clear();
+}
+
+} /* namespace duke */
@@ -3,18 +3,53 @@
 #include "duke/base/NonCopyable.hpp"
 #include "duke/engine/rendering/MeshPool.hpp"
 #include "duke/engine/rendering/ShaderPool.hpp"
+#include "duke/gl/GlObjects.hpp"
+#include "duke/gl/Program.hpp"
 #include <glm/glm.hpp>
 
+#include <initializer_list>
+#include <vector>
+
 namespace duke {
 
+/**
+ * Draws solid colored rects and lines.
+ * Shapes are queued in viewport coordinates and drawn by flush() from a
+ * streaming vertex buffer, in the order they were queued. Consecutive shapes
+ * of the same kind share a draw call.
+ */
 struct GeometryRenderer : public noncopyable {
+  GeometryRenderer();
+
   void drawRect(const glm::ivec2 &viewport, const glm::ivec2 &dimensions, const glm::ivec2 &pan,
                 const glm::vec4 &color) const;
   void drawLine(const glm::ivec2 &viewport, const glm::ivec2 &dimensions, const glm::ivec2 &pan,
                 const glm::vec4 &color) const;
+  // Draws the shapes queued since the last flush.
+  void flush() const;
 
   ShaderPool shaderPool;
   MeshPool meshPool;
+
+ private:
+  struct Vertex {
+    glm::vec2 position;  // normalized device coordinates
+    glm::vec4 color;
+  };
+
+  struct Batch {
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+  };
+
+  void push(GLenum mode, std::initializer_list<Vertex> vertices) const;
+
+  mutable Program m_Program;
+  const gl::GlVertexArrayObject m_Vao;
+  const gl::GlStreamVbo m_Vbo;
+  mutable std::vector<Vertex> m_Vertices;
+  mutable std::vector<Batch> m_Batches;
 };
 
 } /* namespace duke */
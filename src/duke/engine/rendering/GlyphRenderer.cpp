@@ -5,8 +5,12 @@
 #include "duke/engine/rendering/GeometryRenderer.hpp"
 #include "duke/engine/rendering/MeshPool.hpp"
 #include "duke/engine/rendering/ShaderConstants.hpp"
+#include "duke/gl/GlState.hpp"
 #include "duke/io/ImageLoadUtils.hpp"
 
+#include <algorithm>
+#include <cstddef>
+
 namespace duke {
 
 namespace {
@@ -14,15 +18,15 @@ namespace {
 const char pTextVertexShader[] = R"(
 #version 330
 
-layout (location = 0) in vec3 Position;
-layout (location = 1) in vec2 UV;
+// per glyph attributes
+layout (location = 2) in ivec3 PanAndChar;
+layout (location = 3) in vec2 AlphaAndZoom;
 
 uniform ivec2 gViewport;
 uniform ivec2 gImage;
-uniform ivec3 gPanAndChar;
-uniform float gZoom;
 
-out vec2 vVaryingTexCoord; 
+smooth out vec2 vVaryingTexCoord;
+flat out float vAlpha;
 
 mat4 ortho(int left, int right, int bottom, int top) {
     mat4 Result = mat4(1);
@@ -51,10 +55,14 @@ mat4 scale(mat4 m, vec3 v) {
 }
 
 void main() {
+    // unit square as a triangle strip
+    vec2 UV = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec3 Position = vec3(UV * 2 - 1, 1);
+    float gZoom = AlphaAndZoom.y;
     const ivec2 tiles = ivec2(16);
     ivec2 translating = ivec2(0); // translation must be integer to prevent aliasing
     translating /= 2; // moving to center
-    ivec2 gPan = gPanAndChar.xy;
+    ivec2 gPan = PanAndChar.xy;
     translating += gPan; // moving to center
     vec2 scaling = vec2(1);
     scaling /= 2; // bringing square from [-1,1] to [-.5,.5]
@@ -68,25 +76,34 @@ void main() {
     mat4 worldViewProj = proj * world;
     gl_Position = worldViewProj * vec4(Position, 1.0);
     ivec2 charDim = abs(gImage) / tiles;
-    int gChar = gPanAndChar.z;
+    int gChar = PanAndChar.z;
     ivec2 charPos = ivec2(gChar%tiles.x, gChar/tiles.y);
     vVaryingTexCoord = charDim*(UV+charPos);
+    vAlpha = AlphaAndZoom.x;
 })";
 
 const char pTextFragmentShader[] = R"(#version 330
 
 out vec4 vFragColor;
 uniform sampler2DRect gTextureSampler;
-uniform float gAlpha;
 smooth in vec2 vVaryingTexCoord;
+flat in float vAlpha;
 
 void main(void)
 {
     vec4 sample = texture(gTextureSampler, vVaryingTexCoord);
-    sample.a *= gAlpha;
+    sample.a *= vAlpha;
     vFragColor = sample;
 })";
 
+// Points the per glyph attributes of the bound vao to the bound instance buffer, from glyph first.
+void setInstanceAttributes(size_t first) {
+  typedef GlyphRenderer::Glyph Glyph;
+  const size_t offset = first * sizeof(Glyph);
+  glVertexAttribIPointer(2, 3, GL_INT, sizeof(Glyph), (const GLvoid *)(offset + offsetof(Glyph, x)));
+  glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Glyph), (const GLvoid *)(offset + offsetof(Glyph, alpha)));
+}
+
 }  // namespace
 
 GlyphRenderer::GlyphRenderer(const GeometryRenderer &renderer, const char *glyphsFilename)
@@ -97,32 +114,68 @@ GlyphRenderer::GlyphRenderer(const GeometryRenderer &renderer, const char *glyph
   const auto &frame = result.frame;
   const auto &description = frame.getDescription();
   m_Attributes = description.extra_attributes;
-  const auto bound = m_GlyphsTexture.scope_bind_texture();
-  m_GlyphsTexture.initialize(description, frame.getData().begin());
+  {
+    const auto bound = m_GlyphsTexture.scope_bind_texture();
+    m_GlyphsTexture.initialize(description, frame.getData().begin());
+    glTexParameteri(m_GlyphsTexture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(m_GlyphsTexture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+  auto vaoBound = m_Vao.scope_bind();
+  auto vboBound = m_InstanceVbo.scope_bind_buffer();
+  setInstanceAttributes(0);
+  glVertexAttribDivisor(2, 1);
+  glEnableVertexAttribArray(2);
+  glVertexAttribDivisor(3, 1);
+  glEnableVertexAttribArray(3);
+  glCheckError();
+}
+
+bool GlyphRenderer::Glyph::operator==(const Glyph &other) const {
+  return x == other.x && y == other.y && glyph == other.glyph && alpha == other.alpha && zoom == other.zoom;
 }
 
-GlyphRenderer::GlyphBinder GlyphRenderer::begin(const Viewport &viewport) const {
+void GlyphRenderer::draw(int x, int y, const char glyph, float alpha, float zoom) const {
+  m_Glyphs.push_back({x, y, static_cast<unsigned char>(glyph), alpha, zoom});
+}
+
+void GlyphRenderer::flush(const Viewport &viewport) const {
+  m_GeometryRenderer.flush();
+  if (m_Flushed == m_Glyphs.size()) return;
+  const size_t first = m_Flushed;
+  const size_t count = m_Glyphs.size() - first;
+  m_Flushed = m_Glyphs.size();
+  auto vaoBound = m_Vao.scope_bind();
+  {
+    auto vboBound = m_InstanceVbo.scope_bind_buffer();
+    if (m_UploadedGlyphs.size() < m_Glyphs.size()) {
+      // growing, earlier glyphs were already drawn from the previous buffer
+      glBufferData(m_InstanceVbo.target, m_Glyphs.size() * sizeof(Glyph), m_Glyphs.data(), m_InstanceVbo.usage);
+      m_UploadedGlyphs = m_Glyphs;
+      ++m_Uploads;
+    } else if (!std::equal(m_Glyphs.begin() + first, m_Glyphs.end(), m_UploadedGlyphs.begin() + first)) {
+      glBufferSubData(m_InstanceVbo.target, first * sizeof(Glyph), count * sizeof(Glyph), m_Glyphs.data() + first);
+      std::copy(m_Glyphs.begin() + first, m_Glyphs.end(), m_UploadedGlyphs.begin() + first);
+      ++m_Uploads;
+    }
+    setInstanceAttributes(first);
+  }
   m_Program.use();
   m_Program.glUniform2i(shader::gViewport, viewport.dimension.x, viewport.dimension.y);
   m_Program.glUniform1i(shader::gTextureSampler, 0);
-  auto scopeBinded = m_GlyphsTexture.scope_bind_texture();
-  glTexParameteri(m_GlyphsTexture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(m_GlyphsTexture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   using namespace attribute;
   const auto orientation = getWithDefault<DpxImageOrientation>(m_Attributes);
   const auto &description = m_GlyphsTexture.description;
   const auto pair = getTextureDimensions(description.width, description.height, orientation);
   m_Program.glUniform2i(shader::gImage, pair.first, pair.second);
-  return std::move(scopeBinded);
+  auto textureBound = m_GlyphsTexture.scope_bind_texture();
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+  gl::getGlState().called();
+  glCheckError();
 }
 
-void GlyphRenderer::setAlpha(float alpha) const { m_Program.glUniform1f(shader::gAlpha, alpha); }
-
-void GlyphRenderer::setZoom(float zoom) const { m_Program.glUniform1f(shader::gZoom, zoom); }
-
-void GlyphRenderer::draw(int x, int y, const char glyph) const {
-  m_Program.glUniform3i(shader::gPanAndChar, x, y, glyph);
-  m_GeometryRenderer.meshPool.getSquare()->draw();
+void GlyphRenderer::endFrame() const {
+  m_Glyphs.clear();
+  m_Flushed = 0;
 }
 
 const GeometryRenderer &GlyphRenderer::getGeometryRenderer() const { return m_GeometryRenderer; }
@@ -158,7 +211,6 @@ void drawText(const GlyphRenderer &glyphRenderer, const Viewport &viewport, cons
 
   const auto &geometryRenderer = glyphRenderer.getGeometryRenderer();
 
-  auto boundSquare = geometryRenderer.meshPool.getSquare()->scope_bind();
   const glm::ivec2 glyphDim = glm::ivec2(zoom * 8);
   const glm::ivec2 rectDim = textDimensions(pText, glyphDim);
   const glm::ivec2 viewportDim(viewport.dimension);
@@ -166,9 +218,6 @@ void drawText(const GlyphRenderer &glyphRenderer, const Viewport &viewport, cons
                             glm::vec4(0, 0, 0, alpha * .8));
 
   const int xOrigin = x;
-  const auto bound = glyphRenderer.begin(viewport);
-  glyphRenderer.setAlpha(alpha);
-  glyphRenderer.setZoom(zoom);
   for (; *pText != '\0'; ++pText) {
     const char c = *pText;
     if (c == '\n') {
@@ -176,7 +225,7 @@ void drawText(const GlyphRenderer &glyphRenderer, const Viewport &viewport, cons
       y += 8 * zoom;
       continue;
     }
-    glyphRenderer.draw(x, y, c);
+    glyphRenderer.draw(x, y, c, alpha, zoom);
     x += 8 * zoom;
   }
 }
@@ -6,28 +6,52 @@
 #include "duke/gl/Mesh.hpp"
 #include "duke/attributes/Attributes.hpp"
 
+#include <vector>
+
 namespace duke {
 
 struct Viewport;
 struct GeometryRenderer;
 
+/**
+ * Renders text from a 16x16 glyphs texture.
+ * Glyphs are queued and the ones queued since the previous flush() are rendered
+ * in a single instanced draw. Flushing at each overlay boundary keeps overlays
+ * stacked in the order they were rendered. The instance buffer holds the whole
+ * frame's glyphs and is only uploaded where they differ from the previous frame.
+ */
 struct GlyphRenderer : public noncopyable {
-  typedef gl::Binder<gl::GlTextureObject> GlyphBinder;
   GlyphRenderer(const GeometryRenderer &renderer, const char *glyphsFilename = ".duke_ascii_font");
-  GlyphBinder begin(const Viewport &viewport) const;
-  void setAlpha(float alpha) const;
-  void setZoom(float zoom) const;
-  void draw(int x, int y, const char glyph) const;
+  // Queues a glyph at (x, y), in pixels from the viewport's center.
+  void draw(int x, int y, const char glyph, float alpha = 1, float zoom = 1) const;
+  // Draws the shapes queued in the geometry renderer, text backgrounds, then
+  // the glyphs queued since the last flush.
+  void flush(const Viewport &viewport) const;
+  // Next glyphs belong to a new frame.
+  void endFrame() const;
 
   const GeometryRenderer &getGeometryRenderer() const;
 
+  // Number of instance buffer uploads, for statistics.
+  size_t uploads() const { return m_Uploads; }
+
+  struct Glyph {
+    GLint x, y, glyph;
+    GLfloat alpha, zoom;
+    bool operator==(const Glyph &other) const;
+  };
+
  private:
   const GeometryRenderer &m_GeometryRenderer;
   mutable Program m_Program;
   attribute::Attributes m_Attributes;
   Texture m_GlyphsTexture;
-
-  GlyphBinder m_pTextureBind;
+  const gl::GlVertexArrayObject m_Vao;
+  const gl::GlDynamicVbo m_InstanceVbo;
+  mutable std::vector<Glyph> m_Glyphs;  // of the current frame
+  mutable size_t m_Flushed = 0;
+  mutable std::vector<Glyph> m_UploadedGlyphs;
+  mutable size_t m_Uploads = 0;
 };
 
 void drawText(const GlyphRenderer &renderer, const Viewport &viewport, const char *pText, int x, int y, float alpha = 1,
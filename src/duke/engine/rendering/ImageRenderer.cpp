@@ -1,15 +1,26 @@
 #include "ImageRenderer.hpp"
+#include "duke/base/Check.hpp"
 #include "duke/io/IO.hpp"
 #include "duke/attributes/Attributes.hpp"
 #include "duke/attributes/AttributeKeys.hpp"
 #include "duke/engine/Context.hpp"
+#include "duke/engine/Timeline.hpp"
+#include "duke/engine/cache/TexturePackedFrame.hpp"
+#include "duke/engine/cache/TiledFrame.hpp"
+#include "duke/engine/rendering/ColorLuts.hpp"
 #include "duke/engine/rendering/ShaderFactory.hpp"
 #include "duke/engine/rendering/ShaderPool.hpp"
 #include "duke/engine/rendering/ShaderConstants.hpp"
 #include "duke/filesystem/FsUtils.hpp"
+#include "duke/gl/GlState.hpp"
 #include "duke/gl/Mesh.hpp"
 #include "duke/gl/Textures.hpp"
 #include "duke/engine/ColorSpace.hpp"
+#include "duke/streams/IMediaStream.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
 
 namespace duke {
 
@@ -68,32 +79,148 @@ bool isGreyscale(size_t glPackFormat) {
   }
 }
 
-}  // namespace
+void setColorLuts(const Context &context, ShaderDescription &shaderDesc) {
+  if (!context.pColorLuts) return;
+  shaderDesc.colorLuts = true;
+  shaderDesc.displayLut = context.pColorLuts->getDisplayLutType();
+}
 
-void renderWithBoundTexture(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context) {
+ShaderDescription getTextureDesc(const ImageDescription &description, const Context &context) {
   using namespace attribute;
-  const ImageDescription &description = *context.pCurrentImage;
   const auto opengl_format = description.opengl_format;
-
   const auto &extra_attributes = description.extra_attributes;
   const auto inputColorSpace = resolve(extra_attributes, context.fileColorSpace);
-  const uint8_t imageOrientation = getWithDefault<DpxImageOrientation>(extra_attributes);
   const bool swapEndianness = getWithDefault<DpxImageSwapEndianness>(extra_attributes);
   bool redBlueSwapped = getWithDefault<ImageSwapRedAndBlue>(extra_attributes);
   if (isInternalOptimizedFormatRedBlueSwapped(opengl_format)) redBlueSwapped = !redBlueSwapped;
 
-  const ShaderDescription shaderDesc = ShaderDescription::createTextureDesc(  //
-      isGreyscale(opengl_format),                                             //
-      swapEndianness,                                                         //
-      redBlueSwapped,                                                         //
-      opengl_format == GL_RGB10_A2UI,                                         //
+  auto shaderDesc = ShaderDescription::createTextureDesc(  //
+      isGreyscale(opengl_format),                          //
+      swapEndianness,                                      //
+      redBlueSwapped,                                      //
+      opengl_format == GL_RGB10_A2UI,                      //
       inputColorSpace, context.screenColorSpace);
+  shaderDesc.compressed = isBlockCompressedFormat(opengl_format);
+  setColorLuts(context, shaderDesc);
+  return shaderDesc;
+}
+
+ShaderDescription getPyramidDesc(const Context &context) {
+  auto shaderDesc = ShaderDescription::createPyramidDesc(context.screenColorSpace);
+  setColorLuts(context, shaderDesc);
+  return shaderDesc;
+}
+
+void bindColorLuts(const Context &context, Program &program, const ShaderDescription &shaderDesc) {
+  if (context.pColorLuts) context.pColorLuts->bind(program, shaderDesc);
+}
+
+LayerDescription getLayerDesc(const ImageDescription &description, const Context &context) {
+  const ShaderDescription textureDesc = getTextureDesc(description, context);
+  LayerDescription layer;
+  layer.grayscale = textureDesc.grayscale;
+  layer.swapEndianness = textureDesc.swapEndianness;
+  layer.swapRedAndBlue = textureDesc.swapRedAndBlue;
+  layer.tenBitUnpack = textureDesc.tenBitUnpack;
+  layer.compressed = textureDesc.compressed;
+  layer.fileColorspace = textureDesc.fileColorspace;
+  return layer;
+}
+
+// The first layer is bound like single frames, the others after the color luts.
+GLint getLayerTextureUnit(size_t layer) { return layer == 0 ? 0 : 3 + layer; }
+
+// Fills level 0 with linear premultiplied samples of the bound texture then lets the driver box filter the
+// other levels.
+void buildPyramid(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context,
+                  const ImageDescription &description, const MipmapPyramid &pyramid) {
+  GLint previousFrameBuffer = 0;
+  GLint previousViewport[4];
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  glGetIntegerv(GL_VIEWPORT, previousViewport);
+  const bool blending = glIsEnabled(GL_BLEND);
+
+  pyramid.frameBuffer.bind();
+  glViewport(0, 0, description.width, description.height);
+  glDisable(GL_BLEND);
+
+  ShaderDescription shaderDesc = getTextureDesc(description, context);
+  shaderDesc.linearize = true;
   const auto pProgram = shaderPool.get(shaderDesc);
-  const auto pair = getTextureDimensions(description.width, description.height, imageOrientation);
+  pProgram->use();
+  pProgram->glUniform2i(shader::gImage, description.width, description.height);
+  pProgram->glUniform2i(shader::gViewport, description.width, description.height);
+  pProgram->glUniform1i(shader::gTextureSampler, 0);
+  pProgram->glUniform2i(shader::gPan, 0, 0);
+  pProgram->glUniform1f(shader::gZoom, 1);
+  pProgram->glUniform1i(shader::gTransposed, 0);
+  pProgram->glUniform2i(shader::gTileSize, 0, 0);
+  pProgram->glUniform2i(shader::gTileTexels, 0, 0);
+  bindColorLuts(context, *pProgram, shaderDesc);
+  pMesh->draw();
+
+  gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+  glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+  if (blending) glEnable(GL_BLEND);
+  {
+    auto boundPyramid = pyramid.scope_bind_texture();
+    glGenerateMipmap(pyramid.target);
+  }
+  glCheckError();
+}
+
+ShaderDescription getImageDesc(const Context &context, bool pyramid) {
+  return pyramid ? getPyramidDesc(context) : getTextureDesc(*context.pCurrentImage, context);
+}
+
+uint8_t getOrientation(const ImageDescription &description) {
+  return attribute::getWithDefault<attribute::DpxImageOrientation>(description.extra_attributes);
+}
+
+std::pair<int, int> getImageDimensions(const ImageDescription &description) {
+  return getTextureDimensions(description.width, description.height, getOrientation(description));
+}
+
+void resolveClipShaderState(const ShaderPool &shaderPool, const Context &context, bool pyramid,
+                            ClipShaderState &state) {
+  state.description = getImageDesc(context, pyramid);
+  state.pProgram = shaderPool.get(state.description);
+  state.dimensions = getImageDimensions(*context.pCurrentImage);
+  state.transposed = isTransposed(getOrientation(*context.pCurrentImage));
+}
+
+}  // namespace
+
+const ClipShaderState &ClipShaderCache::get(const ShaderPool &shaderPool, const Context &context, bool pyramid) {
+  const ShaderDescription description = getImageDesc(context, pyramid);
+  auto &state = m_States[description];
+  if (!state.pProgram) {
+    state.description = description;
+    state.pProgram = shaderPool.get(description);
+  }
+  state.dimensions = getImageDimensions(*context.pCurrentImage);
+  state.transposed = isTransposed(getOrientation(*context.pCurrentImage));
+  return state;
+}
+
+namespace {
+
+// Uses the program displaying context's current image and sets its uniforms, state is filled if not cached.
+const ClipShaderState &useImageProgram(const ShaderPool &shaderPool, const Context &context, bool pyramid,
+                                       ClipShaderState &uncached) {
+  if (!context.pClipShaderCache) resolveClipShaderState(shaderPool, context, pyramid, uncached);
+  const ClipShaderState &state =
+      context.pClipShaderCache ? context.pClipShaderCache->get(shaderPool, context, pyramid) : uncached;
+  const ShaderDescription &shaderDesc = state.description;
+  Program *pProgram = state.pProgram.get();
+  const auto &pair = state.dimensions;
   pProgram->use();
   pProgram->glUniform2i(shader::gImage, pair.first, pair.second);
   pProgram->glUniform2i(shader::gViewport, context.viewport.dimension.x, context.viewport.dimension.y);
-  pProgram->glUniform1i(shader::gTextureSampler, 0);
+  if (pyramid)
+    pProgram->glUniform1i(shader::gPyramidSampler, 0);
+  else
+    pProgram->glUniform1i(shader::gTextureSampler, 0);
   pProgram->glUniform2i(shader::gPan, context.pan.x, context.pan.y);
   pProgram->glUniform1f(shader::gExposure, context.exposure);
   pProgram->glUniform1f(shader::gGamma, context.gamma);
@@ -101,8 +228,332 @@ void renderWithBoundTexture(const ShaderPool &shaderPool, const Mesh *pMesh, con
                         context.channels.w);
 
   pProgram->glUniform1f(shader::gZoom, context.zoom);
+  pProgram->glUniform1i(shader::gTransposed, state.transposed);
+  pProgram->glUniform2i(shader::gTileSize, 0, 0);
+  if (!pyramid) pProgram->glUniform2i(shader::gTileTexels, 0, 0);
+  bindColorLuts(context, *pProgram, shaderDesc);
+  return state;
+}
+
+// First and last tiles of frame covered by the viewport, none if last < first.
+void getVisibleTiles(const Context &context, const TiledFrame &frame, const ClipShaderState &state, glm::ivec2 &first,
+                     glm::ivec2 &last) {
+  const glm::ivec2 image(state.dimensions.first, state.dimensions.second);
+  const glm::ivec2 viewport = context.viewport.dimension;
+  const glm::ivec2 center = viewport / 2 + context.pan;
+  for (int axis = 0; axis < 2; ++axis) {
+    // the image spans center +/- image * zoom / 2, image is negative when flipped
+    const int texelAxis = state.transposed ? 1 - axis : axis;
+    const int texels = frame.dimensions[texelAxis];
+    const float extent = image[axis] * context.zoom;
+    const float begin = (-center[axis] / extent + .5f) * texels;
+    const float end = ((viewport[axis] - center[axis]) / extent + .5f) * texels;
+    const int firstTexel = std::max(0, int(std::floor(std::min(begin, end))));
+    const int lastTexel = std::min(texels - 1, int(std::ceil(std::max(begin, end))) - 1);
+    first[texelAxis] = firstTexel / int(kTileSize);
+    last[texelAxis] = lastTexel < firstTexel ? first[texelAxis] - 1 : lastTexel / int(kTileSize);
+  }
+}
+
+// Draws tile, or the same region of the overview, with the bound program.
+void setTileUniforms(Program &program, const TiledFrame &frame, glm::ivec2 tile, bool overview) {
+  const glm::ivec2 offset = frame.getTileOffset(tile);
+  const glm::ivec2 size = frame.getTileSize(tile);
+  program.glUniform2i(shader::gTileOffset, offset.x, offset.y);
+  program.glUniform2i(shader::gTileSize, size.x, size.y);
+  // the overview is addressed in frame texels and sampled without clamping
+  if (overview) {
+    program.glUniform2i(shader::gTileOrigin, offset.x, offset.y);
+    return;
+  }
+  const glm::ivec2 origin = offset - frame.getTextureOffset(tile);
+  const glm::ivec2 texels = frame.getTextureSize(tile);
+  program.glUniform2i(shader::gTileOrigin, origin.x, origin.y);
+  program.glUniform2i(shader::gTileTexels, texels.x, texels.y);
+}
+
+// Draws the bound tile into the overview, linear and premultiplied like pyramids. Bilinear filtering
+// averages the texels each overview texel covers, the border provides those of the neighbouring tiles.
+void drawIntoOverview(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context, const TiledFrame &frame,
+                      glm::ivec2 tile, const Texture &texture, TileOverview &overview) {
+  GLint previousFrameBuffer = 0;
+  GLint previousViewport[4];
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  glGetIntegerv(GL_VIEWPORT, previousViewport);
+  const bool blending = glIsEnabled(GL_BLEND);
+
+  const MipmapPyramid &pyramid = *overview.pPyramid;
+  pyramid.frameBuffer.bind();
+  // the whole frame maps to the whole overview
+  glViewport(0, 0, pyramid.width, pyramid.height);
+  glDisable(GL_BLEND);
+
+  ShaderDescription shaderDesc = getTextureDesc(frame.frame.getDescription(), context);
+  shaderDesc.linearize = true;
+  const auto pProgram = shaderPool.get(shaderDesc);
+  pProgram->use();
+  pProgram->glUniform2i(shader::gImage, frame.dimensions.x, frame.dimensions.y);
+  pProgram->glUniform2i(shader::gViewport, frame.dimensions.x, frame.dimensions.y);
+  pProgram->glUniform1i(shader::gTextureSampler, 0);
+  pProgram->glUniform2i(shader::gPan, 0, 0);
+  pProgram->glUniform1f(shader::gZoom, 1);
+  pProgram->glUniform1i(shader::gTransposed, 0);
+  setTileUniforms(*pProgram, frame, tile, false);
+  bindColorLuts(context, *pProgram, shaderDesc);
+  // integer textures can not be filtered
+  const bool filtered = frame.overviewFactor > 1 && !shaderDesc.tenBitUnpack;
+  if (filtered) glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  pMesh->draw();
+  if (filtered) glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+  gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+  glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+  if (blending) glEnable(GL_BLEND);
+
+  const size_t index = tile.y * frame.tiles.x + tile.x;
+  if (!overview.drawn[index]) --overview.remaining;
+  overview.drawn[index] = true;
+  overview.mipmapped = false;
+}
+
+}  // namespace
+
+void renderWithBoundTexture(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context) {
+  const MipmapPyramid *pPyramid = context.zoom < 1 ? context.pCurrentPyramid : nullptr;
+  ClipShaderState uncached;
+  useImageProgram(shaderPool, context, pPyramid, uncached);
+  if (pPyramid) {
+    // 2D and rectangle textures have separate bindings, the frame texture stays bound
+    auto boundPyramid = pPyramid->scope_bind_texture();
+    pMesh->draw();
+  } else {
+    pMesh->draw();
+  }
+  glCheckError();
+}
+
+void renderTiles(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context,
+                 const std::shared_ptr<TiledFrame> &pFrame, TileCache &tileCache, bool waitForTiles) {
+  const TiledFrame &frame = *pFrame;
+  TileOverview &overview = tileCache.getOverview(frame);
+  if (overview.colorSpace != context.fileColorSpace) {
+    std::fill(overview.drawn.begin(), overview.drawn.end(), false);
+    overview.remaining = overview.drawn.size();
+    overview.colorSpace = context.fileColorSpace;
+  }
+  // the overview has at least as many texels as the screen
+  const bool zoomedOut = context.zoom * frame.overviewFactor <= 1;
+  ClipShaderState uncached;
+  const ClipShaderState &state = useImageProgram(shaderPool, context, false, uncached);
+  glm::ivec2 first, last;
+  getVisibleTiles(context, frame, state, first, last);
+  if (zoomedOut && !overview.isComplete()) {
+    // completing the overview, its tiles are not needed afterwards
+    first = glm::ivec2(0);
+    last = frame.tiles - 1;
+  }
+
+  // tiles resident this frame, nullptr if requested
+  std::vector<const Texture *> textures;
+  for (int y = first.y; y <= last.y; ++y)
+    for (int x = first.x; x <= last.x; ++x) {
+      const glm::ivec2 tile(x, y);
+      const bool drawn = overview.drawn[y * frame.tiles.x + x];
+      const Texture *pTexture = nullptr;
+      if (!zoomedOut || !drawn) pTexture = waitForTiles ? &tileCache.get(frame, tile) : tileCache.find(pFrame, tile);
+      textures.push_back(pTexture);
+      if (!pTexture || drawn) continue;
+      auto boundTile = pTexture->scope_bind_texture();
+      drawIntoOverview(shaderPool, pMesh, context, frame, tile, *pTexture, overview);
+    }
+  if (overview.isComplete() && !overview.mipmapped) {
+    auto boundPyramid = overview.pPyramid->scope_bind_texture();
+    glGenerateMipmap(overview.pPyramid->target);
+    overview.mipmapped = true;
+  }
+
+  // drawing into the overview changed the program and the bound textures
+  SharedProgram pOverviewProgram;
+  if (overview.isComplete()) {
+    ClipShaderState uncachedOverview;
+    pOverviewProgram = useImageProgram(shaderPool, context, true, uncachedOverview).pProgram;
+    overview.pPyramid->bind();
+    if (zoomedOut) {
+      pMesh->draw();
+      glCheckError();
+      return;
+    }
+  }
+  const SharedProgram pTileProgram = useImageProgram(shaderPool, context, false, uncached).pProgram;
+  const Program *pUsed = pTileProgram.get();
+  const auto use = [&](const SharedProgram &pProgram) {
+    if (pUsed != pProgram.get()) pProgram->use();
+    pUsed = pProgram.get();
+  };
+  // missing tiles are drawn from the overview when complete, left out otherwise
+  auto pTexture = textures.begin();
+  for (int y = first.y; y <= last.y; ++y)
+    for (int x = first.x; x <= last.x; ++x, ++pTexture) {
+      const glm::ivec2 tile(x, y);
+      if (*pTexture) {
+        use(pTileProgram);
+        auto boundTile = (*pTexture)->scope_bind_texture();
+        setTileUniforms(*pTileProgram, frame, tile, false);
+        pMesh->draw();
+      } else if (pOverviewProgram) {
+        use(pOverviewProgram);
+        setTileUniforms(*pOverviewProgram, frame, tile, true);
+        pMesh->draw();
+      }
+    }
+  glCheckError();
+}
+
+size_t getCompositeLayerCount(CompositeMode mode, size_t visible) {
+  switch (mode) {
+    case CompositeMode::OVER:
+    case CompositeMode::SIDE_BY_SIDE:
+      return visible <= kMaxCompositeLayers ? visible : 0;
+    case CompositeMode::WIPE:
+    case CompositeMode::DIFFERENCE:
+      return visible >= 2 ? 2 : 0;
+  }
+  throw std::runtime_error("unknown composite mode");
+}
+
+size_t getCompositeLayerAt(const Context &context, const std::vector<CompositeLayer> &layers, glm::ivec2 position) {
+  const size_t count = getCompositeLayerCount(context.compositeMode, layers.size());
+  CHECK(count > 0) << "unable to composite " << layers.size() << " layers";
+  switch (context.compositeMode) {
+    case CompositeMode::OVER:
+      // the topmost layer covering position
+      for (size_t layer = count - 1; layer > 0; --layer) {
+        Context layerContext = context;
+        layerContext.pCurrentImage = layers[layer].pImage;
+        const glm::ivec2 texel = getTexelAt(layerContext, position);
+        const ImageDescription &image = *layers[layer].pImage;
+        if (texel.x >= 0 && texel.y >= 0 && texel.x < int(image.width) && texel.y < int(image.height)) return layer;
+      }
+      return 0;
+    case CompositeMode::WIPE:
+      return position.x < context.wipe ? 0 : 1;
+    case CompositeMode::SIDE_BY_SIDE: {
+      const int width = std::max(context.viewport.dimension.x / int(count), 1);
+      return std::min(size_t(std::max(position.x, 0) / width), count - 1);
+    }
+    case CompositeMode::DIFFERENCE:
+      return 0;
+  }
+  throw std::runtime_error("unknown composite mode");
+}
+
+Viewport getCompositeLayerViewport(const Context &context, size_t layer, size_t count) {
+  if (context.compositeMode != CompositeMode::SIDE_BY_SIDE) return context.viewport;
+  const int width = std::max(context.viewport.dimension.x / int(count), 1);
+  return Viewport(context.viewport.offset + glm::ivec2(int(layer) * width, 0),
+                  glm::ivec2(width, context.viewport.dimension.y));
+}
+
+void renderComposite(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context,
+                     const std::vector<CompositeLayer> &layers) {
+  using namespace attribute;
+  const size_t count = getCompositeLayerCount(context.compositeMode, layers.size());
+  CHECK(count > 0) << "unable to composite " << layers.size() << " layers";
+  const auto samplesPyramid = [&](size_t layer) { return context.zoom < 1 && layers[layer].pPyramid; };
+  std::vector<LayerDescription> layerDescs;
+  for (size_t i = 0; i < count; ++i) {
+    layerDescs.push_back(getLayerDesc(*layers[i].pImage, context));
+    layerDescs.back().samplePyramid = samplesPyramid(i);
+  }
+  auto shaderDesc =
+      ShaderDescription::createCompositeDesc(layerDescs, context.compositeMode, context.screenColorSpace);
+  setColorLuts(context, shaderDesc);
+  const auto pProgram = shaderPool.get(shaderDesc);
+  pProgram->use();
+  for (size_t i = 0; i < count; ++i) {
+    const ImageDescription &description = *layers[i].pImage;
+    const uint8_t imageOrientation = getWithDefault<DpxImageOrientation>(description.extra_attributes);
+    const auto dimensions = getTextureDimensions(description.width, description.height, imageOrientation);
+    const GLint unit = getLayerTextureUnit(i);
+    if (samplesPyramid(i))
+      gl::bindToUnit(unit, *layers[i].pPyramid);
+    else
+      gl::bindToUnit(unit, *layers[i].pTexture);
+    pProgram->glUniform1i(shader::gLayerSamplers[i], unit);
+    pProgram->glUniform2i(shader::gLayerImages[i], dimensions.first, dimensions.second);
+    pProgram->glUniform1i(shader::gLayerTransposed[i], isTransposed(imageOrientation));
+  }
+  pProgram->glUniform2i(shader::gViewport, context.viewport.dimension.x, context.viewport.dimension.y);
+  pProgram->glUniform2i(shader::gPan, context.pan.x, context.pan.y);
+  pProgram->glUniform1f(shader::gZoom, context.zoom);
+  pProgram->glUniform1f(shader::gExposure, context.exposure);
+  pProgram->glUniform1f(shader::gGamma, context.gamma);
+  pProgram->glUniform4i(shader::gShowChannel, context.channels.x, context.channels.y, context.channels.z,
+                        context.channels.w);
+  if (context.compositeMode == CompositeMode::WIPE) pProgram->glUniform1i(shader::gCompositeWipe, context.wipe);
+  bindColorLuts(context, *pProgram, shaderDesc);
+  pMesh->draw();
+  glCheckError();
+}
+
+void probeBoundTexture(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context, glm::ivec2 offset,
+                       glm::ivec2 size) {
+  ShaderDescription shaderDesc = getTextureDesc(*context.pCurrentImage, context);
+  shaderDesc.probe = true;
+  const auto pProgram = shaderPool.get(shaderDesc);
+  pProgram->use();
+  pProgram->glUniform1i(shader::gTextureSampler, 0);
+  pProgram->glUniform2i(shader::gTileOffset, offset.x, offset.y);
+  pProgram->glUniform2i(shader::gTileSize, size.x, size.y);
+  bindColorLuts(context, *pProgram, shaderDesc);
   pMesh->draw();
   glCheckError();
 }
 
+glm::ivec2 getTexelAt(const Context &context, glm::ivec2 position) {
+  using namespace attribute;
+  const ImageDescription &description = *context.pCurrentImage;
+  const uint8_t imageOrientation = getWithDefault<DpxImageOrientation>(description.extra_attributes);
+  const auto pair = getTextureDimensions(description.width, description.height, imageOrientation);
+  const glm::vec2 image(pair.first, pair.second);
+  const glm::vec2 center(context.viewport.dimension / 2 + context.pan);
+  // inverts the vertex shader, the image spans center +/- image * zoom / 2 and is negative when flipped
+  const glm::vec2 uv = (glm::vec2(position) + glm::vec2(.5f) - center) / (image * context.zoom) + glm::vec2(.5f);
+  const glm::ivec2 texel(glm::floor(uv * glm::abs(image)));
+  // image is the displayed size, the texture axes are swapped when transposed
+  return isTransposed(imageOrientation) ? glm::ivec2(texel.y, texel.x) : texel;
+}
+
+std::vector<ShaderDescription> getTimelineShaderDescs(const Timeline &timeline, const Context &context,
+                                                      bool mipmapPyramid) {
+  std::set<ShaderDescription> descriptions;
+  for (const Track &track : timeline) {
+    for (const auto &pair : track) {
+      const auto &pStream = pair.second.pStream;
+      if (!pStream) continue;
+      const auto &result = pStream->openContainer();
+      if (!result) continue;
+      const ImageDescription &description = result.frame.getDescription();
+      if (description.opengl_format == -1) continue;
+      ShaderDescription shaderDesc = getTextureDesc(description, context);
+      descriptions.insert(shaderDesc);
+      if (!mipmapPyramid) continue;
+      shaderDesc.linearize = true;
+      descriptions.insert(shaderDesc);
+      descriptions.insert(getPyramidDesc(context));
+    }
+  }
+  return {descriptions.begin(), descriptions.end()};
+}
+
+const MipmapPyramid *getOrBuildPyramid(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context,
+                                       const TexturePackedFrame &frame, MipmapPyramidPool &pool) {
+  if (!frame.pPyramid || frame.pyramidColorSpace != context.fileColorSpace) {
+    if (!frame.pPyramid) frame.pPyramid = pool.get({frame.width, frame.height});
+    buildPyramid(shaderPool, pMesh, context, frame, *frame.pPyramid);
+    frame.pyramidColorSpace = context.fileColorSpace;
+  }
+  return frame.pPyramid.get();
+}
+
 } /* namespace duke */
@@ -1,13 +1,99 @@
 #pragma once
 
+#include "duke/base/NonCopyable.hpp"
+#include "duke/engine/Viewport.hpp"
+#include "duke/engine/cache/MipmapPyramidPool.hpp"
+#include "duke/engine/rendering/ShaderFactory.hpp"
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
 namespace duke {
 
 class Mesh;
+class IMediaStream;
 struct Context;
 struct ShaderPool;
+struct Texture;
+struct TexturePackedFrame;
+struct TiledFrame;
+class TileCache;
+struct Timeline;
+
+// Shader state resolved from a frame's format and attributes.
+struct ClipShaderState {
+  ShaderDescription description;
+  SharedProgram pProgram;
+  std::pair<int, int> dimensions;  // oriented texture dimensions
+  bool transposed;                 // displayed x axis along the texture y axis
+};
 
+/**
+ * Programs of the shader descriptions drawn so far. Descriptions are resolved
+ * from each frame's format, attributes and the display settings, frames of a
+ * clip mostly share one so the program is found without going through the
+ * shader pool. Cleared when the timeline is reloaded.
+ */
+struct ClipShaderCache : public noncopyable {
+  // The state to draw context's current image, sampling the mipmap pyramid or not.
+  // Valid until the next call.
+  const ClipShaderState &get(const ShaderPool &shaderPool, const Context &context, bool pyramid);
+  void clear() { m_States.clear(); }
+
+ private:
+  std::map<ShaderDescription, ClipShaderState> m_States;
+};
+
+// Draws the bound texture, or context.pCurrentPyramid when set and zoomed out.
 void renderWithBoundTexture(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context);
 
+// Draws the tiles of frame covered by the viewport. Tiles not resident are requested from tileCache and
+// drawn from the overview meanwhile, or uploaded right away with waitForTiles. Zoomed out, the whole
+// frame is drawn from the overview once all tiles went through it.
+void renderTiles(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context,
+                 const std::shared_ptr<TiledFrame> &pFrame, TileCache &tileCache, bool waitForTiles);
+
+// Returns the pyramid of frame, building it from the bound frame texture on first call.
+const MipmapPyramid *getOrBuildPyramid(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context,
+                                       const TexturePackedFrame &frame, MipmapPyramidPool &pool);
+
+// A frame drawn by renderComposite, sampled from pPyramid when set and zoomed out.
+struct CompositeLayer {
+  const ImageDescription *pImage;
+  const Texture *pTexture;
+  const MipmapPyramid *pPyramid;
+};
+
+// Layers sampled by a composite in mode from visible frames, 0 if it can not show them.
+size_t getCompositeLayerCount(CompositeMode mode, size_t visible);
+
+// Index of the layer renderComposite shows at position, in viewport pixels from the bottom left.
+size_t getCompositeLayerAt(const Context &context, const std::vector<CompositeLayer> &layers, glm::ivec2 position);
+
+// Part of the viewport layer is centered in, the whole viewport unless composited side by side.
+Viewport getCompositeLayerViewport(const Context &context, size_t layer, size_t count);
+
+// Draws layers in a single pass, combined as context.compositeMode, see getCompositeLayerCount.
+void renderComposite(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context,
+                     const std::vector<CompositeLayer> &layers);
+
+// Draws the file and linear values of the bound texture's texels in [offset, offset + size) over the viewport, to the
+// first and second draw buffers.
+void probeBoundTexture(const ShaderPool &shaderPool, const Mesh *pMesh, const Context &context, glm::ivec2 offset,
+                       glm::ivec2 size);
+
+// Texel of context's current image under position, in viewport pixels from the bottom left, in texture coordinates :
+// axes are swapped back for rotated images. The texel is out of the texture dimensions when position is not over it.
+glm::ivec2 getTexelAt(const Context &context, glm::ivec2 position);
+
 float getZoomValue(const Context &context);
 
+// Programs needed to display the clips of timeline, inferred from their first frame.
+std::vector<ShaderDescription> getTimelineShaderDescs(const Timeline &timeline, const Context &context,
+                                                      bool mipmapPyramid);
+
 } /* namespace duke */
@@ -0,0 +1,299 @@
+#include "PixelProbe.hpp"
+#include "duke/engine/Context.hpp"
+#include "duke/engine/rendering/GeometryRenderer.hpp"
+#include "duke/engine/rendering/ImageRenderer.hpp"
+#include "duke/engine/rendering/ShaderConstants.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/gl/Shader.hpp"
+#include "duke/gl/Textures.hpp"
+#include "duke/image/ImageDescription.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace duke {
+
+namespace {
+
+// Texels of the region drawn at once.
+const int kChunkSize = 256;
+// Texels reduced by a fragment, along each axis, two passes reduce a chunk.
+const int kBlockSize = 16;
+// Floats read for the cursor : file, linear and display values.
+const size_t kCursorFloats = 12;
+
+const char pReduceVertexShader[] = R"(
+#version 330
+
+void main() {
+    // viewport as a triangle strip
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = vec4(corner * 2 - 1, 0, 1);
+})";
+
+const char pReduceFragmentShader[] = R"(
+#version 330
+
+uniform sampler2D gProbeMinSampler;
+uniform sampler2D gProbeMaxSampler;
+uniform sampler2D gProbeSumSampler;
+uniform ivec2 gProbeSize;    // texels of the inputs to reduce
+uniform ivec2 gProbeOffset;  // first fragment of the viewport
+
+layout(location = 0) out vec4 vMin;
+layout(location = 1) out vec4 vMax;
+layout(location = 2) out vec4 vSum;
+
+const int kBlockSize = 16;
+
+void main(void)
+{
+    ivec2 first = (ivec2(gl_FragCoord.xy) - gProbeOffset) * kBlockSize;
+    ivec2 last = min(first + kBlockSize, gProbeSize);
+    vec4 low = vec4(3.4e38);
+    vec4 high = vec4(-3.4e38);
+    vec4 sum = vec4(0);
+    for (int y = first.y; y < last.y; ++y)
+        for (int x = first.x; x < last.x; ++x) {
+            ivec2 texel = ivec2(x, y);
+            low = min(low, texelFetch(gProbeMinSampler, texel, 0));
+            high = max(high, texelFetch(gProbeMaxSampler, texel, 0));
+            sum += texelFetch(gProbeSumSampler, texel, 0);
+        }
+    vMin = low;
+    vMax = high;
+    vSum = sum;
+})";
+
+bool contains(glm::ivec2 dimensions, glm::ivec2 position) {
+  return position.x >= 0 && position.y >= 0 && position.x < dimensions.x && position.y < dimensions.y;
+}
+
+GLvoid *floatOffset(size_t index) { return reinterpret_cast<GLvoid *>(index * sizeof(float)); }
+
+glm::vec4 vec4At(const float *pData, size_t index) {
+  pData += index * 4;
+  return glm::vec4(pData[0], pData[1], pData[2], pData[3]);
+}
+
+// Reduces the min, max and sum of each chunk, stored as planes of cells, chunks of a space on consecutive rows.
+ProbeStatistics combine(const float *pPlanes, glm::ivec2 chunks, int space, size_t texels) {
+  const size_t cells = chunks.x * chunks.y * 2;
+  ProbeStatistics statistics;
+  statistics.min = glm::vec4(std::numeric_limits<float>::max());
+  statistics.max = glm::vec4(-std::numeric_limits<float>::max());
+  double sum[4] = {0, 0, 0, 0};
+  for (int y = 0; y < chunks.y; ++y)
+    for (int x = 0; x < chunks.x; ++x) {
+      const size_t cell = (space * chunks.y + y) * chunks.x + x;
+      statistics.min = glm::min(statistics.min, vec4At(pPlanes, cell));
+      statistics.max = glm::max(statistics.max, vec4At(pPlanes, cells + cell));
+      const glm::vec4 chunkSum = vec4At(pPlanes, 2 * cells + cell);
+      for (int i = 0; i < 4; ++i) sum[i] += chunkSum[i];
+    }
+  for (int i = 0; i < 4; ++i) statistics.mean[i] = sum[i] / texels;
+  return statistics;
+}
+
+}  // namespace
+
+void PixelProbe::Target::initialize(glm::ivec2 newDimensions, size_t attachments) {
+  if (dimensions == newDimensions) return;
+  dimensions = newDimensions;
+  frameBuffer.bind();
+  GLenum drawBuffers[3];
+  for (size_t i = 0; i < attachments; ++i) {
+    auto &texture = textures[i];
+    {
+      auto bound = texture.scope_bind_texture();
+      glTexImage2D(texture.target, 0, GL_RGBA32F, dimensions.x, dimensions.y, 0, GL_RGBA, GL_FLOAT, nullptr);
+      glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    frameBuffer.attachColor(texture, drawBuffers[i]);
+  }
+  glDrawBuffers(attachments, drawBuffers);
+  frameBuffer.checkComplete();
+}
+
+PixelProbe::PixelProbe(const GeometryRenderer &renderer)
+    : m_GeometryRenderer(renderer),
+      m_ReduceProgram(makeVertexShader(pReduceVertexShader), makeFragmentShader(pReduceFragmentShader)) {
+  GLint previousFrameBuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  m_Cursor.initialize(glm::ivec2(1), 2);
+  m_Chunk.initialize(glm::ivec2(kChunkSize), 2);
+  m_Partial.initialize(glm::ivec2(kChunkSize / kBlockSize), 3);
+  gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+  m_ReduceProgram.use();
+  m_ReduceProgram.glUniform1i(shader::gProbeMinSampler, 0);
+  m_ReduceProgram.glUniform1i(shader::gProbeMaxSampler, 1);
+  m_ReduceProgram.glUniform1i(shader::gProbeSumSampler, 2);
+  glCheckError();
+}
+
+PixelProbe::~PixelProbe() {
+  for (auto &readback : m_Readbacks)
+    if (readback.fence) glDeleteSync(readback.fence);
+}
+
+void PixelProbe::probe(const Context &context, glm::ivec2 cursor, const glm::ivec2 *pRegionCorners) {
+  collectReadbacks();
+  Readback &readback = m_Readbacks[m_NextReadback];
+  if (readback.fence || !context.pCurrentTexture || !context.pCurrentImage) return;
+  const glm::ivec2 image(context.pCurrentImage->width, context.pCurrentImage->height);
+  ProbeReadings &readings = readback.readings;
+  readings = ProbeReadings();
+  readings.valid = true;
+  readings.texel = getTexelAt(context, cursor);
+  readings.onImage = contains(image, readings.texel);
+  readings.onViewport = contains(context.viewport.dimension, cursor);
+  readback.chunks = glm::ivec2(0);
+  ReducedRegion region;
+  if (pRegionCorners) {
+    const glm::ivec2 corner = getTexelAt(context, pRegionCorners[0]);
+    const glm::ivec2 opposite = getTexelAt(context, pRegionCorners[1]);
+    readings.regionFirst = glm::max(glm::min(corner, opposite), glm::ivec2(0));
+    readings.regionLast = glm::min(glm::max(corner, opposite), image - glm::ivec2(1));
+    const glm::ivec2 size = readings.regionLast - readings.regionFirst + glm::ivec2(1);
+    if (size.x > 0 && size.y > 0) {
+      readings.regionTexels = size_t(size.x) * size.y;
+      region.pImage = context.pCurrentImage;
+      region.pTexture = context.pCurrentTexture;
+      region.frame = context.currentFrame;
+      region.colorSpace = context.fileColorSpace;
+      region.first = readings.regionFirst;
+      region.last = readings.regionLast;
+      if (!(region == m_Reduced)) readback.chunks = (size + glm::ivec2(kChunkSize - 1)) / kChunkSize;
+    }
+  }
+  m_Reduced = region;
+
+  const size_t bytes = (kCursorFloats + 3 * 4 * 2 * readback.chunks.x * readback.chunks.y) * sizeof(float);
+  auto pboBound = readback.pbo.scope_bind_buffer();
+  if (bytes > readback.capacity) {
+    glBufferData(readback.pbo.target, bytes, nullptr, readback.pbo.usage);
+    readback.capacity = bytes;
+  }
+
+  GLint previousFrameBuffer = 0;
+  GLint previousViewport[4];
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  glGetIntegerv(GL_VIEWPORT, previousViewport);
+  const bool blending = glIsEnabled(GL_BLEND);
+  glDisable(GL_BLEND);
+  {
+    auto textureBound = context.pCurrentTexture->scope_bind_texture();
+    probeCursor(context, cursor, previousFrameBuffer, readback);
+    if (readback.chunks.x) probeRegion(context, readback);
+  }
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_NextReadback = (m_NextReadback + 1) % 2;
+
+  gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+  glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+  if (blending) glEnable(GL_BLEND);
+  glCheckError();
+}
+
+// Reads the texel under the cursor and the displayed pixel, which must not be covered yet.
+void PixelProbe::probeCursor(const Context &context, glm::ivec2 cursor, GLint displayFrameBuffer,
+                             Readback &readback) {
+  const ProbeReadings &readings = readback.readings;
+  if (readings.onImage) {
+    m_Cursor.frameBuffer.bind();
+    glViewport(0, 0, 1, 1);
+    probeBoundTexture(m_GeometryRenderer.shaderPool, m_GeometryRenderer.meshPool.getSquare().get(), context,
+                      readings.texel, glm::ivec2(1));
+    for (GLenum space = 0; space < 2; ++space) {
+      glReadBuffer(GL_COLOR_ATTACHMENT0 + space);
+      glReadPixels(0, 0, 1, 1, GL_RGBA, GL_FLOAT, floatOffset(space * 4));
+    }
+  }
+  if (readings.onViewport) {
+    const glm::ivec2 pixel = context.viewport.offset + cursor;
+    gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, displayFrameBuffer);
+    glReadPixels(pixel.x, pixel.y, 1, 1, GL_RGBA, GL_FLOAT, floatOffset(8));
+  }
+}
+
+// Draws the region chunk by chunk, each is reduced to a cell of the result targets.
+void PixelProbe::probeRegion(const Context &context, Readback &readback) {
+  const auto pSquare = m_GeometryRenderer.meshPool.getSquare();
+  const ProbeReadings &readings = readback.readings;
+  const glm::ivec2 chunks = readback.chunks;
+  m_Results.initialize(chunks * glm::ivec2(1, 2), 3);
+  auto vaoBound = m_Vao.scope_bind();
+  for (int y = 0; y < chunks.y; ++y)
+    for (int x = 0; x < chunks.x; ++x) {
+      const glm::ivec2 offset = readings.regionFirst + glm::ivec2(x, y) * kChunkSize;
+      const glm::ivec2 size = glm::min(glm::ivec2(kChunkSize), readings.regionLast + glm::ivec2(1) - offset);
+      const glm::ivec2 partial = (size + glm::ivec2(kBlockSize - 1)) / kBlockSize;
+      m_Chunk.frameBuffer.bind();
+      glViewport(0, 0, size.x, size.y);
+      probeBoundTexture(m_GeometryRenderer.shaderPool, pSquare.get(), context, offset, size);
+      for (int space = 0; space < 2; ++space) {
+        const gl::GlTexture2D *pChunkInputs[3] = {&m_Chunk.textures[space], &m_Chunk.textures[space],
+                                                  &m_Chunk.textures[space]};
+        m_Partial.frameBuffer.bind();
+        glViewport(0, 0, partial.x, partial.y);
+        reduce(pChunkInputs, size, glm::ivec2(0));
+        const gl::GlTexture2D *pPartialInputs[3] = {&m_Partial.textures[0], &m_Partial.textures[1],
+                                                    &m_Partial.textures[2]};
+        const glm::ivec2 cell(x, space * chunks.y + y);
+        m_Results.frameBuffer.bind();
+        glViewport(cell.x, cell.y, 1, 1);
+        reduce(pPartialInputs, partial, cell);
+      }
+    }
+  const size_t cells = m_Results.dimensions.x * m_Results.dimensions.y;
+  for (GLenum plane = 0; plane < 3; ++plane) {
+    glReadBuffer(GL_COLOR_ATTACHMENT0 + plane);
+    glReadPixels(0, 0, m_Results.dimensions.x, m_Results.dimensions.y, GL_RGBA, GL_FLOAT,
+                 floatOffset(kCursorFloats + plane * cells * 4));
+  }
+}
+
+void PixelProbe::reduce(const gl::GlTexture2D *pInputs[3], glm::ivec2 size, glm::ivec2 offset) {
+  for (int unit = 0; unit < 3; ++unit) gl::bindToUnit(unit, *pInputs[unit]);
+  m_ReduceProgram.use();
+  m_ReduceProgram.glUniform2i(shader::gProbeSize, size.x, size.y);
+  m_ReduceProgram.glUniform2i(shader::gProbeOffset, offset.x, offset.y);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  gl::getGlState().called();
+}
+
+// Maps the pixel buffers the gpu is done with, oldest first so reused region statistics are already read, never waits.
+void PixelProbe::collectReadbacks() {
+  for (size_t i = 0; i < 2; ++i) {
+    Readback &readback = m_Readbacks[(m_NextReadback + i) % 2];
+    if (!readback.fence) continue;
+    if (!gl::isSignaled(readback.fence)) break;
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    auto bound = readback.pbo.scope_bind_buffer();
+    const auto pData = static_cast<const float *>(glMapBufferRange(readback.pbo.target, 0, readback.capacity,
+                                                                   GL_MAP_READ_BIT));
+    if (!pData) {
+      m_Reduced = ReducedRegion();  // the region statistics are lost
+      continue;
+    }
+    ProbeReadings &readings = readback.readings;
+    readings.file = vec4At(pData, 0);
+    readings.linear = vec4At(pData, 1);
+    readings.display = vec4At(pData, 2);
+    if (readings.regionTexels && !readback.chunks.x) {
+      readings.regionFile = m_Readings.regionFile;
+      readings.regionLinear = m_Readings.regionLinear;
+    } else if (readings.regionTexels) {
+      readings.regionFile = combine(pData + kCursorFloats, readback.chunks, 0, readings.regionTexels);
+      readings.regionLinear = combine(pData + kCursorFloats, readback.chunks, 1, readings.regionTexels);
+    }
+    glUnmapBuffer(readback.pbo.target);
+    m_Readings = readings;
+  }
+}
+
+} /* namespace duke */
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/engine/ColorSpace.hpp"
+#include "duke/gl/GlObjects.hpp"
+#include "duke/gl/Program.hpp"
+#include "duke/time/FrameUtils.hpp"
+
+#include <glm/glm.hpp>
+
+struct ImageDescription;
+
+namespace duke {
+
+struct Context;
+struct GeometryRenderer;
+struct Texture;
+
+struct ProbeStatistics {
+  glm::vec4 min;
+  glm::vec4 max;
+  glm::vec4 mean;
+};
+
+// Values under the cursor and over the region, in file, linear and display space.
+struct ProbeReadings {
+  bool valid = false;  // set once a readback completed
+  // cursor, values are only read when over the image and the viewport
+  bool onImage = false;
+  bool onViewport = false;
+  glm::ivec2 texel;
+  glm::vec4 file;
+  glm::vec4 linear;
+  glm::vec4 display;
+  // region, inclusive texel bounds
+  size_t regionTexels = 0;  // 0 without region
+  glm::ivec2 regionFirst;
+  glm::ivec2 regionLast;
+  ProbeStatistics regionFile;
+  ProbeStatistics regionLinear;
+};
+
+/**
+ * Reads pixel values under the cursor and statistics over a region without
+ * stalling the pipeline.
+ * The region is drawn in chunks into float targets and reduced to min, max
+ * and sum on the gpu. The values are copied to pixel buffers and mapped once
+ * their fence is signaled, readings lag displayed frames by one or more frames.
+ * The region is reduced again only when it or the displayed frame changes.
+ */
+class PixelProbe : public noncopyable {
+ public:
+  PixelProbe(const GeometryRenderer &renderer);
+  ~PixelProbe();
+
+  // Queues the readbacks for the image context draws, must be called once it is drawn and before anything is drawn
+  // over it. Positions are in viewport pixels from the bottom left, pRegionCorners points to two opposite corners or
+  // is nullptr without region. Never waits for the gpu.
+  void probe(const Context &context, glm::ivec2 cursor, const glm::ivec2 *pRegionCorners);
+
+  // The latest readings completed by the gpu.
+  const ProbeReadings &getReadings() const { return m_Readings; }
+
+ private:
+  struct Target {
+    void initialize(glm::ivec2 dimensions, size_t attachments);
+
+    gl::GlTexture2D textures[3];
+    gl::GlFrameBufferObject frameBuffer;
+    glm::ivec2 dimensions;
+  };
+  struct Readback {
+    gl::GlStreamReadPbo pbo;
+    size_t capacity = 0;
+    GLsync fence = nullptr;
+    ProbeReadings readings;  // values are filled once mapped
+    glm::ivec2 chunks;       // 0 when the region statistics of the previous readings still apply
+  };
+  // What the last queued region reduction was computed from.
+  struct ReducedRegion {
+    const ImageDescription *pImage = nullptr;
+    const Texture *pTexture = nullptr;
+    FrameIndex frame;
+    ColorSpace colorSpace = ColorSpace::Auto;
+    glm::ivec2 first;
+    glm::ivec2 last;
+
+    bool operator==(const ReducedRegion &other) const {
+      return pImage == other.pImage && pTexture == other.pTexture && frame == other.frame &&
+             colorSpace == other.colorSpace && first == other.first && last == other.last;
+    }
+  };
+
+  void probeCursor(const Context &context, glm::ivec2 cursor, GLint displayFrameBuffer, Readback &readback);
+  void probeRegion(const Context &context, Readback &readback);
+  void reduce(const gl::GlTexture2D *pInputs[3], glm::ivec2 size, glm::ivec2 offset);
+  void collectReadbacks();
+
+  const GeometryRenderer &m_GeometryRenderer;
+  Program m_ReduceProgram;
+  const gl::GlVertexArrayObject m_Vao;  // attributeless, vertices are generated from their id
+  Target m_Cursor;
+  Target m_Chunk;
+  Target m_Partial;
+  Target m_Results;
+  Readback m_Readbacks[2];
+  size_t m_NextReadback = 0;
+  ReducedRegion m_Reduced;
+  ProbeReadings m_Readings;
+};
+
+} /* namespace duke */
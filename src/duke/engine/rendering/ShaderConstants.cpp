@@ -4,16 +4,37 @@ namespace duke {
 namespace shader {
 
 const char gTextureSampler[] = "gTextureSampler";
+const char gPyramidSampler[] = "gPyramidSampler";
+const char gInputLut[] = "gInputLut";
+const char gScreenLut[] = "gScreenLut";
+const char gDisplayLut[] = "gDisplayLut";
+const char gDisplayLutMin[] = "gDisplayLutMin";
+const char gDisplayLutMax[] = "gDisplayLutMax";
 const char gViewport[] = "gViewport";
 const char gImage[] = "gImage";
 const char gPan[] = "gPan";
-const char gPanAndChar[] = "gPanAndChar";
 const char gZoom[] = "gZoom";
-const char gAlpha[] = "gAlpha";
+const char gTileOffset[] = "gTileOffset";
+const char gTileSize[] = "gTileSize";
+const char gTileOrigin[] = "gTileOrigin";
+const char gTileTexels[] = "gTileTexels";
+const char gTransposed[] = "gTransposed";
 const char gExposure[] = "gExposure";
 const char gGamma[] = "gGamma";
 const char gShowChannel[] = "gShowChannel";
-const char gSolidColor[] = "gSolidColor";
+const char gScopeSampler[] = "gScopeSampler";
+const char gScopeMode[] = "gScopeMode";
+const char gScopeScale[] = "gScopeScale";
+const char gProbeMinSampler[] = "gProbeMinSampler";
+const char gProbeMaxSampler[] = "gProbeMaxSampler";
+const char gProbeSumSampler[] = "gProbeSumSampler";
+const char gProbeSize[] = "gProbeSize";
+const char gProbeOffset[] = "gProbeOffset";
+const char gCompositeWipe[] = "gCompositeWipe";
+const char *const gLayerSamplers[] = {"gLayerSampler0", "gLayerSampler1", "gLayerSampler2", "gLayerSampler3"};
+const char *const gLayerImages[] = {"gLayerImage0", "gLayerImage1", "gLayerImage2", "gLayerImage3"};
+const char *const gLayerTransposed[] = {"gLayerTransposed0", "gLayerTransposed1", "gLayerTransposed2",
+                                         "gLayerTransposed3"};
 
 } /* namespace shader */
 } /* namespace duke */
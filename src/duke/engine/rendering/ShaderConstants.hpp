@@ -4,16 +4,37 @@ namespace duke {
 namespace shader {
 
 extern const char gTextureSampler[];
+extern const char gPyramidSampler[];
+extern const char gInputLut[];
+extern const char gScreenLut[];
+extern const char gDisplayLut[];
+extern const char gDisplayLutMin[];
+extern const char gDisplayLutMax[];
 extern const char gViewport[];
 extern const char gImage[];
 extern const char gPan[];
-extern const char gPanAndChar[];
 extern const char gZoom[];
-extern const char gAlpha[];
+extern const char gTileOffset[];
+extern const char gTileSize[];
+extern const char gTileOrigin[];
+extern const char gTileTexels[];
+extern const char gTransposed[];
 extern const char gExposure[];
 extern const char gGamma[];
 extern const char gShowChannel[];
-extern const char gSolidColor[];
+extern const char gScopeSampler[];
+extern const char gScopeMode[];
+extern const char gScopeScale[];
+extern const char gProbeMinSampler[];
+extern const char gProbeMaxSampler[];
+extern const char gProbeSumSampler[];
+extern const char gProbeSize[];
+extern const char gProbeOffset[];
+extern const char gCompositeWipe[];
+// indexed by composited layer
+extern const char *const gLayerSamplers[];
+extern const char *const gLayerImages[];
+extern const char *const gLayerTransposed[];
 
 } /* namespace shader */
 } /* namespace duke */
@@ -14,15 +14,42 @@ extern const char *pColorSpaceConversions;
 
 namespace {
 
-std::tuple<bool, bool, bool, bool, bool, bool, ColorSpace, ColorSpace> asTuple(const ShaderDescription &sd) {
-  return std::make_tuple(sd.grayscale, sd.sampleTexture, sd.displayUv, sd.swapEndianness, sd.swapRedAndBlue,
-                         sd.tenBitUnpack, sd.fileColorspace, sd.screenColorspace);
+std::tuple<bool, bool, bool, bool, bool, bool, bool, bool, bool, bool, bool, LutType, ColorSpace, ColorSpace,
+           const std::vector<LayerDescription> &, CompositeMode>
+asTuple(const ShaderDescription &sd) {
+  return std::tie(sd.grayscale, sd.sampleTexture, sd.displayUv, sd.swapEndianness, sd.swapRedAndBlue,
+                  sd.tenBitUnpack, sd.compressed, sd.linearize, sd.probe, sd.samplePyramid, sd.colorLuts, sd.displayLut,
+                  sd.fileColorspace, sd.screenColorspace, sd.layers, sd.compositeMode);
+}
+
+std::tuple<bool, bool, bool, bool, bool, bool, ColorSpace> asTuple(const LayerDescription &ld) {
+  return std::make_tuple(ld.grayscale, ld.swapEndianness, ld.swapRedAndBlue, ld.tenBitUnpack, ld.compressed,
+                         ld.samplePyramid, ld.fileColorspace);
 }
 
 }  // namespace
 
+bool LayerDescription::operator<(const LayerDescription &other) const { return asTuple(*this) < asTuple(other); }
+
 bool ShaderDescription::operator<(const ShaderDescription &other) const { return asTuple(*this) < asTuple(other); }
 
+bool ShaderDescription::usesInputLut() const {
+  return colorLuts && sampleTexture && !samplePyramid && fileColorspace != ColorSpace::Linear;
+}
+
+bool ShaderDescription::usesScreenLut() const {
+  return colorLuts && (sampleTexture || samplePyramid || !layers.empty()) && !linearize && !probe &&
+         screenColorspace != ColorSpace::Linear;
+}
+
+bool ShaderDescription::usesDisplayLut() const {
+  return displayLut != LutType::NONE && (sampleTexture || samplePyramid || !layers.empty()) && !linearize && !probe;
+}
+
+bool ShaderDescription::foldsDisplayLut() const {
+  return displayLut == LutType::LUT_1D && usesScreenLut() && usesDisplayLut();
+}
+
 ShaderDescription ShaderDescription::createUvDesc() {
   ShaderDescription description;
   description.sampleTexture = false;
@@ -30,9 +57,21 @@ ShaderDescription ShaderDescription::createUvDesc() {
   return description;
 }
 
-ShaderDescription ShaderDescription::createSolidDesc() {
+
+ShaderDescription ShaderDescription::createPyramidDesc(ColorSpace screenColorspace) {
+  ShaderDescription description;
+  description.samplePyramid = true;
+  description.screenColorspace = screenColorspace;
+  return description;
+}
+
+ShaderDescription ShaderDescription::createCompositeDesc(const std::vector<LayerDescription> &layers,
+                                                         CompositeMode mode, ColorSpace screenColorspace) {
   ShaderDescription description;
   description.sampleTexture = false;
+  description.layers = layers;
+  description.compositeMode = mode;
+  description.screenColorspace = screenColorspace;
   return description;
 }
 
@@ -52,10 +91,7 @@ ShaderDescription ShaderDescription::createTextureDesc(bool grayscale, bool swap
 
 namespace {
 
-const char pSampleTenbitsUnpack[] = R"(
-smooth in vec2 vVaryingTexCoord;
-uniform usampler2DRect gTextureSampler;
-
+const char pTenbitsUnpack[] = R"(
 vec4 unpack(uvec4 sample) {
 	uint red   = (sample.a << 2u) | (sample.b >> 6u);
 	uint green = ((sample.b & 0x3Fu) << 4u) | (sample.g >> 4u);
@@ -63,6 +99,11 @@ vec4 unpack(uvec4 sample) {
 	uint alpha = 1023u;//;((sample.r & 0x03u) << 8u);
 	return vec4(red, green, blue, alpha)/1023.;
 }
+)";
+
+const char pSampleTenbitsUnpack[] = R"(
+smooth in vec2 vVaryingTexCoord;
+uniform usampler2DRect gTextureSampler;
 
 vec4 bilinear(usampler2DRect sampler, vec2 offset) {
     vec4 tl = unpack(swizzle(texture(sampler, offset)));
@@ -103,25 +144,82 @@ vec4 nearest(sampler2DRect sampler, vec2 offset) {
 
 )";
 
-const char pTexturedMain[] = R"(
-out vec4 vFragColor;
-uniform bvec4 gShowChannel;
-uniform float gExposure;
-uniform float gGamma;
-uniform float gZoom;
+// Same texel addressing as rectangle textures.
+const char pSampleCompressed[] = R"(
+smooth in vec2 vVaryingTexCoord;
+uniform sampler2D gTextureSampler;
 
-vec2 random(vec2 seed) {
-    /* use the fragment position for a different seed per-pixel */
-    const vec2 scale = vec2(12.9898, 12.9899);
-    return (fract(sin(dot(gl_FragCoord.xy + seed, scale)) * 43758.5453 + seed) *2) -1;
+vec4 texel(sampler2D sampler, vec2 offset) {
+    return swizzle(texture(sampler, offset / vec2(textureSize(sampler, 0))));
+}
+
+vec4 bilinear(sampler2D sampler, vec2 offset) {
+    vec4 tl = texel(sampler, offset);
+    vec4 tr = texel(sampler, offset + vec2(1, 0));
+    vec4 bl = texel(sampler, offset + vec2(0, 1));
+    vec4 br = texel(sampler, offset + vec2(1, 1));
+    vec2 f = fract(offset.xy);
+    vec4 tA = mix(tl, tr, f.x);
+    vec4 tB = mix(bl, br, f.x);
+	return mix(tA, tB, f.y);
+}
+
+vec4 nearest(sampler2D sampler, vec2 offset) {
+	return texel(sampler, offset);
 }
 
+)";
+
+const char pSampleToLinear[] = R"(
 vec4 sampleToLinear(vec2 offset) {
     vec4 sampled = sample(offset);
     sampled.rgb = toLinear(sampled.rgb);
     // sampled.a=1;
     return sampled;
 }
+)";
+
+const char pLutFunctions[] = R"(
+vec3 lutCoordinates(vec3 sample, vec3 domainMin, vec3 domainMax, float size) {
+    return (clamp((sample - domainMin) / (domainMax - domainMin), 0.0, 1.0) * (size - 1.0) + 0.5) / size;
+}
+vec3 lut1d(sampler1D lut, vec3 sample, vec3 domainMin, vec3 domainMax) {
+    vec3 coord = lutCoordinates(sample, domainMin, domainMax, float(textureSize(lut, 0)));
+    return vec3(texture(lut, coord.r).r, texture(lut, coord.g).g, texture(lut, coord.b).b);
+}
+vec3 lut3d(sampler3D lut, vec3 sample, vec3 domainMin, vec3 domainMax) {
+    return texture(lut, lutCoordinates(sample, domainMin, domainMax, float(textureSize(lut, 0).x))).rgb;
+}
+)";
+
+const char pGrade[] = R"(
+uniform bvec4 gShowChannel;
+uniform float gExposure;
+uniform float gGamma;
+
+vec4 grade(vec4 color) {
+    if(any(gShowChannel.xyz))
+        color *= vec4(gShowChannel.xyz,1);
+
+    if(gShowChannel.w)
+        color = vec4(color.aaa,1);
+
+    color.rgb = color.rgb * gExposure;
+    color.rgb = pow(color.rgb,vec3(gGamma));
+
+    color.rgb = toScreen(color.rgb);
+    color.rgb = displayLut(color.rgb);
+    return color;
+}
+)";
+
+// Filters for zoomed out images.
+const char pSupersampling[] = R"(
+vec2 random(vec2 seed) {
+    /* use the fragment position for a different seed per-pixel */
+    const vec2 scale = vec2(12.9898, 12.9899);
+    return (fract(sin(dot(gl_FragCoord.xy + seed, scale)) * 43758.5453 + seed) *2) -1;
+}
 
 float gaussian(vec2 offset){
 	const float sigma = 0.5;
@@ -136,6 +234,11 @@ float triangle(vec2 offset){
     float absolute = abs(offset.x*offset.y);
     return mix(1.f-absolute,0.f, absolute>1.f);
 }
+)";
+
+const char pTexturedMain[] = R"(
+out vec4 vFragColor;
+uniform float gZoom;
 
 void main(void)
 {
@@ -170,28 +273,119 @@ void main(void)
         color = sampleToLinear(vec2(0));
     }
 
-    if(any(gShowChannel.xyz))
-        color *= vec4(gShowChannel.xyz,1);
+    vFragColor = grade(color);
+}
+)";
 
-    if(gShowChannel.w)
-        color = vec4(color.aaa,1);
+const char pLinearizeMain[] = R"(
+out vec4 vFragColor;
 
-    color.rgb = color.rgb * gExposure;
-    color.rgb = pow(color.rgb,vec3(gGamma));
+void main(void)
+{
+    vec4 color = sampleToLinear(vec2(0));
+    color.rgb *= color.a;
+    vFragColor = color;
+}
+)";
 
-    color.rgb = toScreen(color.rgb);
+const char pProbeMain[] = R"(
+layout(location = 0) out vec4 vFileColor;
+layout(location = 1) out vec4 vLinearColor;
 
-    vFragColor = color;
+void main(void)
+{
+    vFileColor = sample(vec2(0));
+    vLinearColor = sampleToLinear(vec2(0));
+}
+)";
+
+// Layers are sampled from the fragment position, drawn as the vertex shader would.
+const char pComposite[] = R"(
+out vec4 vFragColor;
+uniform ivec2 gViewport;
+uniform ivec2 gPan;
+uniform float gZoom;
+
+// Linear premultiplied color of layer drawn around center, transparent outside of it. Zoomed out layers are
+// read from the pyramid level matching the zoom, layers without pyramid are not filtered.
+vec4 layerColor(int layer, vec2 center) {
+    vec2 image = vec2(layerImage(layer));
+    vec2 coord = ((gl_FragCoord.xy - center) / (image * gZoom) + 0.5) * abs(image);
+    if (any(lessThan(coord, vec2(0))) || any(greaterThanEqual(coord, abs(image))))
+        return vec4(0);
+    return sampleLayer(layer, coord, max(0.0, -log2(gZoom)));
+}
+
+vec2 viewportCenter() {
+    return vec2(gViewport / 2 + gPan);
+}
+
+vec4 display(vec4 color) {
+    if(color.a>0)
+        color.rgb /= color.a;
+    return grade(color);
+}
+)";
+
+const char pCompositeOverMain[] = R"(
+void main(void)
+{
+    vec4 color = vec4(0);
+    for (int layer = 0; layer < kLayers; ++layer) {
+        vec4 top = layerColor(layer, viewportCenter());
+        color = top + color * (1 - top.a);
+    }
+    vFragColor = display(color);
+}
+)";
+
+const char pCompositeWipeMain[] = R"(
+uniform int gCompositeWipe;
+
+void main(void)
+{
+    int column = int(gl_FragCoord.x);
+    if (column == gCompositeWipe)
+        vFragColor = vec4(1);
+    else
+        vFragColor = display(layerColor(column < gCompositeWipe ? 0 : 1, viewportCenter()));
+}
+)";
+
+const char pCompositeSideBySideMain[] = R"(
+void main(void)
+{
+    int width = max(gViewport.x / kLayers, 1);
+    int column = min(int(gl_FragCoord.x) / width, kLayers - 1);
+    vec2 center = vec2(ivec2(column * width + width / 2, gViewport.y / 2) + gPan);
+    vFragColor = display(layerColor(column, center));
 }
 )";
 
-const char pSolidMain[] = R"(
+const char pCompositeDifferenceMain[] = R"(
+void main(void)
+{
+    vec4 a = layerColor(0, viewportCenter());
+    vec4 b = layerColor(1, viewportCenter());
+    vFragColor = display(vec4(abs(a.rgb - b.rgb), max(a.a, b.a)));
+}
+)";
+
+// Levels are premultiplied so transparent texels do not bleed while filtering.
+const char pPyramidMain[] = R"(
 out vec4 vFragColor;
-uniform vec4 gSolidColor;
+smooth in vec2 vVaryingTexCoord;
+uniform sampler2D gPyramidSampler;
+uniform ivec2 gImage;
+uniform bool gTransposed;
 
 void main(void)
 {
-    vFragColor = gSolidColor;
+    vec2 texels = abs(vec2(gTransposed ? gImage.yx : gImage));
+    vec4 color = texture(gPyramidSampler, vVaryingTexCoord / texels);
+    if(color.a>0)
+        color.rgb /= color.a;
+    vFragColor = grade(color);
 }
 )";
 
@@ -205,52 +399,194 @@ void main(void)
 }
 )";
 
-void appendToLinearFunction(ostream &stream, const ColorSpace colorspace) {
-  stream << endl << "vec3 toLinear(vec3 sample){return " << getToLinearFunction(colorspace) << "(sample);}" << endl;
+// One fragment per texel of the probed region, covering the viewport.
+const char pProbeVertexShader[] = R"(
+	#version 330
+
+	layout (location = 0) in vec3 Position;
+	layout (location = 1) in vec2 UV;
+
+	uniform ivec2 gTileOffset;
+	uniform ivec2 gTileSize;
+
+	smooth out vec2 vVaryingTexCoord;
+
+	void main() {
+		gl_Position = vec4(Position.xy, 0, 1);
+		vVaryingTexCoord = gTileOffset + UV * gTileSize;
+	})";
+
+// Covers the viewport, composites compute their texture coordinates from the fragment position.
+const char pCompositeVertexShader[] = R"(
+	#version 330
+
+	layout (location = 0) in vec3 Position;
+
+	void main() {
+		gl_Position = vec4(Position.xy, 0, 1);
+	})";
+
+void appendToLinearFunction(ostream &stream, const ShaderDescription &description) {
+  if (description.usesInputLut()) {
+    // the lut covers [0, 1], values outside (e.g. HDR) are converted exactly
+    stream << endl << "uniform sampler1D gInputLut;" << endl
+           << "vec3 toLinear(vec3 sample){" << endl
+           << "    if(any(lessThan(sample, vec3(0))) || any(greaterThan(sample, vec3(1))))" << endl
+           << "        return " << getToLinearFunction(description.fileColorspace) << "(sample);" << endl
+           << "    return lut1d(gInputLut, sample, vec3(0), vec3(1));" << endl << "}" << endl;
+    return;
+  }
+  stream << endl << "vec3 toLinear(vec3 sample){return " << getToLinearFunction(description.fileColorspace)
+         << "(sample);}" << endl;
 }
 
-void appendToScreenFunction(ostream &stream, const ColorSpace colorspace) {
-  stream << endl << "vec3 toScreen(vec3 sample){return " << getToScreenFunction(colorspace) << "(sample);}" << endl;
+void appendToScreenFunction(ostream &stream, const ShaderDescription &description) {
+  if (description.usesScreenLut()) {
+    stream << endl << "uniform sampler1D gScreenLut;" << endl
+           << "vec3 toScreen(vec3 sample){return lut1d(gScreenLut, sample, vec3(0), vec3(1));}" << endl;
+    return;
+  }
+  stream << endl << "vec3 toScreen(vec3 sample){return " << getToScreenFunction(description.screenColorspace)
+         << "(sample);}" << endl;
+}
+
+void appendDisplayLutFunction(ostream &stream, const ShaderDescription &description) {
+  if (!description.usesDisplayLut() || description.foldsDisplayLut()) {
+    stream << endl << "vec3 displayLut(vec3 sample){return sample;}" << endl;
+    return;
+  }
+  const bool is3d = description.displayLut == LutType::LUT_3D;
+  stream << endl << "uniform " << (is3d ? "sampler3D" : "sampler1D") << " gDisplayLut;" << endl
+         << "uniform vec3 gDisplayLutMin;" << endl << "uniform vec3 gDisplayLutMax;" << endl
+         << "vec3 displayLut(vec3 sample){return " << (is3d ? "lut3d" : "lut1d")
+         << "(gDisplayLut, sample, gDisplayLutMin, gDisplayLutMax);}" << endl;
 }
 
 void appendSampler(ostream &stream, const ShaderDescription &description) {
   const bool filtering = false;  // Testing
   const string filter(filtering ? "bilinear" : "nearest");
-  stream << (description.tenBitUnpack ? pSampleTenbitsUnpack : pSampleRegular);
-  stream << "vec4 sample(vec2 offset) {"
-            "  return " << filter << "(gTextureSampler, vVaryingTexCoord+offset); }\n";
+  if (description.tenBitUnpack)
+    stream << pTenbitsUnpack << pSampleTenbitsUnpack;
+  else if (description.compressed)
+    stream << pSampleCompressed;
+  else
+    stream << pSampleRegular;
+  // tiles only hold their texels and a border, filters never read past it
+  stream << "uniform ivec2 gTileTexels;\n"
+            "vec4 sample(vec2 offset) {\n"
+            "  vec2 coord = vVaryingTexCoord + offset;\n"
+            "  if (gTileTexels != ivec2(0)) coord = clamp(coord, vec2(0), vec2(gTileTexels) - 0.5);\n"
+            "  return " << filter << "(gTextureSampler, coord); }\n";
+}
+
+string getSwizzling(bool grayscale, bool swapRedAndBlue, bool swapEndianness) {
+  string swizzling = grayscale ? "rrra" : "rgba";
+  if (swapRedAndBlue) std::swap(swizzling[0], swizzling[2]);
+  if (swapEndianness) std::reverse(swizzling.begin(), swizzling.end());
+  return swizzling;
 }
 
 void appendSwizzle(ostream &stream, const ShaderDescription &description) {
   const char *type = description.tenBitUnpack ? "uvec4" : "vec4";
-  string swizzling = description.grayscale ? "rrra" : "rgba";
-  if (description.swapRedAndBlue) std::swap(swizzling[0], swizzling[2]);
-  if (description.swapEndianness) std::reverse(swizzling.begin(), swizzling.end());
+  const string swizzling =
+      getSwizzling(description.grayscale, description.swapRedAndBlue, description.swapEndianness);
   stream << type << " swizzle(" << type << " sample){return sample." << swizzling << ";}";
 }
 
+// Per layer sampler and conversion to linear premultiplied, then functions dispatching on the layer index. Coordinates
+// are displayed texels, swapped back for transposed layers.
+void appendLayers(ostream &stream, const ShaderDescription &description) {
+  const auto &layers = description.layers;
+  const bool tenBitUnpack = std::any_of(layers.begin(), layers.end(),
+                                        [](const LayerDescription &layer) { return layer.tenBitUnpack; });
+  if (tenBitUnpack) stream << pTenbitsUnpack;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const LayerDescription &layer = layers[i];
+    const string sampler = "gLayerSampler" + to_string(i);
+    const string normalized = " / vec2(textureSize(" + sampler + ", 0))";
+    const char *samplerType = "sampler2DRect";
+    if (layer.samplePyramid || layer.compressed)
+      samplerType = "sampler2D";
+    else if (layer.tenBitUnpack)
+      samplerType = "usampler2DRect";
+    stream << endl << "uniform " << samplerType << " " << sampler << ";" << endl << "uniform ivec2 gLayerImage" << i
+           << ";" << endl << "uniform bool gLayerTransposed" << i << ";" << endl << "vec4 sampleLayer" << i
+           << "(vec2 coord, float lod) {" << endl << "    if (gLayerTransposed" << i << ") coord = coord.yx;" << endl;
+    if (layer.samplePyramid) {
+      stream << "    return textureLod(" << sampler << ", coord" << normalized << ", lod);" << endl << "}" << endl;
+      continue;
+    }
+    ostringstream fetch;
+    fetch << "texture(" << sampler << ", coord" << (layer.compressed ? normalized : "") << ")."
+          << getSwizzling(layer.grayscale, layer.swapRedAndBlue, layer.swapEndianness);
+    stream << "    vec4 sampled = " << (layer.tenBitUnpack ? "unpack(" + fetch.str() + ")" : fetch.str()) << ";"
+           << endl << "    sampled.rgb = " << getToLinearFunction(layer.fileColorspace) << "(sampled.rgb);" << endl
+           << "    return vec4(sampled.rgb * sampled.a, sampled.a);" << endl << "}" << endl;
+  }
+  stream << endl << "const int kLayers = " << layers.size() << ";" << endl;
+  stream << "vec4 sampleLayer(int layer, vec2 coord, float lod) {" << endl;
+  for (size_t i = 0; i + 1 < layers.size(); ++i)
+    stream << "    if (layer == " << i << ") return sampleLayer" << i << "(coord, lod);" << endl;
+  stream << "    return sampleLayer" << layers.size() - 1 << "(coord, lod);" << endl << "}" << endl;
+  stream << "ivec2 layerImage(int layer) {" << endl;
+  for (size_t i = 0; i + 1 < layers.size(); ++i)
+    stream << "    if (layer == " << i << ") return gLayerImage" << i << ";" << endl;
+  stream << "    return gLayerImage" << layers.size() - 1 << ";" << endl << "}" << endl;
+}
+
+const char *getCompositeMain(CompositeMode mode) {
+  switch (mode) {
+    case CompositeMode::OVER:
+      return pCompositeOverMain;
+    case CompositeMode::WIPE:
+      return pCompositeWipeMain;
+    case CompositeMode::SIDE_BY_SIDE:
+      return pCompositeSideBySideMain;
+    case CompositeMode::DIFFERENCE:
+      return pCompositeDifferenceMain;
+  }
+  throw std::runtime_error("unknown composite mode");
+}
+
 }  // namespace
 
 std::string buildFragmentShaderSource(const ShaderDescription &description) {
   ostringstream oss;
   oss << "#version 330" << endl;
-  if (description.sampleTexture) {
-    oss << pColorSpaceConversions << endl;
-    appendToLinearFunction(oss, description.fileColorspace);
-    appendToScreenFunction(oss, description.screenColorspace);
+  if (description.samplePyramid) {
+    oss << pColorSpaceConversions << pLutFunctions << endl;
+    appendToScreenFunction(oss, description);
+    appendDisplayLutFunction(oss, description);
+    oss << pGrade << pPyramidMain;
+  } else if (!description.layers.empty()) {
+    oss << pColorSpaceConversions << pLutFunctions << endl;
+    appendToScreenFunction(oss, description);
+    appendDisplayLutFunction(oss, description);
+    appendLayers(oss, description);
+    oss << pGrade << pComposite << getCompositeMain(description.compositeMode);
+  } else if (description.sampleTexture) {
+    oss << pColorSpaceConversions << pLutFunctions << endl;
+    appendToLinearFunction(oss, description);
+    appendToScreenFunction(oss, description);
+    appendDisplayLutFunction(oss, description);
     appendSwizzle(oss, description);
     appendSampler(oss, description);
-    oss << pTexturedMain;
-  } else {
-    if (description.displayUv)
-      oss << pUvMain;
+    oss << pSampleToLinear;
+    if (description.probe)
+      oss << pProbeMain;
+    else if (description.linearize)
+      oss << pLinearizeMain;
     else
-      oss << pSolidMain;
+      oss << pGrade << pSupersampling << pTexturedMain;
+  } else {
+    oss << pUvMain;
   }
   return oss.str();
 }
 
 std::string buildVertexShaderSource(const ShaderDescription &description) {
+  if (description.probe) return pProbeVertexShader;
+  if (!description.layers.empty()) return pCompositeVertexShader;
   return R"(
 	#version 330
 
@@ -261,8 +597,15 @@ std::string buildVertexShaderSource(const ShaderDescription &description) {
 	uniform ivec2 gImage;
 	uniform ivec2 gPan;
 	uniform float gZoom;
+	// texels of the drawn tile for tiled frames, the whole texture otherwise
+	uniform ivec2 gTileOffset;
+	uniform ivec2 gTileSize;
+	// texel of the bound texture holding gTileOffset, tiles are stored with a border
+	uniform ivec2 gTileOrigin;
+	// displayed x axis along the texture y axis, gImage is the displayed size
+	uniform bool gTransposed;
 
-	out vec2 vVaryingTexCoord; 
+	smooth out vec2 vVaryingTexCoord;
 
 	mat4 ortho(int left, int right, int bottom, int top) {
 		mat4 Result = mat4(1);
@@ -304,14 +647,23 @@ std::string buildVertexShaderSource(const ShaderDescription &description) {
 		world = scale(world, vec3(scaling, 1));
 		mat4 proj = ortho(0, gViewport.x, 0, gViewport.y);
 		mat4 worldViewProj = proj * world;
-		gl_Position = worldViewProj * vec4(Position, 1.0);
-		vVaryingTexCoord = UV * abs(gImage);
+		if (gTileSize == ivec2(0)) {
+			gl_Position = worldViewProj * vec4(Position, 1.0);
+			vec2 texel = UV * abs(gImage);
+			vVaryingTexCoord = gTransposed ? texel.yx : texel;
+		} else {
+			vec2 texel = gTileOffset + UV * gTileSize;
+			vec2 imageUV = (gTransposed ? texel.yx : texel) / abs(vec2(gImage));
+			gl_Position = worldViewProj * vec4(imageUV * 2 - 1, Position.z, 1.0);
+			vVaryingTexCoord = gTileOrigin + UV * gTileSize;
+		}
 	})";
 }
 
-SharedProgram buildProgram(const ShaderDescription &description) {
+SharedProgram buildProgram(const ShaderDescription &description, ProgramBinaryCache *pCache) {
   const string vsSource = buildVertexShaderSource(description);
   const string fsSource = buildFragmentShaderSource(description);
+  if (pCache) return pCache->getOrBuild(vsSource, fsSource);
   return make_shared<Program>(makeVertexShader(vsSource.c_str()), makeFragmentShader(fsSource.c_str()));
 }
 
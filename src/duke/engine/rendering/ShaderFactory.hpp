@@ -1,10 +1,31 @@
 #pragma once
 
 #include "duke/gl/Program.hpp"
+#include "duke/gl/ProgramBinaryCache.hpp"
 #include "duke/engine/ColorSpace.hpp"
+#include "duke/engine/CompositeMode.hpp"
+#include "duke/engine/Lut.hpp"
+
+#include <vector>
 
 namespace duke {
 
+// Composites sample at most this many layers.
+const size_t kMaxCompositeLayers = 4;
+
+// How a composited layer's texture is sampled and linearized.
+struct LayerDescription {
+  bool grayscale = false;
+  bool swapEndianness = false;
+  bool swapRedAndBlue = false;
+  bool tenBitUnpack = false;
+  bool compressed = false;
+  // zoomed out, linear premultiplied samples are read from the layer's mipmap pyramid
+  bool samplePyramid = false;
+  ColorSpace fileColorspace = ColorSpace::Auto;
+  bool operator<(const LayerDescription &other) const;
+};
+
 struct ShaderDescription {
   // vertex
   // fragment
@@ -15,19 +36,44 @@ struct ShaderDescription {
   bool swapEndianness = false;
   bool swapRedAndBlue = false;
   bool tenBitUnpack = false;
+  // block compressed frames live in 2D textures, sampled with normalized coordinates
+  bool compressed = false;
+  // outputs linear premultiplied samples without grading, fills mipmap pyramids
+  bool linearize = false;
+  // outputs file and linear samples of a texel region to two draw buffers, inspects pixel values
+  bool probe = false;
+  // samples a mipmap pyramid instead of the frame texture
+  bool samplePyramid = false;
+  // composites these layers in a single pass instead of sampling the frame texture
+  std::vector<LayerDescription> layers;
+  CompositeMode compositeMode = CompositeMode::OVER;
+  // colorspace conversions sample baked 1D luts instead of evaluating the curves
+  bool colorLuts = false;
+  // applied to screen values
+  LutType displayLut = LutType::NONE;
   ColorSpace fileColorspace = ColorSpace::Auto;    // aka input colorspace
   ColorSpace screenColorspace = ColorSpace::Auto;  // aka output colorspace
   ShaderDescription() = default;
   bool operator<(const ShaderDescription &other) const;
 
+  // Samplers declared by the generated program.
+  bool usesInputLut() const;
+  bool usesScreenLut() const;
+  bool usesDisplayLut() const;
+  // A 1D display lut is baked into the screen lut.
+  bool foldsDisplayLut() const;
+
   static ShaderDescription createTextureDesc(bool grayscale, bool swapEndianness, bool swapRedAndBlue,
                                              bool tenBitUnpack, ColorSpace fileColorspace, ColorSpace screenColorspace);
-  static ShaderDescription createSolidDesc();
+  static ShaderDescription createPyramidDesc(ColorSpace screenColorspace);
+  static ShaderDescription createCompositeDesc(const std::vector<LayerDescription> &layers, CompositeMode mode,
+                                               ColorSpace screenColorspace);
   static ShaderDescription createUvDesc();
 };
 
 std::string buildFragmentShaderSource(const ShaderDescription &description);
 std::string buildVertexShaderSource(const ShaderDescription &description);
-SharedProgram buildProgram(const ShaderDescription &description);
+// Goes through pCache if provided.
+SharedProgram buildProgram(const ShaderDescription &description, ProgramBinaryCache *pCache = nullptr);
 
 } /* namespace duke */
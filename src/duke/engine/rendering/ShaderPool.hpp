@@ -2,18 +2,28 @@
 
 #include "duke/engine/rendering/ShaderFactory.hpp"
 #include <map>
+#include <vector>
 
 namespace duke {
 
 struct ShaderPool {
   SharedProgram get(const ShaderDescription& key) const {
     auto pFound = m_Map.find(key);
-    if (pFound == m_Map.end()) pFound = m_Map.insert(std::make_pair(key, buildProgram(key))).first;
+    if (pFound == m_Map.end()) pFound = m_Map.insert(std::make_pair(key, buildProgram(key, m_pBinaryCache))).first;
     return pFound->second;
   }
 
+  // Builds programs ahead of time so they don't get compiled while playing.
+  void warm(const std::vector<ShaderDescription>& keys) const {
+    for (const auto& key : keys) get(key);
+  }
+
+  // Programs are built without cache if nullptr.
+  void setBinaryCache(ProgramBinaryCache* pCache) { m_pBinaryCache = pCache; }
+
  private:
   mutable std::map<ShaderDescription, SharedProgram> m_Map;
+  ProgramBinaryCache* m_pBinaryCache = nullptr;
 };
 
 }  // namespace duke
@@ -7,6 +7,9 @@
 #include <unistd.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <sstream>
+
 namespace duke {
 
 FileStatus getFileStatus(const char* filename) {
@@ -38,4 +41,19 @@ std::string getExePath() {
 
 std::string getDirname(const std::string& file) { return file.substr(0, file.rfind('/')); }
 
+bool createDirectories(const std::string& directory) {
+  if (directory.empty()) return false;
+  for (size_t index = directory.find('/', 1); index != std::string::npos; index = directory.find('/', index + 1))
+    mkdir(directory.substr(0, index).c_str(), 0755);
+  mkdir(directory.c_str(), 0755);
+  return getFileStatus(directory.c_str()) == FileStatus::DIRECTORY;
+}
+
+std::string getTemporaryFilename(const std::string& filename) {
+  static std::atomic<unsigned> counter(0);
+  std::ostringstream temporary;
+  temporary << filename << ".tmp." << getpid() << '.' << counter++;
+  return temporary.str();
+}
+
 } /* namespace duke */
@@ -20,4 +20,10 @@ std::string getExePath();
 
 std::string getDirname(const std::string& file);
 
+// Creates directory and its missing parents, returns true if directory exists afterwards.
+bool createDirectories(const std::string& directory);
+
+// Name next to filename unique to this process and call, to write a file aside before renaming it.
+std::string getTemporaryFilename(const std::string& filename);
+
 } /* namespace duke */
@@ -4,4 +4,16 @@
 #define GL_RGB10_A2UI 0x906F
 #endif
 
+#ifndef GL_INTERNALFORMAT_PREFERRED
+#define GL_INTERNALFORMAT_PREFERRED 0x8270
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
 #include <GLFW/glfw3.h>
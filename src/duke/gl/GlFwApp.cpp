@@ -1,6 +1,7 @@
 #include "GlFwApp.hpp"
 
 #include "duke/gl/GL.hpp"
+#include "duke/gl/GlState.hpp"
 
 #include <stdexcept>
 #include <cassert>
@@ -86,6 +87,7 @@ DukeGLFWWindow::DukeGLFWWindow(GLFWwindow *pWindow) : m_pWindow(pWindow) {
   if (!m_pWindow) throw std::runtime_error("Illegal creation of nullptr Window");
   getGlfwToDukeWindowMap()[m_pWindow] = this;
   glfwMakeContextCurrent(m_pWindow);
+  gl::getGlState().reset();
 }
 
 DukeGLFWWindow::~DukeGLFWWindow() {
@@ -107,4 +109,23 @@ void DukeGLFWWindow::registerCallbacks() {
 
 GLFWwindow *DukeGLFWWindow::getHandle() { return m_pWindow; }
 
+DukeGLFWSharedContext::DukeGLFWSharedContext(GLFWwindow *pShare) {
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+  m_pWindow = glfwCreateWindow(1, 1, "", nullptr, pShare);
+  glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+  if (!m_pWindow) throw std::runtime_error("Unable to create a shared context");
+}
+
+DukeGLFWSharedContext::~DukeGLFWSharedContext() { glfwDestroyWindow(m_pWindow); }
+
+void DukeGLFWSharedContext::makeCurrent() const {
+  glfwMakeContextCurrent(m_pWindow);
+  gl::getGlState().reset();
+}
+
+void DukeGLFWSharedContext::doneCurrent() const {
+  glfwMakeContextCurrent(nullptr);
+  gl::getGlState().reset();
+}
+
 } /* namespace duke */
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "duke/base/NonCopyable.hpp"
+#include "duke/gl/IGlContext.hpp"
 
 #include <functional>
 
@@ -31,6 +32,19 @@ class DukeGLFWWindow : public noncopyable {
   GLFWwindow* m_pWindow;
 };
 
+// The context of an invisible window sharing the objects of pShare, to be made current on another thread.
+class DukeGLFWSharedContext : public IGlContext, public noncopyable {
+ public:
+  DukeGLFWSharedContext(GLFWwindow* pShare);
+  ~DukeGLFWSharedContext();
+
+  void makeCurrent() const override;
+  void doneCurrent() const override;
+
+ private:
+  GLFWwindow* m_pWindow;
+};
+
 struct DukeGLFWApplication : public noncopyable {
   DukeGLFWApplication();
   ~DukeGLFWApplication();
@@ -1,7 +1,11 @@
 #include "GlObjects.hpp"
 #include "duke/gl/GL.hpp"
+#include "duke/gl/GlState.hpp"
 #include "duke/gl/GlUtils.hpp"
 
+#include <stdexcept>
+#include <string>
+
 namespace duke {
 namespace gl {
 
@@ -18,9 +22,13 @@ GLuint allocateVertexArrayObject() {
 }  // namespace
 
 GlVertexArrayObject::GlVertexArrayObject() : GlObject(allocateVertexArrayObject()) {}
-GlVertexArrayObject::~GlVertexArrayObject() { glDeleteVertexArrays(1, &id); }
-void GlVertexArrayObject::bind() const { glBindVertexArray(id); }
-void GlVertexArrayObject::unbind() const { glBindVertexArray(0); }
+GlVertexArrayObject::~GlVertexArrayObject() {
+  getGlState().deletedVertexArray(id);
+  glDeleteVertexArrays(1, &id);
+}
+void GlVertexArrayObject::bind() const { getGlState().bindVertexArray(id); }
+// Vertex arrays and textures are left bound, the next bind replaces them.
+void GlVertexArrayObject::unbind() const {}
 
 namespace {
 
@@ -33,9 +41,12 @@ GLuint allocateTextureObject() {
 }  // namespace
 
 GlTextureObject::GlTextureObject(GLenum target) : GlObject(allocateTextureObject()), target(target) {}
-GlTextureObject::~GlTextureObject() { glDeleteTextures(1, &id); }
-void GlTextureObject::bind() const { glBindTexture(target, id); }
-void GlTextureObject::unbind() const { glBindTexture(target, 0); }
+GlTextureObject::~GlTextureObject() {
+  getGlState().deletedTexture(id);
+  glDeleteTextures(1, &id);
+}
+void GlTextureObject::bind() const { getGlState().bindTexture(target, id); }
+void GlTextureObject::unbind() const {}
 
 GlTexture2D::GlTexture2D() : GlTextureObject(GL_TEXTURE_2D) {}
 
@@ -53,17 +64,83 @@ GLuint allocateBufferObject() {
 
 GlBufferObject::GlBufferObject(GLenum target, GLenum usage)
     : GlObject(allocateBufferObject()), target(target), usage(usage) {}
-GlBufferObject::~GlBufferObject() { glDeleteBuffers(1, &id); }
-void GlBufferObject::bind() const { glBindBuffer(target, id); }
-void GlBufferObject::unbind() const { glBindBuffer(target, 0); }
+GlBufferObject::~GlBufferObject() {
+  getGlState().deletedBuffer(id);
+  glDeleteBuffers(1, &id);
+}
+void GlBufferObject::bind() const { getGlState().bindBuffer(target, id); }
+// Buffers are unbound so a pixel buffer left bound does not capture client memory transfers.
+void GlBufferObject::unbind() const { getGlState().bindBuffer(target, 0); }
 
 GlStaticVbo::GlStaticVbo() : GlBufferObject(GL_ARRAY_BUFFER, GL_STATIC_DRAW) {}
 
+GlDynamicVbo::GlDynamicVbo() : GlBufferObject(GL_ARRAY_BUFFER, GL_DYNAMIC_DRAW) {}
+
+GlStreamVbo::GlStreamVbo() : GlBufferObject(GL_ARRAY_BUFFER, GL_STREAM_DRAW) {}
+
 GlStaticIndexedVbo::GlStaticIndexedVbo() : GlBufferObject(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW) {}
 
 GlStreamUploadPbo::GlStreamUploadPbo() : GlBufferObject(GL_PIXEL_UNPACK_BUFFER, GL_STREAM_DRAW) {}
 
+GlFencedUploadPbo::GlFencedUploadPbo() : GlBufferObject(GL_PIXEL_UNPACK_BUFFER, GL_STREAM_DRAW) {}
+GlFencedUploadPbo::~GlFencedUploadPbo() {
+  if (m_Fence) glDeleteSync(m_Fence);
+}
+void GlFencedUploadPbo::allocate(GLsizeiptr size) {
+  static const bool immutable = hasGlExtension("GL_ARB_buffer_storage");
+  auto bound = scope_bind_buffer();
+  if (immutable)
+    glBufferStorage(target, size, nullptr, GL_MAP_WRITE_BIT);
+  else
+    glBufferData(target, size, nullptr, usage);
+}
+void GlFencedUploadPbo::fence() {
+  if (m_Fence) glDeleteSync(m_Fence);
+  m_Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+bool GlFencedUploadPbo::waitForTransfers() {
+  if (!m_Fence) return false;
+  const GLuint64 kTimeoutNs = 1000000000;
+  GLenum status = glClientWaitSync(m_Fence, 0, 0);
+  const bool waited = status == GL_TIMEOUT_EXPIRED;
+  while (status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(m_Fence, GL_SYNC_FLUSH_COMMANDS_BIT, kTimeoutNs);
+  glDeleteSync(m_Fence);
+  m_Fence = nullptr;
+  return waited;
+}
+
 GlStaticUploadPbo::GlStaticUploadPbo() : GlBufferObject(GL_PIXEL_UNPACK_BUFFER, GL_STATIC_DRAW) {}
 
+GlStreamReadPbo::GlStreamReadPbo() : GlBufferObject(GL_PIXEL_PACK_BUFFER, GL_STREAM_READ) {}
+
+namespace {
+
+GLuint allocateFrameBufferObject() {
+  GLuint id;
+  glGenFramebuffers(1, &id);
+  return id;
+}
+
+}  // namespace
+
+GlFrameBufferObject::GlFrameBufferObject() : GlObject(allocateFrameBufferObject()) {}
+GlFrameBufferObject::~GlFrameBufferObject() {
+  getGlState().deletedFramebuffer(id);
+  glDeleteFramebuffers(1, &id);
+}
+void GlFrameBufferObject::bind() const { getGlState().bindFramebuffer(GL_FRAMEBUFFER, id); }
+void GlFrameBufferObject::unbind() const { getGlState().bindFramebuffer(GL_FRAMEBUFFER, 0); }
+
+void GlFrameBufferObject::attachColor(const GlTextureObject& texture, GLenum attachment) const {
+  glCheckBound(GL_FRAMEBUFFER, id);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, texture.target, texture.id, 0);
+}
+
+void GlFrameBufferObject::checkComplete() const {
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+    throw std::runtime_error("Incomplete framebuffer, status " + std::to_string(status));
+}
+
 } /* namespace gl */
 } /* namespace duke */
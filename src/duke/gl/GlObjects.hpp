@@ -83,6 +83,14 @@ struct GlStaticVbo : public GlBufferObject {
   GlStaticVbo();
 };
 
+struct GlDynamicVbo : public GlBufferObject {
+  GlDynamicVbo();
+};
+
+struct GlStreamVbo : public GlBufferObject {
+  GlStreamVbo();
+};
+
 struct GlStaticIndexedVbo : public GlBufferObject {
   GlStaticIndexedVbo();
 };
@@ -91,9 +99,50 @@ struct GlStreamUploadPbo : public GlBufferObject {
   GlStreamUploadPbo();
 };
 
+/**
+ * A pixel buffer allocated once and rewritten only when the transfers reading
+ * it are complete, instead of relying on the driver orphaning its storage.
+ * Storage is immutable when GL_ARB_buffer_storage is available.
+ */
+struct GlFencedUploadPbo : public GlBufferObject {
+  GlFencedUploadPbo();
+  virtual ~GlFencedUploadPbo();
+
+  // Allocates size bytes, once.
+  void allocate(GLsizeiptr size);
+  // Marks the end of the commands reading the buffer, call after each transfer.
+  void fence();
+  // Blocks until the gpu is done reading the buffer, returns true if it was not already.
+  bool waitForTransfers();
+
+ private:
+  GLsync m_Fence = nullptr;
+};
+
 struct GlStaticUploadPbo : public GlBufferObject {
   GlStaticUploadPbo();
 };
 
+struct GlStreamReadPbo : public GlBufferObject {
+  GlStreamReadPbo();
+};
+
+class GlFrameBufferObject : public GlObject {
+ public:
+  GlFrameBufferObject();
+  virtual ~GlFrameBufferObject();
+  virtual void bind() const;
+  virtual void unbind() const;
+
+  inline Binder<GlFrameBufferObject> scope_bind_framebuffer() const {
+    return {this};
+  }
+
+  // Attaches level 0 of texture to the color attachment, the framebuffer must be bound.
+  void attachColor(const GlTextureObject& texture, GLenum attachment = GL_COLOR_ATTACHMENT0) const;
+  // Throws if the bound framebuffer is not complete.
+  void checkComplete() const;
+};
+
 } /* namespace gl */
 } /* namespace duke */
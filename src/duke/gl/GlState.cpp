@@ -0,0 +1,176 @@
+#include "GlState.hpp"
+
+#include "duke/gl/GlObjects.hpp"
+
+namespace duke {
+namespace gl {
+
+namespace {
+
+const GLuint UNKNOWN = ~GLuint(0);
+
+int getTextureTargetIndex(GLenum target) {
+  switch (target) {
+    case GL_TEXTURE_1D:
+      return 0;
+    case GL_TEXTURE_2D:
+      return 1;
+    case GL_TEXTURE_3D:
+      return 2;
+    case GL_TEXTURE_RECTANGLE:
+      return 3;
+    default:
+      return -1;
+  }
+}
+
+int getBufferTargetIndex(GLenum target) {
+  switch (target) {
+    case GL_ARRAY_BUFFER:
+      return 0;
+    case GL_ELEMENT_ARRAY_BUFFER:
+      return 1;
+    case GL_PIXEL_UNPACK_BUFFER:
+      return 2;
+    case GL_PIXEL_PACK_BUFFER:
+      return 3;
+    default:
+      return -1;
+  }
+}
+
+void forget(GLuint& bound, GLuint id) {
+  if (bound == id) bound = 0;
+}
+
+}  // namespace
+
+GlState::GlState() { reset(); }
+
+void GlState::reset() {
+  m_Program = UNKNOWN;
+  m_ActiveTexture = UNKNOWN;
+  for (auto& unit : m_Textures)
+    for (auto& texture : unit) texture = UNKNOWN;
+  for (auto& buffer : m_Buffers) buffer = UNKNOWN;
+  m_VertexArray = UNKNOWN;
+  m_DrawFramebuffer = UNKNOWN;
+  m_ReadFramebuffer = UNKNOWN;
+}
+
+bool GlState::update(GLuint& bound, GLuint id) {
+  if (bound == id) {
+    ++skipped;
+    return false;
+  }
+  bound = id;
+  ++calls;
+  return true;
+}
+
+void GlState::useProgram(GLuint id) {
+  if (update(m_Program, id)) glUseProgram(id);
+}
+
+void GlState::activeTexture(GLenum unit) {
+  if (update(m_ActiveTexture, unit - GL_TEXTURE0)) glActiveTexture(unit);
+}
+
+void GlState::bindTexture(GLenum target, GLuint id) {
+  // textures are bound to unit 0 unless stated otherwise
+  if (m_ActiveTexture == UNKNOWN) activeTexture(GL_TEXTURE0);
+  const int index = getTextureTargetIndex(target);
+  if (index >= 0 && m_ActiveTexture < MAX_TEXTURE_UNITS) {
+    if (update(m_Textures[m_ActiveTexture][index], id)) glBindTexture(target, id);
+    return;
+  }
+  ++calls;
+  glBindTexture(target, id);
+}
+
+void GlState::bindBuffer(GLenum target, GLuint id) {
+  const int index = getBufferTargetIndex(target);
+  if (index >= 0) {
+    if (update(m_Buffers[index], id)) glBindBuffer(target, id);
+    return;
+  }
+  ++calls;
+  glBindBuffer(target, id);
+}
+
+void GlState::bindVertexArray(GLuint id) {
+  if (!update(m_VertexArray, id)) return;
+  glBindVertexArray(id);
+  // the element array binding belongs to the vertex array
+  m_Buffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+}
+
+void GlState::bindFramebuffer(GLenum target, GLuint id) {
+  switch (target) {
+    case GL_DRAW_FRAMEBUFFER:
+      if (update(m_DrawFramebuffer, id)) glBindFramebuffer(target, id);
+      return;
+    case GL_READ_FRAMEBUFFER:
+      if (update(m_ReadFramebuffer, id)) glBindFramebuffer(target, id);
+      return;
+    default:
+      if (m_DrawFramebuffer == id && m_ReadFramebuffer == id) {
+        ++skipped;
+        return;
+      }
+      m_DrawFramebuffer = m_ReadFramebuffer = id;
+      ++calls;
+      glBindFramebuffer(target, id);
+  }
+}
+
+void GlState::deletedProgram(GLuint id) {
+  // a deleted program stays in use until another one is, its name may be reused meanwhile
+  if (m_Program == id) m_Program = UNKNOWN;
+}
+
+void GlState::deletedTexture(GLuint id) {
+  for (auto& unit : m_Textures)
+    for (auto& texture : unit) forget(texture, id);
+}
+
+void GlState::modifiedTexture(GLuint id) {
+  for (auto& unit : m_Textures)
+    for (auto& texture : unit)
+      if (texture == id) texture = UNKNOWN;
+}
+
+void GlState::deletedBuffer(GLuint id) {
+  for (auto& buffer : m_Buffers) forget(buffer, id);
+}
+
+void GlState::deletedVertexArray(GLuint id) {
+  if (m_VertexArray != id) return;
+  m_VertexArray = 0;
+  m_Buffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+}
+
+void GlState::deletedFramebuffer(GLuint id) {
+  forget(m_DrawFramebuffer, id);
+  forget(m_ReadFramebuffer, id);
+}
+
+GlState& getGlState() {
+  static thread_local GlState state;
+  return state;
+}
+
+void bindToUnit(GLint unit, const GlTextureObject& texture) {
+  auto& state = getGlState();
+  state.activeTexture(GL_TEXTURE0 + unit);
+  texture.bind();
+  state.activeTexture(GL_TEXTURE0);
+}
+
+bool isSignaled(GLsync fence) {
+  const GLenum status = glClientWaitSync(fence, 0, 0);
+  return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+} /* namespace gl */
+} /* namespace duke */
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "duke/gl/GL.hpp"
+
+#include <cstddef>
+
+namespace duke {
+namespace gl {
+
+class GlTextureObject;
+
+/**
+ * Shadows the bindings of the GL context current on this thread so redundant
+ * binds never reach the driver.
+ * Every bind must go through it and it must be reset when a context is made
+ * current, unknown bindings are always forwarded.
+ */
+struct GlState {
+  GlState();
+
+  // Forgets all bindings, to call when the current context changes.
+  void reset();
+
+  void useProgram(GLuint id);
+  void activeTexture(GLenum unit);
+  void bindTexture(GLenum target, GLuint id);
+  void bindBuffer(GLenum target, GLuint id);
+  void bindVertexArray(GLuint id);
+  void bindFramebuffer(GLenum target, GLuint id);
+
+  // Deleting an object unbinds it, to call before reusing its id.
+  void deletedProgram(GLuint id);
+  void deletedTexture(GLuint id);
+  void deletedBuffer(GLuint id);
+  void deletedVertexArray(GLuint id);
+  void deletedFramebuffer(GLuint id);
+  // Another context changed the texture, it must be bound again for the changes to be visible.
+  void modifiedTexture(GLuint id);
+
+  // Accounts for a GL call that went through (uniforms, draws) or that was skipped.
+  void called() { ++calls; }
+  void skip() { ++skipped; }
+
+  // Counters, the render loop resets them every frame.
+  size_t calls = 0;
+  size_t skipped = 0;
+  void resetCounters() { calls = skipped = 0; }
+
+ private:
+  enum {
+    MAX_TEXTURE_UNITS = 16,
+    TEXTURE_TARGETS = 4,
+    BUFFER_TARGETS = 4
+  };
+  bool update(GLuint& bound, GLuint id);
+
+  GLuint m_Program;
+  GLuint m_ActiveTexture;
+  GLuint m_Textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+  GLuint m_Buffers[BUFFER_TARGETS];
+  GLuint m_VertexArray;
+  GLuint m_DrawFramebuffer;
+  GLuint m_ReadFramebuffer;
+};
+
+// The state of the context current on the calling thread.
+GlState& getGlState();
+
+// Binds texture on unit through the state, GL_TEXTURE0 is active again afterwards.
+void bindToUnit(GLint unit, const GlTextureObject& texture);
+
+// True if the gpu went past fence, never waits.
+bool isSignaled(GLsync fence);
+
+} /* namespace gl */
+} /* namespace duke */
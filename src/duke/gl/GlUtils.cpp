@@ -5,6 +5,7 @@
 #include "duke/base/StringUtils.hpp"
 #include "duke/gl/GL.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <map>
 #include <sstream>
@@ -181,6 +182,8 @@ const char* getInternalFormatString(GLint internalFormat) {
     CASE(GL_RGBA8I);
     CASE(GL_RGBA8_SNORM);
     CASE(GL_RGBA8UI);
+    CASE(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    CASE(GL_COMPRESSED_RGBA_BPTC_UNORM);
   }
 
 #undef CASE
@@ -304,6 +307,33 @@ void glCheckError() {
 
 namespace {
 
+std::string getString(GLenum name) {
+  const GLubyte* pString = glGetString(name);
+  return pString ? reinterpret_cast<const char*>(pString) : "";
+}
+
+}  // namespace
+
+std::string getDriverKey() {
+  return getString(GL_VENDOR) + '\0' + getString(GL_RENDERER) + '\0' + getString(GL_VERSION);
+}
+
+bool hasGlExtension(const char* pName) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i)
+    if (strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), pName) == 0) return true;
+  return false;
+}
+
+bool hasTimerQueries() {
+  GLint bits = 0;
+  glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+  return glGetError() == GL_NO_ERROR && bits > 0;
+}
+
+namespace {
+
 GLuint getBindParameter(GLuint targetType) {
   switch (targetType) {
     case GL_TEXTURE_2D:
@@ -318,6 +348,8 @@ GLuint getBindParameter(GLuint targetType) {
       return GL_PIXEL_UNPACK_BUFFER_BINDING;
     case GL_PIXEL_PACK_BUFFER:
       return GL_PIXEL_PACK_BUFFER_BINDING;
+    case GL_FRAMEBUFFER:
+      return GL_FRAMEBUFFER_BINDING;
   };
   throw std::runtime_error("unsupported targetType");
 }
@@ -352,18 +384,36 @@ void checkProgramError(unsigned int programId) {
   throw std::runtime_error(error);
 }
 
-GLenum getPixelFormat(GLint internalFormat) {
+namespace {
+
+// Tuned upload formats, written once at startup before uploads begin.
+std::map<GLint, UploadFormat> gUploadFormats;
+
+const UploadFormat* findUploadFormat(GLint internalFormat) {
+  const auto pFound = gUploadFormats.find(internalFormat);
+  return pFound == gUploadFormats.end() ? nullptr : &pFound->second;
+}
+
+GLenum getDefaultPixelFormat(GLint internalFormat) {
   switch (internalFormat) {
     case GL_R8:
+    case GL_R8_SNORM:
+    case GL_R16:
+    case GL_R16_SNORM:
+    case GL_R16F:
     case GL_R32F:
       return GL_RED;
     case GL_RGB8:
+    case GL_RGB8_SNORM:
+    case GL_RGB16:
+    case GL_RGB16_SNORM:
     case GL_RGB16F:
     case GL_RGB32F:
-    case GL_RGB16:
       return GL_RGB;
     case GL_RGBA8:
+    case GL_RGBA8_SNORM:
     case GL_RGBA16:
+    case GL_RGBA16_SNORM:
     case GL_RGBA16F:
     case GL_RGBA32F:
       return GL_RGBA;
@@ -378,41 +428,57 @@ GLenum getPixelFormat(GLint internalFormat) {
   }
 }
 
-bool isInternalOptimizedFormatRedBlueSwapped(int internalFormat) {
+bool isDefaultRedBlueSwapped(int internalFormat) {
   switch (internalFormat) {
     case GL_R8:
+    case GL_R8_SNORM:
+    case GL_R16:
+    case GL_R16_SNORM:
+    case GL_R16F:
     case GL_R32F:
     case GL_RGB8:
+    case GL_RGB8_SNORM:
     case GL_RGBA8:
+    case GL_RGBA8_SNORM:
     case GL_RGB10_A2UI:
     case GL_RGB16:
+    case GL_RGB16_SNORM:
     case GL_RGB16F:
     case GL_RGB32F:
     case GL_RGBA16F:
     case GL_RGBA16:
+    case GL_RGBA16_SNORM:
     case GL_RGBA32F:
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
       return false;
     default:
       return true;
   }
 }
 
-GLint getAdaptedInternalFormat(GLint internalFormat) {
-  return internalFormat == GL_RGB10_A2UI ? GL_RGBA8UI : internalFormat;
-}
-
-GLenum getPixelType(GLint internalFormat) {
+GLenum getDefaultPixelType(GLint internalFormat) {
   switch (internalFormat) {
     case GL_R8:
     case GL_RGB8:
       return GL_UNSIGNED_BYTE;
+    case GL_R8_SNORM:
+    case GL_RGB8_SNORM:
+    case GL_RGBA8_SNORM:
+      return GL_BYTE;
+    case GL_R16:
     case GL_RGB16:
     case GL_RGBA16:
       //    case GL_RGB16UI:
       return GL_UNSIGNED_SHORT;
+    case GL_R16_SNORM:
+    case GL_RGB16_SNORM:
+    case GL_RGBA16_SNORM:
+      return GL_SHORT;
     case GL_RGB10_A2UI:
     case GL_RGBA8:
       return GL_UNSIGNED_INT_8_8_8_8_REV;
+    case GL_R16F:
     case GL_RGBA16F:
     case GL_RGB16F:
       return GL_HALF_FLOAT;
@@ -427,6 +493,95 @@ GLenum getPixelType(GLint internalFormat) {
   }
 }
 
+GLenum getSwappedPixelFormat(GLenum pixelFormat) {
+  switch (pixelFormat) {
+    case GL_RGB:
+      return GL_BGR;
+    case GL_RGBA:
+      return GL_BGRA;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+GLint getAdaptedInternalFormat(GLint internalFormat) {
+  return internalFormat == GL_RGB10_A2UI ? GL_RGBA8UI : internalFormat;
+}
+
+GLenum getPixelFormat(GLint internalFormat) {
+  const UploadFormat* pFormat = findUploadFormat(internalFormat);
+  return pFormat ? pFormat->pixelFormat : getDefaultPixelFormat(internalFormat);
+}
+
+GLenum getPixelType(GLint internalFormat) {
+  const UploadFormat* pFormat = findUploadFormat(internalFormat);
+  return pFormat ? pFormat->pixelType : getDefaultPixelType(internalFormat);
+}
+
+bool isInternalOptimizedFormatRedBlueSwapped(int internalFormat) {
+  const UploadFormat* pFormat = findUploadFormat(internalFormat);
+  return pFormat ? pFormat->redBlueSwapped : isDefaultRedBlueSwapped(internalFormat);
+}
+
+bool operator==(const UploadFormat& a, const UploadFormat& b) {
+  return a.pixelFormat == b.pixelFormat && a.pixelType == b.pixelType && a.redBlueSwapped == b.redBlueSwapped;
+}
+
+std::vector<UploadFormat> getUploadFormatCandidates(int internalFormat) {
+  const GLenum pixelFormat = getDefaultPixelFormat(internalFormat);
+  const GLenum pixelType = getDefaultPixelType(internalFormat);
+  const bool swapped = isDefaultRedBlueSwapped(internalFormat);
+  std::vector<UploadFormat> candidates = {{pixelFormat, pixelType, swapped}};
+  // packed and per byte types read the same bytes on little endian machines
+  if (pixelType == GL_UNSIGNED_INT_8_8_8_8_REV && pixelFormat == GL_RGBA)
+    candidates.push_back({pixelFormat, GL_UNSIGNED_BYTE, swapped});
+  const GLenum swappedFormat = getSwappedPixelFormat(pixelFormat);
+  if (swappedFormat == 0) return candidates;
+  const size_t unswapped = candidates.size();
+  for (size_t i = 0; i < unswapped; ++i)
+    candidates.push_back({swappedFormat, candidates[i].pixelType, !candidates[i].redBlueSwapped});
+  return candidates;
+}
+
+void setUploadFormat(int internalFormat, const UploadFormat& format) {
+  const auto candidates = getUploadFormatCandidates(internalFormat);
+  CHECK(std::find(candidates.begin(), candidates.end(), format) != candidates.end())
+      << "Invalid upload format for " << getInternalFormatString(internalFormat);
+  gUploadFormats[internalFormat] = format;
+}
+
+bool isBlockCompressedFormat(int internalFormat) {
+  return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+size_t getBlockCompressedSize(int internalFormat, size_t width, size_t height) {
+  CHECK(isBlockCompressedFormat(internalFormat)) << getInternalFormatString(internalFormat) << " is not compressed";
+  const size_t blockBytes = internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+  return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
+
+unsigned int getTextureTarget(int internalFormat) {
+  return isBlockCompressedFormat(internalFormat) ? GL_TEXTURE_2D : GL_TEXTURE_RECTANGLE;
+}
+
+int getPreferredInternalFormat(int internalFormat) {
+  static const bool canQuery = hasGlExtension("GL_ARB_internalformat_query2");
+  if (!canQuery) return internalFormat;
+  GLint preferred = internalFormat;
+  glGetInternalformativ(GL_TEXTURE_RECTANGLE, internalFormat, GL_INTERNALFORMAT_PREFERRED, 1, &preferred);
+  glCheckError();
+  return preferred;
+}
+
+std::vector<int32_t> getWidenedRgbFormats() {
+  std::vector<int32_t> formats;
+  for (const int32_t format : {GL_RGB16, GL_RGB16F, GL_RGB32F})
+    if (getPreferredInternalFormat(format) != format) formats.push_back(format);
+  return formats;
+}
+
 size_t getChannelCount(GLenum pixel_format) {
   switch (pixel_format) {
     case GL_RGBA:
@@ -435,8 +590,10 @@ size_t getChannelCount(GLenum pixel_format) {
     case GL_RGB:
     case GL_BGR:
       return 3;
+    case GL_RG:
+      return 2;
     case GL_RED:
-      return 3;
+      return 1;
     default:
       throw std::runtime_error("channel count not implemented");
   }
@@ -447,8 +604,10 @@ size_t getBytePerChannel(GLenum pixel_type) {
     case GL_UNSIGNED_INT_8_8_8_8:
     case GL_UNSIGNED_INT_8_8_8_8_REV:
     case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
       return 1;
     case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
     case GL_HALF_FLOAT:
       return 2;
     case GL_FLOAT:
@@ -482,23 +641,37 @@ std::vector<unsigned char> slurpBinaryFile(const char* pFilename) {
   return result;
 }
 
+// Lines then pixels direction. Transposed orientations store the columns of the image, the
+// displayed width is the texture height.
 std::pair<int, int> getTextureDimensions(size_t uwidth, size_t uheight, uint8_t orientation) {
   float width = uwidth;
   float height = uheight;
   switch (orientation) {
     case 0:  // normal (top to bottom, left to right)
     case 1:  // normal (top to bottom, left to right)
+      height = -height;
+      break;
     case 2:  // flipped horizontally (top to bottom, right to left)
+      width = -width;
       height = -height;
       break;
     case 3:  // rotate 180◦ (bottom to top, right to left)
+      width = -width;
+      break;
     case 4:  // flipped vertically (bottom to top, left to right)
       break;
     case 5:  // transposed (left to right, top to bottom)
+      return std::make_pair(height, -width);
     case 6:  // rotated 90◦ clockwise (right to left, top to bottom)
+      return std::make_pair(-height, -width);
     case 7:  // transverse (right to left, bottom to top)
+      return std::make_pair(-height, width);
     case 8:  // rotated 90◦ counter-clockwise (left to right, bottom to top)
+      return std::make_pair(height, width);
+    default:
       throw std::runtime_error("unsupported orientation");
   }
   return std::make_pair(width, height);
 }
+
+bool isTransposed(uint8_t orientation) { return orientation >= 5 && orientation <= 8; }
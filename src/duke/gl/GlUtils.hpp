@@ -5,7 +5,10 @@
 #include <string>
 #include <vector>
 
+// Displayed dimensions of a texture, negative along flipped axes.
 std::pair<int, int> getTextureDimensions(size_t uwidth, size_t uheight, uint8_t orientation = 1);
+// True if the displayed x axis runs along the texture y axis, see getTextureDimensions.
+bool isTransposed(uint8_t orientation);
 
 int32_t getOpenGlFormat(const Channels& channels);
 Channels getChannels(int32_t internalFormat);
@@ -15,6 +18,29 @@ unsigned int getPixelFormat(int internalFormat);
 unsigned int getPixelType(int internalFormat);
 bool isInternalOptimizedFormatRedBlueSwapped(int internalFormat);
 
+// How frames of an internal format are transferred, candidates of a format read the same bytes.
+// Red and blue swapped candidates store the channels exchanged, the shader swaps them back.
+struct UploadFormat {
+  unsigned int pixelFormat;
+  unsigned int pixelType;
+  bool redBlueSwapped;
+};
+bool operator==(const UploadFormat& a, const UploadFormat& b);
+// The first candidate is the default upload format.
+std::vector<UploadFormat> getUploadFormatCandidates(int internalFormat);
+// getPixelFormat, getPixelType and isInternalOptimizedFormatRedBlueSwapped follow format from now on.
+// Must be called before any thread uploads frames of internalFormat.
+void setUploadFormat(int internalFormat, const UploadFormat& format);
+// True for the 4x4 block formats of proxy frames, uploaded as they are with glCompressedTexSubImage2D.
+bool isBlockCompressedFormat(int internalFormat);
+size_t getBlockCompressedSize(int internalFormat, size_t width, size_t height);
+// Frames live in rectangle textures, block compressed ones in 2D textures as rectangles can't hold them.
+unsigned int getTextureTarget(int internalFormat);
+// The format the driver stores internalFormat in, internalFormat itself if the driver can't tell.
+int getPreferredInternalFormat(int internalFormat);
+// The 16 bits, half and float RGB formats the driver stores as RGBA, frames are better padded while decoding.
+std::vector<int32_t> getWidenedRgbFormats();
+
 const char* getInternalFormatString(int internalFormat);
 const char* getPixelFormatString(unsigned int pixelFormat);
 const char* getPixelTypeString(unsigned int pixelType);
@@ -24,6 +50,12 @@ size_t getBytePerChannel(unsigned int pixel_type);
 size_t getBytePerPixels(unsigned int pixel_format, unsigned int pixel_type);
 
 void glCheckError();
+// Vendor, renderer and version strings of the current context, changes with driver updates.
+std::string getDriverKey();
+// True if the current context exposes the extension, e.g. "GL_ARB_buffer_storage".
+bool hasGlExtension(const char* pName);
+// True if the current context supports GL_TIMESTAMP queries.
+bool hasTimerQueries();
 void glCheckBound(unsigned int targetType, unsigned int id);
 void checkShaderError(unsigned int shaderId, const char* source);
 void checkProgramError(unsigned int programId);
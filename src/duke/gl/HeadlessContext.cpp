@@ -0,0 +1,125 @@
+#include "HeadlessContext.hpp"
+
+#include "duke/gl/GlState.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include <cstring>
+
+#ifdef DUKE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace duke {
+
+#ifdef DUKE_EGL
+
+namespace {
+
+bool hasExtension(const char* pExtensions, const char* pName) {
+  if (!pExtensions) return false;
+  const size_t length = strlen(pName);
+  for (const char* pCurrent = strstr(pExtensions, pName); pCurrent; pCurrent = strstr(pCurrent + length, pName))
+    if ((pCurrent == pExtensions || pCurrent[-1] == ' ') && (pCurrent[length] == ' ' || pCurrent[length] == '\0'))
+      return true;
+  return false;
+}
+
+EGLDisplay getDisplay() {
+  EGLDisplay display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+  const char* pClientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  const auto getPlatformDisplay =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (getPlatformDisplay && hasExtension(pClientExtensions, "EGL_MESA_platform_surfaceless"))
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+#endif
+  if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  return display;
+}
+
+}  // namespace
+
+HeadlessContext::HeadlessContext(const HeadlessContext* pShared) {
+  EGLDisplay display = pShared ? pShared->m_pDisplay : getDisplay();
+  EGLConfig config = pShared ? pShared->m_pConfig : nullptr;
+  if (!pShared) {
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+      throw std::runtime_error("Unable to initialize EGL display");
+    m_OwnsDisplay = true;
+    if (!eglBindAPI(EGL_OPENGL_API)) throw std::runtime_error("EGL display does not support OpenGL");
+
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                       EGL_RED_SIZE,        8,               EGL_GREEN_SIZE,      8,
+                                       EGL_BLUE_SIZE,       8,               EGL_ALPHA_SIZE,      8,
+                                       EGL_NONE};
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+      throw std::runtime_error("No suitable EGL config");
+  }
+  m_pDisplay = display;
+  m_pConfig = config;
+
+  const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR, EGL_NONE};
+  EGLContext context = eglCreateContext(display, config, pShared ? pShared->m_pContext : EGL_NO_CONTEXT,
+                                        contextAttributes);
+  if (context == EGL_NO_CONTEXT) throw std::runtime_error("Unable to create an OpenGL 3.3 core EGL context");
+  m_pContext = context;
+
+  // Rendering goes to framebuffer objects, a surface is only needed if the driver requires one.
+  if (!hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (surface == EGL_NO_SURFACE) throw std::runtime_error("Unable to create EGL pbuffer");
+    m_pSurface = surface;
+  }
+  if (!pShared) makeCurrent();
+}
+
+HeadlessContext::~HeadlessContext() {
+  if (!m_pDisplay) return;
+  if (eglGetCurrentContext() == m_pContext) {
+    eglMakeCurrent(m_pDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    gl::getGlState().reset();
+  }
+  if (m_pSurface) eglDestroySurface(m_pDisplay, m_pSurface);
+  if (m_pContext) eglDestroyContext(m_pDisplay, m_pContext);
+  if (m_OwnsDisplay) eglTerminate(m_pDisplay);
+}
+
+void HeadlessContext::makeCurrent() const {
+  EGLSurface surface = m_pSurface ? m_pSurface : EGL_NO_SURFACE;
+  // the bound api is per thread
+  if (!eglBindAPI(EGL_OPENGL_API) || !eglMakeCurrent(m_pDisplay, surface, surface, m_pContext))
+    throw std::runtime_error("Unable to make EGL context current");
+  gl::getGlState().reset();
+}
+
+void HeadlessContext::doneCurrent() const {
+  eglMakeCurrent(m_pDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  gl::getGlState().reset();
+}
+
+bool HeadlessContext::isSupported() { return true; }
+
+#else
+
+HeadlessContext::HeadlessContext(const HeadlessContext*) {
+  throw std::runtime_error("Headless rendering is not available, duke was compiled without EGL");
+}
+
+HeadlessContext::~HeadlessContext() {}
+
+void HeadlessContext::makeCurrent() const {}
+
+void HeadlessContext::doneCurrent() const {}
+
+bool HeadlessContext::isSupported() { return false; }
+
+#endif  // DUKE_EGL
+
+} /* namespace duke */
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/gl/IGlContext.hpp"
+
+namespace duke {
+
+/**
+ * An OpenGL 3.3 core context without window nor monitor.
+ * Uses EGL with the surfaceless platform if available (e.g. Mesa llvmpipe or a
+ * render node), falls back to the default EGL display with a dummy pbuffer.
+ * The context is made current on the creating thread, unless it shares the
+ * objects of pShared in which case it is meant to be made current on another
+ * thread.
+ * Throws std::runtime_error if no context can be created.
+ */
+class HeadlessContext : public IGlContext, public noncopyable {
+ public:
+  explicit HeadlessContext(const HeadlessContext* pShared = nullptr);
+  ~HeadlessContext();
+
+  void makeCurrent() const override;
+  void doneCurrent() const override;
+
+  // True if duke was compiled with headless support.
+  static bool isSupported();
+
+ private:
+  void* m_pDisplay = nullptr;
+  void* m_pConfig = nullptr;
+  bool m_OwnsDisplay = false;
+  void* m_pContext = nullptr;
+  void* m_pSurface = nullptr;
+};
+
+} /* namespace duke */
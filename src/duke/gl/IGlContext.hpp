@@ -0,0 +1,17 @@
+#pragma once
+
+namespace duke {
+
+/**
+ * An OpenGL context that can be made current on any thread, one at a time.
+ * Used by worker threads sharing objects with the render context.
+ */
+class IGlContext {
+ public:
+  virtual ~IGlContext() {}
+  virtual void makeCurrent() const = 0;
+  // Releases the context from the calling thread.
+  virtual void doneCurrent() const = 0;
+};
+
+} /* namespace duke */
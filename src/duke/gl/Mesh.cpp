@@ -1,4 +1,5 @@
 #include "Mesh.hpp"
+#include "duke/gl/GlState.hpp"
 
 #include <stdexcept>
 
@@ -47,6 +48,7 @@ void Mesh::bind() const { vao.bind(); }
 
 void Mesh::draw() const {
   callDraw();
+  gl::getGlState().called();
   glCheckError();
 }
 
@@ -90,13 +92,4 @@ SharedMesh createSquare() {
       {glm::vec3(1, -1, z), glm::vec2(1, 0)}};
   return make_shared<Mesh>(GL_TRIANGLE_FAN, vertices.data(), vertices.size());
 }
-
-SharedMesh createLine() {
-  using namespace std;
-  const float z = 1;
-  const vector<VertexPosUv0> vertices = {       //
-      {glm::vec3(-1, -1, z), glm::vec2(0, 0)},  //
-      {glm::vec3(1, 1, z), glm::vec2(1, 1)}};
-  return make_shared<Mesh>(GL_LINES, vertices.data(), vertices.size());
-}
 }  // namespace duke
@@ -61,6 +61,5 @@ typedef std::shared_ptr<Mesh> SharedMesh;
 typedef std::shared_ptr<IndexedMesh> SharedIndexedMesh;
 
 SharedMesh createSquare();
-SharedMesh createLine();
 
 }  // namespace duke
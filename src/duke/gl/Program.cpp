@@ -1,28 +1,55 @@
 #include "Program.hpp"
+#include "duke/gl/GlState.hpp"
+
+#include <cstring>
 #include <stdexcept>
 
 namespace duke {
 
-Program::Program(const SharedVertexShader& vertexShader, const SharedFragmentShader& fragmentShader)
+Program::Program(const SharedVertexShader& vertexShader, const SharedFragmentShader& fragmentShader,
+                 bool retrievableBinary)
     : programId(glCreateProgram()), pVertexShader(vertexShader), pFragmentShader(fragmentShader) {
   glAttachShader(programId, pVertexShader->getId());
   glAttachShader(programId, pFragmentShader->getId());
+  if (retrievableBinary) glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   glLinkProgram(programId);
   checkProgramError(programId);
 }
 
+Program::Program(GLenum binaryFormat, const std::vector<char>& binary) : programId(glCreateProgram()) {
+  glProgramBinary(programId, binaryFormat, binary.data(), binary.size());
+  try {
+    checkProgramError(programId);
+  } catch (...) {
+    gl::getGlState().deletedProgram(programId);
+    glDeleteProgram(programId);
+    throw;
+  }
+}
+
 Program::~Program() {
-  glDetachShader(programId, pVertexShader->getId());
-  glDetachShader(programId, pFragmentShader->getId());
+  if (pVertexShader) glDetachShader(programId, pVertexShader->getId());
+  if (pFragmentShader) glDetachShader(programId, pFragmentShader->getId());
+  gl::getGlState().deletedProgram(programId);
   glDeleteProgram(programId);
 }
 
+bool Program::getBinary(GLenum& binaryFormat, std::vector<char>& binary) const {
+  GLint length = 0;
+  glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return false;
+  binary.resize(length);
+  glGetProgramBinary(programId, length, &length, &binaryFormat, binary.data());
+  binary.resize(length);
+  return glGetError() == GL_NO_ERROR && length > 0;
+}
+
 void Program::use() const {
 #ifndef NDEBUG
   glValidateProgram(programId);
   glCheckError();
 #endif
-  glUseProgram(programId);
+  gl::getGlState().useProgram(programId);
   glCheckError();
 }
 
@@ -35,20 +62,23 @@ GLint Program::getUniformLocation(const char* pUniformName) const {
 }
 
 Program::CacheEntry& Program::getOrCreate(const char* pUniformName) {
-  auto pFound = m_Cache.find(pUniformName);
-  if (pFound == m_Cache.end())
-    pFound = m_Cache.insert(std::make_pair(pUniformName, CacheEntry{getUniformLocation(pUniformName)})).first;
-  return pFound->second;
+  for (auto& entry : m_Cache)
+    if (entry.pName == pUniformName) return entry;
+  m_Cache.push_back(CacheEntry{pUniformName, getUniformLocation(pUniformName)});
+  return m_Cache.back();
 }
 
 namespace {
 
 template <typename T>
 bool update(char* cached, const T& newValue) {
+  auto& state = gl::getGlState();
   if (memcmp(cached, &newValue, sizeof(newValue)) != 0) {
     memcpy(cached, &newValue, sizeof(newValue));
+    state.called();
     return true;
   }
+  state.skip();
   return false;
 }
 
@@ -1,14 +1,20 @@
 #pragma once
 
 #include "duke/gl/Shader.hpp"
-#include <map>
+#include <vector>
 
 namespace duke {
 
 struct Program : public noncopyable {
-  Program(const SharedVertexShader& vertexShader, const SharedFragmentShader& fragmentShader);
+  // retrievableBinary allows getBinary, requires program binary support.
+  Program(const SharedVertexShader& vertexShader, const SharedFragmentShader& fragmentShader,
+          bool retrievableBinary = false);
+  // Loads a binary previously returned by getBinary, throws if the driver rejects it.
+  Program(GLenum binaryFormat, const std::vector<char>& binary);
   ~Program();
 
+  bool getBinary(GLenum& binaryFormat, std::vector<char>& binary) const;
+
   void use() const;
   GLint getUniformLocation(const char* pUniformName) const;
 
@@ -34,11 +40,13 @@ struct Program : public noncopyable {
   enum {
     DATA_SIZE = 4 * sizeof(GLfloat)
   };
+  // Uniform names are the shader:: constants, entries are found by address.
   struct CacheEntry {
+    const char* pName;
     GLint location;
     char data[DATA_SIZE];
   };
-  typedef std::map<const char*, CacheEntry> Cache;
+  typedef std::vector<CacheEntry> Cache;
   Cache m_Cache;
   CacheEntry& getOrCreate(const char* pUniformName);
 };
@@ -0,0 +1,112 @@
+#include "ProgramBinaryCache.hpp"
+
+#include "duke/filesystem/FsUtils.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/GlUtils.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace duke {
+
+namespace {
+
+// Entries are the header, the key then the binary.
+const uint32_t kMagic = 0x32504b44;  // 'DKP2'
+
+bool isProgramBinarySupported() {
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  const bool supported = major > 4 || (major == 4 && minor >= 1) || hasGlExtension("GL_ARB_get_program_binary");
+  if (!supported) return false;
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+// Files are named after a hash of the key, the key itself is compared to rule collisions out.
+bool readEntry(const std::string& filename, const std::string& key, GLenum& format, std::vector<char>& binary) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+  if (!file) return false;
+  uint32_t header[3];
+  if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != kMagic) return false;
+  format = header[1];
+  if (header[2] != key.size()) return false;
+  std::string entryKey(key.size(), '\0');
+  if (!file.read(&entryKey[0], entryKey.size()) || entryKey != key) return false;
+  binary.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return !binary.empty();
+}
+
+// Written aside under a name unique to this process then renamed, concurrent instances never
+// read a partial entry nor write the same temporary file.
+void writeEntry(const std::string& filename, const std::string& key, GLenum format, const std::vector<char>& binary) {
+  const std::string temporary = getTemporaryFilename(filename);
+  {
+    std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) return;
+    const uint32_t header[3] = {kMagic, format, uint32_t(key.size())};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(key.data(), key.size());
+    file.write(binary.data(), binary.size());
+    if (!file) {
+      file.close();
+      std::remove(temporary.c_str());
+      return;
+    }
+  }
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0) std::remove(temporary.c_str());
+}
+
+}  // namespace
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory) : m_Directory(directory) {}
+
+std::string ProgramBinaryCache::getKey(const std::string& vertexSource, const std::string& fragmentSource) const {
+  return m_DriverKey + '\0' + vertexSource + '\0' + fragmentSource;
+}
+
+std::string ProgramBinaryCache::getFilename(const std::string& key) const {
+  const size_t hash = std::hash<std::string>()(key);
+  char filename[32];
+  snprintf(filename, sizeof(filename), "/%016zx.bin", hash);
+  return m_Directory + filename;
+}
+
+SharedProgram ProgramBinaryCache::getOrBuild(const std::string& vertexSource, const std::string& fragmentSource) {
+  if (!m_Initialized) {
+    m_Initialized = true;
+    m_Enabled = !m_Directory.empty() && isProgramBinarySupported() && createDirectories(m_Directory);
+    m_DriverKey = getDriverKey();
+  }
+  if (!m_Enabled)
+    return std::make_shared<Program>(makeVertexShader(vertexSource.c_str()),
+                                     makeFragmentShader(fragmentSource.c_str()));
+  const std::string key = getKey(vertexSource, fragmentSource);
+  const std::string filename = getFilename(key);
+  GLenum format = 0;
+  std::vector<char> binary;
+  if (readEntry(filename, key, format, binary)) {
+    try {
+      auto pProgram = std::make_shared<Program>(format, binary);
+      ++hits;
+      return pProgram;
+    } catch (std::runtime_error&) {
+      // stale entry, the driver flags the rejected binary, rebuilding it
+      while (glGetError() != GL_NO_ERROR) {
+      }
+    }
+  }
+  ++misses;
+  auto pProgram = std::make_shared<Program>(makeVertexShader(vertexSource.c_str()),
+                                            makeFragmentShader(fragmentSource.c_str()), true);
+  if (pProgram->getBinary(format, binary)) writeEntry(filename, key, format, binary);
+  return pProgram;
+}
+
+} /* namespace duke */
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/gl/Program.hpp"
+
+#include <string>
+
+namespace duke {
+
+/**
+ * Keeps linked programs on disk using glGetProgramBinary so they don't have to be
+ * compiled again on subsequent runs.
+ * Entries are keyed by the shader sources and by the vendor, renderer and version
+ * strings of the driver, a driver update invalidates them. The key is stored in the
+ * entry and compared on load.
+ * Programs are always built from sources if the driver does not support program
+ * binaries or the directory is empty.
+ */
+class ProgramBinaryCache : public noncopyable {
+ public:
+  ProgramBinaryCache(const std::string& directory);
+
+  // Must be called with a current context.
+  SharedProgram getOrBuild(const std::string& vertexSource, const std::string& fragmentSource);
+
+  size_t hits = 0;
+  size_t misses = 0;
+
+ private:
+  std::string getKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+  std::string getFilename(const std::string& key) const;
+
+  const std::string m_Directory;
+  bool m_Initialized = false;
+  bool m_Enabled = false;
+  std::string m_DriverKey;
+};
+
+} /* namespace duke */
@@ -1,12 +1,24 @@
 #include "Textures.hpp"
+#include "duke/gl/GlState.hpp"
 #include "duke/gl/GlUtils.hpp"
+#include "duke/image/ImageUtils.hpp"
 #include "duke/io/ImageLoadUtils.hpp"
 
+#include <algorithm>
+
 namespace duke {
 
 void Texture::initialize(const ImageDescription &description, const GLvoid *pData) {
   const auto opengl_format = description.opengl_format;
   CHECK(opengl_format != -1) << "OpenGl format must be resolved at this point";
+  if (isBlockCompressedFormat(opengl_format)) {
+    glCheckBound(target, id);
+    glCompressedTexImage2D(target, 0, opengl_format, description.width, description.height, 0,
+                           getImageSize(description), pData);
+    glCheckError();
+    this->description = description;
+    return;
+  }
   initialize(description, getAdaptedInternalFormat(opengl_format), getPixelFormat(opengl_format),
              getPixelType(opengl_format), pData);
 }
@@ -31,4 +43,40 @@ void Texture::update(GLint xoffset, GLint yoffset, GLsizei width, GLsizei height
   glCheckError();
 }
 
+void MipmapPyramid::initialize(uint32_t width, uint32_t height) {
+  glCheckBound(target, id);
+  this->width = width;
+  this->height = height;
+  levels = getMipmapLevels(width, height);
+  for (GLsizei level = 0; level < levels; ++level)
+    glTexImage2D(target, level, GL_RGBA16F, std::max(1u, width >> level), std::max(1u, height >> level), 0, GL_RGBA,
+                 GL_HALF_FLOAT, nullptr);
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glCheckError();
+  // pyramids may be created while drawing into another framebuffer
+  GLint previousFrameBuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  frameBuffer.bind();
+  frameBuffer.attachColor(*this);
+  frameBuffer.checkComplete();
+  gl::getGlState().bindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+}
+
+GLsizei getMipmapLevels(uint32_t width, uint32_t height) {
+  GLsizei levels = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size >>= 1) ++levels;
+  return levels;
+}
+
+size_t getMipmapPyramidSize(uint32_t width, uint32_t height) {
+  size_t size = 0;
+  for (GLsizei level = 0; level < getMipmapLevels(width, height); ++level)
+    size += size_t(std::max(1u, width >> level)) * std::max(1u, height >> level) * 4 * sizeof(uint16_t);
+  return size;
+}
+
 }  // namespace duke
@@ -5,7 +5,9 @@
 
 namespace duke {
 
-struct Texture : public gl::GlTextureRectangle {
+// A frame texture, see getTextureTarget for its target.
+struct Texture : public gl::GlTextureObject {
+  explicit Texture(GLenum target = GL_TEXTURE_RECTANGLE) : gl::GlTextureObject(target) {}
   void initialize(const ImageDescription &description, const GLvoid *pData = nullptr);
   void initialize(const ImageDescription &description, GLint internalFormat, GLenum format, GLenum type,
                   const GLvoid *pData);
@@ -15,4 +17,17 @@ struct Texture : public gl::GlTextureRectangle {
   ImageDescription description;
 };
 
+// Half float RGBA texture with a full mip chain, level 0 is the render target of frameBuffer.
+struct MipmapPyramid : public gl::GlTexture2D {
+  void initialize(uint32_t width, uint32_t height);
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  GLsizei levels = 0;
+  gl::GlFrameBufferObject frameBuffer;
+};
+
+GLsizei getMipmapLevels(uint32_t width, uint32_t height);
+size_t getMipmapPyramidSize(uint32_t width, uint32_t height);
+
 }  // namespace duke
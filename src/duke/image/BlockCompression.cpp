@@ -0,0 +1,367 @@
+#include "BlockCompression.hpp"
+
+#include "duke/attributes/AttributeKeys.hpp"
+#include "duke/base/Check.hpp"
+#include "duke/base/TaskPool.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/image/ImageUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace duke {
+
+namespace {
+
+const size_t kBlockSide = 4;
+const size_t kBlockTexels = kBlockSide * kBlockSide;
+// Blocks encoded by a task, below this encoding the rows is not worth the synchronization.
+const size_t kMinBlocksPerTask = 4096;
+
+// Interpolation weights of the BC7 four bits indices, out of 64.
+const uint32_t kBc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+enum class SampleType { UINT8, UINT16, HALF, FLOAT };
+
+struct SourceLayout {
+  SampleType type;
+  size_t components;
+};
+
+bool getSourceLayout(int32_t internalFormat, SourceLayout& layout) {
+  switch (internalFormat) {
+    case GL_RGB8:
+      layout = {SampleType::UINT8, 3};
+      return true;
+    case GL_RGBA8:
+      layout = {SampleType::UINT8, 4};
+      return true;
+    case GL_RGB16:
+      layout = {SampleType::UINT16, 3};
+      return true;
+    case GL_RGBA16:
+      layout = {SampleType::UINT16, 4};
+      return true;
+    case GL_RGB16F:
+      layout = {SampleType::HALF, 3};
+      return true;
+    case GL_RGBA16F:
+      layout = {SampleType::HALF, 4};
+      return true;
+    case GL_RGB32F:
+      layout = {SampleType::FLOAT, 3};
+      return true;
+    case GL_RGBA32F:
+      layout = {SampleType::FLOAT, 4};
+      return true;
+    default:
+      return false;
+  }
+}
+
+float halfToFloat(uint16_t half) {
+  const uint32_t sign = uint32_t(half >> 15) << 31;
+  uint32_t exponent = (half >> 10) & 0x1F;
+  uint32_t mantissa = half & 0x3FF;
+  uint32_t bits = sign;
+  if (exponent == 0x1F) {
+    bits |= 0x7F800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits |= ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa != 0) {  // subnormal, normalized as a float
+    for (exponent = 113; !(mantissa & 0x400); --exponent) mantissa <<= 1;
+    bits |= (exponent << 23) | ((mantissa & 0x3FF) << 13);
+  }
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// NaN goes to 0.
+uint8_t toUnorm8(float value) { return uint8_t((value > 0 ? (value < 1 ? value : 1) : 0) * 255 + .5f); }
+
+uint8_t readSample(SampleType type, const char* pData, size_t index) {
+  switch (type) {
+    case SampleType::UINT8:
+      return reinterpret_cast<const uint8_t*>(pData)[index];
+    case SampleType::UINT16:
+      return (reinterpret_cast<const uint16_t*>(pData)[index] * 255U + 32767U) / 65535U;
+    case SampleType::HALF:
+      return toUnorm8(halfToFloat(reinterpret_cast<const uint16_t*>(pData)[index]));
+    case SampleType::FLOAT:
+      return toUnorm8(reinterpret_cast<const float*>(pData)[index]);
+  }
+  return 0;
+}
+
+void readRow(const SourceLayout& layout, const char* pRow, size_t width, uint8_t* pTexels) {
+  for (size_t x = 0; x < width; ++x, pTexels += 4) {
+    for (size_t c = 0; c < layout.components; ++c)
+      pTexels[c] = readSample(layout.type, pRow, x * layout.components + c);
+    if (layout.components == 3) pTexels[3] = 255;
+  }
+}
+
+// The segment best fitting the texels' first components : the extent of their projections on the principal axis,
+// found by power iteration on the covariance matrix.
+void fitEndpoints(const uint8_t* pTexels, size_t components, float* pLow, float* pHigh) {
+  float mean[4] = {0, 0, 0, 0};
+  for (size_t i = 0; i < kBlockTexels; ++i)
+    for (size_t c = 0; c < components; ++c) mean[c] += pTexels[i * 4 + c];
+  for (size_t c = 0; c < components; ++c) mean[c] /= kBlockTexels;
+  float covariance[4][4] = {};
+  for (size_t i = 0; i < kBlockTexels; ++i)
+    for (size_t a = 0; a < components; ++a)
+      for (size_t b = 0; b < components; ++b)
+        covariance[a][b] += (pTexels[i * 4 + a] - mean[a]) * (pTexels[i * 4 + b] - mean[b]);
+  // starting from the column of the most varying component avoids an axis orthogonal to the principal one
+  size_t widest = 0;
+  for (size_t c = 1; c < components; ++c)
+    if (covariance[c][c] > covariance[widest][widest]) widest = c;
+  float axis[4] = {0, 0, 0, 0};
+  for (size_t c = 0; c < components; ++c) axis[c] = covariance[c][widest];
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[4] = {0, 0, 0, 0};
+    float norm = 0;
+    for (size_t a = 0; a < components; ++a) {
+      for (size_t b = 0; b < components; ++b) next[a] += covariance[a][b] * axis[b];
+      norm = std::max(norm, std::abs(next[a]));
+    }
+    if (norm == 0) break;
+    for (size_t c = 0; c < components; ++c) axis[c] = next[c] / norm;
+  }
+  float length = 0;
+  for (size_t c = 0; c < components; ++c) length += axis[c] * axis[c];
+  float lowest = 0;
+  float highest = 0;
+  if (length > 0) {
+    for (size_t i = 0; i < kBlockTexels; ++i) {
+      float projection = 0;
+      for (size_t c = 0; c < components; ++c) projection += (pTexels[i * 4 + c] - mean[c]) * axis[c];
+      lowest = std::min(lowest, projection / length);
+      highest = std::max(highest, projection / length);
+    }
+  }
+  for (size_t c = 0; c < components; ++c) {
+    pLow[c] = std::min(255.f, std::max(0.f, mean[c] + lowest * axis[c]));
+    pHigh[c] = std::min(255.f, std::max(0.f, mean[c] + highest * axis[c]));
+  }
+}
+
+// Index of the palette entry closest to each texel.
+void getClosestIndices(const uint8_t* pTexels, const uint8_t (*pPalette)[4], size_t entries, size_t components,
+                       uint8_t* pIndices) {
+  for (size_t i = 0; i < kBlockTexels; ++i) {
+    uint32_t closest = ~0U;
+    for (size_t entry = 0; entry < entries; ++entry) {
+      uint32_t distance = 0;
+      for (size_t c = 0; c < components; ++c) {
+        const int delta = int(pTexels[i * 4 + c]) - pPalette[entry][c];
+        distance += delta * delta;
+      }
+      if (distance >= closest) continue;
+      closest = distance;
+      pIndices[i] = entry;
+    }
+  }
+}
+
+uint16_t toRgb565(const float* pColor) {
+  const uint16_t red = uint16_t(pColor[0] * 31 / 255 + .5f);
+  const uint16_t green = uint16_t(pColor[1] * 63 / 255 + .5f);
+  const uint16_t blue = uint16_t(pColor[2] * 31 / 255 + .5f);
+  return (red << 11) | (green << 5) | blue;
+}
+
+void fromRgb565(uint16_t packed, uint8_t* pColor) {
+  const uint8_t red = packed >> 11;
+  const uint8_t green = (packed >> 5) & 0x3F;
+  const uint8_t blue = packed & 0x1F;
+  pColor[0] = (red << 3) | (red >> 2);
+  pColor[1] = (green << 2) | (green >> 4);
+  pColor[2] = (blue << 3) | (blue >> 2);
+  pColor[3] = 255;
+}
+
+void writeLittleEndian(uint32_t value, size_t bytes, uint8_t* pBlock) {
+  for (size_t i = 0; i < bytes; ++i) pBlock[i] = value >> (8 * i);
+}
+
+// Writes fields from the least significant bit of the block onwards.
+struct BitWriter {
+  uint8_t* pBlock;
+  size_t bit;
+  void write(uint32_t value, size_t bits) {
+    for (size_t i = 0; i < bits; ++i, ++bit)
+      if ((value >> i) & 1) pBlock[bit / 8] |= 1 << (bit % 8);
+  }
+};
+
+// 7 bits endpoint and its low bit, the one closest to color.
+void quantizeBc7Endpoint(const float* pColor, uint8_t* pQuantized, uint8_t& pBit) {
+  float bestError = 0;
+  for (uint8_t candidate = 0; candidate < 2; ++candidate) {
+    uint8_t quantized[4];
+    float error = 0;
+    for (size_t c = 0; c < 4; ++c) {
+      quantized[c] = uint8_t(std::min(127.f, std::max(0.f, std::floor((pColor[c] - candidate) / 2 + .5f))));
+      const float delta = ((quantized[c] << 1) | candidate) - pColor[c];
+      error += delta * delta;
+    }
+    if (candidate != 0 && error >= bestError) continue;
+    bestError = error;
+    pBit = candidate;
+    std::copy(quantized, quantized + 4, pQuantized);
+  }
+}
+
+struct EncodedLayout {
+  SourceLayout source;
+  size_t rowBytes;
+  size_t blockBytes;
+  size_t blocksPerRow;
+  void (*encodeBlock)(const uint8_t*, uint8_t*);
+};
+
+void encodeBlockRows(const EncodedLayout& layout, const ImageDescription& description, const char* pSource,
+                     size_t beginRow, size_t endRow, uint8_t* pBlocks) {
+  const size_t width = description.width;
+  std::vector<uint8_t> rows(kBlockSide * width * 4);
+  uint8_t texels[kBlockTexels * 4];
+  for (size_t blockRow = beginRow; blockRow < endRow; ++blockRow) {
+    // edge blocks repeat the last row and column
+    for (size_t y = 0; y < kBlockSide; ++y) {
+      const size_t row = std::min<size_t>(blockRow * kBlockSide + y, description.height - 1);
+      readRow(layout.source, pSource + row * layout.rowBytes, width, rows.data() + y * width * 4);
+    }
+    for (size_t block = 0; block < layout.blocksPerRow; ++block) {
+      for (size_t y = 0; y < kBlockSide; ++y)
+        for (size_t x = 0; x < kBlockSide; ++x) {
+          const size_t column = std::min(block * kBlockSide + x, width - 1);
+          memcpy(texels + (y * kBlockSide + x) * 4, rows.data() + (y * width + column) * 4, 4);
+        }
+      layout.encodeBlock(texels, pBlocks + (blockRow * layout.blocksPerRow + block) * layout.blockBytes);
+    }
+  }
+}
+
+}  // namespace
+
+int32_t getProxyInternalFormat(ProxyFormat format) {
+  switch (format) {
+    case ProxyFormat::BC1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case ProxyFormat::BC7:
+      return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+      return -1;
+  }
+}
+
+void encodeBc1Block(const uint8_t* pTexels, uint8_t* pBlock) {
+  float low[4], high[4];
+  fitEndpoints(pTexels, 3, low, high);
+  uint16_t first = toRgb565(high);
+  uint16_t second = toRgb565(low);
+  // the four levels mode needs the first endpoint greater
+  if (first < second) std::swap(first, second);
+  writeLittleEndian(first, 2, pBlock);
+  writeLittleEndian(second, 2, pBlock + 2);
+  if (first == second) {
+    writeLittleEndian(0, 4, pBlock + 4);
+    return;
+  }
+  uint8_t palette[4][4];
+  fromRgb565(first, palette[0]);
+  fromRgb565(second, palette[1]);
+  for (size_t c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+  }
+  uint8_t indices[kBlockTexels];
+  getClosestIndices(pTexels, palette, 4, 3, indices);
+  uint32_t packed = 0;
+  for (size_t i = 0; i < kBlockTexels; ++i) packed |= uint32_t(indices[i]) << (2 * i);
+  writeLittleEndian(packed, 4, pBlock + 4);
+}
+
+void encodeBc7Block(const uint8_t* pTexels, uint8_t* pBlock) {
+  float low[4], high[4];
+  fitEndpoints(pTexels, 4, low, high);
+  uint8_t endpoints[2][4];
+  uint8_t pBits[2];
+  quantizeBc7Endpoint(low, endpoints[0], pBits[0]);
+  quantizeBc7Endpoint(high, endpoints[1], pBits[1]);
+  uint8_t palette[16][4];
+  for (size_t entry = 0; entry < 16; ++entry)
+    for (size_t c = 0; c < 4; ++c) {
+      const uint32_t first = (endpoints[0][c] << 1) | pBits[0];
+      const uint32_t second = (endpoints[1][c] << 1) | pBits[1];
+      palette[entry][c] = ((64 - kBc7Weights[entry]) * first + kBc7Weights[entry] * second + 32) >> 6;
+    }
+  uint8_t indices[kBlockTexels];
+  getClosestIndices(pTexels, palette, 16, 4, indices);
+  // the first index is stored without its high bit, swapping the endpoints mirrors the weights
+  if (indices[0] & 8) {
+    std::swap(endpoints[0], endpoints[1]);
+    std::swap(pBits[0], pBits[1]);
+    for (auto& index : indices) index = 15 - index;
+  }
+  memset(pBlock, 0, 16);
+  BitWriter writer{pBlock, 0};
+  writer.write(1 << 6, 7);  // mode 6
+  for (size_t c = 0; c < 4; ++c) {
+    writer.write(endpoints[0][c], 7);
+    writer.write(endpoints[1][c], 7);
+  }
+  writer.write(pBits[0], 1);
+  writer.write(pBits[1], 1);
+  writer.write(indices[0], 3);
+  for (size_t i = 1; i < kBlockTexels; ++i) writer.write(indices[i], 4);
+}
+
+bool canEncodeProxy(const ImageDescription& description) {
+  SourceLayout layout;
+  return description.width > 0 && description.height > 0 && getSourceLayout(description.opengl_format, layout) &&
+         description.channels.size() == layout.components &&
+         !attribute::getWithDefault<attribute::DpxImageSwapEndianness>(description.extra_attributes);
+}
+
+void encodeProxy(FrameData& frame, ProxyFormat format, const Allocator& allocator) {
+  const ImageDescription& source = frame.getDescription();
+  CHECK(format != ProxyFormat::NONE && canEncodeProxy(source)) << "Can't encode this frame as a proxy";
+  EncodedLayout layout;
+  getSourceLayout(source.opengl_format, layout.source);
+  layout.rowBytes = source.width * getChannelsByteSize(source.channels);
+  layout.blockBytes = format == ProxyFormat::BC1 ? 8 : 16;
+  layout.blocksPerRow = (source.width + kBlockSide - 1) / kBlockSide;
+  layout.encodeBlock = format == ProxyFormat::BC1 ? &encodeBc1Block : &encodeBc7Block;
+
+  ImageDescription description = source;
+  description.opengl_format = getProxyInternalFormat(format);
+  description.channels.type = Channels::FormatType::UNSIGNED_NORMALIZED;
+  for (auto& channel : description.channels) channel.bits = 8;
+  FrameData encoded;
+  auto blocks = encoded.setDescriptionAndAllocate(description, allocator);
+  auto* pBlocks = reinterpret_cast<uint8_t*>(blocks.begin());
+  const char* pSource = frame.getData().begin();
+
+  const size_t blockRows = (source.height + kBlockSide - 1) / kBlockSide;
+  auto& pool = TaskPool::instance();
+  const size_t rowsPerTask = std::max<size_t>(1, kMinBlocksPerTask / layout.blocksPerRow);
+  if (blockRows <= rowsPerTask || pool.workers() < 2) {
+    encodeBlockRows(layout, description, pSource, 0, blockRows, pBlocks);
+  } else {
+    std::vector<TaskPool::Task> tasks;
+    for (size_t begin = 0; begin < blockRows; begin += rowsPerTask) {
+      const size_t end = std::min(blockRows, begin + rowsPerTask);
+      tasks.push_back([&, begin, end]() { encodeBlockRows(layout, description, pSource, begin, end, pBlocks); });
+    }
+    pool.run(tasks);
+  }
+  frame = std::move(encoded);
+}
+
+} /* namespace duke */
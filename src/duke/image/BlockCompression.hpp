@@ -0,0 +1,32 @@
+#pragma once
+
+#include "duke/image/FrameData.hpp"
+
+#include <cstdint>
+
+namespace duke {
+
+// Block compressed formats frames can be stored as for proxy playback.
+enum class ProxyFormat {
+  NONE,
+  BC1,  // aka S3TC DXT1, opaque, 8 bytes per 4x4 block
+  BC7,  // aka BPTC, with alpha, 16 bytes per 4x4 block
+};
+
+// The OpenGL format of the blocks, -1 for NONE.
+int32_t getProxyInternalFormat(ProxyFormat format);
+
+// Encode 4x4 texels given as 16 row major RGBA8 values.
+// BC1 keeps 5:6:5 endpoints and four levels, alpha is dropped.
+void encodeBc1Block(const uint8_t* pTexels, uint8_t* pBlock);
+// BC7 mode 6 keeps 7 bits RGBA endpoints with a shared low bit and sixteen levels.
+void encodeBc7Block(const uint8_t* pTexels, uint8_t* pBlock);
+
+// True for the RGB and RGBA frames proxies are made from : 8 and 16 bits, half and float channels.
+bool canEncodeProxy(const ImageDescription& description);
+
+// Replaces the frame's pixels with blocks of format, rows of blocks are encoded in parallel on the task pool.
+// Values are clamped to [0, 1] and quantized to 8 bits beforehand.
+void encodeProxy(FrameData& frame, ProxyFormat format, const Allocator& allocator);
+
+} /* namespace duke */
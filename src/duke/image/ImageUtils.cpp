@@ -1,6 +1,7 @@
 #include "duke/image/ImageUtils.hpp"
 
 #include "duke/base/Check.hpp"
+#include "duke/gl/GlUtils.hpp"
 
 size_t getChannelsByteSize(const Channels& channels) {
   size_t bits = 0;
@@ -10,5 +11,7 @@ size_t getChannelsByteSize(const Channels& channels) {
 }
 
 size_t getImageSize(const ImageDescription& description) {
+  if (isBlockCompressedFormat(description.opengl_format))
+    return getBlockCompressedSize(description.opengl_format, description.width, description.height);
   return description.width * description.height * getChannelsByteSize(description.channels);
 }
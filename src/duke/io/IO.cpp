@@ -1,5 +1,9 @@
 #include "IO.hpp"
 
+#include "duke/base/TaskPool.hpp"
+
+#include <algorithm>
+#include <mutex>
 #include <stdexcept>
 
 #include <cassert>
@@ -8,6 +12,44 @@ using namespace std;
 
 namespace duke {
 
+namespace {
+
+// Below this size splitting the read is not worth the synchronization.
+const size_t kMinParallelReadBytes = 32 * 1024 * 1024;
+// Target size of a strip.
+const size_t kStripBytes = 4 * 1024 * 1024;
+
+}  // namespace
+
+bool IImageReader::readStrips(size_t rows, size_t bytesPerRow, const StripReader& readStrip) {
+  const size_t totalBytes = rows * bytesPerRow;
+  auto& pool = TaskPool::instance();
+  if (rows < 2 || totalBytes < kMinParallelReadBytes || pool.workers() < 2) {
+    std::string msg;
+    if (readStrip(0, rows, msg)) return true;
+    return error(msg);
+  }
+  const size_t maxStrips = std::min(rows, pool.workers() * 4);
+  const size_t strips = std::max<size_t>(1, std::min(maxStrips, totalBytes / kStripBytes));
+  const size_t rowsPerStrip = (rows + strips - 1) / strips;
+  std::mutex errorMutex;
+  std::string firstError;
+  bool failed = false;
+  vector<TaskPool::Task> tasks;
+  for (size_t begin = 0; begin < rows; begin += rowsPerStrip) {
+    const size_t end = std::min(rows, begin + rowsPerStrip);
+    tasks.push_back([&, begin, end]() {
+      std::string msg;
+      if (readStrip(begin, end, msg)) return;
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!failed) firstError = msg;
+      failed = true;
+    });
+  }
+  pool.run(tasks);
+  return failed ? error(firstError) : true;
+}
+
 bool IODescriptors::registerDescriptor(IIODescriptor* pDescriptor) {
   assert(pDescriptor);
   m_Descriptors.push_back(unique_ptr<IIODescriptor>(pDescriptor));
@@ -11,6 +11,7 @@
 #include "duke/image/ImageDescription.hpp"
 
 #include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -46,6 +47,9 @@ struct ReadOptions {
   // eg. use [0,2] if images is RGBA but you only want RGB.
   int8_t channelRange[2] = {-1, -1};
 
+  // RGB images are read as RGBA with an opaque alpha, readers unable to do it while decoding ignore it.
+  bool padRgbToRgba = false;
+
   attribute::Attributes extra_attributes;  // Additional attributes.
 };
 
@@ -62,6 +66,14 @@ class IImageReader : public noncopyable {
     return false;
   }
 
+  // Reads a strip of rows [beginRow, endRow), returns false and sets error on failure.
+  typedef std::function<bool(size_t beginRow, size_t endRow, std::string& error)> StripReader;
+
+  // Splits the reading of rows into independent strips and runs them on the shared TaskPool.
+  // Small images are read in one go on the calling thread.
+  // Returns false if any strip failed, the error is then available through getError().
+  bool readStrips(size_t rows, size_t bytesPerRow, const StripReader& readStrip);
+
  public:
   virtual ~IImageReader() {}
 
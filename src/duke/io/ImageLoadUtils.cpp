@@ -11,6 +11,9 @@
 #include "duke/io/IO.hpp"
 #include "duke/memory/Allocator.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <sstream>
 
 using std::move;
@@ -19,15 +22,50 @@ namespace duke {
 
 namespace {
 
-AlignedMalloc alignedMalloc;
-
 ReadFrameResult error(const std::string& error, ReadFrameResult& result) {
   result.error = error;
   return move(result);
 }
 
+const int32_t kPaddableRgbFormats[] = {GL_RGB16, GL_RGB16F, GL_RGB32F};
+
+// One bit per kPaddableRgbFormats entry, decoding threads read it concurrently.
+std::atomic<uint32_t> gPaddedRgbFormats(0);
+
+int getPaddableIndex(int32_t openGlFormat) {
+  const auto pFound = std::find(std::begin(kPaddableRgbFormats), std::end(kPaddableRgbFormats), openGlFormat);
+  return pFound == std::end(kPaddableRgbFormats) ? -1 : pFound - std::begin(kPaddableRgbFormats);
+}
+
+bool isPaddedRgb(const Channels& channels) {
+  for (const int32_t format : kPaddableRgbFormats) {
+    const Channels formatChannels = getChannels(format);
+    if (channels.type != formatChannels.type || channels.size() != formatChannels.size()) continue;
+    if (std::equal(channels.begin(), channels.end(), formatChannels.begin(), [](const Channel& a, const Channel& b) {
+          return a.semantic == b.semantic && a.bits == b.bits;
+        }))
+      return isPaddedRgbFormat(format);
+  }
+  return false;
+}
+
 }  // namespace
 
+void setPaddedRgbFormats(const std::vector<int32_t>& openGlFormats) {
+  uint32_t mask = 0;
+  for (const int32_t format : openGlFormats) {
+    const int index = getPaddableIndex(format);
+    CHECK(index >= 0) << getInternalFormatString(format) << " can't be padded";
+    mask |= 1 << index;
+  }
+  gPaddedRgbFormats = mask;
+}
+
+bool isPaddedRgbFormat(int32_t openGlFormat) {
+  const int index = getPaddableIndex(openGlFormat);
+  return index >= 0 && (gPaddedRgbFormats & (1 << index));
+}
+
 void loadImage(ReadFrameResult& result, const ReadOptionsFunc& getReadOptions) {
   IImageReader* pReader = result.reader.get();
   CHECK(pReader);
@@ -37,8 +75,10 @@ void loadImage(ReadFrameResult& result, const ReadOptionsFunc& getReadOptions) {
   }
   const auto& description = pReader->getContainerDescription();
   CHECK(description.subimages.size() == 1);
-  const auto& options = getReadOptions(description);
-  if (!pReader->read(options, alignedMalloc, result.frame)) {
+  auto options = getReadOptions(description);
+  const auto& channels = description.subimages.front().channels;
+  options.padRgbToRgba = isPaddedRgb(channels);
+  if (!pReader->read(options, getFrameAllocator(), result.frame)) {
     result.error = pReader->getError();
     return;
   }
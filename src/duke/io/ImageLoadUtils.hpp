@@ -4,6 +4,7 @@
 #include "duke/io/IIOOperation.hpp"
 
 #include <functional>
+#include <vector>
 
 namespace duke {
 
@@ -13,6 +14,11 @@ inline ReadOptionsFunc defaultReadOptions() {
   return [](const StreamDescription&) { return ReadOptions{}; };
 }
 
+// RGB formats the driver stores as RGBA, their frames are padded while decoding so uploads need no conversion.
+// May be set at any time, frames decoded before are uploaded as RGB.
+void setPaddedRgbFormats(const std::vector<int32_t>& openGlFormats);
+bool isPaddedRgbFormat(int32_t openGlFormat);
+
 void loadImage(ReadFrameResult& result, const ReadOptionsFunc& getReadOptions = defaultReadOptions());
 
 ReadFrameResult load(const char* pFilename, const ReadOptionsFunc& getReadOptions = defaultReadOptions());
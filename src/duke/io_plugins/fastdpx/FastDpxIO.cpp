@@ -65,6 +65,12 @@ typedef struct _image_information {
 
 namespace duke {
 
+namespace {
+// Frames bigger than this are paged in from several threads before being handed over.
+const size_t kMinPageInStripsBytes = 64 * 1024 * 1024;
+const size_t kPageBytes = 4096;
+}  // namespace
+
 class FastDpxImageReader : public IImageReader {
   const MemoryMappedFile m_File;
   const FileInformation* pInformation;
@@ -115,8 +121,20 @@ class FastDpxImageReader : public IImageReader {
     set<OiioColorspace>(attributes, "KodakLog");
     const char* const pData = pArithmeticPointer + swap(pInformation->offset);
     const auto size = getImageSize(description);
+    const auto rows = description.height;
+    const auto bytesPerRow = size / rows;
+    // Pixels are swapped and unpacked by the shader, the mapped file is handed over as is.
     frame.setDescriptionAndVolatileData(description, {pData, pData + size});
-    return true;
+    if (size < kMinPageInStripsBytes) return true;
+    // Touching a byte per page faults big frames in from several threads instead of the one consuming them.
+    return readStrips(rows, bytesPerRow, [=](size_t beginRow, size_t endRow, std::string&) {
+      const volatile char* const pBegin = pData + beginRow * bytesPerRow;
+      const volatile char* const pEnd = pData + endRow * bytesPerRow;
+      char sink = 0;
+      for (const volatile char* pPage = pBegin; pPage < pEnd; pPage += kPageBytes) sink ^= *pPage;
+      (void)sink;
+      return true;
+    });
   }
 };
 
@@ -5,6 +5,7 @@
 #include "duke/attributes/AttributeKeys.hpp"
 #include "duke/gl/GL.hpp"
 #include "duke/gl/GlUtils.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
 
 #include <mutex>
 #include <memory>
@@ -360,8 +361,11 @@ struct PictureDecoder {
     m_Buffer.resize(lineSize * height);
     m_StridedBuffer.resize(roundedUpLineSize * height);
     for (int i = 0; i < AV_NUM_DATA_POINTERS; ++i) lineSizes[i] = roundedUpLineSize;
+    MemoryAccounting::instance().tag("reader scratch").add(getScratchSize());
   }
 
+  ~PictureDecoder() { MemoryAccounting::instance().tag("reader scratch").remove(getScratchSize()); }
+
   ConstMemorySlice decodeFrame(const AVFrame* pFrame) const {
     char* pSrc = m_StridedBuffer.data();
     if (sws_scale(m_pSwsCtx, pFrame->data, pFrame->linesize, 0, height, reinterpret_cast<unsigned char**>(&pSrc),
@@ -394,6 +398,8 @@ struct PictureDecoder {
  private:
   int lineSize, roundedUpLineSize;
   struct SwsContext* m_pSwsCtx;
+  size_t getScratchSize() const { return m_Buffer.size() + m_StridedBuffer.size(); }
+
   mutable std::vector<char> m_StridedBuffer, m_Buffer;
   int lineSizes[AV_NUM_DATA_POINTERS];
 };
@@ -9,7 +9,9 @@
 
 #include <algorithm>
 #include <iterator>
+#include <mutex>
 #include <set>
+#include <vector>
 
 using namespace std;
 OIIO_NAMESPACE_USING;
@@ -18,14 +20,24 @@ namespace duke {
 
 namespace {
 
+// There are no 32 bits normalized textures, such images are decoded to normalized floats.
+TypeDesc getDecodedFormat(const TypeDesc& format) {
+  switch (format.basetype) {
+    case TypeDesc::INT32:
+    case TypeDesc::UINT32:
+      return TypeDesc::FLOAT;
+    default:
+      return format;
+  }
+}
+
 Channels::FormatType getFormatType(const TypeDesc& description) {
   switch (description.basetype) {
     case TypeDesc::INT8:
     case TypeDesc::INT16:
-    case TypeDesc::INT32:
+      return Channels::FormatType::SIGNED_NORMALIZED;
     case TypeDesc::UINT8:
     case TypeDesc::UINT16:
-    case TypeDesc::UINT32:
       return Channels::FormatType::UNSIGNED_NORMALIZED;
     //    case TypeDesc::UINT8:
     //    case TypeDesc::UINT16:
@@ -103,6 +115,25 @@ ImageDescription getImageDescription(const ImageSpec& imageSpec) {
   return description;
 }
 
+template <typename T>
+void fillAlpha(char* pData, size_t pixels, T opaque) {
+  T* pAlpha = reinterpret_cast<T*>(pData) + 3;
+  for (size_t i = 0; i < pixels; ++i, pAlpha += 4) *pAlpha = opaque;
+}
+
+// Sets the fourth channel of RGBA pixels to their opaque value.
+void fillOpaqueAlpha(const TypeDesc& format, char* pData, size_t pixels) {
+  switch (format.basetype) {
+    case TypeDesc::UINT16:
+      return fillAlpha<uint16_t>(pData, pixels, 0xFFFF);
+    case TypeDesc::HALF:
+      return fillAlpha<uint16_t>(pData, pixels, 0x3C00);
+    case TypeDesc::FLOAT:
+      return fillAlpha<float>(pData, pixels, 1);
+  }
+  CHECK(false) << "Unsupported padded basetype " << format.basetype;
+}
+
 template <typename T>
 void insert(attribute::Attributes& attributes, const char* const key, const void* const ptr, int aggregate) {
   CHECK(aggregate > 0);
@@ -116,11 +147,61 @@ void insert(attribute::Attributes& attributes, const char* const key, const void
 }  // namespace
 
 class OpenImageIOReader : public IImageReader {
+  const string m_Filename;
   unique_ptr<ImageInput> m_pImageInput;
   ImageSpec m_Spec;
+  // Inputs opened for strips other than the first one, idle ones are reused by the next strips.
+  mutex m_StripInputsMutex;
+  vector<unique_ptr<ImageInput>> m_IdleStripInputs;
+
+  // An idle strip input, a newly opened one if all are busy. Returns nullptr and sets error on failure.
+  unique_ptr<ImageInput> acquireStripInput(string& error) {
+    {
+      lock_guard<mutex> lock(m_StripInputsMutex);
+      if (!m_IdleStripInputs.empty()) {
+        unique_ptr<ImageInput> pInput = move(m_IdleStripInputs.back());
+        m_IdleStripInputs.pop_back();
+        return pInput;
+      }
+    }
+    ImageSpec spec;
+    unique_ptr<ImageInput> pInput(ImageInput::create(m_Filename));
+    if (!pInput || !pInput->open(m_Filename, spec)) {
+      error = OpenImageIO::geterror();
+      return nullptr;
+    }
+    return pInput;
+  }
+
+  void releaseStripInput(unique_ptr<ImageInput> pInput) {
+    lock_guard<mutex> lock(m_StripInputsMutex);
+    m_IdleStripInputs.push_back(move(pInput));
+  }
+
+  // Reads scanlines [beginRow, endRow) into pData, pixels are pixelBytes apart.
+  // ImageInput is not thread safe so strips other than the first one read through their own input,
+  // at most one is opened per worker reading concurrently.
+  bool readScanlines(size_t beginRow, size_t endRow, size_t pixelBytes, char* pData, string& error) {
+    const int ybegin = m_Spec.y + beginRow;
+    const int yend = m_Spec.y + endRow;
+    const stride_t xstride = pixelBytes;
+    const stride_t ystride = pixelBytes * m_Spec.width;
+    char* const pStrip = pData + beginRow * ystride;
+    if (beginRow == 0) {
+      if (m_pImageInput->read_scanlines(ybegin, yend, 0, m_Spec.format, pStrip, xstride, ystride)) return true;
+      error = m_pImageInput->geterror();
+      return false;
+    }
+    unique_ptr<ImageInput> pInput = acquireStripInput(error);
+    if (!pInput) return false;
+    const bool success = pInput->read_scanlines(ybegin, yend, 0, m_Spec.format, pStrip, xstride, ystride);
+    if (!success) error = pInput->geterror();
+    releaseStripInput(move(pInput));
+    return success;
+  }
 
  public:
-  OpenImageIOReader(const char* filename) : m_pImageInput(ImageInput::create(filename)) {
+  OpenImageIOReader(const char* filename) : m_Filename(filename), m_pImageInput(ImageInput::create(filename)) {
     if (!m_pImageInput) {
       m_Error = OpenImageIO::geterror();
       return;
@@ -133,6 +214,8 @@ class OpenImageIOReader : public IImageReader {
       m_Error = "can't read volume images";
       return;
     }
+    // pixels are read as this format, OpenImageIO converts them
+    m_Spec.format = getDecodedFormat(m_Spec.format);
     static const vector<string> A = {"A"};
     static const vector<string> RGB = {"R", "G", "B"};
     static const vector<string> RGBA = {"R", "G", "B", "A"};
@@ -200,15 +283,31 @@ class OpenImageIOReader : public IImageReader {
 
   ~OpenImageIOReader() {
     if (m_pImageInput) m_pImageInput->close();
+    for (const auto& pInput : m_IdleStripInputs) pInput->close();
   }
 
   bool read(const ReadOptions& options, const Allocator& allocator, FrameData& frame) override {
     if (options.frame != 0) return error("plugin does not support multiple frames");
     if (options.subimage != 0) return error("plugin does not support subimage yet");
     auto description = m_Description.subimages.at(0);
+    // decoding RGB straight into RGBA pixels, the alpha is filled as rows land
+    const bool pad = options.padRgbToRgba && m_Spec.nchannels == 3;
+    if (pad) description.channels.emplace_back(Channel::Semantic::ALPHA, getBits(m_Spec.format), "A");
+    const size_t pixelBytes = m_Spec.format.size() * description.channels.size();
     auto data = frame.setDescriptionAndAllocate(description, allocator);
-    if (!m_pImageInput->read_image(m_Spec.format, data.begin())) return error(OpenImageIO::geterror());
-    return true;
+    char* const pData = data.begin();
+    if (m_Spec.tile_width > 0) {
+      if (!m_pImageInput->read_image(m_Spec.format, pData, pixelBytes)) return error(OpenImageIO::geterror());
+      if (pad) fillOpaqueAlpha(m_Spec.format, pData, size_t(m_Spec.width) * m_Spec.height);
+      return true;
+    }
+    const size_t rowBytes = pixelBytes * m_Spec.width;
+    return readStrips(m_Spec.height, rowBytes,
+                      [this, pad, pixelBytes, rowBytes, pData](size_t beginRow, size_t endRow, string& error) {
+      if (!readScanlines(beginRow, endRow, pixelBytes, pData, error)) return false;
+      if (pad) fillOpaqueAlpha(m_Spec.format, pData + beginRow * rowBytes, (endRow - beginRow) * m_Spec.width);
+      return true;
+    });
   }
 };
 
@@ -8,6 +8,8 @@
 
 #include <cstdio>
 
+#include <unistd.h>
+
 using namespace attribute;
 
 // Define targa header. This is only used locally.
@@ -33,6 +35,7 @@ namespace duke {
 class TGAImageReader : public IImageReader {
   FILE* m_pFile;
   TGAHEADER m_Header;
+  off_t m_DataOffset = 0;
 
  public:
   TGAImageReader(const char* filename) : m_pFile(fopen(filename, "rb")) {
@@ -44,6 +47,7 @@ class TGAImageReader : public IImageReader {
       m_Error = "Unable to read header";
       return;
     }
+    m_DataOffset = ftell(m_pFile);
     ImageDescription description;
     switch (m_Header.bits) {
       case 24:  // Most likely case
@@ -76,8 +80,18 @@ class TGAImageReader : public IImageReader {
     set<DpxImageOrientation>(attributes, 4);
     set<ImageSwapRedAndBlue>(attributes, true);
     auto data = frame.setDescriptionAndAllocate(description, allocator);
-    if (fread(data.begin(), data.size(), 1, m_pFile) != 1) m_Error = "Unable to read from file";
-    return true;
+    char* const pData = data.begin();
+    const size_t bytesPerRow = data.size() / description.height;
+    const int fd = fileno(m_pFile);
+    const off_t dataOffset = m_DataOffset;
+    // Rows are uncompressed so strips can be read independently with pread.
+    return readStrips(description.height, bytesPerRow, [=](size_t beginRow, size_t endRow, std::string& error) {
+      const size_t offset = beginRow * bytesPerRow;
+      const size_t size = (endRow - beginRow) * bytesPerRow;
+      if (pread(fd, pData + offset, size, dataOffset + offset) == static_cast<ssize_t>(size)) return true;
+      error = "Unable to read from file";
+      return false;
+    });
   }
 };
 
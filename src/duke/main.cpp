@@ -1,5 +1,6 @@
 #include "duke/cmdline/CmdLineParameters.hpp"
 #include "duke/engine/DukeApplication.hpp"
+#include "duke/engine/DukeHeadlessApplication.hpp"
 #include "duke/io/IO.hpp"
 #include "duke/benchmark/Benchmark.hpp"
 #include "duke/config.h"  // autogenerated from config.h.in
@@ -32,6 +33,11 @@ int main(int argc, char **argv) {
       case ApplicationMode::BENCHMARK:
         benchmark();
         break;
+      case ApplicationMode::HEADLESS: {
+        DukeHeadlessApplication headless(parameters);
+        headless.run();
+        break;
+      }
       case ApplicationMode::DUKE:
         DukeApplication duke(parameters);
         duke.run();
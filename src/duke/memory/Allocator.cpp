@@ -1,9 +1,16 @@
 #include "duke/memory/Allocator.hpp"
 
+#include "duke/base/Check.hpp"
+
+#include <algorithm>  // min, max
+#include <atomic>     // atomic
+#include <memory>     // unique_ptr
+#include <mutex>      // mutex
+#include <thread>     // yield
+#include <vector>     // vector
+
 #include <cassert>  // assert
-#include <cstring>  // memset
-// constant for block allocation
-const unsigned char ChunkAllocatorBlocks = CHUNK_ALLOCATOR_BLOCKS;
+#include <cstdint>  // uint64_t
 
 struct ChunkAllocator;
 // forward declaring
@@ -11,13 +18,29 @@ struct ChunkAllocator;
 // Sentinel code
 struct Sentinel {
   unsigned int magic;
+  unsigned int sizeClass;
   ChunkAllocator* pAllocator;
 };
 
 namespace {
 
+const unsigned int SentinelMagic = 0xDEADC0DE;
+
+// a chunk holds at most CHUNK_ALLOCATOR_BLOCKS blocks and no more than this many bytes
+const size_t MaxChunkBytes = 64 * 1024 * 1024;
+
+// four classes per power of two pages, that's up to 2^34 pages
+const size_t SizeClasses = 4 + 4 * 32;
+
+// threads above this count bypass the thread cache
+const size_t MaxCachedThreads = 64;
+
 Sentinel* getSentinelFromBlockStart(void* pBlockStart) { return reinterpret_cast<Sentinel*>(pBlockStart) - 1; }
 
+const Sentinel* getSentinelFromBlockStart(const void* pBlockStart) {
+  return reinterpret_cast<const Sentinel*>(pBlockStart) - 1;
+}
+
 // boundary helpers
 size_t lowerPage(size_t ptr) { return (ptr >> PAGE_SIZE_BITS) << PAGE_SIZE_BITS; }
 
@@ -32,123 +55,240 @@ size_t getChunkSize(size_t chunkSize) {
   return alignedToPage(realChunkSize) ? realChunkSize : upperPage(realChunkSize);
 }
 
-size_t getAllocationSize(size_t chunkSize) {
-  const size_t allAlignedChunkSize = getChunkSize(chunkSize) * ChunkAllocatorBlocks;
+size_t getAllocationSize(size_t chunkSize, size_t blocks) {
+  const size_t allAlignedChunkSize = getChunkSize(chunkSize) * blocks;
   // adding one PAGE_SIZE to ensure we can offset and give aligned data
   return allAlignedChunkSize + PAGE_SIZE;
 }
 
-}  // namespace
+size_t log2Floor(size_t value) {
+  size_t result = 0;
+  while (value >>= 1) ++result;
+  return result;
+}
+
+// size classes are 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20... pages
+size_t getSizeClass(size_t size) {
+  const size_t pages = std::max<size_t>(1, (size + PAGE_SIZE - 1) >> PAGE_SIZE_BITS);
+  if (pages <= 4) return pages - 1;
+  const size_t exponent = log2Floor(pages - 1);
+  const size_t step = size_t(1) << (exponent - 2);
+  const size_t offset = pages - (size_t(1) << exponent);
+  return 4 + (exponent - 2) * 4 + (offset + step - 1) / step - 1;
+}
+
+size_t getClassSize(size_t sizeClass) {
+  if (sizeClass < 4) return (sizeClass + 1) << PAGE_SIZE_BITS;
+  const size_t exponent = (sizeClass - 4) / 4 + 2;
+  const size_t step = (sizeClass - 4) % 4 + 1;
+  return ((4 + step) << (exponent - 2)) << PAGE_SIZE_BITS;
+}
+
+size_t getBlocksPerChunk(size_t blockSize) {
+  const size_t blocks = MaxChunkBytes / getChunkSize(blockSize);
+  return std::min<size_t>(CHUNK_ALLOCATOR_BLOCKS, std::max<size_t>(1, blocks));
+}
 
 /**
- * Reserve CHUNK blocks of contiguous memory aligned on PAGE_SIZE
- * you can then allocate and deallocate CHUNK blocks of size ChunkSize
+ * Threads get a small index used to address their cache slot.
+ * Indices are recycled when threads exit.
  */
-struct ChunkAllocator {
- public:
-  const size_t m_ChunkSize;
+std::atomic<uint64_t> gUsedThreadIndices(0);
 
- private:
-  unsigned char m_AvailableSlots;
-  char* m_pData;
-  bool m_UsedSlot[ChunkAllocatorBlocks];
-  void* m_SlotData[ChunkAllocatorBlocks];
-
- private:
-  inline unsigned char findFreeSlot() const {
-    unsigned char i = 0;
-    for (; i < ChunkAllocatorBlocks; ++i)
-      if (m_UsedSlot[i] == false) return i;
-    assert(false);
-    return i;
+struct ThreadIndex {
+  ThreadIndex() : index(MaxCachedThreads) {
+    uint64_t used = gUsedThreadIndices.load();
+    for (;;) {
+      if (~used == 0) return;
+      const size_t candidate = log2Floor(~used & (used + 1));
+      if (gUsedThreadIndices.compare_exchange_weak(used, used | (uint64_t(1) << candidate))) {
+        index = candidate;
+        return;
+      }
+    }
+  }
+  ~ThreadIndex() {
+    if (index < MaxCachedThreads) gUsedThreadIndices &= ~(uint64_t(1) << index);
   }
+  size_t index;
+};
 
-  inline unsigned char findSlot(void* pData) const {
-    unsigned char i = 0;
-    for (; i < ChunkAllocatorBlocks; ++i)
-      if (m_SlotData[i] == pData) return i;
-    assert(false);
-    return i;
+size_t getThreadIndex() {
+  static thread_local ThreadIndex threadIndex;
+  return threadIndex.index;
+}
+
+/**
+ * Lock free stack of free blocks, the next pointer is stored in the free block itself.
+ * Blocks are page aligned so an ABA tag is packed in the low PAGE_SIZE_BITS
+ * and in the unused upper 16 bits of the pointer.
+ */
+struct FreeList {
+  FreeList() : m_Head(0), m_Readers(0) {}
+
+  void push(void* pBlock) {
+    uint64_t head = m_Head.load();
+    for (;;) {
+      next(pBlock) = pointer(head);
+      if (m_Head.compare_exchange_weak(head, pack(pBlock, tag(head) + 1))) return;
+    }
   }
 
- public:
-  ChunkAllocator(size_t chunkSize)
-      : m_ChunkSize(chunkSize),
-        m_AvailableSlots(ChunkAllocatorBlocks),
-        m_pData((char*)malloc(getAllocationSize(chunkSize))) {
-    assert(PAGE_SIZE == (size_t)getPageSize());
-    memset(m_UsedSlot, false, ChunkAllocatorBlocks);
-    char* pBlockStart = reinterpret_cast<char*>(upperPage(reinterpret_cast<size_t>(m_pData)));
-    const size_t realChunkSize = getChunkSize(chunkSize);
-    for (int i = 0; i < ChunkAllocatorBlocks; ++i) {
-      m_SlotData[i] = pBlockStart;
-      Sentinel* pSentinel = getSentinelFromBlockStart(pBlockStart);
-      pSentinel->pAllocator = this;
-      pSentinel->magic = 0xDEADC0DE;
-      pBlockStart += realChunkSize;
+  void* pop() {
+    ++m_Readers;
+    uint64_t head = m_Head.load();
+    void* pBlock = nullptr;
+    for (;;) {
+      pBlock = pointer(head);
+      if (!pBlock) break;
+      // next might be stale if another thread popped the block meanwhile but then the tag changed
+      if (m_Head.compare_exchange_weak(head, pack(next(pBlock), tag(head) + 1))) break;
     }
+    --m_Readers;
+    return pBlock;
   }
-  ~ChunkAllocator() { ::free(m_pData); }
-  inline bool isNotFull() const { return m_AvailableSlots != 0; }
-  inline bool isNotEmpty() const { return m_AvailableSlots != ChunkAllocatorBlocks; }
-  void* allocate() {
-    assert(isNotFull());
-    const unsigned char index = findFreeSlot();
-    --m_AvailableSlots;
-    m_UsedSlot[index] = true;
-    return m_SlotData[index];
+
+  // Detaches all the blocks, returns the first one of the list.
+  // Waits for concurrent pops to complete so the blocks can safely be released.
+  void* popAll() {
+    uint64_t head = m_Head.load();
+    while (!m_Head.compare_exchange_weak(head, pack(nullptr, tag(head) + 1))) {
+    }
+    while (m_Readers > 0) std::this_thread::yield();
+    return pointer(head);
   }
-  void free(void* pData) {
-    assert(isNotEmpty());
-    m_UsedSlot[findSlot(pData)] = false;
-    ++m_AvailableSlots;
+
+  static void*& next(void* pBlock) { return *reinterpret_cast<void**>(pBlock); }
+
+ private:
+  static const uint64_t TagMask = PAGE_SIZE - 1;
+  static const uint64_t PointerMask = ((uint64_t(1) << 48) - 1) & ~TagMask;
+
+  static uint64_t pack(void* pBlock, uint64_t tag) {
+    return reinterpret_cast<uint64_t>(pBlock) | (tag & TagMask) | ((tag >> PAGE_SIZE_BITS) << 48);
   }
+  static void* pointer(uint64_t value) { return reinterpret_cast<void*>(value & PointerMask); }
+  static uint64_t tag(uint64_t value) { return (value & TagMask) | ((value >> 48) << PAGE_SIZE_BITS); }
+
+  std::atomic<uint64_t> m_Head;
+  std::atomic<size_t> m_Readers;
 };
 
+}  // namespace
+
 /**
- * Maintains a list of dynamically allocated Chunks
+ * Reserve up to CHUNK_ALLOCATOR_BLOCKS blocks of contiguous memory aligned on PAGE_SIZE.
+ * Each block is preceded by a Sentinel pointing back to its chunk.
  */
-#include <list>    // list
-#include <memory>  // unique_ptr
-struct ChunkManager {
-  ChunkManager(const size_t chunkSize) : m_ChunkSize(chunkSize) {}
-  void* allocate() {
-    auto pCurrent = m_Chunks.begin();
-    const auto pEnd = m_Chunks.end();
-    for (; pCurrent != pEnd; ++pCurrent)
-      if ((*pCurrent)->isNotFull()) break;
-    if (pCurrent == pEnd) {  // time to allocate a new chunk
-      // putting chunk front so next time we will find it right away
-      m_Chunks.emplace_front(new ChunkAllocator(m_ChunkSize));
-      pCurrent = m_Chunks.begin();
+struct ChunkAllocator {
+  ChunkAllocator(size_t sizeClass, const void* pOwner)
+      : m_pOwner(pOwner),
+        m_BlockSize(getClassSize(sizeClass)),
+        m_Blocks(getBlocksPerChunk(m_BlockSize)),
+        m_AllocationSize(getAllocationSize(m_BlockSize, m_Blocks)),
+        m_pData((char*)malloc(m_AllocationSize)),
+        m_Collected(0) {
+    assert(PAGE_SIZE == (size_t)getPageSize());
+    CHECK(m_pData) << "Unable to allocate " << m_AllocationSize << " bytes";
+    for (size_t i = 0; i < m_Blocks; ++i) {
+      Sentinel* pSentinel = getSentinelFromBlockStart(getBlock(i));
+      pSentinel->pAllocator = this;
+      pSentinel->sizeClass = sizeClass;
+      pSentinel->magic = SentinelMagic;
     }
-    return (*pCurrent)->allocate();
   }
+  ~ChunkAllocator() { ::free(m_pData); }
+
+  inline void* getBlock(size_t index) const {
+    char* pBlockStart = reinterpret_cast<char*>(upperPage(reinterpret_cast<size_t>(m_pData)));
+    return pBlockStart + index * getChunkSize(m_BlockSize);
+  }
+
+  const void* const m_pOwner;  // the BigAlignedBlock implementation growing it
+  const size_t m_BlockSize;
+  const size_t m_Blocks;
+  const size_t m_AllocationSize;
 
  private:
-  const size_t m_ChunkSize;
-  std::list<std::unique_ptr<ChunkAllocator>> m_Chunks;
+  char* const m_pData;
+
+ public:
+  // number of free blocks found while trimming
+  size_t m_Collected;
 };
 
-#include <mutex>
-#include <map>
 struct BigAlignedBlock::BigAlignedBlockImpl {
+  BigAlignedBlockImpl() {
+    for (auto& slots : m_ThreadCache)
+      for (auto& slot : slots) slot = nullptr;
+  }
+
   inline void* malloc(const size_t size) {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-    auto itr = m_SizeToManager.find(size);
-    if (itr == m_SizeToManager.end())
-      itr = m_SizeToManager.insert(std::make_pair(size, std::unique_ptr<ChunkManager>(new ChunkManager(size)))).first;
-    return itr->second->allocate();
+    const size_t sizeClass = getSizeClass(size);
+    CHECK(sizeClass < SizeClasses) << "Allocation too big " << size;
+    const size_t thread = getThreadIndex();
+    if (thread < MaxCachedThreads)
+      if (void* pBlock = m_ThreadCache[thread][sizeClass].exchange(nullptr)) return pBlock;
+    if (void* pBlock = m_FreeLists[sizeClass].pop()) return pBlock;
+    return grow(sizeClass);
   }
+
   inline void free(void* pData) {
-    std::lock_guard<std::mutex> lock(m_Mutex);
     const Sentinel* pSentinel = getSentinelFromBlockStart(pData);
-    assert(pSentinel->magic == 0xDEADC0DE);
-    assert(pSentinel->pAllocator);
-    pSentinel->pAllocator->free(pData);
+    CHECK(pSentinel->magic == SentinelMagic) << "Not allocated by BigAlignedBlock";
+    const size_t sizeClass = pSentinel->sizeClass;
+    const size_t thread = getThreadIndex();
+    // keeping the block in the thread cache, the previously cached one goes to the free list
+    if (thread < MaxCachedThreads) pData = m_ThreadCache[thread][sizeClass].exchange(pData);
+    if (pData) m_FreeLists[sizeClass].push(pData);
+  }
+
+  size_t trim() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    size_t released = 0;
+    std::vector<void*> blocks;
+    for (size_t sizeClass = 0; sizeClass < SizeClasses; ++sizeClass) {
+      auto& chunks = m_Chunks[sizeClass];
+      if (chunks.empty()) continue;
+      // gathering all free blocks of this class
+      blocks.clear();
+      for (void* pBlock = m_FreeLists[sizeClass].popAll(); pBlock; pBlock = FreeList::next(pBlock))
+        blocks.push_back(pBlock);
+      for (auto& slots : m_ThreadCache)
+        if (void* pBlock = slots[sizeClass].exchange(nullptr)) blocks.push_back(pBlock);
+      // a chunk is idle if all its blocks are free
+      for (auto& pChunk : chunks) pChunk->m_Collected = 0;
+      for (void* pBlock : blocks) ++getSentinelFromBlockStart(pBlock)->pAllocator->m_Collected;
+      for (void* pBlock : blocks) {
+        const ChunkAllocator* pChunk = getSentinelFromBlockStart(pBlock)->pAllocator;
+        if (pChunk->m_Collected != pChunk->m_Blocks) m_FreeLists[sizeClass].push(pBlock);
+      }
+      const auto isIdle = [](const std::unique_ptr<ChunkAllocator>& pChunk) {
+        return pChunk->m_Collected == pChunk->m_Blocks;
+      };
+      for (const auto& pChunk : chunks)
+        if (isIdle(pChunk)) released += pChunk->m_AllocationSize;
+      chunks.erase(std::remove_if(chunks.begin(), chunks.end(), isIdle), chunks.end());
+    }
+    return released;
   }
+
+ private:
+  void* grow(size_t sizeClass) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // another thread may have grown the class while we were waiting
+    if (void* pBlock = m_FreeLists[sizeClass].pop()) return pBlock;
+    auto& chunks = m_Chunks[sizeClass];
+    chunks.emplace_back(new ChunkAllocator(sizeClass, this));
+    const ChunkAllocator& chunk = *chunks.back();
+    for (size_t i = 1; i < chunk.m_Blocks; ++i) m_FreeLists[sizeClass].push(chunk.getBlock(i));
+    return chunk.getBlock(0);
+  }
+
+  FreeList m_FreeLists[SizeClasses];
+  std::atomic<void*> m_ThreadCache[MaxCachedThreads][SizeClasses];
   std::mutex m_Mutex;
-  std::map<size_t, std::unique_ptr<ChunkManager>> m_SizeToManager;
+  std::vector<std::unique_ptr<ChunkAllocator>> m_Chunks[SizeClasses];
 };
 
 BigAlignedBlock::BigAlignedBlock() : pImpl(new BigAlignedBlockImpl()) {}
@@ -160,3 +300,35 @@ void* BigAlignedBlock::malloc(const size_t size) const { return pImpl->malloc(si
 void BigAlignedBlock::free(void* ptr) const {
   if (ptr) pImpl->free(ptr);
 }
+
+size_t BigAlignedBlock::trim() const { return pImpl->trim(); }
+
+size_t BigAlignedBlock::allocatedSize(const void* ptr) const {
+  const Sentinel* pSentinel = getSentinelFromBlockStart(ptr);
+  CHECK(pSentinel->magic == SentinelMagic) << "Not allocated by BigAlignedBlock";
+  return getClassSize(pSentinel->sizeClass);
+}
+
+bool BigAlignedBlock::owns(const void* ptr) const {
+  const Sentinel* pSentinel = getSentinelFromBlockStart(ptr);
+  return pSentinel->magic == SentinelMagic && pSentinel->pAllocator->m_pOwner == pImpl;
+}
+
+namespace {
+
+std::atomic<const Allocator*> gFrameAllocator(nullptr);
+
+const Allocator& getDefaultFrameAllocator() {
+  // Leaked on purpose : frames can still be released during static destruction.
+  static const Allocator* pDefault = new BigAlignedBlock();
+  return *pDefault;
+}
+
+}  // namespace
+
+const Allocator& getFrameAllocator() {
+  const Allocator* pAllocator = gFrameAllocator.load();
+  return pAllocator ? *pAllocator : getDefaultFrameAllocator();
+}
+
+void setFrameAllocator(const Allocator* pAllocator) { gFrameAllocator = pAllocator; }
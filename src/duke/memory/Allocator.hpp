@@ -19,6 +19,14 @@ struct Allocator : public noncopyable {
   virtual void free(void* ptr) const = 0;
   virtual const char* name() const = 0;
   virtual size_t alignment() const = 0;
+  // Gives unused memory back to the system, returns the number of bytes released.
+  virtual size_t trim() const { return 0; }
+  // True if the allocator records its buffers' size and owner with them, see allocatedSize and owns.
+  virtual bool recordsBuffers() const { return false; }
+  // Bytes held by ptr if the allocator records it with the buffer, 0 if it does not know.
+  virtual size_t allocatedSize(const void* ptr) const { return 0; }
+  // True if ptr is a buffer of this allocator, only known by allocators recording their buffers.
+  virtual bool owns(const void* ptr) const { return false; }
 };
 
 /**
@@ -42,11 +50,17 @@ std::shared_ptr<T> make_shared_memory(size_t size, const Allocator& allocator) {
  * Special purpose allocator
  */
 
-// number of slots allocated at once by the ChunkAllocator
+// maximum number of slots allocated at once by the ChunkAllocator
 #ifndef CHUNK_ALLOCATOR_BLOCKS
 #define CHUNK_ALLOCATOR_BLOCKS 8
 #endif
 
+/**
+ * Slab allocator for big page aligned blocks.
+ * Sizes are rounded up to size classes (four per power of two pages).
+ * Each size class has a lock free free list and a one block cache per thread,
+ * the mutex is only taken to grow or trim the chunks.
+ */
 struct BigAlignedBlock : public Allocator {
   BigAlignedBlock();
   virtual ~BigAlignedBlock();
@@ -54,6 +68,12 @@ struct BigAlignedBlock : public Allocator {
   virtual void free(void* ptr) const;
   virtual const char* name() const { return "BigAlignedBlock"; }
   virtual size_t alignment() const { return PAGE_SIZE; }
+  // Gives fully idle chunks back to the system.
+  virtual size_t trim() const;
+  // Size classes and owners are read from the sentinel preceding the blocks.
+  virtual bool recordsBuffers() const { return true; }
+  virtual size_t allocatedSize(const void* ptr) const;
+  virtual bool owns(const void* ptr) const;
 
  private:
   struct BigAlignedBlockImpl;
@@ -106,6 +126,26 @@ struct New : public Allocator {
   virtual const char* name() const { return "New"; }
 };
 
+/**
+ * Allocator used to hold decoded frames, defaults to a BigAlignedBlock.
+ * The allocator set must outlive all the frames allocated through it.
+ * Passing nullptr restores the default allocator.
+ */
+const Allocator& getFrameAllocator();
+void setFrameAllocator(const Allocator* pAllocator);
+
+/**
+ * Takes ownership of an allocator and installs it as the frame allocator
+ * for its lifetime. A nullptr allocator keeps the default one.
+ */
+struct ScopedFrameAllocator : public noncopyable {
+  ScopedFrameAllocator(Allocator* pAllocator) : m_pAllocator(pAllocator) { setFrameAllocator(pAllocator); }
+  ~ScopedFrameAllocator() { setFrameAllocator(nullptr); }
+
+ private:
+  std::unique_ptr<Allocator> m_pAllocator;
+};
+
 // TODO virtual alloc also exists on linux : valloc()
 // actually equivalent to memalign(sysconf(_SC_PAGESIZE),size)
 /**
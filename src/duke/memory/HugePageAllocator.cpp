@@ -0,0 +1,225 @@
+#include "duke/memory/HugePageAllocator.hpp"
+
+#include "duke/base/Check.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace {
+
+size_t roundToHugePage(size_t size) { return (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE; }
+
+void* mapAnonymous(size_t size, int extraFlags) {
+  void* pData = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+  return pData == MAP_FAILED ? nullptr : pData;
+}
+
+// Maps size bytes aligned on HUGE_PAGE_SIZE so transparent huge pages can back the whole region.
+char* mapAligned(size_t size) {
+  char* pData = reinterpret_cast<char*>(mapAnonymous(size + HUGE_PAGE_SIZE, 0));
+  if (!pData) return nullptr;
+  const size_t address = reinterpret_cast<size_t>(pData);
+  char* pAligned = pData + (roundToHugePage(address) - address);
+  if (pAligned != pData) munmap(pData, pAligned - pData);
+  const size_t tail = (pData + size + HUGE_PAGE_SIZE) - (pAligned + size);
+  if (tail) munmap(pAligned + size, tail);
+  return pAligned;
+}
+
+bool adviseHugePages(void* pData, size_t size) {
+#ifdef MADV_HUGEPAGE
+  return madvise(pData, size, MADV_HUGEPAGE) == 0;
+#else
+  return false;
+#endif
+}
+
+void prefault(char* pData, size_t size) {
+  for (size_t i = 0; i < size; i += PAGE_SIZE) pData[i] = 0;
+}
+
+// Sums the AnonHugePages entries of the mappings overlapping [pData, pData + size) in /proc/self/smaps.
+size_t getAnonHugePages(const void* pData, size_t size) {
+  std::ifstream smaps("/proc/self/smaps");
+  if (!smaps) return 0;
+  const size_t begin = reinterpret_cast<size_t>(pData);
+  const size_t end = begin + size;
+  std::string line;
+  bool inRange = false;
+  size_t total = 0;
+  while (std::getline(smaps, line)) {
+    const auto dash = line.find('-');
+    const bool isHeader = dash != std::string::npos && line.find(':') > dash && line.find(' ') > dash;
+    if (isHeader) {
+      size_t mappingBegin = 0, mappingEnd = 0;
+      std::istringstream(line.substr(0, dash)) >> std::hex >> mappingBegin;
+      std::istringstream(line.substr(dash + 1)) >> std::hex >> mappingEnd;
+      inRange = mappingBegin < end && mappingEnd > begin;
+    } else if (inRange && line.compare(0, 14, "AnonHugePages:") == 0) {
+      size_t kilobytes = 0;
+      std::istringstream(line.substr(14)) >> kilobytes;
+      total += kilobytes * 1024;
+    }
+  }
+  return total;
+}
+
+}  // namespace
+
+struct HugePageAllocator::HugePageAllocatorImpl {
+  HugePageAllocatorImpl(size_t reservation, bool prefaultOnFirstUse)
+      : m_Size(roundToHugePage(reservation)) {
+    if (m_Size == 0) return;
+#if defined(MAP_HUGETLB) && defined(MAP_POPULATE)
+    // hugetlb pages are reserved by mmap, faulting them in later can't fail
+    m_pData = reinterpret_cast<char*>(mapAnonymous(m_Size, MAP_HUGETLB | (prefaultOnFirstUse ? 0 : MAP_POPULATE)));
+    if (m_pData) m_Mode = Mode::HUGETLB;
+#endif
+    if (!m_pData) {
+      m_pData = mapAligned(m_Size);
+      CHECK(m_pData) << "Unable to reserve " << m_Size << " bytes";
+      if (adviseHugePages(m_pData, m_Size)) m_Mode = Mode::TRANSPARENT;
+      if (!prefaultOnFirstUse) prefault(m_pData, m_Size);
+    }
+    m_FreeRanges[0] = m_Size;
+    if (prefaultOnFirstUse) m_Faulted.resize(m_Size / HUGE_PAGE_SIZE, false);
+  }
+
+  ~HugePageAllocatorImpl() {
+    if (m_pData) munmap(m_pData, m_Size);
+    for (const auto& pair : m_Allocated)
+      if (pair.second.standalone) munmap(pair.first, pair.second.size);
+  }
+
+  void* malloc(size_t size) {
+    size = roundToHugePage(std::max<size_t>(size, 1));
+    size_t offset = 0;
+    std::vector<size_t> unfaulted;
+    if (takeRange(size, offset, unfaulted)) {
+      // faulted in by the thread owning the range, other allocations don't wait for it
+      for (const size_t page : unfaulted) prefault(m_pData + page * HUGE_PAGE_SIZE, HUGE_PAGE_SIZE);
+      return m_pData + offset;
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // reservation exhausted, mapping this buffer on its own
+    char* pData = mapAligned(size);
+    CHECK(pData) << "Unable to allocate " << size << " bytes";
+    if (m_Mode != Mode::REGULAR) adviseHugePages(pData, size);
+    m_Allocated[pData] = {size, true};
+    return pData;
+  }
+
+  // Reserves size bytes of the reservation at offset, false if no free range is large enough.
+  // With prefaultOnFirstUse, the huge pages of the range never handed out before are added to unfaulted.
+  bool takeRange(size_t size, size_t& offset, std::vector<size_t>& unfaulted) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto itr = m_FreeRanges.begin(); itr != m_FreeRanges.end(); ++itr) {
+      if (itr->second < size) continue;
+      offset = itr->first;
+      const size_t remaining = itr->second - size;
+      m_FreeRanges.erase(itr);
+      if (remaining) m_FreeRanges[offset + size] = remaining;
+      m_Allocated[m_pData + offset] = {size, false};
+      for (size_t page = offset / HUGE_PAGE_SIZE; page < m_Faulted.size() && page < (offset + size) / HUGE_PAGE_SIZE;
+           ++page) {
+        if (m_Faulted[page]) continue;
+        m_Faulted[page] = true;
+        unfaulted.push_back(page);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void free(void* ptr) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto found = m_Allocated.find(reinterpret_cast<char*>(ptr));
+    CHECK(found != m_Allocated.end()) << "Not allocated by HugePageAllocator";
+    const Block block = found->second;
+    m_Allocated.erase(found);
+    if (block.standalone) {
+      munmap(ptr, block.size);
+      return;
+    }
+    // giving the range back and coalescing with its neighbours
+    size_t offset = reinterpret_cast<char*>(ptr) - m_pData;
+    size_t size = block.size;
+    auto next = m_FreeRanges.lower_bound(offset);
+    if (next != m_FreeRanges.end() && next->first == offset + size) {
+      size += next->second;
+      next = m_FreeRanges.erase(next);
+    }
+    if (next != m_FreeRanges.begin()) {
+      auto previous = std::prev(next);
+      if (previous->first + previous->second == offset) {
+        offset = previous->first;
+        size += previous->second;
+        m_FreeRanges.erase(previous);
+      }
+    }
+    m_FreeRanges[offset] = size;
+  }
+
+  struct Block {
+    size_t size;
+    bool standalone;
+  };
+
+  const size_t m_Size;
+  char* m_pData = nullptr;
+  Mode m_Mode = Mode::REGULAR;
+  std::mutex m_Mutex;
+  std::map<size_t, size_t> m_FreeRanges;  // offset -> size
+  std::map<char*, Block> m_Allocated;
+  std::vector<bool> m_Faulted;  // per huge page, empty when prefaulted at construction
+};
+
+HugePageAllocator::HugePageAllocator(size_t reservation, bool prefaultOnFirstUse)
+    : pImpl(new HugePageAllocatorImpl(reservation, prefaultOnFirstUse)) {}
+
+HugePageAllocator::~HugePageAllocator() { delete pImpl; }
+
+void* HugePageAllocator::malloc(const size_t size) const { return pImpl->malloc(size); }
+
+void HugePageAllocator::free(void* ptr) const {
+  if (ptr) pImpl->free(ptr);
+}
+
+HugePageAllocator::Mode HugePageAllocator::mode() const { return pImpl->m_Mode; }
+
+size_t HugePageAllocator::reservedBytes() const { return pImpl->m_Size; }
+
+size_t HugePageAllocator::hugePageBytes() const {
+  switch (pImpl->m_Mode) {
+    case Mode::HUGETLB:
+      return pImpl->m_Size;
+    case Mode::TRANSPARENT:
+      return getAnonHugePages(pImpl->m_pData, pImpl->m_Size);
+    default:
+      return 0;
+  }
+}
+
+const char* toString(HugePageAllocator::Mode mode) {
+  switch (mode) {
+    case HugePageAllocator::Mode::HUGETLB:
+      return "hugetlb";
+    case HugePageAllocator::Mode::TRANSPARENT:
+      return "transparent huge pages";
+    case HugePageAllocator::Mode::REGULAR:
+      return "regular pages";
+  }
+  return "unknown";
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "duke/memory/Allocator.hpp"
+
+#include <cstddef>
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)  // 2MiB
+
+/**
+ * Allocator serving big frame buffers from a reservation backed by huge pages.
+ *
+ * The reservation is mapped with MAP_HUGETLB if the system has huge pages
+ * configured, otherwise it falls back to transparent huge pages (MADV_HUGEPAGE).
+ * The whole reservation is pre-faulted so buffers are never faulted in on first touch,
+ * at construction or with prefaultOnFirstUse huge page by huge page, by the first thread
+ * allocating each one so that pages land on this thread's numa node.
+ * Allocations are rounded to HUGE_PAGE_SIZE and placed first-fit, requests not
+ * fitting in the reservation get their own mapping.
+ */
+struct HugePageAllocator : public Allocator {
+  enum class Mode {
+    HUGETLB,      // explicit huge pages
+    TRANSPARENT,  // transparent huge pages
+    REGULAR       // regular pages
+  };
+
+  HugePageAllocator(size_t reservation, bool prefaultOnFirstUse = false);
+  virtual ~HugePageAllocator();
+  virtual void* malloc(const size_t size) const;
+  virtual void free(void* ptr) const;
+  virtual const char* name() const { return "HugePageAllocator"; }
+  virtual size_t alignment() const { return PAGE_SIZE; }
+
+  // How the reservation was actually obtained.
+  Mode mode() const;
+  size_t reservedBytes() const;
+  // Bytes of the reservation backed by huge pages as reported by the kernel.
+  size_t hugePageBytes() const;
+
+ private:
+  struct HugePageAllocatorImpl;
+  HugePageAllocatorImpl* pImpl;
+};
+
+const char* toString(HugePageAllocator::Mode mode);
@@ -0,0 +1,143 @@
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include "duke/base/Check.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+void MemoryTag::updatePeak(size_t bytes) {
+  size_t peak = m_PeakBytes;
+  while (bytes > peak && !m_PeakBytes.compare_exchange_weak(peak, bytes)) {
+  }
+}
+
+void MemoryTag::add(size_t bytes) {
+  ++m_Count;
+  m_AllocatedBytes += bytes;
+  updatePeak(m_Bytes += bytes);
+}
+
+void MemoryTag::remove(size_t bytes) {
+  --m_Count;
+  m_Bytes -= bytes;
+}
+
+void MemoryTag::set(size_t bytes, size_t count) {
+  const size_t previous = m_Bytes.exchange(bytes);
+  if (bytes > previous) m_AllocatedBytes += bytes - previous;
+  m_Count = count;
+  updatePeak(bytes);
+}
+
+MemoryTag& MemoryAccounting::tag(const std::string& name) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto& entry = m_Tags[name];
+  if (!entry.pTag) entry.pTag.reset(new MemoryTag());
+  return *entry.pTag;
+}
+
+void MemoryAccounting::update() {
+  using namespace std::chrono;
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  const auto now = steady_clock::now();
+  const double seconds = duration_cast<duration<double>>(now - m_LastUpdate).count();
+  if (seconds <= 0) return;
+  for (auto& pair : m_Tags) {
+    auto& entry = pair.second;
+    const uint64_t allocated = entry.pTag->allocatedBytes();
+    entry.allocationRate = (allocated - entry.lastAllocatedBytes) / seconds;
+    entry.lastAllocatedBytes = allocated;
+  }
+  m_LastUpdate = now;
+}
+
+std::vector<MemoryTagStats> MemoryAccounting::snapshot() const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::vector<MemoryTagStats> stats;
+  for (const auto& pair : m_Tags) {
+    const MemoryTag& tag = *pair.second.pTag;
+    stats.push_back({pair.first, tag.bytes(), tag.count(), tag.peakBytes(), tag.allocatedBytes(),
+                     pair.second.allocationRate, tag.hits(), tag.misses()});
+  }
+  return stats;
+}
+
+MemoryAccounting& MemoryAccounting::instance() {
+  static MemoryAccounting accounting;
+  return accounting;
+}
+
+namespace {
+
+double toMiB(double bytes) { return bytes / (1024 * 1024); }
+
+}  // namespace
+
+std::string toString(const std::vector<MemoryTagStats>& stats) {
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1);
+  for (const auto& stat : stats) {
+    if (oss.tellp() != 0) oss << '\n';
+    oss << std::left << std::setw(16) << stat.tag << std::right;
+    oss << std::setw(10) << toMiB(stat.bytes) << " MiB";
+    oss << std::setw(6) << stat.count;
+    oss << "  peak " << toMiB(stat.peakBytes) << " MiB";
+    oss << "  " << toMiB(stat.allocationRate) << " MiB/s";
+    if (stat.hits + stat.misses > 0) oss << "  " << stat.hits << " hits " << stat.misses << " misses";
+  }
+  return oss.str();
+}
+
+std::string toJson(const std::vector<MemoryTagStats>& stats) {
+  std::ostringstream oss;
+  oss << '{';
+  bool first = true;
+  for (const auto& stat : stats) {
+    if (!first) oss << ',';
+    first = false;
+    oss << '"' << stat.tag << "\":{";
+    oss << "\"bytes\":" << stat.bytes << ',';
+    oss << "\"count\":" << stat.count << ',';
+    oss << "\"peak_bytes\":" << stat.peakBytes << ',';
+    oss << "\"allocated_bytes\":" << stat.allocatedBytes << ',';
+    oss << "\"allocation_rate\":" << stat.allocationRate << ',';
+    oss << "\"hits\":" << stat.hits << ',';
+    oss << "\"misses\":" << stat.misses << '}';
+  }
+  oss << '}';
+  return oss.str();
+}
+
+AccountingAllocator::AccountingAllocator(std::unique_ptr<Allocator> pAllocator, const std::string& tag)
+    : m_pAllocator(std::move(pAllocator)), m_Tag(MemoryAccounting::instance().tag(tag)) {
+  CHECK(m_pAllocator);
+}
+
+void* AccountingAllocator::malloc(const size_t size) const {
+  void* pData = m_pAllocator->malloc(size);
+  if (!pData) return pData;
+  if (const size_t allocated = m_pAllocator->allocatedSize(pData)) {
+    m_Tag.add(allocated);
+    return pData;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Sizes[pData] = size;
+  }
+  m_Tag.add(size);
+  return pData;
+}
+
+void AccountingAllocator::free(void* ptr) const {
+  if (!ptr) return;
+  size_t size = m_pAllocator->allocatedSize(ptr);
+  if (!size) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto found = m_Sizes.find(ptr);
+    CHECK(found != m_Sizes.end()) << "Not allocated by AccountingAllocator";
+    size = found->second;
+    m_Sizes.erase(found);
+  }
+  m_Tag.remove(size);
+  m_pAllocator->free(ptr);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "duke/base/NonCopyable.hpp"
+#include "duke/memory/Allocator.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+/**
+ * Memory used by a subsystem.
+ * Counters are either updated incrementally with add/remove or set as a gauge
+ * by subsystems knowing their current usage.
+ */
+class MemoryTag : public noncopyable {
+ public:
+  MemoryTag() : m_Bytes(0), m_Count(0), m_PeakBytes(0), m_AllocatedBytes(0), m_Hits(0), m_Misses(0) {}
+
+  void add(size_t bytes);
+  void remove(size_t bytes);
+  void set(size_t bytes, size_t count);
+  // For pools and caches, whether a request was served from the tag's memory.
+  inline void hit() { ++m_Hits; }
+  inline void miss() { ++m_Misses; }
+
+  inline size_t bytes() const { return m_Bytes; }
+  inline size_t count() const { return m_Count; }
+  inline size_t peakBytes() const { return m_PeakBytes; }
+  inline uint64_t allocatedBytes() const { return m_AllocatedBytes; }
+  inline uint64_t hits() const { return m_Hits; }
+  inline uint64_t misses() const { return m_Misses; }
+
+ private:
+  void updatePeak(size_t bytes);
+
+  std::atomic<size_t> m_Bytes;
+  std::atomic<size_t> m_Count;
+  std::atomic<size_t> m_PeakBytes;
+  std::atomic<uint64_t> m_AllocatedBytes;  // total ever allocated
+  std::atomic<uint64_t> m_Hits;
+  std::atomic<uint64_t> m_Misses;
+};
+
+struct MemoryTagStats {
+  std::string tag;
+  size_t bytes;
+  size_t count;
+  size_t peakBytes;
+  uint64_t allocatedBytes;
+  double allocationRate;  // bytes per second between the two last updates
+  uint64_t hits;
+  uint64_t misses;
+};
+
+/**
+ * Registry of all memory tags.
+ */
+struct MemoryAccounting : public noncopyable {
+  // Returns the tag with this name, it is created on first use.
+  // The returned reference stays valid for the lifetime of the program.
+  MemoryTag& tag(const std::string& name);
+
+  // Samples allocation rates, to be called periodically.
+  void update();
+
+  std::vector<MemoryTagStats> snapshot() const;
+
+  static MemoryAccounting& instance();
+
+ private:
+  struct Entry {
+    std::unique_ptr<MemoryTag> pTag;
+    uint64_t lastAllocatedBytes = 0;
+    double allocationRate = 0;
+  };
+  mutable std::mutex m_Mutex;
+  std::map<std::string, Entry> m_Tags;
+  std::chrono::steady_clock::time_point m_LastUpdate = std::chrono::steady_clock::now();
+};
+
+// Human readable report, one tag per line.
+std::string toString(const std::vector<MemoryTagStats>& stats);
+
+// Machine readable report.
+std::string toJson(const std::vector<MemoryTagStats>& stats);
+
+/**
+ * Allocator decorator accounting for all its allocations in a tag.
+ * Sizes are read back from the wrapped allocator when it records them, the others are kept in a locked map.
+ */
+struct AccountingAllocator : public Allocator {
+  AccountingAllocator(std::unique_ptr<Allocator> pAllocator, const std::string& tag);
+  virtual void* malloc(const size_t size) const;
+  virtual void free(void* ptr) const;
+  virtual const char* name() const { return m_pAllocator->name(); }
+  virtual size_t alignment() const { return m_pAllocator->alignment(); }
+  virtual size_t trim() const { return m_pAllocator->trim(); }
+  virtual bool recordsBuffers() const { return m_pAllocator->recordsBuffers(); }
+  virtual size_t allocatedSize(const void* ptr) const { return m_pAllocator->allocatedSize(ptr); }
+  virtual bool owns(const void* ptr) const { return m_pAllocator->owns(ptr); }
+
+ private:
+  const std::unique_ptr<Allocator> m_pAllocator;
+  MemoryTag& m_Tag;
+  mutable std::mutex m_Mutex;
+  mutable std::map<void*, size_t> m_Sizes;
+};
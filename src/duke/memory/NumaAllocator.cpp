@@ -0,0 +1,77 @@
+#include "duke/memory/NumaAllocator.hpp"
+
+#include "duke/base/Check.hpp"
+
+#include <algorithm>
+
+NumaAllocator::NumaAllocator(const NumaTopology& topology, const PoolFactory& createPool)
+    : m_Topology(topology), m_PoolsRecordBuffers(true) {
+  CHECK(!m_Topology.nodes.empty());
+  for (const auto& node : m_Topology.nodes) {
+    m_Pools.emplace_back(createPool(node));
+    CHECK(m_Pools.back());
+    m_PoolsRecordBuffers &= m_Pools.back()->recordsBuffers();
+  }
+}
+
+size_t NumaAllocator::getCurrentPool() const {
+  const int node = getCurrentThreadNode(m_Topology);
+  for (size_t i = 0; i < m_Topology.nodes.size(); ++i)
+    if (m_Topology.nodes[i].id == node) return i;
+  return 0;
+}
+
+void* NumaAllocator::malloc(const size_t size) const {
+  const size_t index = getCurrentPool();
+  void* pData = m_Pools[index]->malloc(size);
+  if (!pData || m_PoolsRecordBuffers) return pData;
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Owners[pData] = index;
+  return pData;
+}
+
+size_t NumaAllocator::takeOwner(void* ptr) const {
+  if (m_PoolsRecordBuffers) {
+    for (size_t i = 0; i < m_Pools.size(); ++i)
+      if (m_Pools[i]->owns(ptr)) return i;
+    CHECK(false) << "Not allocated by NumaAllocator";
+  }
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  const auto found = m_Owners.find(ptr);
+  CHECK(found != m_Owners.end()) << "Not allocated by NumaAllocator";
+  const size_t index = found->second;
+  m_Owners.erase(found);
+  return index;
+}
+
+void NumaAllocator::free(void* ptr) const {
+  if (!ptr) return;
+  m_Pools[takeOwner(ptr)]->free(ptr);
+}
+
+size_t NumaAllocator::allocatedSize(const void* ptr) const {
+  if (m_PoolsRecordBuffers)
+    for (const auto& pPool : m_Pools)
+      if (pPool->owns(ptr)) return pPool->allocatedSize(ptr);
+  return 0;
+}
+
+bool NumaAllocator::owns(const void* ptr) const {
+  if (!m_PoolsRecordBuffers) return false;
+  for (const auto& pPool : m_Pools)
+    if (pPool->owns(ptr)) return true;
+  return false;
+}
+
+// Only the alignment all pools guarantee.
+size_t NumaAllocator::alignment() const {
+  size_t alignment = m_Pools.front()->alignment();
+  for (const auto& pPool : m_Pools) alignment = std::min(alignment, pPool->alignment());
+  return alignment;
+}
+
+size_t NumaAllocator::trim() const {
+  size_t released = 0;
+  for (const auto& pPool : m_Pools) released += pPool->trim();
+  return released;
+}
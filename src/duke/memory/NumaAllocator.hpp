@@ -0,0 +1,47 @@
+#pragma once
+
+#include "duke/memory/Allocator.hpp"
+#include "duke/memory/NumaTopology.hpp"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Allocator keeping one pool per numa node.
+ * Buffers come from the pool of the node the calling thread is bound to, or runs on,
+ * and always go back to the pool they come from. Free lists and recycled buffers
+ * of a pool therefore never hand a buffer of one node to the threads of another.
+ * Pools recording their buffers, like slabs, tell the buffers they own. Otherwise
+ * the owner of each buffer is kept in a locked map.
+ */
+struct NumaAllocator : public Allocator {
+  typedef std::function<Allocator*(const NumaNode&)> PoolFactory;
+
+  NumaAllocator(const NumaTopology& topology, const PoolFactory& createPool);
+  virtual void* malloc(const size_t size) const;
+  virtual void free(void* ptr) const;
+  virtual const char* name() const { return "NumaAllocator"; }
+  virtual size_t alignment() const;
+  virtual size_t trim() const;
+  virtual bool recordsBuffers() const { return m_PoolsRecordBuffers; }
+  virtual size_t allocatedSize(const void* ptr) const;
+  virtual bool owns(const void* ptr) const;
+
+  inline size_t pools() const { return m_Pools.size(); }
+  inline const Allocator& pool(size_t index) const { return *m_Pools[index]; }
+  // Index of the pool serving the calling thread.
+  size_t getCurrentPool() const;
+
+ private:
+  const NumaTopology m_Topology;
+  // Index of the pool ptr comes from, forgotten from the map if any.
+  size_t takeOwner(void* ptr) const;
+
+  std::vector<std::unique_ptr<Allocator>> m_Pools;  // one per topology node
+  bool m_PoolsRecordBuffers;                         // owners are found without the map
+  mutable std::mutex m_Mutex;
+  mutable std::map<void*, size_t> m_Owners;  // buffer -> pool
+};
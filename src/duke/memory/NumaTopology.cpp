@@ -0,0 +1,127 @@
+#include "NumaTopology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+thread_local int gBoundNode = -1;
+
+bool readFirstLine(const std::string& filename, std::string& line) {
+  std::ifstream file(filename);
+  return file && std::getline(file, line);
+}
+
+NumaTopology getSingleNodeTopology() {
+  NumaTopology topology;
+  NumaNode node{0, {}};
+  const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < cpus; ++i) node.cpus.push_back(i);
+  topology.nodes.push_back(std::move(node));
+  return topology;
+}
+
+}  // namespace
+
+const NumaNode* NumaTopology::findNode(int id) const {
+  for (const auto& node : nodes)
+    if (node.id == id) return &node;
+  return nullptr;
+}
+
+std::vector<int> parseCpuList(const std::string& cpulist) {
+  std::vector<int> cpus;
+  std::istringstream stream(cpulist);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range == "\n") continue;
+    const auto dash = range.find('-');
+    const int first = atoi(range.c_str());
+    const int last = dash == std::string::npos ? first : atoi(range.c_str() + dash + 1);
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+NumaTopology detectNumaTopology(const std::string& sysfsRoot) {
+#ifdef __linux__
+  NumaTopology topology;
+  const std::string nodePath = sysfsRoot + "/devices/system/node";
+  if (DIR* pDir = opendir(nodePath.c_str())) {
+    while (const dirent* pEntry = readdir(pDir)) {
+      const std::string name = pEntry->d_name;
+      if (name.compare(0, 4, "node") != 0 || name.size() == 4) continue;
+      if (name.find_first_not_of("0123456789", 4) != std::string::npos) continue;
+      std::string cpulist;
+      if (!readFirstLine(nodePath + '/' + name + "/cpulist", cpulist)) continue;
+      NumaNode node{atoi(name.c_str() + 4), parseCpuList(cpulist)};
+      if (!node.cpus.empty()) topology.nodes.push_back(std::move(node));
+    }
+    closedir(pDir);
+  }
+  if (topology.nodes.empty()) return getSingleNodeTopology();
+  std::sort(topology.nodes.begin(), topology.nodes.end(),
+            [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+  // GPU node is reported by the first drm card exposing it
+  for (int card = 0; card < 8 && topology.gpuNode < 0; ++card) {
+    std::ostringstream filename;
+    filename << sysfsRoot << "/class/drm/card" << card << "/device/numa_node";
+    std::string value;
+    if (readFirstLine(filename.str(), value)) topology.gpuNode = atoi(value.c_str());
+  }
+  if (!topology.findNode(topology.gpuNode)) topology.gpuNode = -1;
+  return topology;
+#else
+  return getSingleNodeTopology();
+#endif
+}
+
+const NumaTopology& getNumaTopology() {
+  static const NumaTopology topology = detectNumaTopology();
+  return topology;
+}
+
+bool bindCurrentThreadToNode(const NumaNode& node) {
+#ifdef __linux__
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (const int cpu : node.cpus)
+    if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuset);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) return false;
+#ifdef SYS_set_mempolicy
+  // MPOL_PREFERRED from <linux/mempolicy.h>, set through syscall to avoid depending on libnuma.
+  const int MPOL_PREFERRED_MODE = 1;
+  unsigned long nodemask[16] = {};
+  const size_t bitsPerLong = sizeof(unsigned long) * 8;
+  if (node.id < 0 || size_t(node.id) >= bitsPerLong * 16) return false;
+  nodemask[node.id / bitsPerLong] = 1UL << (node.id % bitsPerLong);
+  if (syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, nodemask, bitsPerLong * 16 + 1) != 0) return false;
+#endif
+  gBoundNode = node.id;
+  return true;
+#else
+  return false;
+#endif
+}
+
+int getCurrentThreadNode(const NumaTopology& topology) {
+  if (gBoundNode >= 0) return gBoundNode;
+#ifdef __linux__
+  const int cpu = sched_getcpu();
+  for (const auto& node : topology.nodes)
+    if (std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end()) return node.id;
+#endif
+  return -1;
+}
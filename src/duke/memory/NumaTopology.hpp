@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Where decode workers are placed on NUMA machines.
+ */
+enum class NumaPlacement {
+  NONE,    // let the scheduler decide
+  SPREAD,  // workers are distributed round robin on all nodes
+  GPU      // workers run on the node the GPU is attached to
+};
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+struct NumaTopology {
+  std::vector<NumaNode> nodes;
+  int gpuNode = -1;  // node the GPU is attached to, -1 if unknown
+
+  inline bool isNuma() const { return nodes.size() > 1; }
+  const NumaNode* findNode(int id) const;
+};
+
+// Parses a sysfs cpu list such as "0-3,8,10-11".
+std::vector<int> parseCpuList(const std::string& cpulist);
+
+// Reads the topology from sysfsRoot, falls back to a single node holding all cpus.
+NumaTopology detectNumaTopology(const std::string& sysfsRoot = "/sys");
+
+// The topology of this machine, detected once.
+const NumaTopology& getNumaTopology();
+
+// Pins the calling thread to the node's cpus and makes the node preferred for
+// the pages it touches first. Returns false if not supported.
+bool bindCurrentThreadToNode(const NumaNode& node);
+
+// The node the calling thread is bound to, or else the node of the cpu it runs on, -1 if unknown.
+int getCurrentThreadNode(const NumaTopology& topology);
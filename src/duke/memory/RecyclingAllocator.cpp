@@ -0,0 +1,119 @@
+#include "duke/memory/RecyclingAllocator.hpp"
+
+#include "duke/base/Check.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+// Alignments above a huge page are not worth distinguishing.
+const size_t kMaxTrackedAlignment = 2 * 1024 * 1024;
+
+size_t getAddressAlignment(const void* ptr) {
+  const size_t address = reinterpret_cast<size_t>(ptr);
+  return std::min(address & (~address + 1), kMaxTrackedAlignment);
+}
+
+}  // namespace
+
+RecyclingAllocator::RecyclingAllocator(std::unique_ptr<Allocator> pAllocator, size_t maxRecycledBytes,
+                                       const std::string& tag)
+    : m_pAllocator(std::move(pAllocator)),
+      m_MaxRecycledBytes(maxRecycledBytes),
+      m_Tag(MemoryAccounting::instance().tag(tag)),
+      m_Hits(0),
+      m_Misses(0) {
+  CHECK(m_pAllocator);
+}
+
+RecyclingAllocator::~RecyclingAllocator() { releaseAll(); }
+
+void* RecyclingAllocator::malloc(const size_t size) const {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto found = m_Recycled.lower_bound(Key(size, std::min(alignment(), kMaxTrackedAlignment)));
+    if (found != m_Recycled.end() && found->first.first == size) {
+      void* pData = found->second->ptr;
+      forget(found->second);
+      ++m_Hits;
+      m_Tag.hit();
+      return pData;
+    }
+  }
+  ++m_Misses;
+  m_Tag.miss();
+  void* pData = m_pAllocator->malloc(size);
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Sizes[pData] = size;
+  return pData;
+}
+
+void RecyclingAllocator::free(void* ptr) const {
+  if (!ptr) return;
+  std::vector<void*> released;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto found = m_Sizes.find(ptr);
+    CHECK(found != m_Sizes.end()) << "Not allocated by RecyclingAllocator";
+    const size_t size = found->second;
+    if (size > m_MaxRecycledBytes) {
+      m_Sizes.erase(found);
+      released.push_back(ptr);
+    } else {
+      const Key key(size, getAddressAlignment(ptr));
+      m_Lru.push_front({ptr, key});
+      m_Recycled.insert(std::make_pair(key, m_Lru.begin()));
+      m_RecycledBytes += size;
+      m_Tag.add(size);
+      // making room by releasing the buffers recycled the longest time ago
+      while (m_RecycledBytes > m_MaxRecycledBytes) {
+        const auto oldest = std::prev(m_Lru.end());
+        released.push_back(oldest->ptr);
+        m_Sizes.erase(oldest->ptr);
+        forget(oldest);
+      }
+    }
+  }
+  for (void* pData : released) m_pAllocator->free(pData);
+}
+
+void RecyclingAllocator::forget(Lru::iterator itr) const {
+  const auto range = m_Recycled.equal_range(itr->key);
+  for (auto candidate = range.first; candidate != range.second; ++candidate)
+    if (candidate->second == itr) {
+      m_Recycled.erase(candidate);
+      break;
+    }
+  m_RecycledBytes -= itr->key.first;
+  m_Tag.remove(itr->key.first);
+  m_Lru.erase(itr);
+}
+
+size_t RecyclingAllocator::releaseAll() const {
+  std::vector<void*> released;
+  size_t bytes = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    bytes = m_RecycledBytes;
+    while (!m_Lru.empty()) {
+      released.push_back(m_Lru.front().ptr);
+      m_Sizes.erase(m_Lru.front().ptr);
+      forget(m_Lru.begin());
+    }
+  }
+  for (void* ptr : released) m_pAllocator->free(ptr);
+  return bytes;
+}
+
+size_t RecyclingAllocator::trim() const {
+  const size_t released = releaseAll();
+  return released + m_pAllocator->trim();
+}
+
+size_t RecyclingAllocator::recycledBytes() const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_RecycledBytes;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "duke/memory/Allocator.hpp"
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <cstddef>
+
+class MemoryTag;
+
+/**
+ * Allocator decorator keeping freed buffers around so subsequent allocations
+ * of the same size are served without going back to the wrapped allocator.
+ * Frames of a sequence usually all have the same size so in steady state
+ * playback evicted buffers are directly reused for the next decoded frames.
+ * Buffers are keyed by size and address alignment, only buffers aligned at least
+ * as the wrapped allocator are handed back. The least recently recycled buffers
+ * are released first when the budget is full. Recycled bytes are added to tag, several
+ * allocators can share it.
+ */
+struct RecyclingAllocator : public Allocator {
+  RecyclingAllocator(std::unique_ptr<Allocator> pAllocator, size_t maxRecycledBytes,
+                     const std::string& tag = "recycled buffers");
+  virtual ~RecyclingAllocator();
+  virtual void* malloc(const size_t size) const;
+  virtual void free(void* ptr) const;
+  virtual const char* name() const { return "RecyclingAllocator"; }
+  virtual size_t alignment() const { return m_pAllocator->alignment(); }
+  // Releases all recycled buffers then trims the wrapped allocator.
+  virtual size_t trim() const;
+
+  inline size_t hits() const { return m_Hits; }
+  inline size_t misses() const { return m_Misses; }
+  size_t recycledBytes() const;
+
+ private:
+  typedef std::pair<size_t, size_t> Key;  // size, alignment
+  struct Recycled {
+    void* ptr;
+    Key key;
+  };
+  typedef std::list<Recycled> Lru;
+
+  size_t releaseAll() const;
+  void forget(Lru::iterator itr) const;
+
+  const std::unique_ptr<Allocator> m_pAllocator;
+  const size_t m_MaxRecycledBytes;
+  MemoryTag& m_Tag;
+  mutable std::mutex m_Mutex;
+  mutable Lru m_Lru;  // most recently recycled first
+  mutable std::multimap<Key, Lru::iterator> m_Recycled;
+  mutable std::map<void*, size_t> m_Sizes;  // live and recycled buffers
+  mutable size_t m_RecycledBytes = 0;
+  mutable std::atomic<size_t> m_Hits;
+  mutable std::atomic<size_t> m_Misses;
+};
@@ -48,6 +48,18 @@ TEST(Allocation, BigAllocator) {
   EXPECT_EQ(CHUNK_ALLOCATOR_BLOCKS, allAdresses.size());
 }
 
+TEST(Allocation, BigAllocatorSizes) {
+  BigAlignedBlock allocator;
+  BigAlignedBlock other;
+  void *const pData = allocator.malloc(5 * PAGE_SIZE + 1);
+  // rounded to the 6 pages class
+  EXPECT_EQ(6 * PAGE_SIZE, allocator.allocatedSize(pData));
+  EXPECT_TRUE(allocator.owns(pData));
+  EXPECT_FALSE(other.owns(pData));
+  allocator.free(pData);
+  EXPECT_EQ(0UL, Malloc().allocatedSize(pData));
+}
+
 TEST(Allocation, freeNullPtr) {
   std::vector<std::unique_ptr<Allocator>> allocators;
   allocators.emplace_back(new AlignedMalloc());
@@ -130,3 +142,174 @@ TEST(Allocation, DISABLED_benchmark) {
     cout << double(pair.first.count()) / 1000 << " ms\t" << pair.second << endl;
   }
 }
+
+#include <thread>
+TEST(Allocation, BigAllocatorMultithreaded) {
+  BigAlignedBlock allocator;
+  const size_t sizes[] = {1, PAGE_SIZE * 3, PAGE_SIZE * 17, 5 * 1024 * 1024};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t)
+    threads.emplace_back([&allocator, &sizes, t]() {
+      std::vector<std::pair<char *, size_t>> blocks;
+      for (int i = 0; i < 2000; ++i) {
+        const size_t size = sizes[(i + t) % 4];
+        char *pData = reinterpret_cast<char *>(allocator.malloc(size));
+        ASSERT_TRUE(reinterpret_cast<size_t>(pData) % PAGE_SIZE == 0);
+        pData[0] = pData[size - 1] = char(t);
+        blocks.emplace_back(pData, size);
+        if (blocks.size() > 6) {
+          const auto block = blocks.front();
+          EXPECT_EQ(char(t), block.first[0]);
+          EXPECT_EQ(char(t), block.first[block.second - 1]);
+          allocator.free(block.first);
+          blocks.erase(blocks.begin());
+        }
+      }
+      for (const auto &block : blocks) allocator.free(block.first);
+    });
+  for (auto &thread : threads) thread.join();
+  EXPECT_LT(0UL, allocator.trim());
+  EXPECT_EQ(0UL, allocator.trim());
+}
+
+#include "duke/memory/HugePageAllocator.hpp"
+TEST(Allocation, HugePageAllocator) {
+  HugePageAllocator allocator(8 * 1024 * 1024);
+  EXPECT_EQ(8UL * 1024 * 1024, allocator.reservedBytes());
+  // reservation is first fit with HUGE_PAGE_SIZE granularity
+  void *pFirst = allocator.malloc(3 * 1024 * 1024);
+  void *pSecond = allocator.malloc(1);
+  EXPECT_EQ(reinterpret_cast<char *>(pFirst) + 2 * HUGE_PAGE_SIZE, pSecond);
+  allocator.free(pFirst);
+  void *pThird = allocator.malloc(HUGE_PAGE_SIZE);
+  EXPECT_EQ(pFirst, pThird);
+  // bigger than what's left in the reservation
+  void *pStandalone = allocator.malloc(16 * 1024 * 1024);
+  EXPECT_NE(nullptr, pStandalone);
+  EXPECT_TRUE(reinterpret_cast<size_t>(pStandalone) % allocator.alignment() == 0);
+  static_cast<char *>(pStandalone)[16 * 1024 * 1024 - 1] = 1;
+  allocator.free(pStandalone);
+  allocator.free(pThird);
+  allocator.free(pSecond);
+  allocator.free(nullptr);
+  // ranges are coalesced back
+  void *pAll = allocator.malloc(8 * 1024 * 1024);
+  EXPECT_EQ(pFirst, pAll);
+  allocator.free(pAll);
+  if (allocator.mode() == HugePageAllocator::Mode::HUGETLB) {
+    EXPECT_EQ(allocator.reservedBytes(), allocator.hugePageBytes());
+  }
+}
+
+TEST(Allocation, HugePageAllocatorPrefaultsOnFirstUse) {
+  HugePageAllocator allocator(8 * 1024 * 1024, true);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+    threads.emplace_back([&]() {
+      char *pData = static_cast<char *>(allocator.malloc(HUGE_PAGE_SIZE));
+      EXPECT_EQ(0, pData[HUGE_PAGE_SIZE - 1]);
+      allocator.free(pData);
+    });
+  for (auto &thread : threads) thread.join();
+  void *pAll = allocator.malloc(8 * 1024 * 1024);
+  EXPECT_EQ(0, static_cast<char *>(pAll)[0]);
+  allocator.free(pAll);
+}
+
+#include "duke/memory/RecyclingAllocator.hpp"
+struct CountingAllocator : public Malloc {
+  CountingAllocator(size_t &mallocs, size_t &frees) : mallocs(mallocs), frees(frees) {}
+  virtual void *malloc(const size_t size) const {
+    ++mallocs;
+    return Malloc::malloc(size);
+  }
+  virtual void free(void *ptr) const {
+    ++frees;
+    Malloc::free(ptr);
+  }
+  size_t &mallocs;
+  size_t &frees;
+};
+
+TEST(Allocation, RecyclingAllocator) {
+  size_t mallocs = 0, frees = 0;
+  {
+    RecyclingAllocator allocator(std::unique_ptr<Allocator>(new CountingAllocator(mallocs, frees)), 2000);
+    void *pFirst = allocator.malloc(1000);
+    allocator.free(pFirst);
+    EXPECT_EQ(1000UL, allocator.recycledBytes());
+    // same size is recycled
+    EXPECT_EQ(pFirst, allocator.malloc(1000));
+    EXPECT_EQ(1UL, allocator.hits());
+    EXPECT_EQ(1UL, allocator.misses());
+    // other size is not
+    void *pOther = allocator.malloc(500);
+    EXPECT_EQ(2UL, allocator.misses());
+    EXPECT_EQ(2UL, mallocs);
+    // over capacity buffers are given back
+    void *pBig = allocator.malloc(5000);
+    allocator.free(pBig);
+    EXPECT_EQ(1UL, frees);
+    allocator.free(pOther);
+    allocator.free(pFirst);
+    EXPECT_EQ(1500UL, allocator.recycledBytes());
+    allocator.trim();
+    EXPECT_EQ(0UL, allocator.recycledBytes());
+    EXPECT_EQ(3UL, frees);
+    allocator.free(allocator.malloc(10));
+  }
+  // recycled buffers are released on destruction
+  EXPECT_EQ(mallocs, frees);
+}
+
+TEST(Allocation, RecyclingAllocatorEvictsLeastRecentlyRecycled) {
+  size_t mallocs = 0, frees = 0;
+  RecyclingAllocator allocator(std::unique_ptr<Allocator>(new CountingAllocator(mallocs, frees)), 2000);
+  void *pOld = allocator.malloc(1000);
+  void *pRecent = allocator.malloc(800);
+  void *pNew = allocator.malloc(600);
+  allocator.free(pOld);
+  allocator.free(pRecent);
+  EXPECT_EQ(0UL, frees);
+  // a new size makes room by releasing the oldest buffer
+  allocator.free(pNew);
+  EXPECT_EQ(1UL, frees);
+  EXPECT_EQ(1400UL, allocator.recycledBytes());
+  EXPECT_EQ(pRecent, allocator.malloc(800));
+  EXPECT_EQ(pNew, allocator.malloc(600));
+  void *pAgain = allocator.malloc(1000);
+  EXPECT_EQ(4UL, allocator.misses());
+  for (void *ptr : {pRecent, pNew, pAgain}) allocator.free(ptr);
+}
+
+namespace {
+
+// Hands out buffers with a single byte alignment until asked for an aligned one.
+struct ShiftingAllocator : public Allocator {
+  virtual void *malloc(const size_t size) const {
+    char *pData = static_cast<char *>(memalign(64, size + 64));
+    return aligned ? pData : pData + 1;
+  }
+  virtual void free(void *ptr) const { std::free(static_cast<char *>(ptr) - reinterpret_cast<size_t>(ptr) % 64); }
+  virtual size_t alignment() const { return aligned ? 64 : 1; }
+  virtual const char *name() const { return "ShiftingAllocator"; }
+  mutable bool aligned = false;
+};
+
+}  // namespace
+
+TEST(Allocation, RecyclingAllocatorHonorsAlignment) {
+  auto pShifting = new ShiftingAllocator();
+  RecyclingAllocator allocator(std::unique_ptr<Allocator>(pShifting), 2000);
+  void *pUnaligned = allocator.malloc(100);
+  allocator.free(pUnaligned);
+  pShifting->aligned = true;
+  void *pAligned = allocator.malloc(100);
+  EXPECT_NE(pUnaligned, pAligned);
+  EXPECT_EQ(0UL, reinterpret_cast<size_t>(pAligned) % 64);
+  allocator.free(pAligned);
+  // the aligned buffer suits both
+  EXPECT_EQ(pAligned, allocator.malloc(100));
+  pShifting->aligned = false;
+  allocator.free(pAligned);
+}
@@ -0,0 +1,144 @@
+#include "duke/gl/GL.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/image/BlockCompression.hpp"
+#include "duke/image/ImageUtils.hpp"
+#include "duke/memory/Allocator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace duke;
+
+namespace {
+
+// Reference decoders, straight from the format specifications.
+void decodeBc1Block(const uint8_t* pBlock, uint8_t* pTexels) {
+  uint8_t palette[4][3];
+  for (int endpoint = 0; endpoint < 2; ++endpoint) {
+    const uint16_t packed = pBlock[endpoint * 2] | (pBlock[endpoint * 2 + 1] << 8);
+    palette[endpoint][0] = ((packed >> 11) << 3) | (packed >> 13);
+    palette[endpoint][1] = (((packed >> 5) & 0x3F) << 2) | ((packed >> 9) & 0x3);
+    palette[endpoint][2] = ((packed & 0x1F) << 3) | ((packed >> 2) & 0x7);
+  }
+  for (int c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+  const uint32_t indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (uint32_t(pBlock[7]) << 24);
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) pTexels[i * 4 + c] = palette[(indices >> (2 * i)) & 3][c];
+    pTexels[i * 4 + 3] = 255;
+  }
+}
+
+uint32_t readBits(const uint8_t* pBlock, size_t& bit, size_t count) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < count; ++i, ++bit) value |= ((pBlock[bit / 8] >> (bit % 8)) & 1) << i;
+  return value;
+}
+
+void decodeBc7Mode6Block(const uint8_t* pBlock, uint8_t* pTexels) {
+  static const uint32_t weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+  size_t bit = 0;
+  ASSERT_EQ(1U << 6, readBits(pBlock, bit, 7));
+  uint32_t endpoints[2][4];
+  for (int c = 0; c < 4; ++c)
+    for (int endpoint = 0; endpoint < 2; ++endpoint) endpoints[endpoint][c] = readBits(pBlock, bit, 7) << 1;
+  for (int endpoint = 0; endpoint < 2; ++endpoint) {
+    const uint32_t pBit = readBits(pBlock, bit, 1);
+    for (int c = 0; c < 4; ++c) endpoints[endpoint][c] |= pBit;
+  }
+  for (int i = 0; i < 16; ++i) {
+    const uint32_t weight = weights[readBits(pBlock, bit, i == 0 ? 3 : 4)];
+    for (int c = 0; c < 4; ++c)
+      pTexels[i * 4 + c] = ((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6;
+  }
+  ASSERT_EQ(128U, bit);
+}
+
+int getMaxError(const uint8_t* pTexels, const uint8_t* pDecoded, int components) {
+  int error = 0;
+  for (int i = 0; i < 16; ++i)
+    for (int c = 0; c < components; ++c) error = std::max(error, std::abs(pTexels[i * 4 + c] - pDecoded[i * 4 + c]));
+  return error;
+}
+
+void fillGradient(uint8_t* pTexels) {
+  for (int i = 0; i < 16; ++i) {
+    pTexels[i * 4 + 0] = 20 + i * 12;
+    pTexels[i * 4 + 1] = 200 - i * 8;
+    pTexels[i * 4 + 2] = 64 + i * 4;
+    pTexels[i * 4 + 3] = 255 - i * 10;
+  }
+}
+
+}  // namespace
+
+TEST(BlockCompression, SolidBlocks) {
+  uint8_t texels[64];
+  for (int i = 0; i < 16; ++i) {
+    const uint8_t texel[] = {200, 100, 50, 128};
+    std::copy(texel, texel + 4, texels + i * 4);
+  }
+  uint8_t block[16];
+  uint8_t decoded[64];
+  encodeBc1Block(texels, block);
+  decodeBc1Block(block, decoded);
+  EXPECT_LE(getMaxError(texels, decoded, 3), 4);
+  encodeBc7Block(texels, block);
+  decodeBc7Mode6Block(block, decoded);
+  EXPECT_LE(getMaxError(texels, decoded, 4), 1);
+}
+
+TEST(BlockCompression, GradientBlocks) {
+  uint8_t texels[64];
+  fillGradient(texels);
+  uint8_t block[16];
+  uint8_t decoded[64];
+  // texels are at most half the distance between levels away, red spans 180 over 4 and 16 levels
+  encodeBc1Block(texels, block);
+  decodeBc1Block(block, decoded);
+  EXPECT_LE(getMaxError(texels, decoded, 3), 30);
+  encodeBc7Block(texels, block);
+  decodeBc7Mode6Block(block, decoded);
+  EXPECT_LE(getMaxError(texels, decoded, 4), 6);
+}
+
+TEST(BlockCompression, ProxyFrames) {
+  ImageDescription description;
+  description.width = 6;
+  description.height = 5;
+  description.opengl_format = GL_RGB16F;
+  description.channels = getChannels(GL_RGB16F);
+  EXPECT_TRUE(canEncodeProxy(description));
+  description.opengl_format = GL_RGB10_A2UI;
+  description.channels = getChannels(GL_RGB10_A2UI);
+  EXPECT_FALSE(canEncodeProxy(description));
+
+  description.opengl_format = GL_RGBA32F;
+  description.channels = getChannels(GL_RGBA32F);
+  Malloc allocator;
+  for (const ProxyFormat format : {ProxyFormat::BC1, ProxyFormat::BC7}) {
+    FrameData frame;
+    auto data = frame.setDescriptionAndAllocate(description, allocator);
+    auto* pSamples = reinterpret_cast<float*>(data.begin());
+    for (size_t i = 0; i < data.size() / sizeof(float); ++i) pSamples[i] = 0.5f;
+    encodeProxy(frame, format, allocator);
+    const auto& encoded = frame.getDescription();
+    EXPECT_EQ(getProxyInternalFormat(format), encoded.opengl_format);
+    EXPECT_TRUE(isBlockCompressedFormat(encoded.opengl_format));
+    EXPECT_EQ(description.width, encoded.width);
+    // 2x2 blocks, edge blocks repeat the last texels
+    EXPECT_EQ(format == ProxyFormat::BC1 ? 32U : 64U, frame.getData().size());
+    EXPECT_EQ(frame.getData().size(), getImageSize(encoded));
+    uint8_t decoded[64];
+    const auto* pBlocks = reinterpret_cast<const uint8_t*>(frame.getData().begin());
+    if (format == ProxyFormat::BC1)
+      decodeBc1Block(pBlocks + 24, decoded);
+    else
+      decodeBc7Mode6Block(pBlocks + 48, decoded);
+    for (int c = 0; c < 4; ++c) EXPECT_NEAR(format == ProxyFormat::BC1 && c == 3 ? 255 : 128, decoded[c], 4);
+  }
+}
@@ -0,0 +1,147 @@
+#include "duke/engine/cache/CachedFrame.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/memory/Allocator.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace duke;
+
+namespace {
+
+ImageDescription getDescription(int32_t format, size_t width, size_t height) {
+  ImageDescription description;
+  description.width = width;
+  description.height = height;
+  description.opengl_format = format;
+  description.channels = getChannels(format);
+  return description;
+}
+
+// Horizontal 8 bits ramp, compresses well.
+FrameData getRampFrame(size_t width, size_t height, const Allocator& allocator) {
+  FrameData frame;
+  auto data = frame.setDescriptionAndAllocate(getDescription(GL_RGBA8, width, height), allocator);
+  for (size_t i = 0; i < data.size(); ++i) data.begin()[i] = char((i / 4) % width);
+  return frame;
+}
+
+bool sameData(const FrameData& a, const FrameData& b) {
+  const auto dataA = a.getData();
+  const auto dataB = b.getData();
+  return dataA.size() == dataB.size() && std::equal(dataA.begin(), dataA.end(), dataB.begin());
+}
+
+}  // namespace
+
+TEST(CachedFrame, WorthCompressing) {
+  EXPECT_TRUE(isWorthCompressing(getDescription(GL_RGBA8, 4, 4)));
+  EXPECT_TRUE(isWorthCompressing(getDescription(GL_RGB16, 4, 4)));
+  EXPECT_TRUE(isWorthCompressing(getDescription(GL_RGB10_A2UI, 4, 4)));
+  EXPECT_FALSE(isWorthCompressing(getDescription(GL_RGBA16F, 4, 4)));
+  EXPECT_FALSE(isWorthCompressing(getDescription(GL_RGB32F, 4, 4)));
+  EXPECT_FALSE(isWorthCompressing(ImageDescription()));
+}
+
+TEST(CachedFrame, Default) {
+  CachedFrame cached;
+  Malloc allocator;
+  EXPECT_EQ(0U, cached.getWeight());
+  EXPECT_FALSE(cached.isCompressed());
+  EXPECT_TRUE(cached.getFrame(allocator).getData().empty());
+  EXPECT_EQ(0U, cached.getDescription().width);
+}
+
+TEST(CachedFrame, ColdFrames) {
+  Malloc allocator;
+  // several chunks
+  const FrameData frame = getRampFrame(1024, 1500, allocator);
+  FrameData copy = frame;
+  CachedFrame cached(std::move(copy), true, false, allocator);
+  EXPECT_TRUE(cached.isCompressed());
+  EXPECT_FALSE(cached.isDecoded());
+  EXPECT_LT(cached.getWeight(), frame.getData().size() / 4);
+
+  EXPECT_EQ(frame.getDescription().width, cached.getDescription().width);
+  EXPECT_EQ(frame.getData().size(), cached.getDecodedSize());
+  EXPECT_FALSE(cached.isDecoded());
+
+  // cold frames are decompressed for the caller only
+  MemoryTag& tag = MemoryAccounting::instance().tag("decoded frames");
+  const size_t decodedBytes = tag.bytes();
+  const FrameData transient = cached.getFrame(allocator);
+  EXPECT_FALSE(cached.isDecoded());
+  EXPECT_EQ(decodedBytes, tag.bytes());
+  EXPECT_TRUE(sameData(frame, transient));
+  EXPECT_EQ(frame.getDescription().opengl_format, transient.getDescription().opengl_format);
+
+  cached.decode(allocator);
+  EXPECT_TRUE(cached.isDecoded());
+  EXPECT_EQ(decodedBytes + frame.getData().size(), tag.bytes());
+  const FrameData decoded = cached.getFrame(allocator);
+  EXPECT_TRUE(sameData(frame, decoded));
+  cached.dropDecoded();
+  EXPECT_FALSE(cached.isDecoded());
+  EXPECT_EQ(decodedBytes, tag.bytes());
+  // frames handed out outlive dropped pixels
+  EXPECT_TRUE(sameData(frame, decoded));
+
+  CachedFrame shared = cached;
+  shared.decode(allocator);
+  EXPECT_TRUE(cached.isDecoded());
+  EXPECT_TRUE(sameData(frame, cached.getFrame(allocator)));
+}
+
+TEST(CachedFrame, HotFrames) {
+  Malloc allocator;
+  const FrameData frame = getRampFrame(64, 64, allocator);
+  FrameData copy = frame;
+  CachedFrame cached(std::move(copy), true, true, allocator);
+  EXPECT_TRUE(cached.isCompressed());
+  EXPECT_TRUE(cached.isDecoded());
+  EXPECT_TRUE(sameData(frame, cached.getFrame(allocator)));
+}
+
+TEST(CachedFrame, IncompressibleFrames) {
+  Malloc allocator;
+  FrameData frame;
+  auto data = frame.setDescriptionAndAllocate(getDescription(GL_RGBA8, 64, 64), allocator);
+  uint32_t state = 1;
+  for (char& c : data) c = char((state = state * 1664525 + 1013904223) >> 24);
+  const FrameData original = frame;
+  CachedFrame cached(std::move(frame), true, false, allocator);
+  EXPECT_FALSE(cached.isCompressed());
+  EXPECT_TRUE(cached.isDecoded());
+  EXPECT_EQ(original.getData().size(), cached.getWeight());
+  cached.dropDecoded();
+  EXPECT_TRUE(sameData(original, cached.getFrame(allocator)));
+}
+
+TEST(CachedFrame, WeightIncludesSizeClasses) {
+  BigAlignedBlock allocator;
+  FrameData frame;
+  // a bit more than a power of two, the size class rounds it up
+  auto data = frame.setDescriptionAndAllocate(getDescription(GL_RGBA8, 257, 256), allocator);
+  const size_t held = allocator.allocatedSize(data.begin());
+  EXPECT_LT(data.size(), held);
+  CachedFrame cached(std::move(frame), false, false, allocator);
+  EXPECT_EQ(held, cached.getWeight());
+}
+
+TEST(CachedFrame, VolatileFrames) {
+  Malloc allocator;
+  const FrameData frame = getRampFrame(64, 64, allocator);
+  std::vector<char> buffer(frame.getData().begin(), frame.getData().end());
+  for (const bool compress : {false, true}) {
+    FrameData readerFrame;
+    readerFrame.setDescriptionAndVolatileData(frame.getDescription(), {buffer.data(), buffer.data() + buffer.size()});
+    CachedFrame cached(std::move(readerFrame), compress, false, allocator);
+    std::fill(buffer.begin(), buffer.end(), 0);
+    EXPECT_TRUE(sameData(frame, cached.getFrame(allocator)));
+    std::copy(frame.getData().begin(), frame.getData().end(), buffer.begin());
+  }
+}
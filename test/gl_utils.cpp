@@ -72,3 +72,60 @@ TEST(GlUtils, ChannelsToGl) {
   checkBackAndForth(GL_RGBA8_SNORM);
   checkBackAndForth(GL_RGBA8UI);
 }
+
+TEST(GlUtils, NativeUploadFormats) {
+  for (const int32_t glFormat : {GL_RGB16, GL_RGBA16, GL_RGB16F, GL_RGBA16F, GL_RGB32F, GL_RGBA32F}) {
+    const auto channels = getChannels(glFormat);
+    size_t bits = 0;
+    for (const auto& channel : channels) bits += channel.bits;
+    EXPECT_EQ(glFormat, getAdaptedInternalFormat(glFormat)) << getInternalFormatString(glFormat);
+    EXPECT_EQ(bits / 8, getBytePerPixels(getPixelFormat(glFormat), getPixelType(glFormat)))
+        << getInternalFormatString(glFormat);
+    EXPECT_FALSE(isInternalOptimizedFormatRedBlueSwapped(glFormat)) << getInternalFormatString(glFormat);
+  }
+  EXPECT_EQ(GL_RGBA8UI, getAdaptedInternalFormat(GL_RGB10_A2UI));
+}
+
+TEST(GlUtils, SignedNormalizedFormats) {
+  EXPECT_EQ(GLenum(GL_RGB), getPixelFormat(GL_RGB16_SNORM));
+  EXPECT_EQ(GLenum(GL_SHORT), getPixelType(GL_RGB16_SNORM));
+  EXPECT_EQ(GLenum(GL_RGBA), getPixelFormat(GL_RGBA8_SNORM));
+  EXPECT_EQ(GLenum(GL_BYTE), getPixelType(GL_RGBA8_SNORM));
+  EXPECT_EQ(1U, getChannelCount(GL_RED));
+}
+
+TEST(GlUtils, UploadFormatCandidates) {
+  const auto rgba8 = getUploadFormatCandidates(GL_RGBA8);
+  ASSERT_EQ(4U, rgba8.size());
+  EXPECT_EQ(GLenum(GL_RGBA), rgba8.front().pixelFormat);
+  EXPECT_EQ(GLenum(GL_UNSIGNED_INT_8_8_8_8_REV), rgba8.front().pixelType);
+  EXPECT_FALSE(rgba8.front().redBlueSwapped);
+  const auto rgb16f = getUploadFormatCandidates(GL_RGB16F);
+  ASSERT_EQ(2U, rgb16f.size());
+  EXPECT_EQ(GLenum(GL_BGR), rgb16f.back().pixelFormat);
+  EXPECT_TRUE(rgb16f.back().redBlueSwapped);
+  EXPECT_EQ(1U, getUploadFormatCandidates(GL_RGB10_A2UI).size());
+
+  setUploadFormat(GL_RGB16F, rgb16f.back());
+  EXPECT_EQ(GLenum(GL_BGR), getPixelFormat(GL_RGB16F));
+  EXPECT_EQ(GLenum(GL_HALF_FLOAT), getPixelType(GL_RGB16F));
+  EXPECT_TRUE(isInternalOptimizedFormatRedBlueSwapped(GL_RGB16F));
+  setUploadFormat(GL_RGB16F, rgb16f.front());
+  EXPECT_EQ(GLenum(GL_RGB), getPixelFormat(GL_RGB16F));
+  EXPECT_FALSE(isInternalOptimizedFormatRedBlueSwapped(GL_RGB16F));
+}
+
+TEST(GlUtils, TextureDimensionsFollowOrientation) {
+  typedef std::pair<int, int> Dims;
+  EXPECT_EQ(Dims(4, -2), getTextureDimensions(4, 2));
+  EXPECT_EQ(Dims(4, -2), getTextureDimensions(4, 2, 1));
+  EXPECT_EQ(Dims(-4, -2), getTextureDimensions(4, 2, 2));
+  EXPECT_EQ(Dims(-4, 2), getTextureDimensions(4, 2, 3));
+  EXPECT_EQ(Dims(4, 2), getTextureDimensions(4, 2, 4));
+  EXPECT_EQ(Dims(2, -4), getTextureDimensions(4, 2, 5));
+  EXPECT_EQ(Dims(-2, -4), getTextureDimensions(4, 2, 6));
+  EXPECT_EQ(Dims(-2, 4), getTextureDimensions(4, 2, 7));
+  EXPECT_EQ(Dims(2, 4), getTextureDimensions(4, 2, 8));
+  EXPECT_THROW(getTextureDimensions(4, 2, 9), std::runtime_error);
+  for (uint8_t orientation = 0; orientation <= 8; ++orientation) EXPECT_EQ(orientation >= 5, isTransposed(orientation));
+}
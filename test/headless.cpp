@@ -0,0 +1,1115 @@
+#include <gtest/gtest.h>
+
+#include "duke/attributes/AttributeKeys.hpp"
+#include "duke/gl/GL.hpp"
+#include "duke/gl/GlObjects.hpp"
+#include "duke/gl/GlState.hpp"
+#include "duke/gl/GlUtils.hpp"
+#include "duke/gl/HeadlessContext.hpp"
+#include "duke/gl/ProgramBinaryCache.hpp"
+#include "duke/gl/Textures.hpp"
+#include "duke/benchmark/UploadAutotune.hpp"
+#include "duke/engine/FrameProfiler.hpp"
+#include "duke/engine/Context.hpp"
+#include "duke/cmdline/CmdLineParameters.hpp"
+#include "duke/engine/cache/LoadedTextureCache.hpp"
+#include "duke/engine/cache/TextureUploader.hpp"
+#include "duke/engine/cache/TiledFrame.hpp"
+#include "duke/engine/overlay/ScopesOverlay.hpp"
+#include "duke/engine/rendering/GeometryRenderer.hpp"
+#include "duke/engine/rendering/GlyphRenderer.hpp"
+#include "duke/engine/rendering/ImageRenderer.hpp"
+#include "duke/engine/rendering/PixelProbe.hpp"
+#include "duke/engine/rendering/ColorLuts.hpp"
+#include "duke/engine/rendering/ShaderFactory.hpp"
+#include "duke/gl/Program.hpp"
+#include "duke/image/BlockCompression.hpp"
+#include "duke/io/IO.hpp"
+#include "duke/io/ImageLoadUtils.hpp"
+#include "duke/memory/Allocator.hpp"
+#include "duke/memory/MemoryAccounting.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace duke;
+
+namespace {
+
+// 8 bits RGBA frames, channels included.
+ImageDescription getRgba8Description(size_t width, size_t height) {
+  ImageDescription description;
+  description.width = width;
+  description.height = height;
+  description.opengl_format = GL_RGBA8;
+  for (const char* pName : {"R", "G", "B", "A"}) description.channels.emplace_back(Channel::Semantic::UNKNOWN, 8, pName);
+  return description;
+}
+
+// Glyphs texture where every glyph is an opaque white square, duke's font lives in the io plugins.
+class SolidFontReader : public IImageReader {
+ public:
+  SolidFontReader() {
+    m_Description.frames = 1;
+    ImageDescription image;
+    image.width = 128;
+    image.height = 128;
+    image.opengl_format = GL_RGBA8;
+    image.channels = getChannels(GL_RGBA8);
+    m_Description.subimages.push_back(image);
+  }
+
+  bool read(const ReadOptions& options, const Allocator& allocator, FrameData& frame) override {
+    auto data = frame.setDescriptionAndAllocate(m_Description.subimages.at(0), allocator);
+    std::fill(data.begin(), data.end(), char(0xFF));
+    return true;
+  }
+};
+
+class SolidFontDescriptor : public IIODescriptor {
+  bool supports(Capability capability) const override { return false; }
+  const std::vector<std::string>& getSupportedExtensions() const override {
+    static std::vector<std::string> extensions = {"solid_test_font"};
+    return extensions;
+  }
+  const char* getName() const override { return "Solid test font"; }
+  IImageReader* createFileReader(const char* filename) const override { return new SolidFontReader(); }
+};
+
+bool gSolidFontRegistered = IODescriptors::instance().registerDescriptor(new SolidFontDescriptor());
+
+// 4x4 RGBA8 frames with the frame index in the red channel, decoded once opened.
+class GatedStream : public IMediaStream {
+ public:
+  const ReadFrameResult& openContainer() const override { return m_Container; }
+  ReadFrameResult process(const size_t frame) const override {
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Condition.wait(lock, [this] { return m_Open; });
+    }
+    ReadFrameResult result;
+    auto data = result.frame.setDescriptionAndAllocate(getRgba8Description(4, 4), getFrameAllocator());
+    for (size_t i = 0; i < data.size(); i += 4) {
+      data.begin()[i] = char(frame);
+      data.begin()[i + 3] = char(255);
+    }
+    return result;
+  }
+  bool isForwardOnly() const override { return false; }
+  const attribute::Attributes& getState() const override { return m_State; }
+
+  void open() {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Open = true;
+    }
+    m_Condition.notify_all();
+  }
+
+ private:
+  ReadFrameResult m_Container;
+  attribute::Attributes m_State;
+  mutable std::mutex m_Mutex;
+  mutable std::condition_variable m_Condition;
+  bool m_Open = false;
+};
+
+Timeline getTimeline(const std::shared_ptr<IMediaStream>& pStream, size_t frames) {
+  Track track;
+  track.add(0, Clip{frames, pStream, nullptr});
+  return Timeline{track};
+}
+
+// Retries until done returns true, the upload thread works asynchronously.
+template <typename F>
+bool eventually(F done) {
+  for (size_t i = 0; i < 2000; ++i) {
+    if (done()) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+unsigned char readRed(const Texture& texture) {
+  gl::getGlState().modifiedTexture(texture.id);
+  gl::GlFrameBufferObject frameBuffer;
+  auto boundFrameBuffer = frameBuffer.scope_bind_framebuffer();
+  frameBuffer.attachColor(texture);
+  unsigned char pixel[4] = {0};
+  glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  return pixel[0];
+}
+
+// Machines without EGL nor a usable driver skip the GL tests, their bodies return when skipped is set.
+class Headless : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!HeadlessContext::isSupported()) return;
+    try {
+      pContext.reset(new HeadlessContext());
+      skipped = false;
+    } catch (std::runtime_error& e) {
+      printf("Skipping headless test : %s\n", e.what());
+    }
+  }
+
+  bool skipped = true;
+  std::unique_ptr<HeadlessContext> pContext;
+};
+
+// Draws into a 64x64 RGBA8 target, images are displayed as is : linear, centered and unzoomed.
+class HeadlessRendering : public Headless {
+ protected:
+  void SetUp() override {
+    Headless::SetUp();
+    if (skipped) return;
+    pColorBuffer.reset(new gl::GlTexture2D());
+    {
+      auto boundTexture = pColorBuffer->scope_bind_texture();
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    pFrameBuffer.reset(new gl::GlFrameBufferObject());
+    pFrameBuffer->bind();
+    pFrameBuffer->attachColor(*pColorBuffer);
+    glViewport(0, 0, 64, 64);
+    pGeometryRenderer.reset(new GeometryRenderer());
+    context.viewport = Viewport(glm::ivec2(), glm::ivec2(64, 64));
+    context.fileColorSpace = ColorSpace::Linear;
+    context.screenColorSpace = ColorSpace::Linear;
+    context.pCurrentMediaStream = nullptr;
+  }
+
+  void TearDown() override {
+    pGeometryRenderer.reset();
+    pFrameBuffer.reset();
+    pColorBuffer.reset();
+  }
+
+  // Draws texture as context.pCurrentImage.
+  void render(const Texture& texture) {
+    context.pCurrentImage = &texture.description;
+    context.pCurrentTexture = &texture;
+    auto bound = texture.scope_bind_texture();
+    renderWithBoundTexture(pGeometryRenderer->shaderPool, pGeometryRenderer->meshPool.getSquare().get(), context);
+  }
+
+  glm::ivec4 readPixel(int x, int y) const {
+    unsigned char pixel[4];
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    return glm::ivec4(pixel[0], pixel[1], pixel[2], pixel[3]);
+  }
+
+  std::unique_ptr<gl::GlTexture2D> pColorBuffer;
+  std::unique_ptr<gl::GlFrameBufferObject> pFrameBuffer;
+  std::unique_ptr<GeometryRenderer> pGeometryRenderer;
+  Context context;
+};
+
+}  // namespace
+
+TEST_F(Headless, rendersToFramebuffer) {
+  if (skipped) return;
+  GLint major = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  EXPECT_GE(major, 3);
+
+  gl::GlTexture2D colorBuffer;
+  {
+    auto boundTexture = colorBuffer.scope_bind_texture();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  gl::GlFrameBufferObject frameBuffer;
+  auto boundFrameBuffer = frameBuffer.scope_bind_framebuffer();
+  frameBuffer.attachColor(colorBuffer);
+  EXPECT_NO_THROW(frameBuffer.checkComplete());
+
+  glViewport(0, 0, 4, 4);
+  glClearColor(1, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT);
+  unsigned char pixel[4] = {0};
+  glReadPixels(1, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  EXPECT_EQ(255, pixel[0]);
+  EXPECT_EQ(0, pixel[1]);
+  EXPECT_EQ(0, pixel[2]);
+  EXPECT_EQ(255, pixel[3]);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, compilesMipmapShaders) {
+  if (skipped) return;
+  for (const bool tenBitUnpack : {false, true}) {
+    auto description = ShaderDescription::createTextureDesc(false, false, false, tenBitUnpack, ColorSpace::sRGB,
+                                                            ColorSpace::sRGB);
+    EXPECT_NO_THROW(buildProgram(description));
+    description.linearize = true;
+    EXPECT_NO_THROW(buildProgram(description));
+  }
+  EXPECT_NO_THROW(buildProgram(ShaderDescription::createPyramidDesc(ColorSpace::Rec709)));
+}
+
+TEST_F(Headless, compilesLutShaders) {
+  if (skipped) return;
+  ColorLuts luts;
+  Lut displayLut;
+  displayLut.type = LutType::LUT_3D;
+  displayLut.size = 2;
+  displayLut.data = {0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0, 0, 0, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1};
+  luts.setDisplayLut(displayLut);
+  for (const auto lutType : {LutType::NONE, LutType::LUT_3D}) {
+    auto description = ShaderDescription::createTextureDesc(false, false, false, false, ColorSpace::KodakLog,
+                                                            ColorSpace::sRGB);
+    description.colorLuts = true;
+    description.displayLut = lutType;
+    const auto pProgram = buildProgram(description);
+    pProgram->use();
+    EXPECT_NO_THROW(luts.bind(*pProgram, description));
+    description.linearize = true;
+    EXPECT_NO_THROW(buildProgram(description));
+  }
+  auto pyramid = ShaderDescription::createPyramidDesc(ColorSpace::Rec709);
+  pyramid.colorLuts = true;
+  pyramid.displayLut = LutType::LUT_1D;
+  EXPECT_NO_THROW(buildProgram(pyramid));
+
+  // 1D display luts are folded into the screen lut
+  const auto& tag = MemoryAccounting::instance().tag("color luts");
+  luts.setDisplayLut(bakeToScreen(ColorSpace::Rec709, 16));
+  EXPECT_TRUE(pyramid.foldsDisplayLut());
+  const auto pProgram = buildProgram(pyramid);
+  pProgram->use();
+  EXPECT_NO_THROW(luts.bind(*pProgram, pyramid));
+  const size_t bytes = tag.bytes();
+  EXPECT_GT(bytes, 0U);
+  // replacing the display lut releases its texture and the folded screen lut
+  luts.setDisplayLut(bakeToScreen(ColorSpace::Rec709, 16));
+  EXPECT_LT(tag.bytes(), bytes);
+
+  // luts bigger than the textures the GPU supports are rejected
+  GLint maxSize = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  Lut tooBig = bakeToScreen(ColorSpace::sRGB, 2);
+  tooBig.size = maxSize + 1;
+  tooBig.data.resize(tooBig.size * 3);
+  EXPECT_THROW(luts.setDisplayLut(tooBig), std::runtime_error);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST(MipmapPyramid, levelsAndSize) {
+  EXPECT_EQ(1, getMipmapLevels(1, 1));
+  EXPECT_EQ(13, getMipmapLevels(7680, 4320));
+  EXPECT_EQ(2 * 8 + 8, getMipmapPyramidSize(2, 1));
+}
+
+TEST_F(Headless, mipmapPyramid) {
+  if (skipped) return;
+  MipmapPyramid pyramid;
+  {
+    auto boundPyramid = pyramid.scope_bind_texture();
+    pyramid.initialize(640, 360);
+  }
+  EXPECT_EQ(10, pyramid.levels);
+  auto boundFrameBuffer = pyramid.frameBuffer.scope_bind_framebuffer();
+  EXPECT_NO_THROW(pyramid.frameBuffer.checkComplete());
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, programBinaryCache) {
+  if (skipped) return;
+  char directory[] = "/tmp/duke_program_cache_XXXXXX";
+  ASSERT_TRUE(mkdtemp(directory));
+  const auto description = ShaderDescription::createPyramidDesc(ColorSpace::sRGB);
+  const std::string vertexSource = buildVertexShaderSource(description);
+  const std::string fragmentSource = buildFragmentShaderSource(description);
+  {
+    ProgramBinaryCache cache(directory);
+    EXPECT_TRUE(cache.getOrBuild(vertexSource, fragmentSource));
+    EXPECT_EQ(0, cache.hits);
+    EXPECT_EQ(1, cache.misses);
+  }
+  std::vector<std::string> entries;
+  DIR* pDir = opendir(directory);
+  ASSERT_TRUE(pDir);
+  while (const dirent* pEntry = readdir(pDir))
+    if (pEntry->d_name[0] != '.') entries.push_back(std::string(directory) + '/' + pEntry->d_name);
+  closedir(pDir);
+  const auto cleanup = [&]() {
+    for (const auto& entry : entries) unlink(entry.c_str());
+    rmdir(directory);
+  };
+  if (entries.empty()) {
+    cleanup();
+    printf("Skipping program binary test : unsupported by the driver\n");
+    return;
+  }
+  EXPECT_EQ(1UL, entries.size());
+  {
+    ProgramBinaryCache cache(directory);
+    const auto pProgram = cache.getOrBuild(vertexSource, fragmentSource);
+    EXPECT_TRUE(pProgram);
+    EXPECT_EQ(1, cache.hits);
+    EXPECT_EQ(0, cache.misses);
+    EXPECT_NO_THROW(pProgram->getUniformLocation("gPyramidSampler"));
+  }
+  // an entry holding another program, as a hash collision would, is not loaded
+  const std::string otherFragmentSource = fragmentSource + "\n// another program\n";
+  {
+    ProgramBinaryCache cache(directory);
+    cache.getOrBuild(vertexSource, otherFragmentSource);
+  }
+  entries.clear();
+  pDir = opendir(directory);
+  while (const dirent* pEntry = readdir(pDir))
+    if (pEntry->d_name[0] != '.') entries.push_back(std::string(directory) + '/' + pEntry->d_name);
+  closedir(pDir);
+  ASSERT_EQ(2UL, entries.size());
+  {
+    std::ifstream source(entries.front(), std::ios::binary);
+    std::ofstream(entries.back(), std::ios::binary | std::ios::trunc) << source.rdbuf();
+  }
+  {
+    ProgramBinaryCache cache(directory);
+    cache.getOrBuild(vertexSource, fragmentSource);
+    cache.getOrBuild(vertexSource, otherFragmentSource);
+    EXPECT_EQ(1, cache.hits);
+    EXPECT_EQ(1, cache.misses);
+    EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+  }
+  cleanup();
+}
+
+TEST_F(Headless, glStateSkipsRedundantBinds) {
+  if (skipped) return;
+  auto& state = gl::getGlState();
+  GLint bound = 0;
+  {
+    gl::GlTexture2D texture;
+    texture.bind();
+    state.resetCounters();
+    { auto scoped = texture.scope_bind_texture(); }
+    texture.bind();
+    EXPECT_EQ(0, state.calls);
+    EXPECT_EQ(2, state.skipped);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    EXPECT_EQ(GLint(texture.id), bound);
+  }
+  // deleting unbinds, a new texture reusing the name must really be bound
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+  EXPECT_EQ(0, bound);
+  gl::GlTexture2D texture;
+  state.resetCounters();
+  texture.bind();
+  EXPECT_EQ(1, state.calls);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+  EXPECT_EQ(GLint(texture.id), bound);
+  // pixel buffers are really unbound
+  {
+    gl::GlStreamUploadPbo pbo;
+    auto scoped = pbo.scope_bind_buffer();
+  }
+  glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &bound);
+  EXPECT_EQ(0, bound);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, frameProfilerCollectsWithoutStalling) {
+  if (skipped) return;
+  FrameProfiler profiler("", 2);
+  const size_t frames = 100;
+  for (size_t frame = 0; frame < frames; ++frame) {
+    profiler.nextFrame();
+    ProfileScope image(profiler, ProfiledStage::IMAGE);
+    glClear(GL_COLOR_BUFFER_BIT);
+  }
+  // results are only read once the gpu is done
+  glFinish();
+  profiler.nextFrame();
+  EXPECT_EQ(frames, profiler.getCollectedFrames() + profiler.getDroppedFrames());
+  EXPECT_EQ(frames - 1, profiler.getLastTimings().frame);
+  EXPECT_GT(profiler.getTotalTimings().cpuMs[size_t(ProfiledStage::IMAGE)], 0);
+  EXPECT_EQ(0, profiler.getTotalTimings().cpuMs[size_t(ProfiledStage::UPLOAD)]);
+
+  // stages timed on another thread, with or without gpu times
+  GLint64 gpuNow = 0;
+  if (hasTimerQueries()) glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  const auto cpuNow = duke_clock::now();
+  profiler.nextFrame();
+  profiler.add(ProfiledStage::UPLOAD, cpuNow, cpuNow + std::chrono::milliseconds(2), gpuNow, gpuNow + 1000000);
+  profiler.add(ProfiledStage::UPLOAD, cpuNow, cpuNow + std::chrono::milliseconds(1), 0, 0);
+  profiler.nextFrame();
+  EXPECT_NEAR(3, profiler.getLastTimings().cpuMs[size_t(ProfiledStage::UPLOAD)], 1e-6);
+  if (hasTimerQueries()) EXPECT_NEAR(1, profiler.getLastTimings().gpuMs[size_t(ProfiledStage::UPLOAD)], 1e-6);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, sharedContextUploadsOnAnotherThread) {
+  if (skipped) return;
+  HeadlessContext shared(pContext.get());
+  gl::GlTexture2D texture;
+  GLsync fence = nullptr;
+  std::thread uploader([&]() {
+    shared.makeCurrent();
+    const unsigned char red[] = {255, 0, 0, 255};
+    texture.bind();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, red);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    shared.doneCurrent();
+  });
+  uploader.join();
+  EXPECT_NE(GLenum(GL_WAIT_FAILED), glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9)));
+  glDeleteSync(fence);
+
+  gl::getGlState().modifiedTexture(texture.id);
+  gl::GlFrameBufferObject frameBuffer;
+  auto boundFrameBuffer = frameBuffer.scope_bind_framebuffer();
+  frameBuffer.attachColor(texture);
+  unsigned char pixel[4] = {0};
+  glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  EXPECT_EQ(255, pixel[0]);
+  EXPECT_EQ(0, pixel[1]);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, textureUploaderWakesOnDecodedFrames) {
+  if (skipped) return;
+  const auto pStream = std::make_shared<GatedStream>();
+  LoadedImageCache imageCache(1, 1 << 20);
+  LoadedPboCache pboCache;
+  TexturePool texturePool;
+  TextureUploader uploader(std::unique_ptr<IGlContext>(new HeadlessContext(pContext.get())), imageCache, pboCache,
+                           texturePool, NumaPlacement::NONE);
+  imageCache.load(getTimeline(pStream, 4));
+  const MediaFrameReference mfr(pStream.get(), 2);
+  // requested before being decoded, the image cache wakes the thread up
+  uploader.request({mfr});
+  std::vector<UploadedTexture> uploaded;
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  uploader.collect(uploaded);
+  EXPECT_TRUE(uploaded.empty());
+  pStream->open();
+  ASSERT_TRUE(eventually([&] {
+    uploader.collect(uploaded);
+    return !uploaded.empty();
+  }));
+  ASSERT_EQ(1u, uploaded.size());
+  EXPECT_EQ(mfr, uploaded[0].mfr);
+  EXPECT_NE(GLenum(GL_WAIT_FAILED), glClientWaitSync(uploaded[0].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9)));
+  glDeleteSync(uploaded[0].fence);
+  EXPECT_EQ(2, readRed(*uploaded[0].frame.pTexture));
+
+  std::vector<UploadTiming> timings;
+  ASSERT_TRUE(eventually([&] {
+    uploader.collectTimings(timings);
+    return !timings.empty();
+  }));
+  EXPECT_LE(timings[0].cpuBegin, timings[0].cpuEnd);
+  if (hasTimerQueries()) {
+    EXPECT_GT(timings[0].gpuBegin, 0u);
+    EXPECT_LE(timings[0].gpuBegin, timings[0].gpuEnd);
+  }
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, textureCacheCollectsAndRetiresUploads) {
+  if (skipped) return;
+  const char* const argv[] = {"duke"};
+  LoadedTextureCache textureCache(CmdLineParameters(1, argv));
+  textureCache.startUploadThread(std::unique_ptr<IGlContext>(new HeadlessContext(pContext.get())));
+  EXPECT_TRUE(textureCache.hasUploadThread());
+  const auto pStream = std::make_shared<GatedStream>();
+  pStream->open();
+  textureCache.load(getTimeline(pStream, 16));
+  const MediaFrameReference first(pStream.get(), 0);
+  const auto isLoaded = [&](size_t frame) {
+    textureCache.prepare(frame, IterationMode::FORWARD);
+    return textureCache.getLoadedTexture(MediaFrameReference(pStream.get(), frame)) != nullptr;
+  };
+  // only textures the upload thread is done with are handed out
+  ASSERT_TRUE(eventually([&] { return isLoaded(0); }));
+  const TexturePackedFrame* pFrame = textureCache.getLoadedTexture(first);
+  EXPECT_EQ(0, readRed(*pFrame->pTexture));
+  std::weak_ptr<Texture> pRetired = pFrame->pTexture;
+
+  // moving away, the texture goes back to the pool once the render context is done with it
+  ASSERT_TRUE(eventually([&] { return isLoaded(8); }));
+  EXPECT_EQ(8, readRed(*textureCache.getLoadedTexture(MediaFrameReference(pStream.get(), 8))->pTexture));
+  EXPECT_EQ(nullptr, textureCache.getLoadedTexture(first));
+  glFinish();
+  textureCache.prepare(8, IterationMode::FORWARD);
+  EXPECT_TRUE(pRetired.expired());
+  // pixel buffer stats are per frame
+  EXPECT_LT(0u, textureCache.takePboStats().writes);
+  EXPECT_EQ(0u, textureCache.takePboStats().writes);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, textureCacheDropsUnsupportedProxies) {
+  if (skipped) return;
+  for (const char* pFormat : {"bc1", "bc7"}) {
+    const char* const argv[] = {"duke", "--proxy", pFormat};
+    LoadedTextureCache textureCache(CmdLineParameters(3, argv));
+    const ProxyFormat requested = textureCache.getImageCache().getProxyFormat();
+    textureCache.checkProxySupport();
+    const bool supported = hasGlExtension(requested == ProxyFormat::BC1 ? "GL_EXT_texture_compression_s3tc"
+                                                                        : "GL_ARB_texture_compression_bptc");
+    EXPECT_EQ(supported ? requested : ProxyFormat::NONE, textureCache.getImageCache().getProxyFormat()) << pFormat;
+  }
+}
+
+TEST_F(Headless, tileCacheUploadsOnDemand) {
+  if (skipped) return;
+  ImageDescription description = getRgba8Description(9000, 4);
+  const std::vector<char> pixels(description.width * description.height * 4);
+  FrameData data;
+  data.setDescriptionAndVolatileData(description, ConstMemorySlice(pixels.data(), pixels.data() + pixels.size()));
+  EXPECT_TRUE(needsTiling(description));
+
+  const TiledFrame frame(data);
+  EXPECT_EQ(glm::ivec2(5, 1), frame.tiles);
+  EXPECT_EQ(glm::ivec2(8192, 0), frame.getTileOffset(glm::ivec2(4, 0)));
+  EXPECT_EQ(glm::ivec2(808, 4), frame.getTileSize(glm::ivec2(4, 0)));
+  // borders are clipped to the frame
+  EXPECT_EQ(glm::ivec2(0, 0), frame.getTextureOffset(glm::ivec2(0, 0)));
+  EXPECT_EQ(glm::ivec2(kTileSize + kTileBorder, 4), frame.getTextureSize(glm::ivec2(0, 0)));
+  EXPECT_EQ(glm::ivec2(kTileSize - kTileBorder, 0), frame.getTextureOffset(glm::ivec2(1, 0)));
+  EXPECT_EQ(glm::ivec2(kTileSize + 2 * kTileBorder, 4), frame.getTextureSize(glm::ivec2(1, 0)));
+  EXPECT_EQ(glm::ivec2(808 + kTileBorder, 4), frame.getTextureSize(glm::ivec2(4, 0)));
+  EXPECT_EQ(4, frame.overviewFactor);
+  EXPECT_EQ(glm::ivec2(2250, 1), frame.overviewDimensions);
+
+  // room for two tiles
+  const size_t tileBytes = (kTileSize + 2 * kTileBorder) * (kTileSize + 2 * kTileBorder) * 4;
+  TileCache cache(2 * tileBytes);
+  cache.nextFrame();
+  cache.get(frame, glm::ivec2(0, 0));
+  cache.get(frame, glm::ivec2(1, 0));
+  cache.get(frame, glm::ivec2(0, 0));
+  EXPECT_EQ(2u, cache.uploads());
+  cache.nextFrame();
+  cache.get(frame, glm::ivec2(0, 0));
+  cache.get(frame, glm::ivec2(2, 0));  // evicts tile 1
+  cache.get(frame, glm::ivec2(0, 0));
+  EXPECT_EQ(3u, cache.uploads());
+  cache.nextFrame();
+  cache.get(frame, glm::ivec2(1, 0));
+  EXPECT_EQ(4u, cache.uploads());
+
+  // tiles of the current frame are kept beyond the budget
+  cache.nextFrame();
+  for (int x = 0; x < 3; ++x) cache.get(frame, glm::ivec2(x, 0));
+  const size_t uploads = cache.uploads();
+  for (int x = 0; x < 3; ++x) cache.get(frame, glm::ivec2(x, 0));
+  EXPECT_EQ(uploads, cache.uploads());
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, tileCacheInsertsRequestedTiles) {
+  if (skipped) return;
+  ImageDescription description = getRgba8Description(9000, 4);
+  const std::vector<char> pixels(description.width * description.height * 4);
+  FrameData data;
+  data.setDescriptionAndVolatileData(description, ConstMemorySlice(pixels.data(), pixels.data() + pixels.size()));
+  const auto pFrame = std::make_shared<const TiledFrame>(data);
+
+  TileCache cache;
+  cache.nextFrame();
+  EXPECT_EQ(nullptr, cache.find(pFrame, glm::ivec2(1, 0)));
+  EXPECT_EQ(nullptr, cache.find(pFrame, glm::ivec2(1, 0)));  // requested once
+  std::vector<TileUpload> requests;
+  cache.takeRequests(requests);
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_EQ(glm::ivec2(1, 0), requests[0].tile);
+  requests[0].pTexture = cache.acquire(*pFrame);
+  {
+    auto bound = requests[0].pTexture->scope_bind_texture();
+    uploadTile(*pFrame, requests[0].tile, *requests[0].pTexture);
+  }
+  cache.insert(requests[0]);
+  EXPECT_EQ(requests[0].pTexture.get(), cache.find(pFrame, glm::ivec2(1, 0)));
+  EXPECT_EQ(1u, cache.uploads());
+  requests.clear();
+  cache.takeRequests(requests);
+  EXPECT_TRUE(requests.empty());
+
+  TileOverview& overview = cache.getOverview(*pFrame);
+  EXPECT_EQ(5u, overview.remaining);
+  EXPECT_FALSE(overview.isComplete());
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, tiledFramesDrawFromTilesOrOverview) {
+  if (skipped) return;
+  // red changes on the edge between the second and the third tile
+  ImageDescription description = getRgba8Description(8200, 1024);
+  std::vector<unsigned char> pixels(description.width * description.height * 4, 255);
+  for (size_t i = 0; i < pixels.size(); i += 4) pixels[i] = (i / 4) % description.width < 2 * kTileSize ? 200 : 50;
+  FrameData data;
+  data.setDescriptionAndVolatileData(
+      description, ConstMemorySlice(reinterpret_cast<const char*>(pixels.data()),
+                                    reinterpret_cast<const char*>(pixels.data() + pixels.size())));
+  ASSERT_TRUE(needsTiling(description));
+  const auto pFrame = std::make_shared<TiledFrame>(data);
+
+  TileCache tileCache;
+  context.pCurrentImage = &pFrame->frame.getDescription();
+  // full resolution, both sides of the seam come from tiles
+  tileCache.nextFrame();
+  renderTiles(pGeometryRenderer->shaderPool, pGeometryRenderer->meshPool.getSquare().get(), context, pFrame, tileCache,
+              true);
+  EXPECT_EQ(2u, tileCache.uploads());
+  EXPECT_NEAR(200, readPixel(20, 32).r, 1);
+  EXPECT_NEAR(50, readPixel(44, 32).r, 1);
+  // zoomed out, the whole frame comes from the overview
+  context.zoom = 1. / 128;
+  tileCache.nextFrame();
+  renderTiles(pGeometryRenderer->shaderPool, pGeometryRenderer->meshPool.getSquare().get(), context, pFrame, tileCache,
+              true);
+  EXPECT_TRUE(tileCache.getOverview(*pFrame).isComplete());
+  EXPECT_NEAR(200, readPixel(20, 32).r, 1);
+  EXPECT_NEAR(50, readPixel(44, 32).r, 1);
+  const size_t uploads = tileCache.uploads();
+  tileCache.nextFrame();
+  renderTiles(pGeometryRenderer->shaderPool, pGeometryRenderer->meshPool.getSquare().get(), context, pFrame, tileCache,
+              true);
+  EXPECT_EQ(uploads, tileCache.uploads());
+  EXPECT_NEAR(200, readPixel(20, 32).r, 1);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, fencedPboIsRewrittenAfterTransfers) {
+  if (skipped) return;
+  gl::GlTexture2D texture;
+  {
+    auto bound = texture.scope_bind_texture();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  gl::GlFencedUploadPbo pbo;
+  pbo.allocate(4);
+  if (hasGlExtension("GL_ARB_buffer_storage")) {
+    auto bound = pbo.scope_bind_buffer();
+    GLint immutable = GL_FALSE;
+    glGetBufferParameteriv(pbo.target, GL_BUFFER_IMMUTABLE_STORAGE, &immutable);
+    EXPECT_EQ(GL_TRUE, immutable);
+  }
+  EXPECT_FALSE(pbo.waitForTransfers());
+  for (const unsigned char red : {255, 128}) {
+    pbo.waitForTransfers();
+    auto boundPbo = pbo.scope_bind_buffer();
+    auto* pData = static_cast<unsigned char*>(
+        glMapBufferRange(pbo.target, 0, 4, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    const unsigned char pixel[] = {red, 0, 0, 255};
+    std::copy(pixel, pixel + 4, pData);
+    glUnmapBuffer(pbo.target);
+    auto boundTexture = texture.scope_bind_texture();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    pbo.fence();
+  }
+  pbo.waitForTransfers();
+  EXPECT_FALSE(pbo.waitForTransfers());
+
+  gl::GlFrameBufferObject frameBuffer;
+  auto boundFrameBuffer = frameBuffer.scope_bind_framebuffer();
+  frameBuffer.attachColor(texture);
+  unsigned char pixel[4] = {0};
+  glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  EXPECT_EQ(128, pixel[0]);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, scopesHistogramIsReadBack) {
+  if (skipped) return;
+  // a red image, scopes are computed from a 512x256 resampling
+  ImageDescription description = getRgba8Description(4, 2);
+  std::vector<unsigned char> pixels;
+  for (int i = 0; i < 8; ++i) pixels.insert(pixels.end(), {255, 0, 0, 255});
+  Texture texture;
+  {
+    auto bound = texture.scope_bind_texture();
+    texture.initialize(description, pixels.data());
+  }
+
+  ScopesOverlay scopes(*pGeometryRenderer);
+  context.pCurrentImage = &texture.description;
+  context.pCurrentTexture = &texture;
+  scopes.render(context);
+  EXPECT_EQ(0, scopes.getHistogram().maxCount);
+  glFinish();
+  scopes.render(context);  // collects the previous readback
+
+  const auto& histogram = scopes.getHistogram();
+  const float pixelCount = 512 * 256;
+  EXPECT_EQ(pixelCount, histogram.maxCount);
+  EXPECT_EQ(pixelCount, histogram.counts[255 * 4 + 0]);      // red
+  EXPECT_EQ(pixelCount, histogram.counts[0 * 4 + 1]);        // green
+  EXPECT_EQ(pixelCount, histogram.counts[0 * 4 + 2]);        // blue
+  EXPECT_EQ(pixelCount, histogram.counts[54 * 4 + 3]);       // luma, 0.2126
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, pixelProbeReadsCursorAndRegion) {
+  if (skipped) return;
+  // texel (x, y) is (60x, 200y, 10, 255)
+  ImageDescription description = getRgba8Description(4, 2);
+  std::vector<unsigned char> pixels;
+  for (int y = 0; y < 2; ++y)
+    for (int x = 0; x < 4; ++x) pixels.insert(pixels.end(), {(unsigned char)(60 * x), (unsigned char)(200 * y), 10, 255});
+  Texture texture;
+  {
+    auto bound = texture.scope_bind_texture();
+    texture.initialize(description, pixels.data());
+  }
+  render(texture);
+
+  // the image spans [30, 34) x [31, 33) and is flipped, its first row is on top
+  PixelProbe probe(*pGeometryRenderer);
+  const glm::ivec2 cursor(31, 31);
+  const glm::ivec2 corners[] = {glm::ivec2(30, 31), glm::ivec2(33, 32)};
+  probe.probe(context, cursor, corners);
+  EXPECT_FALSE(probe.getReadings().valid);
+  glFinish();
+  probe.probe(context, cursor, corners);  // collects the previous readback
+
+  const auto& readings = probe.getReadings();
+  const auto expectNear = [](glm::vec4 expected, glm::vec4 actual) {
+    for (int i = 0; i < 4; ++i) EXPECT_NEAR(expected[i] / 255, actual[i], 1e-3) << "component " << i;
+  };
+  ASSERT_TRUE(readings.valid);
+  EXPECT_TRUE(readings.onImage);
+  EXPECT_EQ(glm::ivec2(1, 1), readings.texel);
+  expectNear(glm::vec4(60, 200, 10, 255), readings.file);
+  expectNear(glm::vec4(60, 200, 10, 255), readings.linear);
+  expectNear(glm::vec4(60, 200, 10, 255), readings.display);
+  EXPECT_EQ(8, readings.regionTexels);
+  expectNear(glm::vec4(0, 0, 10, 255), readings.regionFile.min);
+  expectNear(glm::vec4(180, 200, 10, 255), readings.regionFile.max);
+  expectNear(glm::vec4(90, 100, 10, 255), readings.regionLinear.mean);
+
+  // the unchanged region is not reduced again, its statistics carry over
+  glFinish();
+  probe.probe(context, glm::ivec2(33, 32), corners);
+  glFinish();
+  probe.probe(context, glm::ivec2(33, 32), corners);
+  EXPECT_EQ(glm::ivec2(3, 0), probe.getReadings().texel);
+  EXPECT_EQ(8, probe.getReadings().regionTexels);
+  expectNear(glm::vec4(180, 200, 10, 255), probe.getReadings().regionFile.max);
+  expectNear(glm::vec4(90, 100, 10, 255), probe.getReadings().regionLinear.mean);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST(ImageRenderer, texelAtFollowsOrientation) {
+  // rotated 90 degrees counter-clockwise, the 4x2 texture is displayed as 2x4 over [31, 33) x [30, 34)
+  ImageDescription description = getRgba8Description(4, 2);
+  attribute::set<attribute::DpxImageOrientation>(description.extra_attributes, 8);
+  Context context;
+  context.viewport = Viewport(glm::ivec2(), glm::ivec2(64, 64));
+  context.pCurrentImage = &description;
+  EXPECT_EQ(glm::ivec2(0, 0), getTexelAt(context, glm::ivec2(31, 30)));
+  EXPECT_EQ(glm::ivec2(3, 1), getTexelAt(context, glm::ivec2(32, 33)));
+  EXPECT_EQ(glm::ivec2(4, 0), getTexelAt(context, glm::ivec2(31, 34)));
+}
+
+TEST_F(HeadlessRendering, glyphBatchesFollowOverlayOrder) {
+  if (skipped) return;
+  ASSERT_TRUE(gSolidFontRegistered);
+  GlyphRenderer glyphRenderer(*pGeometryRenderer, "glyphs.solid_test_font");
+  const Viewport viewport(glm::ivec2(), glm::ivec2(64, 64));
+  const glm::ivec4 white(255), red(255, 0, 0, 255);
+
+  // a glyph overlay then a rect overlay covering it, twice
+  for (int frame = 0; frame < 2; ++frame) {
+    glClear(GL_COLOR_BUFFER_BIT);
+    glyphRenderer.draw(32, 32, 'a');
+    glyphRenderer.flush(viewport);
+    pGeometryRenderer->drawRect(viewport.dimension, viewport.dimension, glm::ivec2(), glm::vec4(1, 0, 0, 1));
+    glyphRenderer.flush(viewport);
+    glyphRenderer.endFrame();
+    EXPECT_EQ(red, readPixel(32, 32));
+  }
+  // unchanged glyphs are not uploaded again
+  EXPECT_EQ(1U, glyphRenderer.uploads());
+
+  // within an overlay, text backgrounds are drawn under the glyphs
+  glClear(GL_COLOR_BUFFER_BIT);
+  drawText(glyphRenderer, viewport, "a", 32, 32);
+  glyphRenderer.flush(viewport);
+  glyphRenderer.endFrame();
+  EXPECT_EQ(white, readPixel(32, 32));
+  EXPECT_EQ(1U, glyphRenderer.uploads());
+
+  glClear(GL_COLOR_BUFFER_BIT);
+  drawText(glyphRenderer, viewport, "b", 32, 32);
+  glyphRenderer.flush(viewport);
+  glyphRenderer.endFrame();
+  EXPECT_EQ(2U, glyphRenderer.uploads());
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, compositesTracksInASinglePass) {
+  if (skipped) return;
+  // first track texel (x, y) is (60x, 200y, 10, 255), the second track is uniformly (20, 20, 20, 255)
+  ImageDescription description = getRgba8Description(4, 2);
+  std::vector<unsigned char> first;
+  std::vector<unsigned char> second;
+  for (int y = 0; y < 2; ++y)
+    for (int x = 0; x < 4; ++x) {
+      first.insert(first.end(), {(unsigned char)(60 * x), (unsigned char)(200 * y), 10, 255});
+      second.insert(second.end(), {20, 20, 20, 255});
+    }
+  // the third track is the first one rotated 90 degrees counter-clockwise
+  Texture textures[3];
+  const unsigned char* pixels[] = {first.data(), second.data(), first.data()};
+  for (int i = 0; i < 3; ++i) {
+    if (i == 2) attribute::set<attribute::DpxImageOrientation>(description.extra_attributes, 8);
+    auto bound = textures[i].scope_bind_texture();
+    textures[i].initialize(description, pixels[i]);
+  }
+  std::vector<CompositeLayer> layers = {{&textures[0].description, &textures[0], nullptr},
+                                        {&textures[1].description, &textures[1], nullptr}};
+  context.pCurrentImage = &textures[0].description;
+  context.pCurrentTexture = &textures[0];
+
+  // the images span [30, 34) x [31, 33) and are flipped, their first row is on top
+  const auto composite = [&](CompositeMode mode) {
+    context.compositeMode = mode;
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    renderComposite(pGeometryRenderer->shaderPool, pGeometryRenderer->meshPool.getSquare().get(), context, layers);
+  };
+  const auto expectPixel = [&](int x, int y, glm::ivec4 expected) {
+    const glm::ivec4 pixel = readPixel(x, y);
+    for (int i = 0; i < 4; ++i) EXPECT_NEAR(expected[i], pixel[i], 1) << "pixel " << x << ' ' << y << " component " << i;
+  };
+
+  EXPECT_EQ(2U, getCompositeLayerCount(CompositeMode::WIPE, 3));
+  EXPECT_EQ(0U, getCompositeLayerCount(CompositeMode::DIFFERENCE, 1));
+  EXPECT_EQ(0U, getCompositeLayerCount(CompositeMode::OVER, kMaxCompositeLayers + 1));
+
+  composite(CompositeMode::OVER);
+  expectPixel(30, 31, glm::ivec4(20, 20, 20, 255));
+  expectPixel(10, 10, glm::ivec4(0));
+  EXPECT_EQ(1U, getCompositeLayerAt(context, layers, glm::ivec2(30, 31)));
+  EXPECT_EQ(0U, getCompositeLayerAt(context, layers, glm::ivec2(10, 10)));
+
+  context.wipe = 32;
+  composite(CompositeMode::WIPE);
+  expectPixel(30, 31, glm::ivec4(0, 200, 10, 255));
+  expectPixel(32, 31, glm::ivec4(255));
+  expectPixel(33, 31, glm::ivec4(20, 20, 20, 255));
+  EXPECT_EQ(0U, getCompositeLayerAt(context, layers, glm::ivec2(30, 31)));
+  EXPECT_EQ(1U, getCompositeLayerAt(context, layers, glm::ivec2(33, 31)));
+
+  composite(CompositeMode::DIFFERENCE);
+  expectPixel(33, 32, glm::ivec4(160, 20, 10, 255));
+
+  // each track is centered in its half of the viewport
+  composite(CompositeMode::SIDE_BY_SIDE);
+  expectPixel(14, 32, glm::ivec4(0, 0, 10, 255));
+  expectPixel(46, 32, glm::ivec4(20, 20, 20, 255));
+  expectPixel(30, 32, glm::ivec4(0));
+  EXPECT_EQ(1U, getCompositeLayerAt(context, layers, glm::ivec2(46, 32)));
+  const Viewport viewport = getCompositeLayerViewport(context, 1, 2);
+  EXPECT_EQ(glm::ivec2(32, 0), viewport.offset);
+  EXPECT_EQ(glm::ivec2(32, 64), viewport.dimension);
+
+  // the rotated track spans [31, 33) x [30, 34), the first texel is at the bottom left
+  layers[1] = {&textures[2].description, &textures[2], nullptr};
+  composite(CompositeMode::OVER);
+  expectPixel(31, 30, glm::ivec4(0, 0, 10, 255));
+  expectPixel(32, 33, glm::ivec4(180, 200, 10, 255));
+
+  // zoomed out, the first track is read from its pyramid : averages of 2x2 texels over [31, 33) x [32, 33)
+  MipmapPyramid pyramid;
+  {
+    std::vector<float> linear;
+    for (const unsigned char value : first) linear.push_back(value / 255.f);
+    auto bound = pyramid.scope_bind_texture();
+    pyramid.initialize(4, 2);
+    glTexSubImage2D(pyramid.target, 0, 0, 0, 4, 2, GL_RGBA, GL_FLOAT, linear.data());
+    glGenerateMipmap(pyramid.target);
+  }
+  layers[0].pPyramid = &pyramid;
+  context.zoom = .5;
+  context.wipe = 64;
+  composite(CompositeMode::WIPE);
+  expectPixel(31, 32, glm::ivec4(30, 100, 10, 255));
+  expectPixel(32, 32, glm::ivec4(150, 100, 10, 255));
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, nativeFormatsUploadWithoutConversion) {
+  if (skipped) return;
+  // Texels keep their format and precision : reading them back gives the uploaded bytes. Whether the driver
+  // stores RGB as RGBA can't be observed this way, it is only known from GL_INTERNALFORMAT_PREFERRED, these
+  // formats are padded while decoding.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  setPaddedRgbFormats(getWidenedRgbFormats());
+  for (const int32_t glFormat : {GL_RGB16, GL_RGBA16, GL_RGB16F, GL_RGBA16F, GL_RGB32F, GL_RGBA32F}) {
+    const int preferred = getPreferredInternalFormat(glFormat);
+    EXPECT_TRUE(preferred == glFormat || getChannels(preferred).size() == 4) << getInternalFormatString(glFormat);
+    EXPECT_EQ(preferred != glFormat, isPaddedRgbFormat(glFormat)) << getInternalFormatString(glFormat);
+    ImageDescription description;
+    description.width = 3;
+    description.height = 2;
+    description.opengl_format = glFormat;
+    description.channels = getChannels(glFormat);
+    const GLenum format = getPixelFormat(glFormat);
+    const GLenum type = getPixelType(glFormat);
+    const size_t size = description.width * description.height * getBytePerPixels(format, type);
+    std::vector<unsigned char> pixels(size);
+    for (size_t i = 0; i < size; ++i) pixels[i] = i * 7;
+    if (type == GL_HALF_FLOAT) {
+      auto* pHalf = reinterpret_cast<uint16_t*>(pixels.data());
+      for (size_t i = 0; i < size / 2; ++i) pHalf[i] = 0x3C00 + i;  // 1 plus i units in the last place
+    }
+    if (type == GL_FLOAT) {
+      auto* pFloat = reinterpret_cast<float*>(pixels.data());
+      for (size_t i = 0; i < size / 4; ++i) pFloat[i] = i * 0.25f;
+    }
+    Texture texture;
+    auto bound = texture.scope_bind_texture();
+    texture.initialize(description, pixels.data());
+    std::vector<unsigned char> readback(size);
+    glGetTexImage(GL_TEXTURE_RECTANGLE, 0, format, type, readback.data());
+    EXPECT_EQ(pixels, readback) << getInternalFormatString(glFormat);
+    GLint internalFormat = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_RECTANGLE, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    EXPECT_EQ(glFormat, internalFormat) << getInternalFormatString(glFormat);
+  }
+  setPaddedRgbFormats({});
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(Headless, uploadAutotunerPicksCandidates) {
+  if (skipped) return;
+  const UploadTuning tuning = measureUploadFormats(64, 32, 3);
+  EXPECT_EQ(getDriverKey(), tuning.driver);
+  for (const int internalFormat : getTunedInternalFormats()) {
+    const auto pFound = tuning.formats.find(internalFormat);
+    ASSERT_TRUE(pFound != tuning.formats.end()) << getInternalFormatString(internalFormat);
+    const auto candidates = getUploadFormatCandidates(internalFormat);
+    EXPECT_NE(candidates.end(), std::find(candidates.begin(), candidates.end(), pFound->second));
+  }
+
+  char directory[] = "/tmp/duke_upload_tuning_XXXXXX";
+  ASSERT_TRUE(mkdtemp(directory));
+  const std::string filename = std::string(directory) + "/upload-formats";
+  UploadTuning read;
+  EXPECT_FALSE(readUploadTuning(filename, read));
+  writeUploadTuning(filename, tuning);
+  ASSERT_TRUE(readUploadTuning(filename, read));
+  EXPECT_EQ(tuning.driver, read.driver);
+  EXPECT_EQ(tuning.formats.size(), read.formats.size());
+  for (const auto& pair : tuning.formats) EXPECT_TRUE(pair.second == read.formats[pair.first]);
+  unlink(filename.c_str());
+  rmdir(directory);
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, clipShaderCacheFollowsFrameAttributes) {
+  if (skipped) return;
+  ImageDescription description = getRgba8Description(4, 4);
+  const unsigned char texel[] = {200, 100, 50, 255};
+  std::vector<unsigned char> pixels;
+  for (int i = 0; i < 16; ++i) pixels.insert(pixels.end(), std::begin(texel), std::end(texel));
+  ClipShaderCache cache;
+  context.pClipShaderCache = &cache;
+  // same stream, format and size, only the attributes differ from one frame to the next
+  for (const bool swapRedAndBlue : {false, true, false}) {
+    attribute::set<attribute::ImageSwapRedAndBlue>(description.extra_attributes, swapRedAndBlue);
+    Texture texture;
+    {
+      auto bound = texture.scope_bind_texture();
+      texture.initialize(description, pixels.data());
+    }
+    render(texture);
+    const glm::ivec4 pixel = readPixel(32, 32);
+    EXPECT_NEAR(swapRedAndBlue ? texel[2] : texel[0], pixel[0], 1);
+    EXPECT_NEAR(swapRedAndBlue ? texel[0] : texel[2], pixel[2], 1);
+  }
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, swappedUploadFormatDisplaysSameColors) {
+  if (skipped) return;
+  ImageDescription description = getRgba8Description(4, 4);
+  const unsigned char texel[] = {200, 100, 50, 255};
+  std::vector<unsigned char> pixels;
+  for (int i = 0; i < 16; ++i) pixels.insert(pixels.end(), std::begin(texel), std::end(texel));
+  // every candidate displays the texel the same way
+  for (const auto& candidate : getUploadFormatCandidates(GL_RGBA8)) {
+    setUploadFormat(GL_RGBA8, candidate);
+    Texture texture;
+    {
+      auto bound = texture.scope_bind_texture();
+      texture.initialize(description, pixels.data());
+    }
+    render(texture);
+    const glm::ivec4 pixel = readPixel(32, 32);
+    for (int i = 0; i < 4; ++i)
+      EXPECT_NEAR(texel[i], pixel[i], 1) << getPixelFormatString(candidate.pixelFormat) << ' '
+                                         << getPixelTypeString(candidate.pixelType) << " component " << i;
+  }
+  setUploadFormat(GL_RGBA8, getUploadFormatCandidates(GL_RGBA8).front());
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
+
+TEST_F(HeadlessRendering, blockCompressedProxiesDisplayLikeFrames) {
+  if (skipped) return;
+  if (!hasGlExtension("GL_EXT_texture_compression_s3tc") || !hasGlExtension("GL_ARB_texture_compression_bptc")) {
+    printf("Skipping block compression test : unsupported by the driver\n");
+    return;
+  }
+  // a solid color per block so proxies are close to the frame everywhere
+  ImageDescription description = getRgba8Description(8, 8);
+  Malloc allocator;
+  FrameData frame;
+  auto data = frame.setDescriptionAndAllocate(description, allocator);
+  for (size_t y = 0; y < 8; ++y)
+    for (size_t x = 0; x < 8; ++x) {
+      const unsigned char texel[] = {uint8_t(x < 4 ? 200 : 40), uint8_t(y < 4 ? 180 : 60), 100, 255};
+      std::copy(std::begin(texel), std::end(texel), data.begin() + (y * 8 + x) * 4);
+    }
+  const auto renderFrame = [&](const FrameData& frame) {
+    const auto& frameDescription = frame.getDescription();
+    Texture texture(getTextureTarget(frameDescription.opengl_format));
+    context.pCurrentImage = &texture.description;
+    context.pCurrentTexture = &texture;
+    auto bound = texture.scope_bind_texture();
+    texture.initialize(frameDescription, frame.getData().begin());
+    glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    renderWithBoundTexture(pGeometryRenderer->shaderPool, pGeometryRenderer->meshPool.getSquare().get(), context);
+    std::vector<unsigned char> pixels(64 * 64 * 4);
+    glReadPixels(0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+  };
+  const auto reference = renderFrame(frame);
+  for (const ProxyFormat format : {ProxyFormat::BC1, ProxyFormat::BC7}) {
+    FrameData proxy = frame;
+    encodeProxy(proxy, format, allocator);
+    EXPECT_EQ(GL_TEXTURE_2D, getTextureTarget(proxy.getDescription().opengl_format));
+    const auto pixels = renderFrame(proxy);
+    int error = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) error = std::max(error, std::abs(reference[i] - pixels[i]));
+    EXPECT_LE(error, 4) << getInternalFormatString(proxy.getDescription().opengl_format);
+  }
+  LayerDescription layer;
+  layer.fileColorspace = ColorSpace::sRGB;
+  LayerDescription compressedLayer = layer;
+  compressedLayer.compressed = true;
+  EXPECT_NO_THROW(buildProgram(
+      ShaderDescription::createCompositeDesc({compressedLayer, layer}, CompositeMode::WIPE, ColorSpace::sRGB)));
+  EXPECT_EQ(GLenum(GL_NO_ERROR), glGetError());
+}
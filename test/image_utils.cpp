@@ -1,7 +1,21 @@
+#include "duke/gl/GL.hpp"
 #include "duke/image/ImageUtils.hpp"
+#include "duke/io/ImageLoadUtils.hpp"
 
 #include <gtest/gtest.h>
 
+using namespace duke;
+
+TEST(ImageLoadUtils, PaddedRgbFormats) {
+  setPaddedRgbFormats({GL_RGB16F, GL_RGB32F});
+  EXPECT_TRUE(isPaddedRgbFormat(GL_RGB16F));
+  EXPECT_TRUE(isPaddedRgbFormat(GL_RGB32F));
+  EXPECT_FALSE(isPaddedRgbFormat(GL_RGB16));
+  EXPECT_FALSE(isPaddedRgbFormat(GL_RGBA16F));
+  setPaddedRgbFormats({});
+  EXPECT_FALSE(isPaddedRgbFormat(GL_RGB16F));
+}
+
 // TEST(ImageUtils, ChannelsByteSize) {
 //  Channels channels;
 //  EXPECT_EQ(0, getChannelsByteSize(channels));
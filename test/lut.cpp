@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include "duke/engine/Lut.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace duke;
+
+namespace {
+
+Lut parseCube(const char* pContent) {
+  std::istringstream stream(pContent);
+  return duke::parseCube(stream);
+}
+
+void expectApply(const Lut& lut, float r, float g, float b, float er, float eg, float eb) {
+  const float in[3] = {r, g, b};
+  float out[3];
+  lut.apply(in, out);
+  EXPECT_NEAR(er, out[0], 1e-5);
+  EXPECT_NEAR(eg, out[1], 1e-5);
+  EXPECT_NEAR(eb, out[2], 1e-5);
+}
+
+}  // namespace
+
+TEST(Lut, cube1d) {
+  const Lut lut = parseCube(
+      "# comment\n"
+      "TITLE \"invert\"\n"
+      "LUT_1D_SIZE 2\n"
+      "1 1 1\n"
+      "0 0 0\n");
+  EXPECT_EQ(LutType::LUT_1D, lut.type);
+  EXPECT_EQ(2, lut.size);
+  expectApply(lut, 0, 0.25, 1, 1, 0.75, 0);
+}
+
+TEST(Lut, cube3d) {
+  // identity with red and blue swapped, red varies fastest
+  const Lut lut = parseCube(
+      "LUT_3D_SIZE 2\n"
+      "DOMAIN_MIN 0 0 0\n"
+      "DOMAIN_MAX 2 2 2\n"
+      "0 0 0\n1 0 0\n0 1 0\n1 1 0\n"
+      "0 0 1\n1 0 1\n0 1 1\n1 1 1\n");
+  EXPECT_EQ(LutType::LUT_3D, lut.type);
+  EXPECT_EQ(8, lut.entries());
+  expectApply(lut, 0, 0, 0, 0, 0, 0);
+  expectApply(lut, 2, 1, 0, 1, 0.5, 0);
+  expectApply(lut, 0.5, 1, 1.5, 0.25, 0.5, 0.75);
+  // outside the domain is clamped
+  expectApply(lut, -1, 3, 2, 0, 1, 1);
+}
+
+TEST(Lut, cubeInputRange) {
+  const Lut lut = parseCube(
+      "LUT_1D_SIZE 3\n"
+      "LUT_1D_INPUT_RANGE -1 3\n"
+      "0 0 0\n0.5 0.5 0.5\n1 1 1\n");
+  EXPECT_FLOAT_EQ(-1, lut.domainMin[1]);
+  EXPECT_FLOAT_EQ(3, lut.domainMax[2]);
+  expectApply(lut, -1, 1, 2, 0, 0.5, 0.75);
+  EXPECT_NO_THROW(parseCube("LUT_3D_SIZE 2\nLUT_3D_INPUT_RANGE 0 1\n0 0 0\n1 0 0\n0 1 0\n1 1 0\n"
+                            "0 0 1\n1 0 1\n0 1 1\n1 1 1\n"));
+}
+
+TEST(Lut, compose) {
+  const Lut invert = parseCube("LUT_1D_SIZE 2\n1 1 1\n0 0 0\n");
+  const Lut screen = bakeToScreen(ColorSpace::sRGB, 256);
+  const Lut lut = compose(screen, invert);
+  EXPECT_EQ(screen.size, lut.size);
+  // on the lut's entries
+  for (const float value : {0.f, 51 / 255.f, 1.f}) {
+    const float expected = 1 - toScreen(ColorSpace::sRGB, value);
+    expectApply(lut, value, value, value, expected, expected, expected);
+  }
+  const Lut cube = parseCube("LUT_3D_SIZE 2\n0 0 0\n1 0 0\n0 1 0\n1 1 0\n0 0 1\n1 0 1\n0 1 1\n1 1 1\n");
+  EXPECT_THROW(compose(screen, cube), std::runtime_error);
+}
+
+TEST(Lut, cubeErrors) {
+  EXPECT_THROW(parseCube("0 0 0\n"), std::runtime_error);
+  EXPECT_THROW(parseCube("LUT_1D_SIZE 3\n0 0 0\n1 1 1\n"), std::runtime_error);
+  EXPECT_THROW(parseCube("LUT_3D_SIZE 2\n0 0 zero\n"), std::runtime_error);
+}
+
+TEST(Lut, spi1d) {
+  std::istringstream stream(
+      "Version 1\n"
+      "From 0 2\n"
+      "Length 3\n"
+      "Components 1\n"
+      "{\n"
+      "0\n0.25\n1\n"
+      "}\n");
+  const Lut lut = parseSpi1d(stream);
+  EXPECT_EQ(LutType::LUT_1D, lut.type);
+  EXPECT_EQ(3, lut.size);
+  expectApply(lut, 1, 0.5, 2, 0.25, 0.125, 1);
+}
+
+TEST(Lut, spi3d) {
+  std::istringstream stream(
+      "SPILUT 1.0\n"
+      "3 3\n"
+      "2 2 2\n"
+      "0 0 0 0 0 0\n0 0 1 0 0 1\n0 1 0 0 1 0\n0 1 1 0 1 1\n"
+      "1 0 0 1 0 0\n1 0 1 1 0 1\n1 1 0 1 1 0\n1 1 1 1 1 1\n");
+  const Lut lut = parseSpi3d(stream);
+  EXPECT_EQ(LutType::LUT_3D, lut.type);
+  EXPECT_EQ(2, lut.size);
+  expectApply(lut, 0.25, 0.5, 0.75, 0.25, 0.5, 0.75);
+}
+
+TEST(Lut, bakedColorSpaces) {
+  const float values[] = {0.f, 0.01f, 0.18f, 0.5f, 0.9f, 1.f};
+  float out[3];
+  for (const auto colorspace : {ColorSpace::sRGB, ColorSpace::Rec709, ColorSpace::Linear, ColorSpace::KodakLog}) {
+    const Lut lut = bakeToLinear(colorspace);
+    EXPECT_EQ(4096, lut.size);
+    for (const float value : values) {
+      const float in[3] = {value, value, value};
+      lut.apply(in, out);
+      EXPECT_NEAR(toLinear(colorspace, value), out[0], 1e-3);
+    }
+  }
+  for (const auto colorspace : {ColorSpace::sRGB, ColorSpace::Rec709, ColorSpace::Linear}) {
+    const Lut lut = bakeToScreen(colorspace);
+    for (const float value : values) {
+      const float in[3] = {value, value, value};
+      lut.apply(in, out);
+      EXPECT_NEAR(toScreen(colorspace, value), out[1], 1e-3);
+    }
+  }
+}
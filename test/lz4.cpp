@@ -0,0 +1,83 @@
+#include "duke/base/Lz4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace duke;
+
+namespace {
+
+std::vector<char> compress(const std::vector<char>& data) {
+  std::vector<char> compressed(getLz4CompressBound(data.size()));
+  compressed.resize(lz4Compress(data.data(), data.size(), compressed.data()));
+  return compressed;
+}
+
+void expectRoundTrip(const std::vector<char>& data) {
+  const auto compressed = compress(data);
+  EXPECT_LE(compressed.size(), getLz4CompressBound(data.size()));
+  std::vector<char> decompressed(data.size());
+  EXPECT_TRUE(lz4Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+  EXPECT_EQ(data, decompressed);
+}
+
+std::vector<char> getNoise(size_t size) {
+  std::mt19937 generator(size);
+  std::vector<char> data(size);
+  for (char& c : data) c = char(generator());
+  return data;
+}
+
+}  // namespace
+
+TEST(Lz4, TinyBlocks) {
+  for (size_t size = 0; size < 32; ++size) {
+    expectRoundTrip(std::vector<char>(size, 'a'));
+    expectRoundTrip(getNoise(size));
+  }
+}
+
+TEST(Lz4, RepeatedData) {
+  const std::vector<char> zeros(1 << 20, 0);
+  expectRoundTrip(zeros);
+  EXPECT_LT(compress(zeros).size(), zeros.size() / 200);
+
+  // 16 bits RGB pixels of a grey ramp
+  std::vector<uint16_t> samples(3 * 100000);
+  for (size_t i = 0; i < samples.size(); ++i) samples[i] = (i / 3) % 1024;
+  const auto* pBytes = reinterpret_cast<const char*>(samples.data());
+  const std::vector<char> ramp(pBytes, pBytes + samples.size() * sizeof(uint16_t));
+  expectRoundTrip(ramp);
+  EXPECT_LT(compress(ramp).size(), ramp.size() / 2);
+}
+
+TEST(Lz4, IncompressibleData) {
+  // long literal runs, the worst case
+  const auto noise = getNoise(300000);
+  expectRoundTrip(noise);
+  // noise then a long match far away
+  auto mixed = getNoise(70000);
+  mixed.insert(mixed.end(), mixed.begin() + 10000, mixed.begin() + 60000);
+  expectRoundTrip(mixed);
+}
+
+TEST(Lz4, MalformedBlocks) {
+  const std::string text = "abcdabcdabcdabcdabcdabcdabcdabcdabcdabcd and some more text";
+  const std::vector<char> data(text.begin(), text.end());
+  const auto compressed = compress(data);
+  std::vector<char> decompressed(data.size());
+  // wrong sizes
+  EXPECT_FALSE(lz4Decompress(compressed.data(), compressed.size(), decompressed.data(), data.size() - 1));
+  decompressed.resize(data.size() + 1);
+  EXPECT_FALSE(lz4Decompress(compressed.data(), compressed.size(), decompressed.data(), data.size() + 1));
+  // truncated
+  for (size_t size = 0; size < compressed.size(); ++size)
+    EXPECT_FALSE(lz4Decompress(compressed.data(), size, decompressed.data(), data.size()));
+  // match before the start of the block
+  const char outOfBounds[] = {0x10, 'a', 0x10, 0x00, 0x00};
+  EXPECT_FALSE(lz4Decompress(outOfBounds, sizeof(outOfBounds), decompressed.data(), 6));
+}
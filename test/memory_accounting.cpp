@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include "duke/memory/MemoryAccounting.hpp"
+
+TEST(MemoryAccounting, tag) {
+  MemoryTag tag;
+  tag.add(100);
+  tag.add(50);
+  tag.remove(100);
+  EXPECT_EQ(50UL, tag.bytes());
+  EXPECT_EQ(1UL, tag.count());
+  EXPECT_EQ(150UL, tag.peakBytes());
+  EXPECT_EQ(150UL, tag.allocatedBytes());
+  tag.set(20, 3);
+  EXPECT_EQ(20UL, tag.bytes());
+  EXPECT_EQ(3UL, tag.count());
+  EXPECT_EQ(150UL, tag.peakBytes());
+  EXPECT_EQ(150UL, tag.allocatedBytes());
+}
+
+TEST(MemoryAccounting, allocator) {
+  AccountingAllocator allocator(std::unique_ptr<Allocator>(new Malloc()), "test allocator");
+  auto &tag = MemoryAccounting::instance().tag("test allocator");
+  EXPECT_EQ(&tag, &MemoryAccounting::instance().tag("test allocator"));
+  void *pFirst = allocator.malloc(1000);
+  void *pSecond = allocator.malloc(24);
+  EXPECT_EQ(1024UL, tag.bytes());
+  EXPECT_EQ(2UL, tag.count());
+  allocator.free(pFirst);
+  allocator.free(nullptr);
+  EXPECT_EQ(24UL, tag.bytes());
+  EXPECT_EQ(1UL, tag.count());
+  EXPECT_EQ(1024UL, tag.peakBytes());
+  allocator.free(pSecond);
+  EXPECT_EQ(0UL, tag.bytes());
+
+  const auto stats = MemoryAccounting::instance().snapshot();
+  const auto json = toJson(stats);
+  EXPECT_NE(std::string::npos, json.find("\"test allocator\":{\"bytes\":0,\"count\":0,\"peak_bytes\":1024"));
+  EXPECT_NE(std::string::npos, toString(stats).find("test allocator"));
+}
+
+TEST(MemoryAccounting, slabAllocatorSizes) {
+  AccountingAllocator allocator(std::unique_ptr<Allocator>(new BigAlignedBlock()), "test slab");
+  auto &tag = MemoryAccounting::instance().tag("test slab");
+  // the block held, not the size asked
+  void *pData = allocator.malloc(1);
+  EXPECT_EQ(size_t(PAGE_SIZE), tag.bytes());
+  allocator.free(pData);
+  EXPECT_EQ(0UL, tag.bytes());
+}
+
+#include "duke/memory/RecyclingAllocator.hpp"
+TEST(MemoryAccounting, recycledBuffers) {
+  RecyclingAllocator allocator(std::unique_ptr<Allocator>(new Malloc()), 2000, "test recycled");
+  auto &tag = MemoryAccounting::instance().tag("test recycled");
+  allocator.free(allocator.malloc(1000));
+  EXPECT_EQ(1000UL, tag.bytes());
+  EXPECT_EQ(1UL, tag.count());
+  allocator.free(allocator.malloc(1000));
+  EXPECT_EQ(1UL, tag.hits());
+  EXPECT_EQ(1UL, tag.misses());
+  const auto stats = MemoryAccounting::instance().snapshot();
+  EXPECT_NE(std::string::npos, toString(stats).find("1 hits 1 misses"));
+  EXPECT_NE(std::string::npos, toJson(stats).find("\"hits\":1,\"misses\":1}"));
+  allocator.trim();
+  EXPECT_EQ(0UL, tag.bytes());
+}
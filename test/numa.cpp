@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include "duke/memory/NumaTopology.hpp"
+
+TEST(Numa, parseCpuList) {
+  EXPECT_EQ(std::vector<int>(), parseCpuList(""));
+  EXPECT_EQ(std::vector<int>({0}), parseCpuList("0\n"));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), parseCpuList("0-3,8,10-11"));
+}
+
+TEST(Numa, fallbackTopology) {
+  const auto topology = detectNumaTopology("/non/existing/sysfs");
+  ASSERT_EQ(1UL, topology.nodes.size());
+  EXPECT_FALSE(topology.isNuma());
+  EXPECT_FALSE(topology.nodes[0].cpus.empty());
+  EXPECT_EQ(-1, topology.gpuNode);
+  EXPECT_EQ(&topology.nodes[0], topology.findNode(0));
+  EXPECT_EQ(nullptr, topology.findNode(1));
+}
+
+TEST(Numa, currentMachine) {
+  const auto& topology = getNumaTopology();
+  ASSERT_FALSE(topology.nodes.empty());
+  for (const auto& node : topology.nodes) EXPECT_FALSE(node.cpus.empty());
+}
+
+#include "duke/memory/NumaAllocator.hpp"
+TEST(Numa, allocatorPools) {
+  // the calling thread runs on the second node
+  NumaTopology topology;
+  topology.nodes.push_back({0, {}});
+  topology.nodes.push_back({3, parseCpuList("0-4095")});
+  std::vector<const NumaNode *> created;
+  NumaAllocator allocator(topology, [&](const NumaNode &node) {
+    created.push_back(&node);
+    return new Malloc();
+  });
+  ASSERT_EQ(2UL, allocator.pools());
+  EXPECT_EQ(0, created[0]->id);
+  EXPECT_EQ(3, created[1]->id);
+  EXPECT_EQ(1UL, allocator.getCurrentPool());
+  EXPECT_FALSE(allocator.recordsBuffers());
+  void *pData = allocator.malloc(100);
+  EXPECT_NE(nullptr, pData);
+  allocator.free(pData);
+  allocator.free(nullptr);
+  EXPECT_EQ(0UL, allocator.allocatedSize(pData));
+}
+
+TEST(Numa, slabPoolsOwnTheirBuffers) {
+  NumaTopology topology;
+  topology.nodes.push_back({0, {}});
+  topology.nodes.push_back({3, parseCpuList("0-4095")});
+  NumaAllocator allocator(topology, [](const NumaNode &) { return new BigAlignedBlock(); });
+  void *pData = allocator.malloc(100);
+  ASSERT_NE(nullptr, pData);
+  EXPECT_TRUE(allocator.recordsBuffers());
+  EXPECT_TRUE(allocator.pool(1).owns(pData));
+  EXPECT_FALSE(allocator.pool(0).owns(pData));
+  EXPECT_EQ(size_t(PAGE_SIZE), allocator.allocatedSize(pData));
+  allocator.free(pData);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include "duke/engine/PresentationScheduler.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace duke;
+
+namespace {
+
+// Plays a timeline presenting a frame per swap.
+struct Playback {
+  Playback(double refreshRate, const FrameDuration& frameDuration)
+      : scheduler(refreshRate), frameDuration(frameDuration) {}
+
+  void swapAfter(double microseconds) {
+    time += std::chrono::microseconds(std::llround(microseconds));
+    const size_t frame = FrameIndex(BaseRational(playbackTime / frameDuration)).round();
+    shown.push_back(frame);
+    scheduler.swapped(time, {frame, true, playbackTime, frameDuration, 1});
+    playbackTime += scheduler.getAdvance();
+  }
+
+  PresentationScheduler scheduler;
+  const FrameDuration frameDuration;
+  duke_clock::time_point time;
+  Time playbackTime;
+  std::vector<size_t> shown;
+};
+
+const double k60HzUs = 1e6 / 60;
+
+}  // namespace
+
+TEST(PresentationScheduler, pulldownDespiteJitter) {
+  Playback playback(60, FrameDuration::FILM);
+  const double jitterUs[] = {0, 2000, -1500, 2500, -3000};
+  for (size_t i = 0; i < 600; ++i) playback.swapAfter(k60HzUs + jitterUs[i % 5]);
+  // 3:2 pulldown, frames alternately shown for 3 and 2 refreshes
+  std::vector<size_t> runs(1, 1);
+  for (size_t i = 1; i < playback.shown.size(); ++i) {
+    EXPECT_LE(playback.shown[i] - playback.shown[i - 1], 1u);
+    if (playback.shown[i] == playback.shown[i - 1])
+      ++runs.back();
+    else
+      runs.push_back(1);
+  }
+  for (size_t i = 2; i + 1 < runs.size(); ++i) {
+    EXPECT_EQ(5u, runs[i] + runs[i - 1]);
+    EXPECT_NE(runs[i], runs[i - 1]);
+  }
+  const auto& stats = playback.scheduler.getStats();
+  EXPECT_EQ(600u, stats.presented);
+  EXPECT_EQ(0u, stats.late);
+  EXPECT_EQ(0u, stats.repeated);
+  EXPECT_EQ(0u, stats.dropped);
+}
+
+TEST(PresentationScheduler, estimatesRefreshPeriod) {
+  Playback playback(0, FrameDuration::PAL);
+  for (size_t i = 0; i < 200; ++i) playback.swapAfter(i == 100 ? 2 * k60HzUs : k60HzUs);
+  EXPECT_NEAR(k60HzUs, playback.scheduler.getRefreshPeriod().asDouble() * 1e6, 1);
+  EXPECT_EQ(1u, playback.scheduler.getStats().late);
+}
+
+TEST(PresentationScheduler, followsTheClock) {
+  // the reported rate is off, playback stays a refresh away from the clock while the estimate settles
+  const double k50HzUs = 1e6 / 50;
+  Playback playback(60, FrameDuration::PAL);
+  playback.swapAfter(0);
+  const auto first = playback.time;
+  for (size_t i = 0; i < 3000; ++i) {
+    playback.swapAfter(i % 100 == 50 ? 2 * k50HzUs : k50HzUs);
+    const double dueUs = std::chrono::duration<double, std::micro>(playback.time - first).count() + k50HzUs;
+    ASSERT_NEAR(dueUs, playback.playbackTime.asDouble() * 1e6, k50HzUs) << "swap " << i;
+  }
+  EXPECT_NEAR(k50HzUs, playback.scheduler.getRefreshPeriod().asDouble() * 1e6, 1);
+}
+
+TEST(PresentationScheduler, accountsMissedRefreshes) {
+  {  // a frame per refresh, missing one drops a frame
+    Playback playback(50, FrameDuration(1, 50));
+    for (size_t i = 0; i < 10; ++i) playback.swapAfter(i == 5 ? 40000 : 20000);
+    const auto& stats = playback.scheduler.getStats();
+    EXPECT_EQ(1u, stats.late);
+    EXPECT_EQ(1u, stats.repeated);
+    EXPECT_EQ(1u, stats.dropped);
+  }
+  {  // frames last two refreshes, missing one only shortens a frame
+    Playback playback(50, FrameDuration::PAL);
+    for (size_t i = 0; i < 10; ++i) playback.swapAfter(i == 5 ? 40000 : 20000);
+    const auto& stats = playback.scheduler.getStats();
+    EXPECT_EQ(1u, stats.late);
+    EXPECT_EQ(0u, stats.dropped);
+  }
+  {  // paused, nothing is due
+    PresentationScheduler scheduler(50);
+    duke_clock::time_point time;
+    for (size_t i = 0; i < 10; ++i) {
+      time += std::chrono::milliseconds(i == 5 ? 60 : 20);
+      scheduler.swapped(time, {0, i != 3, Time(), FrameDuration::PAL, 0});
+    }
+    EXPECT_EQ(0u, scheduler.getStats().late);
+  }
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include "duke/base/TaskPool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace duke;
+
+TEST(TaskPool, runsAllTasks) {
+  TaskPool pool(4);
+  std::vector<int> values(1000, 0);
+  std::vector<TaskPool::Task> tasks;
+  for (size_t i = 0; i < values.size(); ++i) tasks.push_back([&values, i]() { values[i] = i; });
+  pool.run(tasks);
+  for (size_t i = 0; i < values.size(); ++i) EXPECT_EQ(i, values[i]);
+}
+
+TEST(TaskPool, nestedRun) {
+  TaskPool pool(2);
+  std::atomic<int> count(0);
+  std::vector<TaskPool::Task> tasks;
+  for (size_t i = 0; i < 8; ++i)
+    tasks.push_back([&]() {
+      std::vector<TaskPool::Task> subtasks(8, [&count]() { ++count; });
+      pool.run(subtasks);
+    });
+  pool.run(tasks);
+  EXPECT_EQ(64, count);
+}
+
+TEST(TaskPool, propagatesException) {
+  TaskPool pool(2);
+  std::atomic<int> count(0);
+  std::vector<TaskPool::Task> tasks(16, [&count]() { ++count; });
+  tasks.push_back([]() { throw std::runtime_error("failed"); });
+  EXPECT_THROW(pool.run(tasks), std::runtime_error);
+  EXPECT_EQ(16, count);
+}